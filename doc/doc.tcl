@@ -14,7 +14,8 @@ namespace eval iocp {
 
         The extension includes the following packages:
 
-        * The `iocp_inet` package implements communication channels over TCP/IP.
+        * The `iocp_inet` package implements communication channels over TCP/IP
+        and AF_UNIX stream sockets.
 
         * The `iocp_bt` package implements Bluetooth channels (currently client-only)
         along with supporting commands for device and service discovery.
@@ -29,6 +30,164 @@ namespace eval iocp {
         The source code is available from the Github
         [repository](https://github.com/apnadkarni/iocp).
     }
+
+    # Dummy procs to document C commands
+
+    proc configure {args} {
+        # Sets or retrieves settings for the current thread.
+        #  -busypoll MICROSECONDS - time to poll for ready channels before
+        #    the event loop blocks
+        #  -completionport shared|thread - whether I/O for channels created
+        #    in the thread completes on the shared completion port or on a
+        #    port owned by the thread
+        #
+        # If called with a single option name, returns the value of that
+        # option. Otherwise sets the specified options, if any, and returns
+        # a dictionary containing all settings.
+        #
+        # By default, a thread waiting in the event loop sleeps until a
+        # channel becomes ready and is woken by the completion thread.
+        # For threads dedicated to latency sensitive traffic, the
+        # `-busypoll` option makes the event loop poll the thread's ready
+        # queue for up to MICROSECONDS each time before it would sleep,
+        # avoiding the wake up latency at the cost of CPU. MICROSECONDS
+        # must be between `0` and `1000`. Polling stops early when another
+        # thread posts an event to the thread, for example with
+        # `thread::send`, or a window message arrives. However, Tcl does not
+        # make the wait required by other event sources available, so
+        # timers created with `after` may be delayed by up to MICROSECONDS
+        # every time the event loop polls without finding a ready channel.
+        # Busy polling is not done on single processor systems. A value of
+        # `0` (default) disables busy polling.
+        #
+        # The `BusyPollHits` and `BusyPollMisses` counters returned by
+        # `iocp::stats` give the number of polls that did and did not find
+        # a ready channel.
+        #
+        # By default the completions for all channels in the process are
+        # processed by a single completion thread, which then hands the
+        # channel to the owning Tcl thread. Setting `-completionport` to
+        # `thread` gives the current thread a completion port of its own,
+        # serviced by a completion thread of its own, which is used for
+        # all channels subsequently created in the thread. Completions
+        # for these channels then do not queue behind those of other
+        # threads, and the completion thread is preferably scheduled on
+        # the processor the Tcl thread was running on when the option was
+        # set. Connections accepted by a listening socket use the port of
+        # the listening socket. The setting cannot be changed back to
+        # `shared`. Channels already created, or transferred from another
+        # thread, continue to use the port they were created with. The
+        # two channels passed to [splice] must use the same port. Sockets
+        # on a per-thread port are not kept in the socket cache. When the
+        # thread exits its port is reused by the next thread that sets
+        # `-completionport` to `thread`.
+        #
+        # The `ThreadPortCompletions` counter returned by `iocp::stats`
+        # gives the number of completions processed on per-thread ports.
+    }
+
+    proc dispatch {{budget {}}} {
+        # Controls how channel events are dispatched in the current thread.
+        #   budget - maximum number of ready channels to notify in each pass
+        #     of the event loop
+        #
+        # By default a Tcl event is queued for each channel that becomes
+        # ready and the channel is notified when the event loop services
+        # that event. If $budget is a positive integer, up to that many
+        # ready channels are notified directly when the event loop checks
+        # for events, saving the allocation and queueing of an event for
+        # each. Any remaining ready channels are notified in following
+        # passes of the event loop so that timers and other events are
+        # not held up. A $budget of `0` restores the default.
+        #
+        # Returns the budget in effect.
+    }
+
+    proc schedule {args} {
+        # Sets fairness budgets for the channels of the current thread.
+        #  -bytes MAXBYTES - maximum number of bytes read from a channel in
+        #    each pass of the event loop
+        #  -callbacks MAXCALLBACKS - maximum number of ready channels
+        #    notified in each pass of the event loop
+        #
+        # A single connection receiving a bulk transfer can otherwise
+        # keep the event loop busy and delay the handlers of other,
+        # interactive connections. Once a non-blocking channel has had
+        # MAXBYTES read from it in a pass, it reports no further data
+        # until the next pass, as though no more data had arrived, and is
+        # notified again then. Ready channels beyond MAXCALLBACKS are left
+        # for the next pass. Within a pass, channels are notified in the
+        # order of their `-priority` socket option. A value of `0`
+        # (default) means no limit. Blocking reads are not limited.
+        #
+        # Returns a dictionary with the settings in effect.
+    }
+
+    proc spin {{maxmicroseconds {}}} {
+        # Controls spinning in blocking channel operations.
+        #   maxmicroseconds - maximum time in microseconds to spin waiting
+        #     for an I/O operation to complete
+        #
+        # By default, a blocking read or write that has to wait for an I/O
+        # operation puts the thread to sleep until the operation completes.
+        # On low latency networks the completion often follows within a
+        # few microseconds and the context switch dominates the cost of
+        # the wait. If $maxmicroseconds is a positive integer, the thread
+        # first spins for up to that long before sleeping. The actual time
+        # spent spinning adapts to the recent waits on each channel. The
+        # setting applies to all threads in the process and is ignored on
+        # single processor systems. A value of `0` restores the default.
+        #
+        # The `SpinHits` and `SpinMisses` counters returned by `iocp::stats`
+        # give the number of waits that did and did not complete while
+        # spinning.
+        #
+        # Returns the maximum in effect.
+    }
+
+    proc watch {chan {events {}}} {
+        # Registers a channel for readiness notification through [poll].
+        #   chan - a channel created by the `iocp` package
+        #   events - list containing `readable` and/or `writable`. An empty
+        #     list unregisters the channel.
+        #
+        # While registered, the channel is placed on a queue for the
+        # current thread when it may have become readable or writable and
+        # is reported by [poll] instead of through the Tcl event loop.
+        # File event handlers for the channel are not invoked while it is
+        # registered. The registration is removed if the channel is
+        # transferred to another thread. Listening sockets cannot be
+        # registered.
+        #
+        # If $events is not specified, the command returns the currently
+        # registered events. Otherwise it returns an empty string.
+    }
+
+    proc poll {args} {
+        # Returns the channels registered with [watch] that are ready for I/O.
+        #   -max COUNT - maximum number of channels to return. Defaults to
+        #     `0` which places no limit.
+        #   -timeout MS - number of milliseconds to wait if no channels are
+        #     ready. Defaults to `0` which returns immediately. A negative
+        #     value waits indefinitely.
+        #
+        # The return value is a list of pairs, each containing the name of a
+        # channel and a list of `readable` and `writable` indicating the
+        # ready events. This provides a batch interface similar to
+        # `epoll_wait` for servers that process many connections in a
+        # loop or coroutine without the overhead of a file event script
+        # invocation for each ready channel.
+        #
+        # As for file events, a channel is reported as readable while input
+        # data or end of file is available and as writable only once each
+        # time writes complete. A non-blocking channel should be read
+        # until no more data is available, or the channel will be reported
+        # again by the next call.
+        #
+        # The command does not run the Tcl event loop. Other event sources,
+        # including file events on channels that are not registered, are
+        # not serviced while the command waits.
+    }
 }
 
 namespace eval iocp::inet {
@@ -55,24 +214,180 @@ namespace eval iocp::inet {
         # [socket](http://www.tcl-lang.org/man/tcl8.6/TclCmd/socket.htm)
         # command for details.
         #
-        # The only functional enhancement offered by this command is
+        # The primary enhancement offered by this command is
         # significantly improved performance with reduced CPU load.
         #
+        # Client sockets additionally accept the following options to
+        # reduce the latency of the first request on a new connection.
+        #
+        #  -initialdata DATA - Binary data to send as part of establishing
+        #    the connection. Any data written to the channel follows it.
+        #    Limited to 65536 bytes.
+        #  -fastopen - Enables TCP Fast Open so that the initial data can
+        #    be carried in the SYN packet itself.
+        #
+        # With `-async`, the initial data is passed to the system along
+        # with the connection request and is sent as soon as the connection
+        # is established without waiting for the application to write it.
+        # With `-fastopen`, it may be sent even before, saving a full round
+        # trip on repeat connections to a server. Fast Open requires support
+        # from the operating system on both ends and is silently not used
+        # otherwise. It has no effect on synchronous connections where the
+        # initial data is simply written once the connection completes.
+        #
         # In addition to the standard configuration options supported
         # by the Tcl `socket` command, the following additional configuration
         # options are supported through the Tcl `fconfigure` and
         # `chan configure` commands. They can be read as well as set.
         #
+        #  -acceptrange {MIN MAX} - Bounds within which the number of pending
+        #    accepts is adapted to the connection rate (listening socket
+        #    only). See below.
+        #  -acceptreceive COUNT - Number of bytes to receive along with each
+        #    accepted connection (listening socket only). See below.
+        #  -compress SPEC - Compresses all data sent and received (client
+        #    socket only). See below.
+        #  -compressstats - Byte counts before and after compression (client
+        #    socket only). Read-only.
+        #  -framing SPEC - Enables length-prefixed message framing (client
+        #    socket only). See [readmsg].
         #  -keepalive BOOL - Controls the socket `SO_KEEPALIVE` option.
-        #  -maxpendingaccepts COUNT - Maximum number of pending accepts to post
-        #    on the socket (listening socket only).
+        #  -maxpendingaccepts COUNT - Number of pending accepts currently
+        #    posted on the socket (listening socket only). Setting it fixes
+        #    the number, disabling adaptation.
         #  -maxpendingreads COUNT - Maximum number of pending reads to post
         #    on the socket.
         #  -maxpendingwrites COUNT - Maximum number of pending writes to post
         #    on the socket.
         #  -nagle BOOL - Controls the socket `TCL_NODELAY` option
+        #  -priority PRIORITY - Order in which the socket is notified
+        #    relative to other ready channels, `high`, `normal` (default) or
+        #    `low`. See [schedule].
+        #  -ratelimit LIMITS - Limits the rate of data transfer (client
+        #    socket only). See below.
+        #  -rcvlowat COUNT - Only generate `readable` events when at least
+        #    COUNT bytes have been received (client socket only). See below.
+        #  -readdelimiter DELIM - Only generate `readable` events when a
+        #    complete record ending in DELIM has been received (client
+        #    socket only). See below.
+        #  -readrecords - Number of complete records received but not yet
+        #    read into the channel buffers (client socket only). Read-only.
         #  -sorcvbuf BUFSIZE - Size of Winsock socket receive buffer.
         #  -sosndbuf BUFSIZE - Size of Winsock socket send buffer.
+        #  -tls SPEC - Enables TLS on a connected socket (client socket
+        #    only). See below.
+        #  -tlsstatus - State of the TLS session of the socket (client
+        #    socket only). Read-only.
+        #
+        # The `-acceptreceive` option defaults to `0`. When set to a positive
+        # value, a connection is only passed to the accept callback once the
+        # client has sent some data (up to COUNT bytes) or closed the
+        # connection, and that data is already queued on the new channel.
+        # This saves a read round trip for request/response protocols like
+        # HTTP where the client sends first. It must not be used for
+        # protocols where the server sends first. Note that clients that
+        # connect without sending occupy one of the `-maxpendingaccepts`
+        # accept slots until they do.
+        #
+        # The `-readdelimiter` option defaults to the empty string. It may
+        # be set to one or two ASCII characters, for example `\n` or `\r\n`
+        # for line oriented protocols. Received data is then scanned for
+        # the delimiter as it arrives and `readable` file events are only
+        # generated once a complete record is available, at end of file,
+        # on errors, or if more than 1MB has been received without a
+        # delimiter. A `gets` based handler is then not invoked only to find
+        # a partial line. The delimiter does not otherwise affect reading
+        # and is independent of the `-translation` option.
+        #
+        # The `-rcvlowat` option defaults to `1`. Setting it to a larger
+        # value, up to 1MB, suppresses `readable` events until that many
+        # bytes have been received, or at end of file or on errors, so that
+        # an application reading in large blocks is not woken for every
+        # network receive. Unlike the `SO_RCVLOWAT` socket option, which
+        # Winsock does not support, it only applies to file events and not
+        # to blocking reads. It is ignored if `-framing` or
+        # `-readdelimiter` is set.
+        #
+        # The `-ratelimit` option value is a dictionary with the optional
+        # keys `read`, `write` and `burst`, and defaults to the empty
+        # string, meaning no limits. The value of `read` and `write` is
+        # either the maximum number of bytes per second to receive or send
+        # respectively, or the name of a rate limiter returned by
+        # [ratelimit] to share a limit with other channels. The `burst`
+        # key specifies how many bytes may be transferred at once after
+        # the channel has been idle. It only applies to rates given as
+        # numbers and defaults to a tenth of the rate. The limits are
+        # enforced by holding back reads from the network and writes from
+        # the channel. Data written to a socket that is the target of
+        # [splice] or [sendfile] is not limited. Limit the source instead.
+        #
+        # The `-tls` option encrypts the connection with TLS using the
+        # Windows Schannel library. Unlike stacking a TLS channel on the
+        # socket, records are encrypted and decrypted inside the socket
+        # channel, with decryption done as data is received. The option
+        # value is a dictionary with the following keys:
+        #   role - `client` (default) or `server`.
+        #   servername - the name of the server. Used for the TLS server
+        #     name indication and certificate verification (client only).
+        #   verify - boolean indicating whether the server certificate is
+        #     verified against the system certificate store. Defaults to
+        #     `1`, in which case `servername` must be specified (client
+        #     only).
+        #   certificate - path to a PFX (PKCS #12) file containing the
+        #     server certificate and private key (server only, required).
+        #   password - password for the certificate file (server only).
+        # The option can only be set once, on a connected socket that is not
+        # the source or target of a [splice]. For servers, it is typically
+        # set from the accept callback. Any data already received, including
+        # data read into the channel buffers by a previous [gets] or [read],
+        # is treated as part of the handshake, so the channel should be in
+        # binary mode. The handshake proceeds in the background.
+        # Writes are held back until it completes. A failed handshake,
+        # including one that fails on data received before the option was
+        # set, is reported as an error on the next read or write and not
+        # by the fconfigure call. TLS remains enabled on the channel, which
+        # can then only be closed. Reading the `-tls` option returns the
+        # configuration less any password. The `-tlsstatus` option returns
+        # a dictionary whose `state` key is one of
+        # `none`, `handshake`, `open`, `closed` (the peer has closed the
+        # session) or `failed`. When available, the `protocol` key holds the
+        # negotiated protocol version and the `error` key the reason for a
+        # failure. Closing the channel or half-closing it for writing sends
+        # a TLS close notification to the peer. [splice], [sendfile] and
+        # [writemsg] are not supported on TLS sockets.
+        #
+        # The `-compress` option value is a compression format, one of
+        # `deflate`, `gzip` or `zlib`, optionally followed by the key `level`
+        # and a compression level between `0` and `9`, e.g. `{deflate level
+        # 1}`. Once set, all data written to the socket is compressed and
+        # all data received is decompressed using the Tcl zlib library, so
+        # the peer must use the same format. Decompression is done as data
+        # is received so `readable` events, `-framing` and `-readdelimiter`
+        # only see the decompressed data. Data written is compressed each
+        # time the channel buffer is flushed, ending with a zlib sync flush
+        # so the peer can decompress all data written so far. Fewer, larger
+        # flushes, e.g. with `-buffering full` and a larger `-buffersize`,
+        # improve the compression ratio. Closing the channel or half-closing
+        # it for writing terminates the compressed stream. End of the peer's
+        # compressed stream is treated as end of file. The option is
+        # typically set at a protocol defined point before the peer sends
+        # compressed data and cannot be unset or combined with `-tls`.
+        # The `-compressstats` option returns a dictionary with the keys
+        # `bytesin` and `wirein`, the number of bytes received after and
+        # before decompression, and `bytesout` and `wireout`, the number of
+        # bytes written before and after compression. [splice] and
+        # [sendfile] are not supported on compressed sockets.
+        #
+        # Listening sockets start with 5 pending accepts. When all of them
+        # are consumed before they can be replaced, the number is doubled
+        # up to the `-acceptrange` maximum. It is halved, down to the
+        # minimum, after an interval of about a second in which fewer
+        # connections were accepted than were posted. Accepts already posted
+        # beyond a reduced number are not cancelled but are not replaced
+        # as connections use them up. The default range is
+        # `{2 64}`. Reading `-maxpendingaccepts` returns the currently chosen
+        # number. Setting `-acceptrange` again, for example after having set
+        # `-maxpendingaccepts`, reenables adaptation.
         #
         # It is recommended these be left at their default values except
         # in cases where performance needs to be fine tuned for specific
@@ -82,6 +397,583 @@ namespace eval iocp::inet {
         # The returned channel must be closed with the Tcl `close`
         # or `chan close` command.
     }
+
+    proc sendfile {chan path args} {
+        # Sends the contents of a file over a TCP socket.
+        #   chan - a TCP client channel returned by `socket`
+        #   path - path of the file to send
+        #   -command CMDPREFIX - if specified, the command returns
+        #     immediately and the command prefix is invoked on completion.
+        #   -header DATA - binary data to send before the file content.
+        #   -length COUNT - maximum number of bytes of the file to send.
+        #     Defaults to the remainder of the file.
+        #   -offset OFFSET - offset in the file at which to start sending.
+        #     Defaults to `0`.
+        #   -trailer DATA - binary data to send after the file content.
+        #
+        # The file data is sent directly from the operating system file cache
+        # using the Windows `TransmitFile` function without being copied
+        # through Tcl channel buffers. Any output buffered in the channel
+        # is flushed before the file is sent. An error is raised if a
+        # non-blocking channel cannot be flushed immediately.
+        #
+        # Without the `-command` option, the command returns the total number
+        # of bytes sent, including the header and trailer, after the
+        # transmission completes. With the `-command` option, the command
+        # returns an empty string and the transmission continues in the
+        # background. On completion, the command prefix is invoked from the
+        # event loop with the number of bytes sent as an additional argument.
+        # If the transmission failed, an error message is appended as a
+        # second argument. The callback is not invoked if the channel
+        # is closed before the transmission completes.
+        #
+        # The application should not write to the channel until the
+        # transmission completes.
+        #
+        # As with `puts`, the data is sent as is. No message header is added
+        # for the `-framing` option of the channel, so it must be passed with
+        # `-header` if required. The channel's `-ratelimit` write limit is not
+        # applied to the transfer. The command fails on channels with the
+        # `-tls` or `-compress` options set.
+        #
+        # A single call can send at most 2147483646 bytes of file data.
+    }
+
+    proc broadcast {data chans} {
+        # Writes the same data to multiple TCP sockets.
+        #   data - binary data to write
+        #   chans - list of TCP client channels returned by `socket`
+        #
+        # The data is copied once into a single reference counted block that
+        # is written to every channel without passing through the Tcl
+        # channel buffers. The block is freed when the last write
+        # completes. This is more efficient than writing the data to each
+        # channel with `puts` when fanning out to a large number of
+        # connections.
+        #
+        # A channel is skipped, and the data not written to it, if it
+        # already has the number of writes outstanding configured with
+        # `-maxpendingwrites`, is held back by its `-ratelimit` setting, is no
+        # longer connected, or has output buffered in the channel that
+        # cannot be flushed immediately. The application can use this to
+        # drop or defer messages for slow receivers instead of buffering
+        # without bound.
+        #
+        # An error is raised without writing any data if any of the channels
+        # is not a TCP client socket, was not opened for writing, has the
+        # `-tls` or `-compress` options set, or is the target of a [splice].
+        #
+        # Returns the list of channels that were skipped.
+    }
+
+    proc splice {from to args} {
+        # Forwards data received on one channel to another.
+        #   from - channel from which data is read
+        #   to - channel to which data is written
+        #   -bidirectional - data is forwarded in both directions.
+        #   -command CMDPREFIX - command prefix to invoke when the splice
+        #     ends.
+        #
+        # Once the splice is set up, data received on $from is written to
+        # $to directly from the I/O completion thread, reusing the receive
+        # buffers. The data is not copied through Tcl channel buffers and
+        # the event loop is not involved. Reads on $from are suspended while
+        # $to has the maximum number of writes outstanding so a slow
+        # receiver does not result in unbounded memory use.
+        #
+        # Both channels must be channels created by the `iocp` package that
+        # support splicing, currently TCP and Bluetooth client sockets, and
+        # use the same completion port (see [configure]). They are placed
+        # in binary mode. Any data already buffered in $from is
+        # written to $to before the command returns.
+        #
+        # The command always returns immediately. The splice in each direction
+        # ends when the source channel reaches end of file or an error occurs on
+        # either channel. The command prefix, if specified, is then invoked from
+        # the event loop with the source and target channels and the number of
+        # bytes forwarded as additional arguments. If the splice ended because
+        # of an error, an error message is appended as a fourth argument.
+        # With `-bidirectional`, the callback is invoked once for each
+        # direction. The end of file condition on the source is left
+        # in place so it is also visible to any `read` or `fileevent` handler
+        # on the channel.
+        #
+        # The application should neither read from $from nor write to $to
+        # while the splice is active. Closing either channel ends the splice.
+        # The callback is not invoked for a splice whose source is closed.
+    }
+
+    proc socketcache {{maxsockets {}}} {
+        # Configures the process-wide cache of recycled sockets.
+        #   maxsockets - maximum number of sockets to hold in the cache for
+        #     each address family and connection direction. `0` disables
+        #     the cache.
+        #
+        # When the cache is enabled, closing a TCP connection disconnects the
+        # socket with `DisconnectEx` so the underlying socket handle can be
+        # reused instead of being closed. New connections accepted by
+        # server sockets and asynchronous (`-async`) outbound connections
+        # then draw from the cache before creating new sockets. This
+        # reduces the cost of connection setup for services with high
+        # connection churn.
+        #
+        # Only outbound connections that do not specify `-myaddr` or
+        # `-myport` use recycled sockets. Sockets whose `-keepalive`,
+        # `-nagle`, `-sorcvbuf` or `-sosndbuf` options were changed are
+        # not recycled. Note that when the local end closes the connection
+        # first, Windows only recycles the socket after the TCP TIME_WAIT
+        # interval.
+        #
+        # The cache is disabled by default. The number of cache hits and misses
+        # and the number of sockets returned to the cache are reported by
+        # `iocp::stats` as `SocketCacheHits`, `SocketCacheMisses` and
+        # `SocketCachePuts`.
+        #
+        # Returns the limit in effect before the call.
+    }
+
+    proc pool {subcommand args} {
+        # Manages pools of reusable outbound TCP connections.
+        #   subcommand - one of the subcommands described below.
+        #   args - subcommand dependent arguments.
+        #
+        # Request/response style clients that repeatedly connect to the
+        # same servers can use a connection pool to avoid the cost of
+        # name resolution, socket creation and the TCP handshake on
+        # every request. The command takes the following forms.
+        #
+        #     pool create ?-idletimeout MS? ?-maxidle COUNT? ?-maxperendpoint COUNT? ?-myaddr ADDR?
+        #
+        # Creates a new pool and returns its name. The `-idletimeout` option
+        # specifies the number of milliseconds after which an idle connection
+        # is closed instead of being reused (default 60000, `0` for no limit).
+        # The `-maxidle` option limits the number of idle connections
+        # retained for each endpoint (default 8). The `-maxperendpoint`
+        # option limits the number of connections, idle or in use, to each
+        # endpoint (default 16). The `-myaddr` option has the same meaning
+        # as for the `socket` command.
+        #
+        #     pool acquire POOL HOST PORT
+        #
+        # Returns a connected channel to the specified endpoint. An idle
+        # connection is reused if one is available. Idle connections that
+        # have been closed or reset by the remote end, or have unread data
+        # pending, are discarded. A new blocking connection is opened if no
+        # idle connection is usable. An error is raised if the
+        # `-maxperendpoint` limit would be exceeded.
+        #
+        #     pool release POOL CHAN ?-discard?
+        #
+        # Returns a channel obtained with `pool acquire` to the pool. Any
+        # pending output is flushed and channel options changed with
+        # `fconfigure`, such as `-blocking`, `-translation`, `-framing` or
+        # `-ratelimit`, are reset to their values when the connection was
+        # opened. The `-tls` and `-compress` options, which cannot be turned
+        # off, are retained so applications using them should not share the
+        # pool with those that do not. The channel is closed instead
+        # if `-discard` is specified, if it is no longer usable or if the
+        # endpoint already has `-maxidle` idle connections. In all cases
+        # the channel name is no longer valid in the interpreter after
+        # the call. Applications must not release a channel on which a
+        # response is still expected.
+        #
+        # Pooled channels may also be closed directly with `close` in which
+        # case they are simply removed from the pool.
+        #
+        #     pool stats POOL
+        #
+        # Returns a dictionary of pool statistics. The keys `acquires`,
+        # `releases`, `hits` (idle connections reused), `misses` (new
+        # connections opened), `evictions` (unusable idle connections
+        # closed), `expirations` (idle connections closed due to timeout),
+        # `discards` (released connections closed) and `limitfailures`
+        # contain counts. The `endpoints` key contains a nested dictionary
+        # keyed by `HOST PORT` with per-endpoint `active`, `idle`,
+        # `connects` and `reuses` counts.
+        #
+        #     pool destroy POOL
+        #
+        # Destroys the pool closing all idle connections. Channels that
+        # have been acquired and not released remain open and must be
+        # closed by the application.
+    }
+
+    proc ratelimit {subcommand args} {
+        # Manages rate limiters shared between sockets.
+        #   subcommand - one of the subcommands described below.
+        #   args - subcommand dependent arguments.
+        #
+        # A rate limiter is a token bucket that caps the aggregate rate
+        # of all sockets whose `-ratelimit` option refers to it, for
+        # example to limit the total bandwidth used by one client of a
+        # server. Limiter names are local to the interpreter that created
+        # them. Sockets transferred to another thread keep their limiter.
+        # The command takes the following forms.
+        #
+        #     ratelimit create RATE ?BURST?
+        #
+        # Creates a rate limiter allowing RATE bytes per second and returns
+        # its name. BURST is the number of bytes that may be transferred
+        # at once after the sockets have been idle. It defaults to a tenth
+        # of RATE.
+        #
+        #     ratelimit configure LIMITER RATE ?BURST?
+        #
+        # Changes the rate and burst size of the limiter.
+        #
+        #     ratelimit stats LIMITER
+        #
+        # Returns a dictionary with the keys `rate`, `burst`, `tokens`
+        # (bytes that may currently be transferred, negative if the rate
+        # has been exceeded), `bytes` (total bytes transferred) and
+        # `throttles` (number of times transfers were held back).
+        #
+        #     ratelimit destroy LIMITER
+        #
+        # Deletes the limiter name. Sockets using the limiter continue to
+        # do so until they are closed or their `-ratelimit` option is
+        # changed.
+    }
+
+    proc udp {args} {
+        # Returns a channel for a UDP socket.
+        #   -family FAMILY - `inet` (default) or `inet6`.
+        #   -myaddr ADDR - local address to bind to. Defaults to the
+        #     wildcard address.
+        #   -myport PORT - local port to bind to. Defaults to a port
+        #     chosen by the system.
+        #   -reuseaddr - sets the `SO_REUSEADDR` socket option before
+        #     binding, for example to allow several sockets to receive
+        #     on the same multicast port.
+        #
+        # The channel is in binary mode. Several receives are kept posted
+        # on the socket so that datagrams arriving in bursts are not
+        # dropped while the application is busy. Reading the channel with
+        # the Tcl `read` command returns datagram payloads without their
+        # boundaries or source addresses. The `recvmany` and `sendmany`
+        # commands should be used instead when these are needed.
+        #
+        # Data written to the channel with `puts` is sent to the address
+        # configured with the `-remote` option. Each flush of the channel
+        # sends one datagram so the channel should be configured with
+        # `-buffering none` or `-buffering full` with explicit flushes.
+        #
+        # The following options may be set or retrieved with `fconfigure`
+        # (or `chan configure`) in addition to the standard channel options.
+        #
+        # -broadcast BOOL - controls sending of broadcast datagrams.
+        # -maxdatagram COUNT - size of the receive buffers (default 8192).
+        #   Longer datagrams are truncated.
+        # -maxpendingreads COUNT - number of receives kept posted
+        #   (default 8).
+        # -maxpendingwrites COUNT - limit on sends outstanding from
+        #   channel writes (default 64).
+        # -mcastadd {GROUP ?INTERFACE?} - joins a multicast group.
+        #   INTERFACE is a local IPv4 address or an IPv6 interface index.
+        #   Write only.
+        # -mcastdrop {GROUP ?INTERFACE?} - leaves a multicast group.
+        #   Write only.
+        # -mcastloop BOOL - controls loopback of sent multicast datagrams.
+        # -mcastttl COUNT - time-to-live (hop limit) for multicast datagrams.
+        # -remote {HOST PORT} - default destination for datagrams. An empty
+        #   list clears the default.
+        # -sockname - returns the local address and port. Read only.
+        # -sorcvbuf COUNT, -sosndbuf COUNT - socket buffer sizes.
+        #
+        # The returned channel must be closed with the Tcl `close`
+        # or `chan close` command.
+    }
+
+    proc recvmany {chan {maxcount {}}} {
+        # Returns datagrams received on a UDP socket.
+        #   chan - a channel returned by `udp`
+        #   maxcount - maximum number of datagrams to return. Defaults
+        #     to all received datagrams.
+        #
+        # The command does not block. It returns a list, possibly empty, of
+        # the datagrams already received on the socket, each element being a
+        # list containing the payload and the numeric address and port of the
+        # sender. Retrieving a batch of datagrams in a single call from a
+        # `readable` file event handler is much cheaper than one `read` per
+        # datagram at high packet rates.
+        #
+        # An error is raised only if the first queued receive failed. Errors
+        # following received datagrams are reported on the next call.
+    }
+
+    proc sendmany {chan datagrams} {
+        # Sends datagrams on a UDP socket.
+        #   chan - a channel returned by `udp`
+        #   datagrams - list of datagrams to send
+        #
+        # Each element of $datagrams is a list containing the payload and
+        # optionally the destination host and port. Datagrams without a
+        # destination are sent to the address set with the `-remote` option.
+        # The sends are queued in a single call without regard to the
+        # `-maxpendingwrites` limit and complete in the background.
+        #
+        # Returns the number of datagrams queued.
+    }
+
+    proc readmsg {chan {varname {}}} {
+        # Reads a message from a socket with message framing enabled.
+        #   chan - a client socket with the `-framing` option set
+        #   varname - name of a variable in which to store the message
+        #
+        # The `-framing` option for client sockets treats the received
+        # byte stream as a sequence of messages, each preceded by a header
+        # containing the length of the message. The option value is either
+        # the empty string, the default, which disables framing, or a list
+        # of the form
+        #
+        #     length SIZE ?ORDER? ?MAXLENGTH?
+        #
+        # SIZE is the size of the length header in bytes and may be `1`,
+        # `2` or `4`. ORDER is `big` (default) or `little` and specifies
+        # the byte order of the header. Messages longer than MAXLENGTH
+        # (default 16MB) are rejected. The length in the header does not
+        # include the header itself.
+        #
+        # When framing is enabled, `readable` file events are only
+        # generated once a complete message has been received, or on end of
+        # file or error. This avoids script level parsing and repeated
+        # callbacks for partially received messages.
+        #
+        # The command returns the next message without its header. On a
+        # blocking channel, the command waits for a complete message. If a
+        # complete message is not available, because the channel is
+        # non-blocking or at end of file, the empty string is returned and
+        # `eof` can be used to distinguish the two. If $varname is
+        # specified, the message is stored in the variable and the command
+        # returns the length of the message, or `-1` if none was available.
+        #
+        # An error is raised if the connection is closed in the middle of a
+        # message or a message exceeds the maximum length.
+        #
+        # Messages are read directly from the socket, bypassing the
+        # channel's buffering and translation. The command raises an error
+        # if data has been read into the channel buffers with `read` or
+        # `gets` so the two should not be mixed.
+    }
+
+    proc writemsg {chan message args} {
+        # Writes messages to a socket with message framing enabled.
+        #   chan - a client socket with the `-framing` option set
+        #   message - binary message to write
+        #   args - additional messages to write
+        #
+        # Each message is preceded with a length header as specified by the
+        # `-framing` option of the channel (see [readmsg]). All messages are
+        # queued in a single write, without regard to the
+        # `-maxpendingwrites` limit. Any data already written to the
+        # channel with `puts` is flushed first.
+    }
+}
+
+namespace eval iocp::unix {
+    variable _ruff_preamble {
+        The `iocp::unix` namespace implements communication over AF_UNIX
+        stream sockets which are available in Windows 10 version 1803 and
+        later. These avoid the overhead of the TCP/IP stack for
+        communication between processes on the same system.
+
+        The commands are part of the `iocp_inet` package which is loaded as
+
+            package require iocp_inet
+    }
+
+    proc socket args {
+        # Returns a client or server AF_UNIX stream channel.
+        #   args - see below
+        #
+        # The command takes the forms
+        #
+        #     socket PATH
+        #     socket -server CMDPREFIX PATH
+        #
+        # The first form connects to a server listening on the socket file
+        # PATH. The connection is made synchronously.
+        #
+        # The second form creates a listening socket bound to PATH. The file
+        # must not already exist. It is deleted when the listening channel
+        # is closed. As for the Tcl `socket` command, CMDPREFIX is invoked
+        # for every accepted connection with the new channel, the client
+        # address and port as additional arguments. The address is
+        # the client's socket path, generally empty since clients
+        # are not bound to a path, and the port is always `0`.
+        #
+        # PATH must be less than 108 bytes long in the system encoding.
+        #
+        # The channels support the same configuration options as TCP
+        # channels returned by [::iocp::inet::socket] other than the
+        # TCP-specific `-keepalive` and `-nagle` options. The `-peername`
+        # and `-sockname` options return the socket path.
+        #
+        # The returned channel must be closed with the Tcl `close`
+        # or `chan close` command.
+    }
+}
+
+namespace eval iocp::pipe {
+    variable _ruff_preamble {
+        The `iocp::pipe` namespace implements channels over Windows named
+        pipes. Unlike the pipe channels built into Tcl, which use a helper
+        thread per pipe, these use overlapped I/O through the same I/O
+        completion port as the sockets in the `iocp::inet` namespace.
+
+        The commands are part of the `iocp_inet` package which is loaded as
+
+            package require iocp_inet
+    }
+
+    proc open args {
+        # Returns a client or server named pipe channel.
+        #   args - see below
+        #
+        # The command takes the forms
+        #
+        #     open NAME
+        #     open -server CMDPREFIX NAME
+        #
+        # NAME is the name of the pipe. Names not beginning with `\\`
+        # are taken to be in the local pipe namespace `\\.\pipe\`.
+        #
+        # The first form connects to a server for the named pipe. The
+        # connection is made synchronously. If all server instances of the
+        # pipe are in use, the command waits for one to become available.
+        #
+        # The second form creates a listening channel for the named pipe.
+        # An error is raised if another server has already created a pipe
+        # with that name. As for the Tcl `socket` command, CMDPREFIX is
+        # invoked for every accepted connection with the new channel, the
+        # full pipe name and `0` as additional arguments. Remote clients
+        # are not accepted.
+        #
+        # Connection channels support the following options in addition
+        # to the standard channel options.
+        #
+        # -maxpendingreads COUNT - Sets the maximum number of reads posted
+        #   to the pipe.
+        # -maxpendingwrites COUNT - Sets the maximum number of writes
+        #   posted to the pipe before the channel blocks.
+        # -name - Returns the full name of the pipe. Read-only.
+        # -peerpid - Returns the process id of the process at the other end
+        #   of the pipe. Read-only.
+        #
+        # Listening channels support the `-name` option and
+        # `-maxpendingaccepts` which sets the number of pipe instances
+        # kept waiting for client connections.
+        #
+        # Pipes cannot be half-closed. The returned channel must be closed
+        # with the Tcl `close` or `chan close` command.
+    }
+}
+
+namespace eval iocp::file {
+    variable _ruff_preamble {
+        The `iocp::file` namespace implements channels over files opened
+        for overlapped I/O. Reads are issued ahead of the application and
+        completed through the same I/O completion port as the sockets in
+        the `iocp::inet` namespace so large sequential transfers do not
+        block the event loop.
+
+        The commands are part of the `iocp_inet` package which is loaded as
+
+            package require iocp_inet
+    }
+
+    proc open args {
+        # Returns a channel for reading or writing a file.
+        #   args - see below
+        #
+        # The command takes the form
+        #
+        #     open ?-offset OFFSET? PATH ?ACCESS?
+        #
+        # ACCESS may be `r` (default) to read an existing file, `w` to
+        # create or truncate the file for writing, or `a` to append to
+        # the file, creating it if necessary. The channel is either
+        # readable or writable, never both.
+        #
+        # If `-offset` is specified, reading or writing starts at byte
+        # OFFSET in the file. The option cannot be used in append mode.
+        #
+        # The channel is a stream and cannot be repositioned with `seek`.
+        # Readable channels may be used as the source for `fcopy` and
+        # [::iocp::inet::splice]. To send an entire file over a socket,
+        # [::iocp::inet::sendfile] is more efficient.
+        #
+        # The channel supports the following options in addition to the
+        # standard channel options.
+        #
+        # -maxpendingreads COUNT - Sets the maximum number of reads issued
+        #   ahead of the application.
+        # -maxpendingwrites COUNT - Sets the maximum number of writes
+        #   posted to the file before the channel blocks.
+        # -readsize SIZE - Sets the number of bytes requested by each read.
+        # -size - Returns the current size of the file. Read-only.
+        #
+        # The returned channel must be closed with the Tcl `close` or
+        # `chan close` command. Closing a writable channel waits for
+        # posted writes to complete and raises an error if any failed.
+    }
+}
+
+namespace eval iocp::co {
+    variable _ruff_preamble {
+        The `iocp::co` namespace implements commands for reading and
+        writing channels from coroutines. When the operation cannot be
+        completed immediately on a non-blocking channel, the calling
+        coroutine is suspended and resumed directly by the extension once
+        the channel is ready. No file event handler is involved.
+
+        The commands may be used with any channel created by the `iocp`
+        package except those registered with [::iocp::watch]. At most one
+        coroutine at a time may wait to read, and one to write, a channel.
+        If the channel is closed while a coroutine is waiting, the command
+        raises an error.
+    }
+
+    proc read {chan {numchars {}}} {
+        # Reads from a channel, suspending the calling coroutine as needed.
+        #   chan - a channel created by the `iocp` package
+        #   numchars - number of characters to read
+        #
+        # If $numchars is specified, the command returns once that many
+        # characters have been read. Otherwise, it returns all data up to
+        # end of file. Fewer characters are returned only at end of file.
+        #
+        # The command must be called from within a coroutine.
+    }
+
+    proc gets {chan {varName {}}} {
+        # Reads the next line from a channel, suspending the calling
+        # coroutine until a complete line is available.
+        #   chan - a channel created by the `iocp` package
+        #   varName - name of variable in which to store the line
+        #
+        # The line is returned without the terminating newline. If
+        # $varName is specified, the line is stored in that variable and
+        # the command returns the number of characters in the line, or
+        # `-1` at end of file. Otherwise the command returns the line,
+        # or an empty string at end of file.
+        #
+        # The command must be called from within a coroutine.
+    }
+
+    proc write {chan data} {
+        # Writes to a channel, suspending the calling coroutine until the
+        # data has been accepted.
+        #   chan - a channel created by the `iocp` package
+        #   data - data to write
+        #
+        # The channel is flushed after writing $data. If the channel cannot
+        # accept all the data immediately, the coroutine is suspended until
+        # the data buffered in the channel has been handed to the system.
+        # Unlike `puts`, no newline is appended.
+        #
+        # The command must be called from within a coroutine.
+    }
 }
 
 namespace eval iocp::bt {
@@ -197,7 +1089,8 @@ namespace eval iocp::bt {
         #
         # Once the connection is established, Bluetooth channel operation
         # is identical to that of Tcl sockets except that half closes
-        # are not supported.
+        # are not supported and the `-tls` and `-compress` options of
+        # [::iocp::inet::socket] channels are not available.
         #
         # The returned channel must be closed with the Tcl `close`
         # or `chan close` command.
@@ -244,7 +1137,7 @@ proc iocp::Document {outfile args} {
     variable _preamble
 
     set ns [namespace current]
-    set namespaces [list ${ns}::inet ${ns}::bt ${ns}::bt::sdr ${ns}::bt::names]
+    set namespaces [list ${ns} ${ns}::inet ${ns}::unix ${ns}::pipe ${ns}::file ${ns}::co ${ns}::bt ${ns}::bt::sdr ${ns}::bt::names]
     ruff::document $namespaces -autopunctuate 1 -excludeprocs {^[_A-Z]} \
         -recurse 0 -preamble $_preamble -pagesplit namespace \
         -navigation sticky \
@@ -0,0 +1,178 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh broadcastbench.tcl help
+#
+# Compares fanning out messages to many sockets with iocp::inet::broadcast
+# against writing each message to every socket with puts.
+
+proc serverAccept {so addr port} {
+    fconfigure $so -blocking 0 -translation binary
+    incr ::accepted
+    fileevent $so readable [list serverRead $so]
+}
+
+proc serverRead {so} {
+    incr ::received [string length [read $so]]
+    if {[eof $so]} {
+        close $so
+    }
+}
+
+proc privateBytes {} {
+    # Process private bytes if twapi is available
+    if {[catch {
+        set bytes [dict get [twapi::get_process_info [pid] -privatebytes] -privatebytes]
+    }]} {
+        return ""
+    }
+    return $bytes
+}
+
+proc fanout {port mode nconns count size batch maxpendingwrites} {
+    set ::accepted 0
+    set ::received 0
+    set chans {}
+    for {set i 0} {$i < $nconns} {incr i} {
+        set so [iocp::inet::socket 127.0.0.1 $port]
+        fconfigure $so -translation binary -blocking 0 -buffering none \
+            -maxpendingwrites $maxpendingwrites
+        lappend chans $so
+    }
+    while {$::accepted < $nconns} {
+        vwait ::accepted
+    }
+
+    set msg [string repeat x $size]
+    set skipped 0
+    set stats [iocp::stats]
+    set mem [privateBytes]
+    set peak $mem
+    set start [clock microseconds]
+    for {set i 1} {$i <= $count} {incr i} {
+        if {$mode eq "broadcast"} {
+            incr skipped [llength [iocp::inet::broadcast $msg $chans]]
+        } else {
+            foreach so $chans {
+                puts -nonewline $so $msg
+            }
+        }
+        if {$i % $batch == 0} {
+            # Sample memory before receivers drain the queued data
+            if {$mem ne ""} {
+                set now [privateBytes]
+                if {$now > $peak} {
+                    set peak $now
+                }
+            }
+            update
+        }
+    }
+    set expected [expr {($count * $nconns - $skipped) * $size}]
+    while {$::received < $expected} {
+        vwait ::received
+    }
+    set elapsed [expr {[clock microseconds] - $start}]
+    foreach so $chans {
+        close $so
+    }
+    set blocks [expr {[dict get [iocp::stats] SharedDataAllocs] - [dict get $stats SharedDataAllocs]}]
+    if {$mem ne ""} {
+        set peak [expr {$peak - $mem}]
+    } else {
+        set peak ""
+    }
+    return [list $count [expr {$count * $nconns - $skipped}] $skipped $elapsed $peak $blocks]
+}
+
+proc report {label result} {
+    lassign $result count delivered skipped elapsed peak blocks
+    set secs [expr {($elapsed ? $elapsed : 1) / 1000000.0}]
+    if {$peak eq ""} {
+        set peak "       -"
+    } else {
+        set peak [format "%8.1f" [expr {$peak / 1048576.0}]]
+    }
+    puts [format "%-9s %8.0f msgs/sec, %9.0f deliveries/sec, %7d skipped, memory +%s MB, %d shared blocks" \
+              $label [expr {$count / $secs}] [expr {$delivered / $secs}] \
+              $skipped $peak $blocks]
+}
+
+proc bench {args} {
+    uplevel #0 package require iocp_inet
+    catch {uplevel #0 package require twapi}
+    set nconns 100
+    if {[dict exists $args -connections]} {
+        set nconns [dict get $args -connections]
+    }
+    set count 10000
+    if {[dict exists $args -count]} {
+        set count [dict get $args -count]
+    }
+    set size 200
+    if {[dict exists $args -size]} {
+        set size [dict get $args -size]
+    }
+    set batch 100
+    if {[dict exists $args -batch]} {
+        set batch [dict get $args -batch]
+    }
+    set maxpendingwrites 100
+    if {[dict exists $args -maxpendingwrites]} {
+        set maxpendingwrites [dict get $args -maxpendingwrites]
+    }
+
+    foreach mode {puts broadcast} {
+        set listener [iocp::inet::socket -server serverAccept -myaddr 127.0.0.1 0]
+        set port [lindex [fconfigure $listener -sockname] 2]
+        report $mode [fanout $port $mode $nconns $count $size $batch $maxpendingwrites]
+        close $listener
+    }
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 bench|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh broadcastbench.tcl bench ?-connections N? ?-count N? ?-size BYTES? ?-batch N? ?-maxpendingwrites N?
+
+Sends COUNT messages (default 10000) of SIZE bytes (default 200) to each of
+N loopback connections (default 100) in two ways:
+
+    puts      - each message is written to every connection with puts
+    broadcast - each message is written to all connections with a single
+                iocp::inet::broadcast call sharing one data block
+
+The event loop is entered after every BATCH messages (default 100) so the
+receivers can drain their sockets. Each connection has -maxpendingwrites set
+to N (default 100). In broadcast mode, connections at this limit are
+skipped and the number of undelivered messages is shown. In puts mode,
+data that cannot be written is buffered in the Tcl channel instead.
+
+Prints the messages broadcast and the messages delivered per second, the
+peak growth in process private memory (only if the twapi package is
+available) and the number of shared data blocks allocated.
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            bench {
+                bench {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
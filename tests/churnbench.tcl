@@ -0,0 +1,126 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh churnbench.tcl help
+#
+# Measures connection setup and teardown rates with and without the
+# iocp::inet::socketcache socket recycling.
+
+namespace eval client {}
+
+proc client::client {args} {
+    uplevel #0 package require iocp_inet
+    set addr 127.0.0.1
+    if {[dict exists $args -server]} {
+        set addr [dict get $args -server]
+    }
+    set port 10106
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set count 5000
+    if {[dict exists $args -count]} {
+        set count [dict get $args -count]
+    }
+    if {[dict exists $args -socketcache]} {
+        iocp::inet::socketcache [dict get $args -socketcache]
+    }
+
+    set start [clock microseconds]
+    for {set i 0} {$i < $count} {incr i} {
+        # -async so outbound connections can also use recycled sockets
+        set so [iocp::inet::socket -async $addr $port]
+        fconfigure $so -buffering line
+        puts $so $i
+        if {[gets $so line] < 0 || $line != $i} {
+            error "Bad response from server."
+        }
+        close $so
+    }
+    set elapsed [expr {[clock microseconds] - $start}]
+    puts "[format %.1f [expr {(double($count) * 1000000)/$elapsed}]] connections/s"
+
+    set so [iocp::inet::socket $addr $port]
+    fconfigure $so -buffering line
+    puts $so STATS
+    set server_stats [gets $so]
+    close $so
+    set client_stats [iocp::stats]
+    foreach {label stats} [list client $client_stats server $server_stats] {
+        puts "$label socket cache hits: [dict get $stats SocketCacheHits], misses: [dict get $stats SocketCacheMisses], recycled: [dict get $stats SocketCachePuts]"
+    }
+}
+
+namespace eval server {}
+
+proc server::respond {so} {
+    if {[gets $so line] < 0} {
+        if {[eof $so]} {
+            close $so
+        }
+        return
+    }
+    if {$line eq "STATS"} {
+        puts $so [iocp::stats]
+    } else {
+        puts $so $line
+    }
+}
+
+proc server::accept {so addr port} {
+    fconfigure $so -blocking 0 -buffering line
+    fileevent $so readable [list [namespace current]::respond $so]
+}
+
+proc server::server {args} {
+    uplevel #0 package require iocp_inet
+    set port 10106
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    if {[dict exists $args -socketcache]} {
+        iocp::inet::socketcache [dict get $args -socketcache]
+    }
+    set listener [iocp::inet::socket -server [namespace current]::accept $port]
+    vwait forever
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 client|server|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh churnbench.tcl server ?-port PORT? ?-socketcache MAXSOCKETS?
+    tclsh churnbench.tcl client ?-server ADDR? ?-port PORT? ?-count N? ?-socketcache MAXSOCKETS?
+
+Start the server first. The client opens COUNT connections in sequence,
+exchanging a single line on each before closing it, and prints the
+connection rate followed by the socket cache statistics of both ends.
+Run once with -socketcache 0 (the default) and once with a non-zero
+MAXSOCKETS on the server, and optionally the client, to compare.
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            client {
+                client::client {*}[lrange $argv 1 end]
+            }
+            server {
+                server::server {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
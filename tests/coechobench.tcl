@@ -0,0 +1,141 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh coechobench.tcl help
+#
+# Compares a line echo server written with coroutines and the iocp::co
+# commands against one written with fileevent handlers.
+
+proc coAccept {so addr port} {
+    fconfigure $so -blocking 0 -translation lf -buffering none
+    coroutine coEcho[incr ::coId] coEcho $so
+}
+
+proc coEcho {so} {
+    while {[iocp::co::gets $so line] >= 0} {
+        iocp::co::write $so $line\n
+    }
+    close $so
+}
+
+proc fileeventAccept {so addr port} {
+    fconfigure $so -blocking 0 -translation lf -buffering line
+    fileevent $so readable [list fileeventEcho $so]
+}
+
+proc fileeventEcho {so} {
+    while {[gets $so line] >= 0} {
+        puts $so $line
+    }
+    if {[eof $so]} {
+        close $so
+    }
+}
+
+proc clientRead {so msg} {
+    while {[gets $so line] >= 0} {
+        if {[incr ::remaining($so) -1] > 0} {
+            puts $so $msg
+        } else {
+            close $so
+            incr ::done
+            return
+        }
+    }
+}
+
+proc roundtrips {port nconns count size} {
+    set msg [string repeat x $size]
+    set ::done 0
+    set chans {}
+    for {set i 0} {$i < $nconns} {incr i} {
+        set so [iocp::inet::socket 127.0.0.1 $port]
+        fconfigure $so -blocking 0 -translation lf -buffering line
+        set ::remaining($so) $count
+        fileevent $so readable [list clientRead $so $msg]
+        lappend chans $so
+    }
+    set start [clock microseconds]
+    foreach so $chans {
+        puts $so $msg
+    }
+    while {$::done < $nconns} {
+        vwait ::done
+    }
+    return [list [expr {$nconns * $count}] [expr {[clock microseconds] - $start}]]
+}
+
+proc report {label result} {
+    lassign $result total elapsed
+    set secs [expr {($elapsed ? $elapsed : 1) / 1000000.0}]
+    puts [format "%-10s %8d round trips in %9.1f ms, %9.0f round trips/sec, %7.1f us/round trip" \
+              $label $total [expr {$elapsed / 1000.0}] [expr {$total / $secs}] \
+              [expr {$elapsed / double($total ? $total : 1)}]]
+}
+
+proc bench {args} {
+    uplevel #0 package require iocp_inet
+    set nconns 50
+    if {[dict exists $args -connections]} {
+        set nconns [dict get $args -connections]
+    }
+    set count 1000
+    if {[dict exists $args -count]} {
+        set count [dict get $args -count]
+    }
+    set size 100
+    if {[dict exists $args -size]} {
+        set size [dict get $args -size]
+    }
+
+    foreach mode {fileevent co} {
+        set listener [iocp::inet::socket -server ${mode}Accept -myaddr 127.0.0.1 0]
+        set port [lindex [fconfigure $listener -sockname] 2]
+        report $mode [roundtrips $port $nconns $count $size]
+        close $listener
+    }
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 bench|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh coechobench.tcl bench ?-connections N? ?-count N? ?-size BYTES?
+
+Opens N loopback connections (default 50) to a line echo server and sends
+COUNT lines (default 1000) of SIZE bytes (default 100) on each, waiting
+for each line to be echoed before sending the next. The server is
+implemented in two ways:
+
+    fileevent - a readable handler on each connection reads lines with
+                gets and echoes them with puts
+    co        - a coroutine per connection reads lines with iocp::co::gets
+                and echoes them with iocp::co::write
+
+The clients are identical in both cases and run in the same process.
+Prints the number of round trips per second and the average time for
+each round trip.
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            bench {
+                bench {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
@@ -0,0 +1,196 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh compressbench.tcl help
+#
+# Compares the cost and wire size of compressing socket data with the
+# -compress socket option against compressing it in script with a zlib
+# stream before writing.
+
+proc serverAccept {mode spec so addr port} {
+    fconfigure $so -blocking 0 -translation binary
+    switch -exact -- $mode {
+        native {
+            fconfigure $so -compress $spec
+        }
+        tcl {
+            set ::inflater [zlib stream [dict get {deflate inflate gzip gunzip zlib decompress} [lindex $spec 0]]]
+        }
+    }
+    set ::received 0
+    set ::wire 0
+    fileevent $so readable [list serverRead $mode $so]
+}
+
+proc serverRead {mode so} {
+    set data [read $so]
+    if {$mode ne "native"} {
+        incr ::wire [string length $data]
+    }
+    if {$mode eq "tcl"} {
+        $::inflater put $data
+        set data [$::inflater get]
+    }
+    incr ::received [string length $data]
+    if {[eof $so]} {
+        if {$mode eq "native"} {
+            # Data is read after decompression so get wire count from socket
+            set ::wire [dict get [fconfigure $so -compressstats] wirein]
+        }
+        close $so
+        if {$mode eq "tcl"} {
+            $::inflater close
+        }
+        set ::done 1
+    }
+}
+
+proc cpuTime {} {
+    # Process user and kernel time in milliseconds if twapi is available
+    if {[catch {
+        set times [twapi::get_process_info [pid] -usertime -privilegedtime]
+    }]} {
+        return ""
+    }
+    return [expr {([dict get $times -usertime] + [dict get $times -privilegedtime]) / 10000.0}]
+}
+
+proc sampleData {size} {
+    # Log-like text compresses realistically, unlike repeated strings
+    set data ""
+    set n 0
+    while {[string length $data] < $size} {
+        append data [format "%s host%d app\[%d\]: request %d status %d bytes %d duration %.3f" \
+                           [clock format [expr {1600000000 + $n}] -format "%Y-%m-%dT%H:%M:%S" -gmt 1] \
+                           [expr {$n % 7}] [expr {1000 + $n % 13}] $n \
+                           [lindex {200 200 200 304 404 500} [expr {$n % 6}]] \
+                           [expr {($n * 7919) % 50000}] [expr {($n % 97) / 10.0}]] \n
+        incr n
+    }
+    return $data
+}
+
+proc transfer {port mode spec size buffersize} {
+    set ::done 0
+    set so [iocp::inet::socket 127.0.0.1 $port]
+    fconfigure $so -translation binary -blocking 0 -buffersize $buffersize
+    switch -exact -- $mode {
+        native {
+            fconfigure $so -compress $spec
+        }
+        tcl {
+            set level 6
+            if {[dict exists [lrange $spec 1 end] level]} {
+                set level [dict get [lrange $spec 1 end] level]
+            }
+            set deflater [zlib stream [dict get {deflate deflate gzip gzip zlib compress} [lindex $spec 0]] -level $level]
+        }
+    }
+    set block [sampleData $buffersize]
+    set blockLen [string length $block]
+    set cpu [cpuTime]
+    set start [clock microseconds]
+    for {set written 0} {$written < $size} {incr written $blockLen} {
+        if {$mode eq "tcl"} {
+            $deflater put -flush $block
+            puts -nonewline $so [$deflater get]
+        } else {
+            puts -nonewline $so $block
+        }
+    }
+    if {$mode eq "tcl"} {
+        $deflater put -finalize {}
+        puts -nonewline $so [$deflater get]
+        $deflater close
+    }
+    close $so
+    vwait ::done
+    set elapsed [expr {[clock microseconds] - $start}]
+    if {$cpu ne ""} {
+        set cpu [expr {[cpuTime] - $cpu}]
+    }
+    return [list $written $elapsed $cpu]
+}
+
+proc report {label result} {
+    lassign $result total elapsed cpu
+    set mb [expr {$total / 1048576.0}]
+    if {$cpu eq ""} {
+        set cpuPerMB "      -"
+    } else {
+        set cpuPerMB [format "%7.2f" [expr {$cpu / $mb}]]
+    }
+    puts [format "%-8s %10d bytes in %9.1f ms, CPU %s ms/MB, %10d wire bytes (%5.1f%%)" \
+              $label $total [expr {$elapsed / 1000.0}] $cpuPerMB $::wire \
+              [expr {100.0 * $::wire / ($total ? $total : 1)}]]
+}
+
+proc bench {args} {
+    uplevel #0 package require iocp_inet
+    catch {uplevel #0 package require twapi}
+    set spec deflate
+    if {[dict exists $args -compress]} {
+        set spec [dict get $args -compress]
+    }
+    set size [expr {32*1024*1024}]
+    if {[dict exists $args -size]} {
+        set size [dict get $args -size]
+    }
+    set buffersize 65536
+    if {[dict exists $args -buffersize]} {
+        set buffersize [dict get $args -buffersize]
+    }
+
+    foreach mode {plain tcl native} {
+        set listener [iocp::inet::socket -server [list serverAccept $mode $spec] -myaddr 127.0.0.1 0]
+        set port [lindex [fconfigure $listener -sockname] 2]
+        report $mode [transfer $port $mode $spec $size $buffersize]
+        close $listener
+    }
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 bench|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh compressbench.tcl bench ?-compress SPEC? ?-size BYTES? ?-buffersize BYTES?
+
+Transfers SIZE bytes (default 32MB) of log-like text over a loopback
+socket in three ways and prints the elapsed time, the CPU time per MB of
+data and the number of bytes sent over the wire:
+
+    plain  - no compression
+    tcl    - compressed in script with a zlib stream, flushed and written
+             for every BUFFERSIZE bytes, and decompressed in script by the
+             receiver
+    native - compressed and decompressed by the sockets with the -compress
+             option set to SPEC (default deflate)
+
+The sending socket uses a channel buffer of BUFFERSIZE bytes (default
+64KB) so that both compressed modes flush after the same amount of data.
+The CPU time includes both sender and receiver and is only shown if the
+twapi package is available.
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            bench {
+                bench {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
@@ -0,0 +1,119 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh filebench.tcl help
+#
+# Measures file read throughput with channels from the Tcl open command
+# versus iocp::file::open with overlapped read-ahead.
+
+proc create {path size} {
+    set fd [open $path wb]
+    set block [string repeat 0123456789abcdef 4096]
+    for {set written 0} {$written < $size} {incr written [string length $block]} {
+        puts -nonewline $fd $block
+    }
+    close $fd
+}
+
+proc readfile {mode path args} {
+    if {$mode eq "open"} {
+        set fd [open $path rb]
+    } else {
+        set fd [iocp::file::open $path]
+        fconfigure $fd -translation binary
+        if {[dict exists $args -maxpendingreads]} {
+            fconfigure $fd -maxpendingreads [dict get $args -maxpendingreads]
+        }
+        if {[dict exists $args -readsize]} {
+            fconfigure $fd -readsize [dict get $args -readsize]
+        }
+    }
+    set chunk 65536
+    if {[dict exists $args -chunk]} {
+        set chunk [dict get $args -chunk]
+    }
+    fconfigure $fd -buffersize $chunk
+    set total 0
+    set start [clock microseconds]
+    while {1} {
+        set data [read $fd $chunk]
+        incr total [string length $data]
+        if {[eof $fd]} {
+            break
+        }
+    }
+    set elapsed [expr {[clock microseconds] - $start}]
+    close $fd
+    return [list $total $elapsed]
+}
+
+proc bench {args} {
+    uplevel #0 package require iocp_inet
+    set path [file join [pwd] filebench.dat]
+    if {[dict exists $args -file]} {
+        set path [dict get $args -file]
+    }
+    set size [expr {256*1024*1024}]
+    if {[dict exists $args -size]} {
+        set size [dict get $args -size]
+    }
+    set count 3
+    if {[dict exists $args -count]} {
+        set count [dict get $args -count]
+    }
+    set created 0
+    if {![file exists $path]} {
+        create $path $size
+        set created 1
+    }
+    foreach mode {open iocp} {
+        for {set i 0} {$i < $count} {incr i} {
+            lassign [readfile $mode $path {*}$args] total elapsed
+            puts [format "%-5s %12d bytes in %8.1f ms (%.1f MB/s)" \
+                      $mode $total [expr {$elapsed / 1000.0}] \
+                      [expr {$total / ($elapsed ? $elapsed : 1) / 1.048576}]]
+        }
+    }
+    if {$created} {
+        file delete $path
+    }
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 bench|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh filebench.tcl bench ?-file PATH? ?-size BYTES? ?-count N? ?-chunk BYTES? ?-maxpendingreads N? ?-readsize BYTES?
+
+Reads the file PATH, COUNT times each, through a channel returned by the
+Tcl open command and through one returned by iocp::file::open and prints
+the throughput for each run. Reads are done with read in CHUNK byte
+pieces. If PATH does not exist, a file of SIZE bytes (default 256MB) is
+created and deleted afterwards. The -maxpendingreads and -readsize options
+are passed to the iocp channel. Note that after the first run the file
+will generally be in the system cache. Use a file larger than available
+memory to measure disk rather than cache throughput.
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            bench {
+                bench {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
@@ -0,0 +1,152 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh firstbytebench.tcl help
+#
+# Measures the latency from opening a connection to receiving the first
+# byte of the response with and without the -initialdata and -fastopen
+# socket options.
+
+namespace eval client {}
+
+proc client::connect {mode addr port request} {
+    switch -exact -- $mode {
+        plain {
+            set so [iocp::inet::socket $addr $port]
+            puts -nonewline $so $request
+            flush $so
+        }
+        async {
+            set so [iocp::inet::socket -async $addr $port]
+            puts -nonewline $so $request
+            flush $so
+        }
+        initialdata {
+            set so [iocp::inet::socket -async -initialdata $request $addr $port]
+        }
+        fastopen {
+            set so [iocp::inet::socket -async -fastopen -initialdata $request $addr $port]
+        }
+        default {
+            error "Unknown mode $mode. Must be plain, async, initialdata or fastopen."
+        }
+    }
+    return $so
+}
+
+proc client::client {args} {
+    uplevel #0 package require iocp_inet
+    set addr 127.0.0.1
+    if {[dict exists $args -server]} {
+        set addr [dict get $args -server]
+    }
+    set port 10107
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set count 1000
+    if {[dict exists $args -count]} {
+        set count [dict get $args -count]
+    }
+    set modes {plain async initialdata fastopen}
+    if {[dict exists $args -mode]} {
+        set modes [list [dict get $args -mode]]
+    }
+
+    set request "GET / HTTP/1.0\n"
+    foreach mode $modes {
+        set latencies {}
+        for {set i 0} {$i < $count} {incr i} {
+            set start [clock microseconds]
+            set so [connect $mode $addr $port $request]
+            fconfigure $so -translation binary
+            if {[read $so 1] eq ""} {
+                error "No response from server."
+            }
+            lappend latencies [expr {[clock microseconds] - $start}]
+            close $so
+        }
+        set latencies [lsort -integer $latencies]
+        set total 0
+        foreach latency $latencies {
+            incr total $latency
+        }
+        puts [format "%-12s mean %7.1f us, median %6d us, p99 %6d us" \
+                  $mode [expr {double($total)/$count}] \
+                  [lindex $latencies [expr {$count/2}]] \
+                  [lindex $latencies [expr {($count*99)/100}]]]
+    }
+}
+
+namespace eval server {}
+
+proc server::respond {so} {
+    if {[gets $so line] < 0} {
+        if {[eof $so]} {
+            close $so
+        }
+        return
+    }
+    puts $so "HTTP/1.0 200 OK"
+    close $so
+}
+
+proc server::accept {so addr port} {
+    fconfigure $so -blocking 0 -buffering line
+    fileevent $so readable [list [namespace current]::respond $so]
+}
+
+proc server::server {args} {
+    uplevel #0 package require iocp_inet
+    set port 10107
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set listener [iocp::inet::socket -server [namespace current]::accept $port]
+    vwait forever
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 client|server|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh firstbytebench.tcl server ?-port PORT?
+    tclsh firstbytebench.tcl client ?-server ADDR? ?-port PORT? ?-count N? ?-mode MODE?
+
+Start the server first. For each MODE, the client opens COUNT connections
+in sequence, sending a single request line on each, and prints the time
+from opening the socket to receiving the first byte of the response.
+MODE may be one of
+    plain       - synchronous connect followed by a write
+    async       - -async connect followed by a write
+    initialdata - request passed with -initialdata
+    fastopen    - request passed with -initialdata and -fastopen
+All modes are run if -mode is not specified. Fast Open only has an effect
+if enabled in the system on both ends (netsh interface tcp show global).
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            client {
+                client::client {*}[lrange $argv 1 end]
+            }
+            server {
+                server::server {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
@@ -0,0 +1,123 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh getsbench.tcl help
+#
+# Measures the number of readable callbacks needed to receive a line
+# oriented stream with and without the -readdelimiter socket option.
+
+proc serverAccept {delim so addr port} {
+    set ::callbacks 0
+    set ::lines 0
+    set ::start [clock microseconds]
+    fconfigure $so -blocking 0 -translation binary
+    if {$delim ne ""} {
+        fconfigure $so -readdelimiter $delim
+    }
+    fileevent $so readable [list serverRead $so]
+}
+
+proc serverRead {so} {
+    incr ::callbacks
+    while {[gets $so line] >= 0} {
+        incr ::lines
+    }
+    if {[eof $so]} {
+        set elapsed [expr {[clock microseconds] - $::start}]
+        close $so
+        puts [format "%d lines, %d callbacks (%.2f lines/callback) in %.1f ms" \
+                  $::lines $::callbacks \
+                  [expr {double($::lines) / ($::callbacks ? $::callbacks : 1)}] \
+                  [expr {$elapsed / 1000.0}]]
+        set ::done 1
+    }
+}
+
+proc server {args} {
+    uplevel #0 package require iocp_inet
+    set port 10101
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set delim ""
+    if {[dict exists $args -delimiter]} {
+        set delim [subst -nocommands -novariables [dict get $args -delimiter]]
+    }
+    set listener [iocp::inet::socket -server [list serverAccept $delim] $port]
+    while {1} {
+        vwait ::done
+    }
+}
+
+proc client {args} {
+    uplevel #0 package require iocp_inet
+    set addr 127.0.0.1
+    if {[dict exists $args -addr]} {
+        set addr [dict get $args -addr]
+    }
+    set port 10101
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set count 100000
+    if {[dict exists $args -count]} {
+        set count [dict get $args -count]
+    }
+    set chunk 7
+    if {[dict exists $args -chunk]} {
+        set chunk [dict get $args -chunk]
+    }
+    set line "[string repeat x 60]\n"
+    set so [iocp::inet::socket $addr $port]
+    fconfigure $so -translation binary -buffering none -nagle 0
+    # Write each line in CHUNK byte pieces so that lines straddle receives
+    for {set i 0} {$i < $count} {incr i} {
+        for {set off 0} {$off < [string length $line]} {incr off $chunk} {
+            puts -nonewline $so [string range $line $off [expr {$off+$chunk-1}]]
+        }
+    }
+    close $so
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 server|client|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh getsbench.tcl server ?-port PORT? ?-delimiter DELIM?
+    tclsh getsbench.tcl client ?-addr ADDR? ?-port PORT? ?-count N? ?-chunk BYTES?
+
+The client sends COUNT lines of 61 bytes each, writing every line in CHUNK
+byte pieces with Nagle disabled so that lines are split across many
+receives. The server reads the lines with gets from a readable handler and
+prints the number of lines, the number of callbacks and the elapsed time
+for each connection. If -delimiter is specified (e.g. \n or \r\n), the
+server socket is configured with -readdelimiter so that readable events
+are only generated once a complete line has been received. Compare the
+callback counts of server runs with and without -delimiter.
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            server {
+                server {*}[lrange $argv 1 end]
+            }
+            client {
+                client {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
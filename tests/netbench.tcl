@@ -50,6 +50,10 @@ proc help {} {
                        sockets or iocp_inet package (default tcl) as the socket
                        provider to use for the client and server
                        If only one is given, it is used for both.
+                       The provider unix uses iocp_inet AF_UNIX sockets
+                       for comparison with loopback TCP. It must be used
+                       for both client and server and the client must run
+                       on the same system as the server.
         -payload text|binary - specifies the payload type as text or binary.
                        If unspecified, payload is chosen based on whether
                        socket options (below) specify binary transfer or not.
@@ -73,7 +77,12 @@ proc help {} {
 
         Further, for the iocp provider only, the following options may
         be specified:
-           -maxpendingreads, -maxpendingwrites, -sosndbuf, -sorcvbuf
+           -maxpendingreads, -maxpendingwrites, -sosndbuf, -sorcvbuf,
+           -rcvlowat
+
+        The detail output includes the number of readable notifications
+        the server received per MB of data. Compare runs with different
+        values of -rcvlowat to see the effect of the receive low watermark.
 
         The batch command accepts an additional option:
         -script FILE - Path of file from which to read test configurations.
@@ -113,6 +122,9 @@ proc socket_command {provider} {
     } elseif {$provider eq "iocp"} {
         uplevel #0 package require iocp
         return iocp::inet::socket
+    } elseif {$provider eq "unix"} {
+        uplevel #0 package require iocp_inet
+        return iocp::unix::socket
     } elseif {$provider eq "iocpsock"} {
         uplevel #0 package require Iocpsock
         return socket2
@@ -238,6 +250,20 @@ proc client::nonblocking_write_timer {} {
     set nonblocking_write_gate done
 }
 
+proc client::open_data_socket {local_provider remote_provider} {
+    # Returns a data connection to the server
+    variable control
+    variable server
+
+    set socommand [socket_command $local_provider]
+    set port [dict get $control(dataports) $remote_provider]
+    if {$local_provider eq "unix"} {
+        # AF_UNIX listeners are identified by path, not address and port
+        return [$socommand $port]
+    }
+    return [$socommand $server(-addr) $port]
+}
+
 proc client::bench_nonblocking {local_provider remote_provider} {
     variable options
     variable sooptions
@@ -248,11 +274,10 @@ proc client::bench_nonblocking {local_provider remote_provider} {
 
     set payload [payload $options(-payload)]
 
-    set socommand [socket_command $local_provider]
     # IMPORTANT:
     # Do NOT do any operations on $payload other than writing it
     # since [string length] etc. will all shimmer it.
-    set so [$socommand $server(-addr) [dict get $control(dataports) $remote_provider]]
+    set so [open_data_socket $local_provider $remote_provider]
     fconfigure $so {*}[array get sooptions] -blocking 0
 
     set nonblocking_write_count 0
@@ -289,11 +314,10 @@ proc client::bench {local_provider remote_provider} {
 
     set payload [payload $options(-payload)]
 
-    set socommand [socket_command $local_provider]
     # IMPORTANT:
     # Do NOT do any operations on $payload other than writing it
     # since [string length] etc. will all shimmer it.
-    set so [$socommand $server(-addr) [dict get $control(dataports) $remote_provider]]
+    set so [open_data_socket $local_provider $remote_provider]
     fconfigure $so {*}[array get sooptions]
 
     set start [clock microseconds]
@@ -386,7 +410,7 @@ proc client::runtest {args} {
     }
 
     foreach opt {-buffering -buffersize -encoding -eofchar -translation
-        -maxpendingreads -maxpendingwrites -sosndbuf -sorcvbuf} {
+        -maxpendingreads -maxpendingwrites -sosndbuf -sorcvbuf -rcvlowat} {
         if {[info exists opts($opt)]} {
             set sooptions($opt) $opts($opt)
             unset opts($opt)
@@ -451,9 +475,12 @@ proc client::runtest {args} {
     }
 
     if {![dict exists $control(dataports) $remote_provider] ||
-        [dict get $control(dataports) $remote_provider] == 0} {
+        [dict get $control(dataports) $remote_provider] eq "0"} {
         error "Server does not support $remote_provider."
     }
+    if {($local_provider eq "unix") != ($remote_provider eq "unix")} {
+        error "Provider unix must be used for both client and server."
+    }
 
     if {$options(-nbwrites)} {
         set client_result [bench_nonblocking $local_provider $remote_provider]
@@ -461,8 +488,13 @@ proc client::runtest {args} {
         set client_result [bench $local_provider $remote_provider]
     }
 
-    set sockname [dict get $client_result Socket -sockname]
-    set id [list [lindex $sockname 0] [lindex $sockname 2]]
+    if {$local_provider eq "unix"} {
+        # Client AF_UNIX sockets are unnamed. See server::accept_data
+        set id [list "" 0]
+    } else {
+        set sockname [dict get $client_result Socket -sockname]
+        set id [list [lindex $sockname 0] [lindex $sockname 2]]
+    }
     puts $control(so) [list FINISH $id]
     set server_result [gets $control(so)]
 
@@ -553,6 +585,11 @@ proc client::print {result {level summary}} {
                 set duration [expr {$End - $Start}]
                 set mbps [format %.2f [expr {double($Received)/$duration}]]
                 puts "SERVER: $mbps MB/s (Rcvd $Received bytes in $duration usecs)"
+                if {$Received} {
+                    puts [format "        %d notifications (%.1f per MB)" \
+                              $Notifications \
+                              [expr {$Notifications * 1048576.0 / $Received}]]
+                }
                 dict unset Socket -sockname
                 dict unset Socket -peername
                 dict unset Socket -error
@@ -700,6 +737,19 @@ proc server::server {args} {
         puts stdout "Iocpsock socket listening on $listening_ports(iocpsock)."
     }
 
+    # AF_UNIX sockets need Windows 10 1803 or later
+    set path [file join $::env(TEMP) netbench-[pid].sock]
+    if {[catch {
+        iocp::unix::socket -server [namespace current]::accept_data $path
+    } listener]} {
+        set listening_ports(unix) 0
+        puts stderr "Could not create AF_UNIX socket. Provider unix will not be available."
+    } else {
+        set listeners(unix) $listener
+        set listening_ports(unix) $path
+        puts stdout "AF_UNIX socket listening on $listening_ports(unix)."
+    }
+
     vwait forever
 }
 
@@ -720,8 +770,7 @@ proc server::end_test {controlso dataso} {
     close $dataso
     unset sockets($dataso)
     puts $controlso [list OK $result]
-    set peer [dict get $result Socket -peername]
-    dict unset clients [lindex $peer 0] [lindex $peer 2]
+    dict unset clients {*}[dict get $result Remote]
 }
 
 proc server::read_control {so} {
@@ -792,7 +841,7 @@ proc server::accept_data {so addr port} {
     fconfigure $so {*}$opts
 
     fileevent $so readable [list [namespace current]::read_data $so]
-    set sockets($so) [dict create Remote [list $addr $port] Received 0 Sent 0 Start [clock microseconds]]
+    set sockets($so) [dict create Remote [list $addr $port] Received 0 Sent 0 Notifications 0 Start [clock microseconds]]
     dict set clients $addr $port $so
 }
 
@@ -800,6 +849,7 @@ proc server::read_data {so} {
     variable sockets
     variable options
 
+    dict incr sockets($so) Notifications
     if {[catch {
         read $so $options(-readsize)
     } data]} {
@@ -0,0 +1,166 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh pingbench.tcl help
+#
+# Measures the round trip latency of an event driven ping-pong exchange
+# for different iocp::configure -busypoll settings.
+
+namespace eval client {}
+
+proc client::pong {so size} {
+    variable start
+    variable latencies
+    variable remaining
+    variable pending
+    # Partial messages are completed on the next readable event
+    append pending [read $so [expr {$size - [string length $pending]}]]
+    if {[eof $so]} {
+        error "Server closed connection."
+    }
+    if {[string length $pending] < $size} {
+        return
+    }
+    set pending ""
+    lappend latencies [expr {[clock microseconds] - $start}]
+    if {[incr remaining -1] <= 0} {
+        set ::client::done 1
+        return
+    }
+    set start [clock microseconds]
+    puts -nonewline $so $::client::msg
+}
+
+proc client::client {args} {
+    variable start
+    variable latencies
+    variable remaining
+    variable pending
+    uplevel #0 package require iocp_inet
+    set addr 127.0.0.1
+    if {[dict exists $args -server]} {
+        set addr [dict get $args -server]
+    }
+    set port 10109
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set count 10000
+    if {[dict exists $args -count]} {
+        set count [dict get $args -count]
+    }
+    set size 64
+    if {[dict exists $args -size]} {
+        set size [dict get $args -size]
+    }
+    set busypolls {0 50 1000}
+    if {[dict exists $args -busypoll]} {
+        set busypolls [dict get $args -busypoll]
+    }
+
+    set ::client::msg [string repeat x $size]
+    foreach busypoll $busypolls {
+        iocp::configure -busypoll $busypoll
+        set so [iocp::inet::socket $addr $port]
+        fconfigure $so -translation binary -buffering none -blocking 0 -nagle 0
+        fileevent $so readable [list [namespace current]::pong $so $size]
+        # First 100 round trips are warm up and not counted
+        set pending ""
+        set remaining 100
+        set start [clock microseconds]
+        puts -nonewline $so $::client::msg
+        vwait ::client::done
+
+        set stats [iocp::stats]
+        set latencies {}
+        set remaining $count
+        set start [clock microseconds]
+        puts -nonewline $so $::client::msg
+        vwait ::client::done
+        set after [iocp::stats]
+        close $so
+
+        set hits [expr {[dict get $after BusyPollHits] - [dict get $stats BusyPollHits]}]
+        set misses [expr {[dict get $after BusyPollMisses] - [dict get $stats BusyPollMisses]}]
+        set latencies [lsort -integer $latencies]
+        puts [format "busypoll %7d us: median %6d us, p99 %6d us, p99.9 %6d us, poll hits %7d, misses %7d" \
+                  $busypoll \
+                  [lindex $latencies [expr {$count/2}]] \
+                  [lindex $latencies [expr {($count*99)/100}]] \
+                  [lindex $latencies [expr {($count*999)/1000}]] \
+                  $hits $misses]
+    }
+    iocp::configure -busypoll 0
+}
+
+namespace eval server {}
+
+proc server::echo {so} {
+    puts -nonewline $so [read $so]
+    if {[eof $so]} {
+        close $so
+    }
+}
+
+proc server::accept {so addr port} {
+    fconfigure $so -translation binary -buffering none -blocking 0 -nagle 0
+    fileevent $so readable [list [namespace current]::echo $so]
+}
+
+proc server::server {args} {
+    uplevel #0 package require iocp_inet
+    set port 10109
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    if {[dict exists $args -busypoll]} {
+        iocp::configure -busypoll [dict get $args -busypoll]
+    }
+    set listener [iocp::inet::socket -server [namespace current]::accept $port]
+    vwait forever
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 client|server|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh pingbench.tcl server ?-port PORT? ?-busypoll MICROSECONDS?
+    tclsh pingbench.tcl client ?-server ADDR? ?-port PORT? ?-count N? ?-size BYTES? ?-busypoll LIST?
+
+Start the server first, preferably on another system on the same LAN.
+For each value in LIST (default 0 50 1000), the client sets
+iocp::configure -busypoll to that value, opens a connection and sends
+COUNT messages (default 10000) of SIZE bytes (default 64) from fileevent
+handlers, sending each after the previous one is echoed. Prints the
+median, 99th and 99.9th percentile round trip times and the number of
+busy polls that found a ready channel (hits) or timed out (misses). The
+server's own busy poll setting can be set with -busypoll (default 0).
+
+Compare with the throughput oriented netbench.tcl.
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            client {
+                client::client {*}[lrange $argv 1 end]
+            }
+            server {
+                server::server {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
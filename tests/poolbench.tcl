@@ -0,0 +1,175 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh poolbench.tcl help
+#
+# Compares request/response rates when opening a new connection per request
+# against reusing connections from an iocp::inet::pool.
+
+namespace eval client {
+    proc socket_command {provider} {
+        if {$provider eq "tcl"} {
+            return socket
+        } elseif {$provider eq "iocp"} {
+            uplevel #0 package require iocp_inet
+            return iocp::inet::socket
+        } elseif {$provider eq "iocpsock"} {
+            uplevel #0 package require Iocpsock
+            return socket2
+        } else {
+            error "Unknown socket provider $provider."
+        }
+    }
+
+    # Sends a single line request and waits for the echoed response.
+    proc request {so payload} {
+        puts $so $payload
+        flush $so
+        if {[gets $so line] < 0 || $line ne $payload} {
+            error "Bad response from server."
+        }
+    }
+
+    proc run_fresh {provider addr port count payload} {
+        set cmd [socket_command $provider]
+        set start [clock microseconds]
+        for {set i 0} {$i < $count} {incr i} {
+            set so [$cmd $addr $port]
+            fconfigure $so -buffering line
+            request $so $payload
+            close $so
+        }
+        return [expr {[clock microseconds] - $start}]
+    }
+
+    proc run_pooled {addr port count payload} {
+        uplevel #0 package require iocp_inet
+        set pool [iocp::inet::pool create]
+        set start [clock microseconds]
+        for {set i 0} {$i < $count} {incr i} {
+            set so [iocp::inet::pool acquire $pool $addr $port]
+            fconfigure $so -buffering line
+            request $so $payload
+            iocp::inet::pool release $pool $so
+        }
+        set elapsed [expr {[clock microseconds] - $start}]
+        set stats [iocp::inet::pool stats $pool]
+        iocp::inet::pool destroy $pool
+        return [list $elapsed $stats]
+    }
+}
+
+proc client::client {args} {
+    set addr 127.0.0.1
+    if {[dict exists $args -server]} {
+        set addr [dict get $args -server]
+    }
+    set port 10103
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set count 1000
+    if {[dict exists $args -count]} {
+        set count [dict get $args -count]
+    }
+    set provider iocp
+    if {[dict exists $args -provider]} {
+        set provider [dict get $args -provider]
+    }
+    set payload [string repeat x 64]
+    if {[dict exists $args -size]} {
+        set payload [string repeat x [dict get $args -size]]
+    }
+
+    set elapsed [run_fresh $provider $addr $port $count $payload]
+    puts "fresh ($provider): [format %.1f [expr {(double($count) * 1000000)/$elapsed}]] req/s"
+
+    lassign [run_pooled $addr $port $count $payload] elapsed stats
+    puts "pooled (iocp): [format %.1f [expr {(double($count) * 1000000)/$elapsed}]] req/s"
+    puts "pool hits: [dict get $stats hits], misses: [dict get $stats misses], evictions: [dict get $stats evictions]"
+}
+
+namespace eval server {
+    proc socket_command {provider} {
+        if {$provider eq "tcl"} {
+            return socket
+        } elseif {$provider eq "iocp"} {
+            uplevel #0 package require iocp_inet
+            return iocp::inet::socket
+        } elseif {$provider eq "iocpsock"} {
+            uplevel #0 package require Iocpsock
+            return socket2
+        } else {
+            error "Unknown socket provider $provider."
+        }
+    }
+}
+
+proc server::echo {so} {
+    if {[gets $so line] < 0} {
+        if {[eof $so]} {
+            close $so
+        }
+        return
+    }
+    puts $so $line
+    flush $so
+}
+
+proc server::accept {so addr port} {
+    fconfigure $so -blocking 0 -buffering line
+    fileevent $so readable [list [namespace current]::echo $so]
+}
+
+proc server::server {args} {
+    set port 10103
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set provider iocp
+    if {[dict exists $args -provider]} {
+        set provider [dict get $args -provider]
+    }
+    set listener [[socket_command $provider] -server [namespace current]::accept $port]
+    vwait forever
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 client|server|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh poolbench.tcl server ?-port PORT? ?-provider PROVIDER?
+    tclsh poolbench.tcl client ?-server ADDR? ?-port PORT? ?-provider PROVIDER? ?-count N? ?-size BYTES?
+
+Start the echo server first. The client then sends COUNT line requests of
+BYTES bytes, first opening a new connection for every request using the
+PROVIDER socket command (tcl, iocp or iocpsock) and then reusing connections
+from an iocp::inet::pool. Both request rates are printed along with the pool
+hit and miss counts.
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            client {
+                client::client {*}[lrange $argv 1 end]
+            }
+            server {
+                server::server {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
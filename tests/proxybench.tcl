@@ -0,0 +1,178 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh proxybench.tcl help
+#
+# Compares TCP proxy throughput when forwarding with fcopy against
+# forwarding with iocp::inet::splice.
+
+namespace eval client {}
+
+proc client::client {args} {
+    uplevel #0 package require iocp_inet
+    set addr 127.0.0.1
+    if {[dict exists $args -server]} {
+        set addr [dict get $args -server]
+    }
+    set port 10104
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set count 10000
+    if {[dict exists $args -count]} {
+        set count [dict get $args -count]
+    }
+    set size 65536
+    if {[dict exists $args -size]} {
+        set size [dict get $args -size]
+    }
+
+    set so [iocp::inet::socket $addr $port]
+    fconfigure $so -translation binary
+    set data [string repeat x $size]
+    set start [clock microseconds]
+    for {set i 0} {$i < $count} {incr i} {
+        puts -nonewline $so $data
+    }
+    # The sink acknowledges with the byte count once it sees EOF.
+    close $so write
+    set received [gets $so]
+    set elapsed [expr {[clock microseconds] - $start}]
+    close $so
+    if {$received != $count * $size} {
+        error "Sink received $received bytes, expected [expr {$count * $size}]."
+    }
+    puts "[format %.1f [expr {(double($received) * 1000000)/($elapsed * 1048576)}]] MB/s"
+}
+
+namespace eval proxy {}
+
+# Both fcopy and splice invoke the callback with the byte count and an
+# optional error message, so the same handlers serve both modes.
+proc proxy::forwarded {from to count {error {}}} {
+    if {$error eq ""} {
+        # Propagate the half close so the sink sees EOF and acknowledges.
+        close $to write
+    } else {
+        close $from
+        close $to
+    }
+}
+
+proc proxy::backward {from to count {error {}}} {
+    close $from
+    close $to
+}
+
+proc proxy::accept {mode upaddr upport so addr port} {
+    set up [iocp::inet::socket $upaddr $upport]
+    if {$mode eq "splice"} {
+        iocp::inet::splice $so $up -command [namespace current]::forwarded
+        iocp::inet::splice $up $so -command [namespace current]::backward
+    } else {
+        fconfigure $so -translation binary -blocking 0
+        fconfigure $up -translation binary -blocking 0
+        fcopy $so $up -command [list [namespace current]::forwarded $so $up]
+        fcopy $up $so -command [list [namespace current]::backward $up $so]
+    }
+}
+
+proc proxy::proxy {args} {
+    uplevel #0 package require iocp_inet
+    set port 10104
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set upaddr 127.0.0.1
+    if {[dict exists $args -upstream]} {
+        set upaddr [dict get $args -upstream]
+    }
+    set upport 10105
+    if {[dict exists $args -upport]} {
+        set upport [dict get $args -upport]
+    }
+    set mode splice
+    if {[dict exists $args -mode]} {
+        set mode [dict get $args -mode]
+    }
+    if {$mode ni {fcopy splice}} {
+        error "Unknown mode $mode. Must be fcopy or splice."
+    }
+    set listener [iocp::inet::socket -server [list [namespace current]::accept $mode $upaddr $upport] $port]
+    vwait forever
+}
+
+namespace eval server {}
+
+proc server::read {so} {
+    variable counts
+    incr counts($so) [string length [chan read $so]]
+    if {[eof $so]} {
+        fconfigure $so -blocking 1
+        puts $so $counts($so)
+        close $so
+        unset counts($so)
+    }
+}
+
+proc server::accept {so addr port} {
+    variable counts
+    set counts($so) 0
+    fconfigure $so -blocking 0 -translation binary -buffersize 65536
+    fileevent $so readable [list [namespace current]::read $so]
+}
+
+proc server::server {args} {
+    uplevel #0 package require iocp_inet
+    set port 10105
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set listener [iocp::inet::socket -server [namespace current]::accept $port]
+    vwait forever
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 client|proxy|server|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh proxybench.tcl server ?-port PORT?
+    tclsh proxybench.tcl proxy ?-port PORT? ?-upstream ADDR? ?-upport PORT? ?-mode fcopy|splice?
+    tclsh proxybench.tcl client ?-server ADDR? ?-port PORT? ?-count N? ?-size BYTES?
+
+Start the sink server (default port 10105) and the proxy (default port 10104)
+and then run the client against the proxy. The client sends COUNT blocks of
+BYTES bytes through the proxy to the sink and prints the throughput. The proxy
+forwards data using fcopy or iocp::inet::splice depending on the -mode option.
+Run the proxy under a CPU monitor to compare the processor usage of the two
+modes as well.
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            client {
+                client::client {*}[lrange $argv 1 end]
+            }
+            proxy {
+                proxy::proxy {*}[lrange $argv 1 end]
+            }
+            server {
+                server::server {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
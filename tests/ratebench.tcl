@@ -0,0 +1,150 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh ratebench.tcl help
+#
+# Measures the accuracy and overhead of the -ratelimit socket option by
+# comparing achieved against configured transfer rates.
+
+proc serverAccept {so addr port} {
+    fconfigure $so -blocking 0 -translation binary
+    dict set ::received $so 0
+    fileevent $so readable [list serverRead $so]
+}
+
+proc serverRead {so} {
+    set data [read $so]
+    dict incr ::received $so [string length $data]
+    if {[eof $so]} {
+        close $so
+        dict unset ::received $so
+        if {[dict size $::received] == 0} {
+            set ::done 1
+        }
+    }
+}
+
+proc transfer {port nsockets size limit} {
+    set ::received {}
+    set ::done 0
+    set sockets {}
+    for {set i 0} {$i < $nsockets} {incr i} {
+        set so [iocp::inet::socket 127.0.0.1 $port]
+        fconfigure $so -translation binary -blocking 0
+        if {$limit ne ""} {
+            fconfigure $so -ratelimit $limit
+        }
+        lappend sockets $so
+    }
+    set block [string repeat x 65536]
+    set start [clock microseconds]
+    foreach so $sockets {
+        for {set written 0} {$written < $size} {incr written 65536} {
+            puts -nonewline $so $block
+        }
+        close $so
+    }
+    vwait ::done
+    return [expr {[clock microseconds] - $start}]
+}
+
+proc report {label total elapsed configured} {
+    set achieved [expr {$total * 1000000.0 / ($elapsed ? $elapsed : 1)}]
+    if {$configured} {
+        set accuracy [format "%6.1f%%" [expr {100.0 * $achieved / $configured}]]
+    } else {
+        set accuracy "      -"
+    }
+    puts [format "%-10s %12d bytes in %9.1f ms %12.0f B/s configured %12s B/s %s" \
+              $label $total [expr {$elapsed / 1000.0}] $achieved \
+              [expr {$configured ? $configured : "none"}] $accuracy]
+}
+
+proc bench {args} {
+    uplevel #0 package require iocp_inet
+    set rate [expr {4*1024*1024}]
+    if {[dict exists $args -rate]} {
+        set rate [dict get $args -rate]
+    }
+    set size [expr {16*1024*1024}]
+    if {[dict exists $args -size]} {
+        set size [dict get $args -size]
+    }
+    set nsockets 4
+    if {[dict exists $args -sockets]} {
+        set nsockets [dict get $args -sockets]
+    }
+    set burst 0
+    if {[dict exists $args -burst]} {
+        set burst [dict get $args -burst]
+    }
+
+    set listener [iocp::inet::socket -server serverAccept -myaddr 127.0.0.1 0]
+    set port [lindex [fconfigure $listener -sockname] 2]
+
+    # Baseline without limits gives the overhead reference
+    set elapsed [transfer $port 1 $size ""]
+    report unlimited $size $elapsed 0
+
+    # Single socket with a private bucket
+    set limit [list write $rate]
+    if {$burst} {
+        lappend limit burst $burst
+    }
+    set elapsed [transfer $port 1 $size $limit]
+    report private $size $elapsed $rate
+
+    # Shared bucket capping the aggregate rate of a group of sockets
+    if {$burst} {
+        set limiter [iocp::inet::ratelimit create $rate $burst]
+    } else {
+        set limiter [iocp::inet::ratelimit create $rate]
+    }
+    set elapsed [transfer $port $nsockets $size [list write $limiter]]
+    report "shared x$nsockets" [expr {$nsockets * $size}] $elapsed $rate
+    puts "Limiter stats: [iocp::inet::ratelimit stats $limiter]"
+    iocp::inet::ratelimit destroy $limiter
+
+    close $listener
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 bench|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh ratebench.tcl bench ?-rate BYTES/SEC? ?-size BYTES? ?-sockets N? ?-burst BYTES?
+
+Transfers SIZE bytes (default 16MB) over loopback sockets with non-blocking
+writes and prints the achieved rate for three runs: a single socket with
+no limit, a single socket with a private -ratelimit of RATE bytes/sec
+(default 4MB/s) and N sockets (default 4) sharing a bucket created with
+iocp::inet::ratelimit create RATE. The accuracy column is the achieved
+rate as a percentage of the configured rate. Values slightly above 100%
+reflect the initial burst allowance. The unlimited run gives the upper
+bound against which the overhead of the limiter can be judged. The stats
+of the shared limiter, including the number of times the sockets were
+throttled, are printed at the end.
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            bench {
+                bench {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
@@ -0,0 +1,203 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh schedbench.tcl help
+#
+# Measures the round trip latency of small interactive requests while
+# bulk transfers are in progress on other connections, with and without
+# the iocp::schedule budgets and -priority socket option.
+
+proc bulkAccept {so addr port} {
+    fconfigure $so -blocking 0 -translation binary
+    fileevent $so readable [list bulkRead $so]
+}
+
+proc bulkRead {so} {
+    incr ::bulkReceived [string length [read $so]]
+    if {[eof $so]} {
+        close $so
+    }
+}
+
+proc echoAccept {priority so addr port} {
+    fconfigure $so -blocking 0 -translation lf -buffering line -priority $priority
+    fileevent $so readable [list echoRead $so]
+}
+
+proc echoRead {so} {
+    while {[gets $so line] >= 0} {
+        puts $so $line
+    }
+    if {[eof $so]} {
+        close $so
+    }
+}
+
+proc bulkWrite {so block} {
+    if {$::running} {
+        puts -nonewline $so $block
+    }
+}
+
+proc pingRead {so} {
+    if {[gets $so line] < 0} {
+        return
+    }
+    lappend ::samples [expr {[clock microseconds] - $::sent($so)}]
+    if {[incr ::remaining -1] <= 0} {
+        set ::running 0
+        return
+    }
+    after $::interval [list ping $so]
+}
+
+proc ping {so} {
+    set ::sent($so) [clock microseconds]
+    puts $so ping
+}
+
+proc measure {mode nbulk ninteractive count interval} {
+    iocp::schedule {*}[dict get $::modes $mode schedule]
+    set priority [dict get $::modes $mode priority]
+    set bulkListener [iocp::inet::socket -server bulkAccept -myaddr 127.0.0.1 0]
+    set echoListener [iocp::inet::socket -server [list echoAccept $priority] -myaddr 127.0.0.1 0]
+    set bulkPort [lindex [fconfigure $bulkListener -sockname] 2]
+    set echoPort [lindex [fconfigure $echoListener -sockname] 2]
+
+    set ::bulkReceived 0
+    set ::samples {}
+    set ::remaining [expr {$ninteractive * $count}]
+    set ::interval $interval
+    set ::running 1
+
+    set block [string repeat x 65536]
+    set bulkChans {}
+    for {set i 0} {$i < $nbulk} {incr i} {
+        set so [iocp::inet::socket 127.0.0.1 $bulkPort]
+        fconfigure $so -blocking 0 -translation binary -buffering none
+        fileevent $so writable [list bulkWrite $so $block]
+        lappend bulkChans $so
+    }
+    set chans {}
+    for {set i 0} {$i < $ninteractive} {incr i} {
+        set so [iocp::inet::socket 127.0.0.1 $echoPort]
+        fconfigure $so -blocking 0 -translation lf -buffering line -priority $priority
+        fileevent $so readable [list pingRead $so]
+        lappend chans $so
+    }
+
+    set start [clock microseconds]
+    foreach so $chans {
+        ping $so
+    }
+    while {$::running} {
+        vwait ::running
+    }
+    set elapsed [expr {[clock microseconds] - $start}]
+    foreach so [concat $chans $bulkChans] {
+        close $so
+    }
+    close $bulkListener
+    close $echoListener
+    iocp::schedule -bytes 0 -callbacks 0
+    return [list [lsort -integer $::samples] $::bulkReceived $elapsed]
+}
+
+proc percentile {sorted p} {
+    set n [llength $sorted]
+    if {$n == 0} {
+        return 0
+    }
+    set i [expr {int(ceil($p * $n / 100.0)) - 1}]
+    return [lindex $sorted [expr {$i < 0 ? 0 : $i}]]
+}
+
+proc report {label result} {
+    lassign $result samples received elapsed
+    set secs [expr {($elapsed ? $elapsed : 1) / 1000000.0}]
+    puts [format "%-9s RTT p50 %8.1f ms, p99 %8.1f ms, max %8.1f ms, bulk %8.1f MB/sec" \
+              $label [expr {[percentile $samples 50] / 1000.0}] \
+              [expr {[percentile $samples 99] / 1000.0}] \
+              [expr {[lindex $samples end] / 1000.0}] \
+              [expr {$received / 1048576.0 / $secs}]]
+}
+
+proc bench {args} {
+    uplevel #0 package require iocp_inet
+    set nbulk 4
+    if {[dict exists $args -bulk]} {
+        set nbulk [dict get $args -bulk]
+    }
+    set ninteractive 4
+    if {[dict exists $args -interactive]} {
+        set ninteractive [dict get $args -interactive]
+    }
+    set count 200
+    if {[dict exists $args -count]} {
+        set count [dict get $args -count]
+    }
+    set interval 5
+    if {[dict exists $args -interval]} {
+        set interval [dict get $args -interval]
+    }
+    set bytes 16384
+    if {[dict exists $args -bytes]} {
+        set bytes [dict get $args -bytes]
+    }
+    set callbacks 8
+    if {[dict exists $args -callbacks]} {
+        set callbacks [dict get $args -callbacks]
+    }
+
+    set ::modes [dict create \
+                     default  {schedule {} priority normal} \
+                     budget   [list schedule [list -bytes $bytes -callbacks $callbacks] priority normal] \
+                     priority [list schedule [list -bytes $bytes -callbacks $callbacks] priority high]]
+    foreach mode [dict keys $::modes] {
+        report $mode [measure $mode $nbulk $ninteractive $count $interval]
+    }
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 bench|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh schedbench.tcl bench ?-bulk N? ?-interactive N? ?-count N? ?-interval MS? ?-bytes MAXBYTES? ?-callbacks MAXCALLBACKS?
+
+Runs N bulk loopback connections (default 4) that continuously write 64KB
+blocks while N interactive connections (default 4) each send COUNT short
+lines (default 200), INTERVAL ms apart (default 5), to a line echo server
+in the same process. Repeats the measurement in three modes:
+
+    default  - no scheduling budgets
+    budget   - iocp::schedule -bytes MAXBYTES (default 16384) -callbacks
+               MAXCALLBACKS (default 8)
+    priority - as budget, with the interactive sockets at both ends set to
+               -priority high
+
+Prints the median, 99th percentile and maximum round trip times of the
+interactive requests and the throughput of the bulk connections.
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            bench {
+                bench {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
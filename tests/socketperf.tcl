@@ -27,6 +27,15 @@ namespace path {::tclTestPerf}
 
 ## init:
 
+# Replaces the core socket command with the iocp one in the current thread
+# and sets the event dispatch budget, see iocp::dispatch.
+proc use-iocp {dispatch} {
+  package require iocp_inet
+  rename ::socket ::tcl_socket
+  interp alias {} ::socket {} ::iocp::inet::socket
+  iocp::dispatch $dispatch
+}
+
 proc create-server {} {
   upvar ::in in
   package require Thread
@@ -38,6 +47,10 @@ proc create-server {} {
   # helper worker for server :
   set in(-srv-worker) [thread::create]
   thread::send -async $in(-srv-worker) [list array set in [array get in]]
+  if {$in(-iocp)} {
+    thread::send $in(-srv-worker) [list proc use-iocp {dispatch} [info body use-iocp]]
+    thread::send $in(-srv-worker) [list use-iocp $in(-dispatch)]
+  }
   set ip [thread::send $in(-srv-worker) {
     proc _accept {ch addr port} {
       chan configure $ch -blocking 0
@@ -111,8 +124,10 @@ proc test {{reptime 1000}} {
 
 # if calling direct:
 if {[info exists ::argv0] && [file tail $::argv0] eq [file tail [info script]]} {
-  array set in {-time "1000 500" -server "" -port ""}
+  # -iocp 1 uses iocp sockets, -dispatch N sets the iocp::dispatch budget
+  array set in {-time "1000 500" -server "" -port "" -iocp 0 -dispatch 0}
   array set in $argv 
+  if {$in(-iocp)} { ::tclTestPerf-Socket::use-iocp $in(-dispatch) }
   if {$in(-server) eq "" || $in(-port) eq ""} { ::tclTestPerf-Socket::create-server }
   ::tclTestPerf-Socket::test $in(-time)
   if {[info exists in(-srv-worker)]} { ::tclTestPerf-Socket::stop-server }
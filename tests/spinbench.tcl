@@ -0,0 +1,148 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh spinbench.tcl help
+#
+# Measures the round trip latency of a blocking request/response exchange
+# for different iocp::spin settings.
+
+namespace eval client {}
+
+proc client::client {args} {
+    uplevel #0 package require iocp_inet
+    set addr 127.0.0.1
+    if {[dict exists $args -server]} {
+        set addr [dict get $args -server]
+    }
+    set port 10108
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set count 10000
+    if {[dict exists $args -count]} {
+        set count [dict get $args -count]
+    }
+    set size 64
+    if {[dict exists $args -size]} {
+        set size [dict get $args -size]
+    }
+    set spins {0 20 50 200}
+    if {[dict exists $args -spin]} {
+        set spins [dict get $args -spin]
+    }
+
+    set msg [string repeat x $size]
+    foreach spin $spins {
+        iocp::spin $spin
+        set so [iocp::inet::socket $addr $port]
+        fconfigure $so -translation binary -buffering none -nagle 0
+        # Warm up so the spin time adapts before measuring
+        for {set i 0} {$i < 100} {incr i} {
+            puts -nonewline $so $msg
+            read $so $size
+        }
+        set stats [iocp::stats]
+        set latencies {}
+        for {set i 0} {$i < $count} {incr i} {
+            set start [clock microseconds]
+            puts -nonewline $so $msg
+            if {[string length [read $so $size]] != $size} {
+                error "Short response from server."
+            }
+            lappend latencies [expr {[clock microseconds] - $start}]
+        }
+        close $so
+        set after [iocp::stats]
+        set hits [expr {[dict get $after SpinHits] - [dict get $stats SpinHits]}]
+        set misses [expr {[dict get $after SpinMisses] - [dict get $stats SpinMisses]}]
+        set latencies [lsort -integer $latencies]
+        set total 0
+        foreach latency $latencies {
+            incr total $latency
+        }
+        puts [format "spin %4d us: mean %7.1f us, median %6d us, p99 %6d us, spin hits %7d, misses %7d" \
+                  $spin [expr {double($total)/$count}] \
+                  [lindex $latencies [expr {$count/2}]] \
+                  [lindex $latencies [expr {($count*99)/100}]] \
+                  $hits $misses]
+    }
+    iocp::spin 0
+}
+
+namespace eval server {}
+
+proc server::echo {so size} {
+    set data [read $so $size]
+    if {[eof $so]} {
+        close $so
+        return
+    }
+    puts -nonewline $so $data
+}
+
+proc server::accept {size so addr port} {
+    fconfigure $so -translation binary -buffering none -nagle 0
+    # Blocking reads of a fixed size so the server also exercises spinning
+    fileevent $so readable [list [namespace current]::echo $so $size]
+}
+
+proc server::server {args} {
+    uplevel #0 package require iocp_inet
+    set port 10108
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set size 64
+    if {[dict exists $args -size]} {
+        set size [dict get $args -size]
+    }
+    if {[dict exists $args -spin]} {
+        iocp::spin [dict get $args -spin]
+    }
+    set listener [iocp::inet::socket -server [list [namespace current]::accept $size] $port]
+    vwait forever
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 client|server|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh spinbench.tcl server ?-port PORT? ?-size BYTES? ?-spin MAXMICROSECONDS?
+    tclsh spinbench.tcl client ?-server ADDR? ?-port PORT? ?-count N? ?-size BYTES? ?-spin LIST?
+
+Start the server first, preferably on another system on the same LAN.
+For each value in LIST (default 0 20 50 200), the client sets iocp::spin
+to that value, opens a connection and sends COUNT messages (default
+10000) of SIZE bytes (default 64), waiting for each to be echoed with a
+blocking read before sending the next. SIZE must be the same on both
+ends. Prints the mean, median and 99th percentile round trip times and
+the number of blocking waits that completed while spinning (hits) or
+went to sleep after spinning (misses). The server's own spin setting can
+be set with -spin (default 0).
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            client {
+                client::client {*}[lrange $argv 1 end]
+            }
+            server {
+                server::server {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
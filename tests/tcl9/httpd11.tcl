@@ -153,8 +153,19 @@ proc Service {chan addr port} {
 
         set path [string trimleft $path /]
         set path [file join [pwd] $path]
+        set sendfile 0
         if {[file exists $path] && [file isfile $path]} {
             foreach {what type} [mime-type $path] break
+        }
+        if {[file exists $path] && [file isfile $path] &&
+            $::httpd_mode eq "sendfile" && $req eq "GET"} {
+            # Send the file as is via iocp::inet::sendfile without
+            # reading it into memory. No encoding or chunking.
+            set sendfile 1
+            set data ""
+            set code "200 OK"
+            set close [expr {[dict get? $meta connection] eq "close"}]
+        } elseif {[file exists $path] && [file isfile $path]} {
             set f [open $path r]
             if {$what eq "binary"} {
                 chan configure $f -translation binary
@@ -167,7 +178,11 @@ proc Service {chan addr port} {
             set close [expr {[dict get? $meta connection] eq "close"}]
         }
 
-        if {$protocol eq "HTTP/1.1"} {
+        if {$sendfile} {
+            if {$protocol ne "HTTP/1.1"} {
+                set close 1
+            }
+        } elseif {$protocol eq "HTTP/1.1"} {
 	    foreach enc [split [dict get? $meta accept-encoding] ,] {
 		set enc [string trim $enc]
 		# The current implementation of "compress" appears to be
@@ -205,7 +220,9 @@ proc Service {chan addr port} {
         chan configure $chan -buffering line -encoding iso8859-1 -translation crlf
         Puts $chan "$protocol $code"
         Puts $chan "content-type: $type"
-        Puts $chan [format "x-crc32: %08x" [zlib crc32 $data]]
+        if {!$sendfile} {
+            Puts $chan [format "x-crc32: %08x" [zlib crc32 $data]]
+        }
         if {$req eq "POST"} {
             Puts $chan [format "x-query-length: %d" [string length $query]]
         }
@@ -213,7 +230,9 @@ proc Service {chan addr port} {
             Puts $chan "connection: close"
         }
 	Puts $chan "x-requested-encodings: [dict get? $meta accept-encoding]"
-        if {$encoding eq "identity" && (!$nosendclose)} {
+        if {$sendfile} {
+            Puts $chan "content-length: [file size $path]"
+        } elseif {$encoding eq "identity" && (!$nosendclose)} {
             Puts $chan "content-length: [string length $data]"
         } elseif {$encoding eq "identity"} {
             # This is a blatant attempt to confuse the client by sending neither
@@ -238,7 +257,9 @@ proc Service {chan addr port} {
         } else {
             set encoding2 $encoding
         }
-        if {$transfer eq "chunked"} {
+        if {$sendfile} {
+            iocp::inet::sendfile $chan $path
+        } elseif {$transfer eq "chunked"} {
             blow-chunks $data $chan $encoding2
         } elseif {$encoding2 ne "identity" && $msdeflate eq {1}} {
             puts -nonewline $chan [string range [zlib $encoding2 $data] 2 end-4]
@@ -282,8 +303,18 @@ proc Control {chan} {
     }
 }
 
-proc Main {{port 0}} {
+# mode "sendfile" serves static files with iocp::inet::sendfile for
+# benchmarking file transfer throughput, e.g.
+#   tclsh httpd11.tcl 8080 sendfile
+# A non-zero acceptreceive receives the start of each request along with
+# the accept (see the -acceptreceive socket option), e.g.
+#   tclsh httpd11.tcl 8080 default 4096
+proc Main {{port 0} {mode default} {acceptreceive 0}} {
+    set ::httpd_mode $mode
     set server [socket -server Accept -myaddr localhost $port]
+    if {$acceptreceive} {
+        chan configure $server -acceptreceive $acceptreceive
+    }
     puts [chan configure $server -sockname]
     flush stdout
     chan event stdin readable [list Control stdin]
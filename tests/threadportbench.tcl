@@ -0,0 +1,171 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh threadportbench.tcl help
+#
+# Compares a multi-threaded echo server using the shared completion port
+# against one where each server thread owns its completion port
+# (iocp::configure -completionport thread).
+
+package require Thread
+
+# Script run in each server thread. Returns the listening port.
+set workerScript {
+    package require iocp_inet
+    proc echo {so} {
+        set data [read $so]
+        if {[eof $so]} {
+            close $so
+            return
+        }
+        puts -nonewline $so $data
+    }
+    proc accept {so addr port} {
+        fconfigure $so -blocking 0 -translation binary -buffering none
+        fileevent $so readable [list echo $so]
+    }
+    proc start {mode} {
+        iocp::configure -completionport $mode
+        set listener [iocp::inet::socket -server accept -myaddr 127.0.0.1 0]
+        return [lindex [fconfigure $listener -sockname] 2]
+    }
+}
+
+proc clientRead {so size} {
+    append ::pending($so) [read $so]
+    if {[eof $so]} {
+        error "Server closed connection."
+    }
+    # Wait for the complete message before sending the next one
+    if {[string length $::pending($so)] < $size} {
+        return
+    }
+    set ::pending($so) ""
+    if {[incr ::remaining($so) -1] > 0} {
+        puts -nonewline $so $::msg
+    } else {
+        close $so
+        incr ::done
+    }
+}
+
+proc measure {mode nthreads nconns count size} {
+    # A fresh set of threads for each mode since the completion port
+    # setting of a thread cannot be reverted.
+    set tids {}
+    set ports {}
+    for {set i 0} {$i < $nthreads} {incr i} {
+        set tid [thread::create -preserved]
+        thread::send $tid $::workerScript
+        lappend ports [thread::send $tid [list start $mode]]
+        lappend tids $tid
+    }
+
+    set ::msg [string repeat x $size]
+    set ::done 0
+    set chans {}
+    for {set i 0} {$i < $nconns} {incr i} {
+        set so [iocp::inet::socket 127.0.0.1 [lindex $ports [expr {$i % $nthreads}]]]
+        fconfigure $so -blocking 0 -translation binary -buffering none
+        set ::remaining($so) $count
+        set ::pending($so) ""
+        fileevent $so readable [list clientRead $so $size]
+        lappend chans $so
+    }
+
+    set stats [iocp::stats]
+    set start [clock microseconds]
+    foreach so $chans {
+        puts -nonewline $so $::msg
+    }
+    while {$::done < $nconns} {
+        vwait ::done
+    }
+    set elapsed [expr {[clock microseconds] - $start}]
+    set after [iocp::stats]
+    foreach tid $tids {
+        thread::release -wait $tid
+    }
+    return [list [expr {$nconns * $count}] $elapsed \
+                [expr {[dict get $after ThreadPortCompletions] - [dict get $stats ThreadPortCompletions]}]]
+}
+
+proc report {label result} {
+    lassign $result total elapsed threadport
+    set secs [expr {($elapsed ? $elapsed : 1) / 1000000.0}]
+    puts [format "%-7s %8d round trips in %9.1f ms, %9.0f round trips/sec, thread port completions %8d" \
+              $label $total [expr {$elapsed / 1000.0}] [expr {$total / $secs}] $threadport]
+}
+
+proc bench {args} {
+    uplevel #0 package require iocp_inet
+    set nthreads 4
+    if {[dict exists $args -threads]} {
+        set nthreads [dict get $args -threads]
+    }
+    set nconns 64
+    if {[dict exists $args -connections]} {
+        set nconns [dict get $args -connections]
+    }
+    set count 1000
+    if {[dict exists $args -count]} {
+        set count [dict get $args -count]
+    }
+    set size 100
+    if {[dict exists $args -size]} {
+        set size [dict get $args -size]
+    }
+    set modes {shared thread}
+    if {[dict exists $args -modes]} {
+        set modes [dict get $args -modes]
+    }
+
+    foreach mode $modes {
+        report $mode [measure $mode $nthreads $nconns $count $size]
+    }
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 bench|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh threadportbench.tcl bench ?-threads N? ?-connections N? ?-count N? ?-size BYTES? ?-modes LIST?
+
+Starts N echo server threads (default 4), each with its own loopback
+listener, and opens N connections (default 64) from the main thread
+spread evenly across them. Each connection sends COUNT messages (default
+1000) of SIZE bytes (default 100), waiting for each to be echoed before
+sending the next. For each value in LIST (default shared thread) the
+server threads are created afresh with iocp::configure -completionport
+set to that value.
+
+Prints the number of round trips per second and the number of
+completions that were processed on the per-thread completion ports
+(ThreadPortCompletions in iocp::stats). Cache miss
+counts are not measured by the script; run it under a profiler that
+reads the processor performance counters (for example Windows
+Performance Recorder or VTune) to compare them between the two modes.
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            bench {
+                bench {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
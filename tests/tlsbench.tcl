@@ -0,0 +1,224 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh tlsbench.tcl help
+#
+# Compares the throughput and round trip rate of TLS done natively within
+# the socket channel via the -tls option against a TLS channel stacked on
+# the socket with twapi::tls_socket, as used by tlsecho.tcl.
+
+proc loadCredentials {mode pfx subject} {
+    if {$mode ne "stacked"} {
+        return
+    }
+    uplevel #0 package require twapi
+    set fd [open $pfx rb]
+    set certStore [twapi::cert_temporary_store -pfx [read $fd]]
+    close $fd
+    set serverCert [twapi::cert_store_find_certificate $certStore subject_substring $subject]
+    set ::serverCreds [twapi::sspi_acquire_credentials -credentials [twapi::sspi_schannel_credentials -certificates [list $serverCert]] -package unisp -role server]
+    twapi::cert_release $serverCert
+    twapi::cert_store_release $certStore
+}
+
+proc serverAccept {mode pfx so addr port} {
+    fconfigure $so -blocking 0 -buffering none -translation binary
+    if {$mode eq "native"} {
+        fconfigure $so -tls [list role server certificate $pfx]
+    }
+    fileevent $so readable [list serverRead $so]
+}
+
+proc serverRead {so} {
+    if {[catch {
+        puts -nonewline $so [read $so]
+        if {[eof $so]} {
+            close $so
+        }
+    } msg]} {
+        puts stderr $msg
+        catch {close $so}
+    }
+}
+
+proc server {args} {
+    uplevel #0 package require iocp_inet
+    set port 10101
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set mode native
+    if {[dict exists $args -mode]} {
+        set mode [dict get $args -mode]
+    }
+    set pfx [file join [file dirname [info script]] certs twapitest.pfx]
+    if {[dict exists $args -pfx]} {
+        set pfx [dict get $args -pfx]
+    }
+    set subject twapitestserver
+    if {[dict exists $args -subject]} {
+        set subject [dict get $args -subject]
+    }
+    loadCredentials $mode $pfx $subject
+    switch -exact -- $mode {
+        plain -
+        native {
+            set listener [iocp::inet::socket -server [list serverAccept $mode $pfx] $port]
+        }
+        stacked {
+            set listener [twapi::tls_socket -socketcmd iocp::inet::socket \
+                              -credentials $::serverCreds \
+                              -server [list serverAccept $mode $pfx] $port]
+        }
+        default {
+            error "Unknown mode \"$mode\". Must be plain, native or stacked."
+        }
+    }
+    vwait ::forever
+}
+
+proc connect {mode addr port} {
+    switch -exact -- $mode {
+        plain {
+            set so [iocp::inet::socket $addr $port]
+        }
+        native {
+            set so [iocp::inet::socket $addr $port]
+            fconfigure $so -tls {verify 0}
+        }
+        stacked {
+            uplevel #0 package require twapi
+            set so [twapi::tls_socket -socketcmd iocp::inet::socket \
+                        -verifier [list apply {args {return 1}}] $addr $port]
+        }
+        default {
+            error "Unknown mode \"$mode\". Must be plain, native or stacked."
+        }
+    }
+    fconfigure $so -translation binary -buffering none
+    return $so
+}
+
+proc client {args} {
+    uplevel #0 package require iocp_inet
+    set addr 127.0.0.1
+    if {[dict exists $args -addr]} {
+        set addr [dict get $args -addr]
+    }
+    set port 10101
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set mode native
+    if {[dict exists $args -mode]} {
+        set mode [dict get $args -mode]
+    }
+    set count 10000
+    if {[dict exists $args -count]} {
+        set count [dict get $args -count]
+    }
+    set size [expr {64*1024*1024}]
+    if {[dict exists $args -size]} {
+        set size [dict get $args -size]
+    }
+
+    # Round trips of small messages measure per-record latency
+    set so [connect $mode $addr $port]
+    set msg [string repeat x 100]
+    set start [clock microseconds]
+    for {set i 0} {$i < $count} {incr i} {
+        puts -nonewline $so $msg
+        read $so [string length $msg]
+    }
+    set elapsed [expr {[clock microseconds] - $start}]
+    close $so
+    puts [format "%-8s %8d round trips in %9.1f ms (%.0f/sec)" $mode $count \
+              [expr {$elapsed / 1000.0}] \
+              [expr {$count * 1000000.0 / ($elapsed ? $elapsed : 1)}]]
+
+    # Bulk transfer measures encryption and decryption throughput. Data is
+    # sent from a writable handler so the echo can be read concurrently.
+    set so [connect $mode $addr $port]
+    fconfigure $so -blocking 0
+    set ::block [string repeat 0123456789abcdef 4096]
+    set ::sent 0
+    set ::received 0
+    set ::size $size
+    set start [clock microseconds]
+    fileevent $so writable [list clientWrite $so]
+    fileevent $so readable [list clientRead $so]
+    vwait ::bulkDone
+    set elapsed [expr {[clock microseconds] - $start}]
+    close $so
+    puts [format "%-8s %8d bytes echoed in %9.1f ms (%.1f MB/sec)" $mode \
+              $::received [expr {$elapsed / 1000.0}] \
+              [expr {$::received / 1048576.0 * 1000000.0 / ($elapsed ? $elapsed : 1)}]]
+}
+
+proc clientWrite {so} {
+    if {$::sent >= $::size} {
+        fileevent $so writable {}
+        return
+    }
+    puts -nonewline $so $::block
+    incr ::sent [string length $::block]
+}
+
+proc clientRead {so} {
+    incr ::received [string length [read $so]]
+    if {$::received >= $::size || [eof $so]} {
+        fileevent $so readable {}
+        set ::bulkDone 1
+    }
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 server|client|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh tlsbench.tcl server ?-port PORT? ?-mode MODE? ?-pfx PFXFILE? ?-subject SUBJECT?
+    tclsh tlsbench.tcl client ?-addr ADDR? ?-port PORT? ?-mode MODE? ?-count N? ?-size BYTES?
+
+MODE is one of plain, native or stacked (default native) and must be the
+same for the server and client. In native mode, TLS is enabled on the
+sockets with the -tls option. In stacked mode, the twapi::tls_socket
+command is used to layer TLS over IOCP sockets as in tlsecho.tcl. The plain
+mode does not use TLS and gives the upper bound.
+
+The server echoes all data received. Its certificate and private key are
+read from PFXFILE (default certs/twapitest.pfx). In stacked mode, the
+certificate whose subject contains SUBJECT (default twapitestserver) is
+used. In native mode, the first certificate in the file that has a private
+key is used so the file should only contain the server certificate. The
+client does not verify the server certificate.
+
+The client first times COUNT round trips (default 10000) of 100 byte
+messages and then the echo of SIZE bytes (default 64MB) written and read
+concurrently. Compare the results of the three modes.
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            server {
+                server {*}[lrange $argv 1 end]
+            }
+            client {
+                client {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
@@ -0,0 +1,144 @@
+# Copyright (c) 2026 agent
+# All rights reserved.
+# See LICENSE file for details.
+# For instructions:
+#   tclsh udpbench.tcl help
+#
+# Measures UDP datagram throughput in packets per second when receiving
+# datagrams through the channel with read versus in batches with recvmany.
+
+namespace eval server {
+    variable count 0
+    variable mode recvmany
+    variable size 64
+}
+
+proc server::receive {so} {
+    variable count
+    variable mode
+    variable size
+    if {$mode eq "read"} {
+        # Boundaries are lost so datagrams are counted by size
+        incr count [expr {[string length [read $so]] / $size}]
+    } else {
+        incr count [llength [iocp::inet::recvmany $so]]
+    }
+}
+
+proc server::report {} {
+    variable count
+    variable last
+    set now [clock milliseconds]
+    if {$count} {
+        puts [format "%10.0f datagrams/sec" \
+                  [expr {(1000.0 * $count) / ($now - $last)}]]
+    }
+    set count 0
+    set last $now
+    after 1000 [namespace current]::report
+}
+
+proc server::server {args} {
+    variable mode
+    uplevel #0 package require iocp_inet
+    set port 10108
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    if {[dict exists $args -mode]} {
+        set mode [dict get $args -mode]
+    }
+    if {[dict exists $args -size]} {
+        variable size [dict get $args -size]
+    }
+    set so [iocp::inet::udp -myport $port]
+    if {[dict exists $args -maxpendingreads]} {
+        fconfigure $so -maxpendingreads [dict get $args -maxpendingreads]
+    }
+    fconfigure $so -blocking 0
+    fileevent $so readable [list [namespace current]::receive $so]
+    variable last [clock milliseconds]
+    report
+    vwait forever
+}
+
+namespace eval client {}
+
+proc client::client {args} {
+    uplevel #0 package require iocp_inet
+    set addr 127.0.0.1
+    if {[dict exists $args -server]} {
+        set addr [dict get $args -server]
+    }
+    set port 10108
+    if {[dict exists $args -port]} {
+        set port [dict get $args -port]
+    }
+    set count 1000000
+    if {[dict exists $args -count]} {
+        set count [dict get $args -count]
+    }
+    set size 64
+    if {[dict exists $args -size]} {
+        set size [dict get $args -size]
+    }
+    set batch 32
+    if {[dict exists $args -batch]} {
+        set batch [dict get $args -batch]
+    }
+
+    set so [iocp::inet::udp]
+    fconfigure $so -remote [list $addr $port]
+    set datagrams [lrepeat $batch [list [string repeat x $size]]]
+    set start [clock milliseconds]
+    for {set sent 0} {$sent < $count} {incr sent $batch} {
+        iocp::inet::sendmany $so $datagrams
+        # Let completions drain so sends are not queued without bound
+        update
+    }
+    set elapsed [expr {[clock milliseconds] - $start}]
+    puts [format "Sent %d datagrams of %d bytes in %d ms (%.0f datagrams/sec)" \
+              $sent $size $elapsed [expr {(1000.0 * $sent) / ($elapsed ? $elapsed : 1)}]]
+    close $so
+}
+
+proc usage {} {
+    puts stderr "Usage: [file tail [info nameofexecutable]] $::argv0 client|server|help ?options?"
+}
+
+proc help {} {
+    puts {
+Usage:
+    tclsh udpbench.tcl server ?-port PORT? ?-mode read|recvmany? ?-size BYTES? ?-maxpendingreads N?
+    tclsh udpbench.tcl client ?-server ADDR? ?-port PORT? ?-count N? ?-size BYTES? ?-batch N?
+
+Start the server first. The client sends COUNT datagrams of BYTES bytes,
+BATCH datagrams per sendmany call. The server prints the number of
+datagrams received per second. In read mode, the server reads received
+data with read and counts datagrams assuming they are all BYTES long. In
+recvmany mode (default), all received datagrams are retrieved with a
+single recvmany call. Datagrams not received in time are dropped by the
+system so the received rate may be lower than the send rate.
+    }
+}
+
+if {[string equal -nocase [file normalize [info script]/...] [file normalize $argv0/...]]} {
+    if {[llength $argv] == 0} {
+        usage
+    } else {
+        switch -exact -- [lindex $argv 0] {
+            client {
+                client::client {*}[lrange $argv 1 end]
+            }
+            server {
+                server::server {*}[lrange $argv 1 end]
+            }
+            help {
+                help
+            }
+            default {
+                usage
+            }
+        }
+    }
+}
@@ -21,6 +21,7 @@ IocpModuleState iocpModuleState;
 typedef struct IocpReadyQEntry {
     IocpLink     link;
     IocpChannel *chanPtr;
+    int          priority;      /* Channel priority when queued */
 } IocpReadyQEntry;
 /* TBD - placeholders until free list cache is implemented */
 IOCP_INLINE IocpReadyQEntry *IocpReadyQEntryAllocate() {
@@ -30,6 +31,26 @@ IOCP_INLINE void IocpReadyQEntryFree(IocpReadyQEntry *rqePtr) {
     ckfree(rqePtr);
 }
 
+/*
+ * Completion port owned by a Tcl thread (iocp::configure -completionport).
+ * Channels created by the thread have their handles associated with this
+ * port instead of the shared one. As for the shared port, a single
+ * completion thread dequeues and processes all completions on the port.
+ * The completion routines depend on this as it ensures completions for a
+ * channel, and for the two channels of a splice, are never processed
+ * concurrently. The Tcl thread itself must therefore never dequeue from
+ * the port. Since a handle cannot be moved to another port, a port is
+ * never freed before process exit. When the owning thread exits it is
+ * returned to a pool for reuse and the port's completion thread continues
+ * to service the remaining handles.
+ */
+typedef struct IocpPort {
+    IocpLink link;              /* Links all ports, see iocpPorts */
+    HANDLE   port;              /* The completion port */
+    HANDLE   thread;            /* Completion thread for the port */
+    int      inUse;             /* Whether owned by a Tcl thread */
+} IocpPort;
+
 /*
  * IocpThreadData holds the state specific to a Tcl thread. Note that
  * it is also accessed from the IOCP completion thread so access needs to
@@ -48,6 +69,42 @@ typedef struct IocpThreadData {
      * entries via EventSourceSetup/EventSourceCheck.
      */
     IocpList     readyQ;
+    /*
+     * Poll queue. Channels registered with iocp::watch are queued here
+     * instead of on readyQ and are dequeued by iocp::poll, bypassing the
+     * Tcl event loop. pollCv is signalled when a channel is queued.
+     */
+    IocpList     pollQ;
+    CONDITION_VARIABLE pollCv;
+    /*
+     * Maximum number of ready channels notified directly from
+     * IocpEventSourceCheck in each pass of the event loop. If 0, a Tcl
+     * event is queued for each ready channel instead. Set with
+     * iocp::dispatch.
+     */
+    int          dispatchBudget;
+    /*
+     * Scheduling budgets set with iocp::schedule. A pass is one call to
+     * IocpEventSourceCheck and the processing of the channels it
+     * dequeues. schedCallbacks limits the channels notified per pass and
+     * schedBytes the data read from each non-blocking channel per pass.
+     * Channels over the byte budget are held on deferQ until the next
+     * pass. 0 means no limit.
+     */
+    IocpList     deferQ;
+    unsigned int passId;
+    int          schedBytes;
+    int          schedCallbacks;
+    /*
+     * Busy polling set with iocp::configure -busypoll. Before the event
+     * loop blocks, the thread polls the ready queue for up to busyPoll
+     * microseconds. busyPolling is set while it does so, in which case
+     * IocpReadyQAdd need not alert the thread.
+     */
+    int          busyPoll;
+    int          busyPolling;
+    IocpPort    *portPtr;       /* Own completion port or NULL. Only
+                                 * accessed from the owning thread */
     LONG         numRefs;   /* Number of references to this structure */
     Tcl_ThreadId threadId;  /* Id of corresponding thread */
 } IocpThreadData;
@@ -61,11 +118,50 @@ IOCP_INLINE void IocpThreadDataUnlock(IocpThreadData *tsdPtr) {
 /* Statistics */
 IocpStats iocpStats;
 
+/*
+ * Maximum time in microseconds blocking waits spin before sleeping. Set
+ * with iocp::spin. 0 disables spinning. Spinning is never done on single
+ * processor systems where it only delays the completion thread.
+ */
+static volatile int iocpSpinMax;
+#define IOCP_SPIN_MAX_LIMIT 10000
+/*
+ * Limit on iocp::configure -busypoll. Tcl has no interface to find the
+ * block time required by other event sources, so a due timer can be held
+ * up by up to this long on every pass.
+ */
+#define IOCP_BUSYPOLL_MAX_LIMIT 1000
+static LONGLONG iocpPerfFrequency; /* Races are benign, same value */
+static int      iocpNumProcessors;
+
+/* All per-thread completion ports. See IocpPort. */
+static struct {
+    IocpLock lock;
+    IocpList ports;
+} iocpPorts;
+static Iocp_DoOnceState iocpPortsInitFlag;
+
 /* Prototypes */
-static void IocpRequestEventPoll(IocpChannel *lockedChanPtr);
 static void IocpNotifyChannel(IocpChannel *lockedChanPtr);
+static int  IocpChannelReadyMask(IocpChannel *lockedChanPtr);
+static void IocpChannelReportCompletions(IocpChannel *lockedChanPtr);
 static int  IocpEventHandler(Tcl_Event *evPtr, int flags);
+static int  IocpDispatchDoneHandler(Tcl_Event *evPtr, int flags);
+static void IocpChannelService(IocpChannel *lockedChanPtr);
+static void IocpDispatchReady(IocpThreadData *lockedTsdPtr, int budget);
+static void IocpReadyQInsert(IocpList *listPtr, IocpReadyQEntry *rqePtr);
+static void IocpReadyQRestore(IocpList *listPtr, IocpList *leftPtr);
+static int  IocpSpinInit(void);
+static int  IocpBusyPoll(IocpThreadData *lockedTsdPtr);
+static HANDLE IocpThreadPort(void);
+static IocpPort *IocpPortAcquire(Tcl_Interp *interp);
+static void IocpPortRelease(IocpPort *portPtr);
+static void IocpPortsShutdown(void);
+static void IocpSchedStartPass(IocpThreadData *lockedTsdPtr);
+static int  IocpSchedOverBudget(IocpChannel *lockedChanPtr);
 static int  IocpChannelFileEventMask(IocpChannel *lockedChanPtr);
+static int  IocpBufferCountRecords(IocpChannel *lockedChanPtr,
+                                   const IocpBuffer *bufPtr, int prevByte);
 static void IocpChannelConnectionStep(IocpChannel *lockedChanPtr, int blockable);
 static void IocpChannelExitConnectedState(IocpChannel *lockedChanPtr);
 static void IocpChannelAwaitConnectCompletion(IocpChannel *lockedChanPtr);
@@ -166,6 +262,7 @@ IocpBuffer *IocpBufferNew(
                                  worry about reference counts etc.*/
     bufPtr->winError  = 0;
     bufPtr->operation = op;
+    bufPtr->completionProc = NULL;
     bufPtr->flags     = flags;
     IocpLinkInit(&bufPtr->link);
 
@@ -176,6 +273,33 @@ IocpBuffer *IocpBufferNew(
     return bufPtr;
 }
 
+/*
+ * Allocates an IocpBuffer whose data is the content of a shared data block.
+ *  sharedPtr - block whose reference count is incremented. The reference
+ *              is released when the buffer is freed.
+ *  op        - IOCP_BUFFER_OP_WRITE etc.
+ *  flags     - as for IocpBufferNew. IOCP_BUFFER_F_SHARED is added.
+ *
+ * The data in the buffer must not be modified.
+ *
+ * On success, returns a pointer that should be freed by calling
+ * IocpBufferFree. On failure, returns NULL.
+ */
+IocpBuffer *IocpBufferNewShared(
+    IocpSharedData   *sharedPtr,  /* Data to be referenced */
+    enum IocpBufferOp op,         /* IOCP_BUFFER_OP_WRITE etc. */
+    int               flags)      /* IOCP_BUFFER_F_* */
+{
+    IocpBuffer *bufPtr = IocpBufferNew(0, op, flags | IOCP_BUFFER_F_SHARED);
+    if (bufPtr == NULL)
+        return NULL;
+    InterlockedIncrement(&sharedPtr->numRefs);
+    bufPtr->data.bytes    = sharedPtr->bytes;
+    bufPtr->data.capacity = sharedPtr->len;
+    bufPtr->data.len      = sharedPtr->len;
+    return bufPtr;
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -187,18 +311,81 @@ IocpBuffer *IocpBufferNew(
  *    None.
  *
  * Side effects:
- *    The underlying data buffer is also freed.
+ *    The underlying data buffer is also freed. For a shared buffer, the
+ *    reference to the shared data block is released instead.
  *
  *------------------------------------------------------------------------
  */
 void IocpBufferFree(IocpBuffer *bufPtr)
 {
     IOCP_ASSERT(bufPtr->chanPtr == NULL);
-    IocpDataBufferFini(&bufPtr->data);
+    if (bufPtr->flags & IOCP_BUFFER_F_SHARED) {
+        IocpSharedDataDrop(CONTAINING_RECORD(bufPtr->data.bytes,
+                                             IocpSharedData, bytes));
+    } else {
+        IocpDataBufferFini(&bufPtr->data);
+    }
     IOCP_STATS_INCR(IocpBufferFrees);
     ckfree(bufPtr);
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpSharedDataNew --
+ *
+ *    Allocates a shared data block holding a copy of the passed data.
+ *
+ * Results:
+ *    Pointer to the block with a reference count of 1 held by the caller,
+ *    or NULL if memory could not be allocated.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpSharedData *IocpSharedDataNew(
+    const char *bytes,          /* Data to copy */
+    int         len)            /* Number of bytes */
+{
+    IocpSharedData *sharedPtr;
+
+    sharedPtr = attemptckalloc(offsetof(IocpSharedData, bytes) + (len ? len : 1));
+    if (sharedPtr == NULL)
+        return NULL;
+    IOCP_STATS_INCR_ALWAYS(IocpSharedDataAllocs);
+    sharedPtr->numRefs = 1;
+    sharedPtr->len     = len;
+    memcpy(sharedPtr->bytes, bytes, len);
+    return sharedPtr;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpSharedDataDrop --
+ *
+ *    Releases a reference to a shared data block. May be called from any
+ *    thread.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The block is freed when the last reference is released.
+ *
+ *------------------------------------------------------------------------
+ */
+void IocpSharedDataDrop(
+    IocpSharedData *sharedPtr)  /* Block to release */
+{
+    if (InterlockedDecrement(&sharedPtr->numRefs) == 0) {
+        IOCP_STATS_INCR_ALWAYS(IocpSharedDataFrees);
+        ckfree(sharedPtr);
+    }
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -223,6 +410,9 @@ IocpChannel *IocpChannelNew(
     chanPtr          = ckalloc(vtblPtr->allocationSize);
     IOCP_STATS_INCR(IocpChannelAllocs);
     IocpListInit(&chanPtr->inputBuffers);
+    IocpListInit(&chanPtr->completions);
+    IocpListInit(&chanPtr->heldBuffers);
+    chanPtr->readSeqNext  = 0;
     chanPtr->owningTsdPtr = NULL;
     chanPtr->owningThread  = 0;
     chanPtr->readyQThread = 0;
@@ -235,6 +425,33 @@ IocpChannel *IocpChannelNew(
     chanPtr->pendingWrites    = 0;
     chanPtr->maxPendingReads  = IOCP_MAX_PENDING_READS_DEFAULT;
     chanPtr->maxPendingWrites = IOCP_MAX_PENDING_WRITES_DEFAULT;
+    chanPtr->spliceToPtr      = NULL;
+    chanPtr->spliceFromPtr    = NULL;
+    chanPtr->spliceDoneBufPtr = NULL;
+    chanPtr->splicedBytes     = 0;
+    chanPtr->frameHeaderSize  = 0;
+    chanPtr->frameMaxLength   = 0;
+    chanPtr->frameFlags       = 0;
+    chanPtr->readDelimiterLen = 0;
+    chanPtr->lastInputByte    = -1;
+    chanPtr->inputBytes       = 0;
+    chanPtr->rcvLowat         = 1;
+    chanPtr->readBucketPtr    = NULL;
+    chanPtr->writeBucketPtr   = NULL;
+    chanPtr->rateTimer        = NULL;
+    chanPtr->tlsPtr           = NULL;
+    chanPtr->compressPtr      = NULL;
+    chanPtr->watchMask        = 0;
+    chanPtr->pollMask         = 0;
+    chanPtr->coReadPtr        = NULL;
+    chanPtr->coWritePtr       = NULL;
+    chanPtr->priority         = IOCP_PRIORITY_NORMAL;
+    chanPtr->passId           = 0;
+    chanPtr->passBytes        = 0;
+    chanPtr->spinUsecs        = -1; /* Not yet tuned */
+    chanPtr->port             = IocpThreadPort();
+    if (chanPtr->port == NULL)
+        chanPtr->port = iocpModuleState.completion_port;
     chanPtr->numRefs = 1;
     chanPtr->vtblPtr = vtblPtr;
     InitializeConditionVariable(&chanPtr->cv);
@@ -272,11 +489,24 @@ void IocpChannelDrop(
         if (lockedChanPtr->vtblPtr->finalize)
             lockedChanPtr->vtblPtr->finalize(lockedChanPtr);
 
+        IocpRateRelease(lockedChanPtr);
+        IocpTlsRelease(lockedChanPtr);
+        IocpCompressRelease(lockedChanPtr);
+
         /* If finalize did not free buffers, do our default frees. */
         while ((linkPtr = IocpListPopFront(&lockedChanPtr->inputBuffers)) != NULL) {
             IocpBuffer  *bufPtr = CONTAINING_RECORD(linkPtr, IocpBuffer, link);
             IocpBufferFree(bufPtr);
         }
+        while ((linkPtr = IocpListPopFront(&lockedChanPtr->heldBuffers)) != NULL) {
+            IocpBuffer  *bufPtr = CONTAINING_RECORD(linkPtr, IocpBuffer, link);
+            IocpBufferFree(bufPtr);
+        }
+        /* Completions never reported to Tcl only need their resources freed */
+        while ((linkPtr = IocpListPopFront(&lockedChanPtr->completions)) != NULL) {
+            IocpBuffer  *bufPtr = CONTAINING_RECORD(linkPtr, IocpBuffer, link);
+            bufPtr->completionProc(NULL, bufPtr);
+        }
 
         IocpChannelUnlock(lockedChanPtr);
         IocpLockDelete(&lockedChanPtr->lock);
@@ -462,6 +692,35 @@ static void IocpChannelAwaitConnectCompletion(
     }
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpSpinInit --
+ *
+ *    Initializes the values needed for spinning in blocking waits.
+ *
+ * Results:
+ *    The number of processors in the system.
+ *
+ * Side effects:
+ *    iocpPerfFrequency and iocpNumProcessors are initialized on first
+ *    call.
+ *
+ *------------------------------------------------------------------------
+ */
+static int IocpSpinInit(void)
+{
+    if (iocpNumProcessors == 0) {
+        LARGE_INTEGER frequency;
+        SYSTEM_INFO   si;
+        QueryPerformanceFrequency(&frequency);
+        iocpPerfFrequency = frequency.QuadPart;
+        GetSystemInfo(&si);
+        iocpNumProcessors = si.dwNumberOfProcessors;
+    }
+    return iocpNumProcessors;
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -469,13 +728,17 @@ static void IocpChannelAwaitConnectCompletion(
  *
  *    Releases the lock on a IocpChannel and then blocks until an I/O
  *    completion is signaled. On returning the IocpChannel lock is reacquired.
+ *    If enabled with iocp::spin, the thread first spins for a time based
+ *    on recent waits on the channel to avoid a context switch when the
+ *    completion follows shortly.
  *
  * Results:
  *    None.
  *
  * Side effects:
  *    Because the lock on the IocpChannel is released and reacquired,
- *    the channel state might have changed before returning.
+ *    the channel state might have changed before returning. The spin
+ *    statistics and the channel's spin time are updated.
  *
  *------------------------------------------------------------------------
  */
@@ -483,10 +746,65 @@ void IocpChannelAwaitCompletion(
     IocpChannel *lockedChanPtr,    /* Must be locked on entry */
     int          blockType)        /* Exactly one of IOCP_CHAN_F_BLOCKED_* values  */
 {
+    int           spinMax = iocpSpinMax;
+    int           spinUsecs;
+    LARGE_INTEGER start, now;
+    LONGLONG      deadline, waited;
+
     IOCP_TRACE(("IocpChannelAwaitCompletion Enter: lockedChanPtr=%p, blockType=0x%x\n", lockedChanPtr, blockType));
     lockedChanPtr->flags &= ~ IOCP_CHAN_F_BLOCKED_MASK;
     lockedChanPtr->flags |= blockType;
-    IocpChannelCVWait(lockedChanPtr);
+
+    if (spinMax == 0 || IocpSpinInit() <= 1) {
+        IocpChannelCVWait(lockedChanPtr);
+        IOCP_TRACE(("IocpChannelAwaitCompletion Leave: lockedChanPtr=%p, blockType=0x%x\n", lockedChanPtr, blockType));
+        return;
+    }
+
+    /*
+     * Spin with the channel unlocked so the completion thread can clear
+     * the blocked flag. If it does, the wake it issues is a no-op as there
+     * is no waiter. Otherwise, fall back to the condition variable. The
+     * flag is rechecked under the lock so a completion cannot be missed.
+     */
+    spinUsecs = lockedChanPtr->spinUsecs;
+    if (spinUsecs < 0 || spinUsecs > spinMax)
+        spinUsecs = spinMax;
+    QueryPerformanceCounter(&start);
+    deadline = start.QuadPart + (spinUsecs * iocpPerfFrequency) / 1000000;
+    IocpChannelUnlock(lockedChanPtr);
+    do {
+        YieldProcessor();
+        QueryPerformanceCounter(&now);
+    } while ((*(volatile int *)&lockedChanPtr->flags & blockType) &&
+             now.QuadPart < deadline);
+    IocpChannelLock(lockedChanPtr);
+
+    if (lockedChanPtr->flags & blockType) {
+        IOCP_STATS_INCR_ALWAYS(IocpSpinMisses);
+        IocpChannelCVWait(lockedChanPtr);
+        QueryPerformanceCounter(&now);
+    } else {
+        IOCP_STATS_INCR_ALWAYS(IocpSpinHits);
+    }
+
+    /*
+     * Aim to spin for twice the recent wait times, smoothed over the last
+     * several waits. Waits longer than the maximum are not worth spinning
+     * for so back off, but never below 1us so a change in the traffic
+     * pattern is noticed.
+     */
+    waited = ((now.QuadPart - start.QuadPart) * 1000000) / iocpPerfFrequency;
+    if (waited <= spinMax) {
+        LONGLONG target = 2 * waited;
+        if (target > spinMax)
+            target = spinMax;
+        spinUsecs += (int) ((target - spinUsecs) / 8);
+    } else {
+        spinUsecs -= spinUsecs / 4;
+    }
+    lockedChanPtr->spinUsecs = spinUsecs < 1 ? 1 : spinUsecs;
+
     IOCP_TRACE(("IocpChannelAwaitCompletion Leave: lockedChanPtr=%p, blockType=0x%x\n", lockedChanPtr, blockType));
 }
 
@@ -559,7 +877,7 @@ IocpEventSourceSetup(
     tsdPtr = IocpThreadDataGet(); /* Note: tsdPtr is locked */
     IOCP_ASSERT(tsdPtr != NULL);
 
-    if (tsdPtr->readyQ.headPtr) {
+    if (tsdPtr->readyQ.headPtr || tsdPtr->deferQ.headPtr) {
         /*
          * At least one channel needs to be looked at. Set block time to 0
          * so event loop will poll immediately.
@@ -567,11 +885,306 @@ IocpEventSourceSetup(
         IOCP_TRACE(("IocpEventSourceSetup (Thread %d): Set block time to 0\n", Tcl_GetCurrentThread()));
         Tcl_Time blockTime = { 0, 0 };
         Tcl_SetMaxBlockTime(&blockTime);
+    } else if (tsdPtr->busyPoll > 0 && !(flags & TCL_DONT_WAIT) &&
+               IocpSpinInit() > 1) {
+        if (IocpBusyPoll(tsdPtr)) {
+            Tcl_Time blockTime = { 0, 0 };
+            Tcl_SetMaxBlockTime(&blockTime);
+        }
     }
     IocpThreadDataUnlock(tsdPtr);
     IOCP_TRACE(("IocpEventSourceSetup return (Thread %d)\n", Tcl_GetCurrentThread()));
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * IocpBusyPoll --
+ *
+ *	Polls the ready queue of the current thread for up to the time set
+ *	with iocp::configure -busypoll. This avoids the latency of the
+ *	thread sleeping in the notifier and being woken by Tcl_ThreadAlert
+ *	when a completion arrives shortly. Polling stops early if a message
+ *	arrives for the thread, as the notifier uses these for alerts from
+ *	other threads, e.g. thread::send, as well as for window events.
+ *
+ * Results:
+ *	Non-0 if the ready queue is not empty, 0 if the time expired.
+ *
+ * Side effects:
+ *	The thread data lock is released while polling and reacquired.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+IocpBusyPoll(
+    IocpThreadData *lockedTsdPtr) /* Must be locked. Locked on return */
+{
+    LARGE_INTEGER now;
+    LONGLONG      deadline;
+    int           ready;
+
+    QueryPerformanceCounter(&now);
+    deadline = now.QuadPart + (lockedTsdPtr->busyPoll * iocpPerfFrequency) / 1000000;
+    lockedTsdPtr->busyPolling = 1;
+    IocpThreadDataUnlock(lockedTsdPtr);
+    do {
+        YieldProcessor();
+        if (*(IocpLink * volatile *)&lockedTsdPtr->readyQ.headPtr != NULL)
+            break;
+        if (HIWORD(GetQueueStatus(QS_ALLINPUT)) != 0)
+            break;          /* Other events pending. Let the notifier run. */
+        QueryPerformanceCounter(&now);
+    } while (now.QuadPart < deadline);
+    IocpThreadDataLock(lockedTsdPtr);
+    /*
+     * Checked again under the lock. An entry queued after this will see
+     * busyPolling cleared and alert the thread.
+     */
+    lockedTsdPtr->busyPolling = 0;
+    ready = lockedTsdPtr->readyQ.headPtr != NULL;
+    if (ready)
+        IOCP_STATS_INCR_ALWAYS(IocpBusyPollHits);
+    else
+        IOCP_STATS_INCR_ALWAYS(IocpBusyPollMisses);
+    return ready;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpPortsInit --
+ *
+ *    Initializes the list of per-thread completion ports. Called through
+ *    Iocp_DoOnce.
+ *
+ * Results:
+ *    TCL_OK.
+ *
+ * Side effects:
+ *    The port list lock is initialized.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode IocpPortsInit(ClientData notUsed)
+{
+    IocpLockInit(&iocpPorts.lock);
+    IocpListInit(&iocpPorts.ports);
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpPortAcquire --
+ *
+ *    Gets a completion port for the calling thread, reusing one released
+ *    by an exited thread if possible.
+ *
+ * Results:
+ *    Pointer to the port or NULL on failure with an error message in
+ *    interp.
+ *
+ * Side effects:
+ *    A completion port and its completion thread may be created.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpPort *
+IocpPortAcquire(
+    Tcl_Interp *interp)         /* For error messages */
+{
+    IocpPort *portPtr = NULL;
+    IocpLink *linkPtr;
+
+    (void) Iocp_DoOnce(&iocpPortsInitFlag, IocpPortsInit, NULL);
+
+    IocpLockAcquireExclusive(&iocpPorts.lock);
+    for (linkPtr = iocpPorts.ports.headPtr; linkPtr; linkPtr = linkPtr->nextPtr) {
+        IocpPort *candidatePtr = CONTAINING_RECORD(linkPtr, IocpPort, link);
+        if (!candidatePtr->inUse) {
+            portPtr = candidatePtr;
+            portPtr->inUse = 1;
+            break;
+        }
+    }
+    IocpLockReleaseExclusive(&iocpPorts.lock);
+    if (portPtr)
+        return portPtr;
+
+    portPtr = ckalloc(sizeof(*portPtr));
+    /* Only the port's completion thread ever dequeues. See IocpPort. */
+    portPtr->port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, (ULONG_PTR)NULL, 1);
+    if (portPtr->port == NULL) {
+        Iocp_ReportLastWindowsError(interp, "couldn't create completion port: ");
+        ckfree(portPtr);
+        return NULL;
+    }
+    portPtr->thread =
+        CreateThread(NULL, 0, IocpCompletionThread, portPtr->port, 0, NULL);
+    if (portPtr->thread == NULL) {
+        Iocp_ReportLastWindowsError(interp, "couldn't create completion thread: ");
+        CloseHandle(portPtr->port);
+        ckfree(portPtr);
+        return NULL;
+    }
+    portPtr->inUse = 1;
+    IocpLockAcquireExclusive(&iocpPorts.lock);
+    IocpListAppend(&iocpPorts.ports, &portPtr->link);
+    IocpLockReleaseExclusive(&iocpPorts.lock);
+    return portPtr;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpPortRelease --
+ *
+ *    Returns a per-thread completion port to the pool when its owning
+ *    thread exits.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The port may be reused by another thread. Its completion thread
+ *    continues to service handles already attached to it.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpPortRelease(
+    IocpPort *portPtr)          /* Port to release */
+{
+    IocpLockAcquireExclusive(&iocpPorts.lock);
+    portPtr->inUse = 0;
+    IocpLockReleaseExclusive(&iocpPorts.lock);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpPortsShutdown --
+ *
+ *    Stops the completion threads of all per-thread completion ports and
+ *    frees the ports. Called at process exit.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    As above.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpPortsShutdown(void)
+{
+    IocpLink *linkPtr;
+
+    if (iocpPortsInitFlag == 0)
+        return;                 /* Never initialized */
+    IocpLockAcquireExclusive(&iocpPorts.lock);
+    while ((linkPtr = IocpListPopFront(&iocpPorts.ports)) != NULL) {
+        IocpPort *portPtr = CONTAINING_RECORD(linkPtr, IocpPort, link);
+        /* As for the shared port in IocpProcessCleanup */
+        PostQueuedCompletionStatus(portPtr->port, 0, 0, 0);
+        if (WaitForSingleObject(portPtr->thread, 500) == WAIT_TIMEOUT) {
+            TerminateThread(portPtr->thread, 0xdead);
+        }
+        CloseHandle(portPtr->thread);
+        CloseHandle(portPtr->port);
+        ckfree(portPtr);
+    }
+    IocpLockReleaseExclusive(&iocpPorts.lock);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpThreadPort --
+ *
+ *    Returns the completion port owned by the calling thread.
+ *
+ * Results:
+ *    The port handle or NULL if the thread uses the shared port.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static HANDLE
+IocpThreadPort(void)
+{
+    IocpThreadData *tsdPtr;
+
+    /* portPtr is only modified by the owning thread so no lock needed */
+    tsdPtr = TlsGetValue(iocpModuleState.tlsIndex);
+    return tsdPtr && tsdPtr->portPtr ? tsdPtr->portPtr->port : NULL;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpAttachDefaultPort --
+ *
+ *    Associates a handle with the completion port owned by the calling
+ *    thread, if any, or with the shared completion port. Only for handles
+ *    of a channel the calling thread is about to create with
+ *    IocpChannelNew, which picks the same port. See IocpChannelAttachPort.
+ *
+ * Results:
+ *    The port handle on success, NULL on failure with the error
+ *    available through GetLastError.
+ *
+ * Side effects:
+ *    All completions for the handle are queued to the port.
+ *
+ *------------------------------------------------------------------------
+ */
+HANDLE
+IocpAttachDefaultPort(
+    HANDLE h)                   /* Handle to attach */
+{
+    HANDLE port = IocpThreadPort();
+    return CreateIoCompletionPort(h,
+                                  port ? port : iocpModuleState.completion_port,
+                                  0, /* Completion key - unused */
+                                  0);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelAttachPort --
+ *
+ *    Associates a handle with the completion port of a channel. Must be
+ *    used instead of IocpAttachDefaultPort for handles of an existing
+ *    channel as the channel may have moved to another thread, or the
+ *    call may be made from a completion thread. All handles of a channel
+ *    must be on the same port so its completions are never processed
+ *    by two completion threads at the same time.
+ *
+ * Results:
+ *    The port handle on success, NULL on failure with the error
+ *    available through GetLastError.
+ *
+ * Side effects:
+ *    All completions for the handle are queued to the port.
+ *
+ *------------------------------------------------------------------------
+ */
+HANDLE
+IocpChannelAttachPort(
+    IocpChannel *chanPtr,       /* Channel the handle belongs to */
+    HANDLE       h)             /* Handle to attach */
+{
+    return CreateIoCompletionPort(h, chanPtr->port,
+                                  0, /* Completion key - unused */
+                                  0);
+}
+
 /*
  *----------------------------------------------------------------------
  *
@@ -598,6 +1211,8 @@ IocpEventSourceCheck(
     IocpList        readyQ;
     IocpLink       *linkPtr;
     Tcl_ThreadId    threadId;
+    int             budget;
+    int             queued = 0;
 
     IOCP_TRACE(("IocpEventSourceCheck Enter (Thread %d): flags=0x%x\n", Tcl_GetCurrentThread(), flags));
 
@@ -610,11 +1225,33 @@ IocpEventSourceCheck(
     tsdPtr = IocpThreadDataGet(); /* Note: tsdPtr is locked */
     IOCP_ASSERT(tsdPtr != NULL);  /* As long thread lives! */
 
+    IocpSchedStartPass(tsdPtr);
+    budget = tsdPtr->schedCallbacks;
+
+    if (tsdPtr->dispatchBudget > 0) {
+        if (budget == 0 || budget > tsdPtr->dispatchBudget)
+            budget = tsdPtr->dispatchBudget;
+        IocpDispatchReady(tsdPtr, budget); /* Unlocks tsdPtr */
+        IOCP_TRACE(("IocpEventSourceCheck return (Thread %d): direct dispatch\n", Tcl_GetCurrentThread()));
+        return;
+    }
+
     readyQ = IocpListPopAll(&tsdPtr->readyQ);
     IocpThreadDataUnlock(tsdPtr);
 
     while ((linkPtr = IocpListPopFront(&readyQ)) != NULL) {
         IocpReadyQEntry *rqePtr = CONTAINING_RECORD(linkPtr, IocpReadyQEntry, link);
+        if (budget > 0 && queued >= budget) {
+            /*
+             * Over the callback budget. Leave the rest for the next pass
+             * ahead of entries that were queued meanwhile.
+             */
+            IocpListPrepend(&readyQ, linkPtr);
+            IocpThreadDataLock(tsdPtr);
+            IocpReadyQRestore(&tsdPtr->readyQ, &readyQ);
+            IocpThreadDataUnlock(tsdPtr);
+            break;
+        }
         if (rqePtr->chanPtr != NULL) {
             IocpChannel *lockedChanPtr = rqePtr->chanPtr;
             IocpChannelLock(lockedChanPtr);
@@ -640,6 +1277,7 @@ IocpEventSourceCheck(
                 IOCP_TRACE(("IocpEventSourceCheck (Thread %d): lockedChanPtr=%p queued to event queue.\n", Tcl_GetCurrentThread(), lockedChanPtr));
                 IocpChannelUnlock(lockedChanPtr);
                 Tcl_QueueEvent((Tcl_Event *) evPtr, TCL_QUEUE_TAIL);
+                queued++;
             }
             else {
                 /* Channel not attached to this thread or already queued */
@@ -653,13 +1291,272 @@ IocpEventSourceCheck(
 }
 
 /*
- *------------------------------------------------------------------------
+ *----------------------------------------------------------------------
  *
- * IocpChannelNudgeThread --
+ * IocpDispatchReady --
  *
- *    Wakes up the thread owning a channel if it is blocked for I/O
- *    completion or if not, places the channel on the ready queue for
- *    the owning thread and alerts the thread.
+ *	Notifies up to budget channels on the ready queue of the current
+ *	thread directly instead of queueing a Tcl event for each. Channels
+ *	beyond the budget are left on the ready queue for the next pass of
+ *	the event loop so that timers and other event sources are not
+ *	starved.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Channel event handlers are run. A single Tcl event is queued if any
+ *	channel was notified so that Tcl_DoOneEvent returns to its caller
+ *	(e.g. vwait) instead of waiting for the next event.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+IocpDispatchReady(
+    IocpThreadData *lockedTsdPtr, /* Must be locked. Unlocked on return */
+    int             budget)       /* Maximum number of channels to notify */
+{
+    IocpLink     *linkPtr;
+    Tcl_ThreadId  threadId = lockedTsdPtr->threadId;
+    int           dispatched = 0;
+
+    /*
+     * Entries are popped one at a time as the handlers may reenter the
+     * event loop which will then process the rest of the queue itself.
+     */
+    while (budget-- > 0 &&
+           (linkPtr = IocpListPopFront(&lockedTsdPtr->readyQ)) != NULL) {
+        IocpReadyQEntry *rqePtr = CONTAINING_RECORD(linkPtr, IocpReadyQEntry, link);
+        IocpChannel     *chanPtr = rqePtr->chanPtr;
+
+        /* Lock hierarchy - tsd must not be locked when locking a channel */
+        IocpThreadDataUnlock(lockedTsdPtr);
+        if (chanPtr != NULL) {
+            IocpChannelLock(chanPtr);
+            rqePtr->chanPtr = NULL;
+            chanPtr->readyQThread = 0; /* Enable further enqueing */
+            /*
+             * As in IocpEventSourceCheck, ignore channels moved to other
+             * threads and those with an event queued before dispatch mode
+             * was changed. The latter will be handled by IocpEventHandler.
+             */
+            if (chanPtr->owningThread == threadId &&
+                chanPtr->eventQThread != threadId) {
+                IocpChannelService(chanPtr);
+                dispatched++;
+            }
+            IocpChannelDrop(chanPtr); /* Deref from rqePtr */
+        }
+        IocpReadyQEntryFree(rqePtr);
+        IocpThreadDataLock(lockedTsdPtr);
+    }
+    IocpThreadDataUnlock(lockedTsdPtr);
+
+    if (dispatched) {
+        Tcl_Event *evPtr = ckalloc(sizeof(*evPtr));
+        evPtr->proc = IocpDispatchDoneHandler;
+        Tcl_QueueEvent(evPtr, TCL_QUEUE_TAIL);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * IocpDispatchDoneHandler --
+ *
+ *	Event handler for the event queued by IocpDispatchReady. All work
+ *	has already been done.
+ *
+ * Results:
+ *	Always 1 so the event is removed.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+IocpDispatchDoneHandler(
+    Tcl_Event *evPtr,           /* Not used */
+    int        flags)           /* Not used */
+{
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * IocpSchedStartPass --
+ *
+ *	Starts a new scheduling pass for the current thread. Channels that
+ *	were deferred in the previous pass for exceeding their byte budget
+ *	are moved back to the ready queue.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The pass counter is incremented. The thread data lock may be
+ *	released and reacquired.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+IocpSchedStartPass(
+    IocpThreadData *lockedTsdPtr) /* Must be locked. Locked on return */
+{
+    IocpList  deferQ;
+    IocpLink *linkPtr;
+
+    lockedTsdPtr->passId++;
+    if (lockedTsdPtr->deferQ.headPtr == NULL)
+        return;
+
+    deferQ = IocpListPopAll(&lockedTsdPtr->deferQ);
+    /* Lock hierarchy - tsd must not be locked when locking a channel */
+    IocpThreadDataUnlock(lockedTsdPtr);
+    while ((linkPtr = IocpListPopFront(&deferQ)) != NULL) {
+        IocpReadyQEntry *rqePtr = CONTAINING_RECORD(linkPtr, IocpReadyQEntry, link);
+        IocpChannel     *chanPtr = rqePtr->chanPtr;
+        if (chanPtr != NULL) {
+            IocpChannelLock(chanPtr);
+            chanPtr->flags &= ~IOCP_CHAN_F_SCHED_DEFERRED;
+            if (chanPtr->owningThread == lockedTsdPtr->threadId)
+                IocpReadyQAdd(chanPtr, 0);
+            IocpChannelDrop(chanPtr); /* Deref from rqePtr */
+        }
+        IocpReadyQEntryFree(rqePtr);
+    }
+    IocpThreadDataLock(lockedTsdPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * IocpSchedOverBudget --
+ *
+ *	Checks whether a channel has read its share of data in the current
+ *	scheduling pass of the calling thread as set by iocp::schedule. If
+ *	so, the channel is deferred to the next pass.
+ *
+ * Results:
+ *	Non-0 if the channel is over budget, 0 otherwise.
+ *
+ * Side effects:
+ *	The channel's byte count is reset at the start of each pass. An
+ *	over budget channel is placed on the thread's deferred queue.
+ *
+ *----------------------------------------------------------------------
+ */
+static int
+IocpSchedOverBudget(
+    IocpChannel *lockedChanPtr) /* Must be locked */
+{
+    IocpThreadData  *tsdPtr;
+    IocpReadyQEntry *rqePtr;
+
+    /* passId and schedBytes are only modified by the owning thread */
+    tsdPtr = TlsGetValue(iocpModuleState.tlsIndex);
+    if (tsdPtr == NULL || tsdPtr->schedBytes == 0)
+        return 0;
+    if (lockedChanPtr->passId != tsdPtr->passId) {
+        lockedChanPtr->passId    = tsdPtr->passId;
+        lockedChanPtr->passBytes = 0;
+        return 0;
+    }
+    if (lockedChanPtr->passBytes < tsdPtr->schedBytes)
+        return 0;
+
+    if ((lockedChanPtr->flags & IOCP_CHAN_F_SCHED_DEFERRED) == 0) {
+        rqePtr = IocpReadyQEntryAllocate();
+        rqePtr->chanPtr  = lockedChanPtr;
+        rqePtr->priority = lockedChanPtr->priority;
+        lockedChanPtr->numRefs += 1; /* Will be unrefed on dequeing from deferQ */
+        lockedChanPtr->flags |= IOCP_CHAN_F_SCHED_DEFERRED;
+        IocpThreadDataLock(tsdPtr);
+        IocpListAppend(&tsdPtr->deferQ, &rqePtr->link);
+        IocpThreadDataUnlock(tsdPtr);
+    }
+    return 1;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelSetPriority --
+ *
+ *    Sets the scheduling priority of a channel. Channels of higher
+ *    priority are placed ahead of those of lower priority on the ready
+ *    queue of the owning thread.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR with an error message in interp
+ *    otherwise.
+ *
+ * Side effects:
+ *    Sets the channel priority. Entries already on a ready queue keep
+ *    their position.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode
+IocpChannelSetPriority(
+    Tcl_Interp  *interp,        /* For error messages. May be NULL */
+    IocpChannel *lockedChanPtr, /* Must be locked */
+    const char  *value)         /* high, normal or low */
+{
+    static const char *const priorities[] = {"high", "normal", "low", NULL};
+    int i;
+
+    for (i = 0; priorities[i]; ++i) {
+        if (!strcmp(value, priorities[i])) {
+            lockedChanPtr->priority = i; /* Same order as IOCP_PRIORITY_* */
+            return TCL_OK;
+        }
+    }
+    if (interp) {
+        Tcl_SetObjResult(interp,
+                         Tcl_ObjPrintf("bad priority \"%s\": must be high, normal or low", value));
+    }
+    Tcl_SetErrno(EINVAL);
+    return TCL_ERROR;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelGetPriority --
+ *
+ *    Stores the scheduling priority of a channel in dsPtr.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The priority is appended to dsPtr as a list element.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpChannelGetPriority(
+    IocpChannel *lockedChanPtr, /* Must be locked */
+    Tcl_DString *dsPtr)         /* Where to store the value */
+{
+    switch (lockedChanPtr->priority) {
+    case IOCP_PRIORITY_HIGH: Tcl_DStringAppendElement(dsPtr, "high"); break;
+    case IOCP_PRIORITY_LOW:  Tcl_DStringAppendElement(dsPtr, "low"); break;
+    default:                 Tcl_DStringAppendElement(dsPtr, "normal"); break;
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelNudgeThread --
+ *
+ *    Wakes up the thread owning a channel if it is blocked for I/O
+ *    completion or if not, places the channel on the ready queue for
+ *    the owning thread and alerts the thread.
  *
  * Results:
  *    None.
@@ -726,6 +1623,16 @@ IocpThreadInit()
         tsdPtr = ckalloc(sizeof(*tsdPtr));
         IocpLockInit(&tsdPtr->lock);
         IocpListInit(&tsdPtr->readyQ);
+        IocpListInit(&tsdPtr->pollQ);
+        InitializeConditionVariable(&tsdPtr->pollCv);
+        tsdPtr->dispatchBudget = 0;
+        IocpListInit(&tsdPtr->deferQ);
+        tsdPtr->passId         = 0;
+        tsdPtr->schedBytes     = 0;
+        tsdPtr->schedCallbacks = 0;
+        tsdPtr->busyPoll       = 0;
+        tsdPtr->busyPolling    = 0;
+        tsdPtr->portPtr        = NULL;
         tsdPtr->numRefs = 1;    /* Corresponding decrement at thread exit */
         tsdPtr->threadId = Tcl_GetCurrentThread();
         TlsSetValue(iocpModuleState.tlsIndex, tsdPtr);
@@ -761,16 +1668,27 @@ IocpThreadDataDrop(
     if (lockedTsdPtr->numRefs == 1) {
         /* Final reference. Free up everything */
         IocpList         readyQ;
+        IocpList         pollQ;
+        IocpList         deferQ;
         IocpLink        *linkPtr;
 
         readyQ = IocpListPopAll(&lockedTsdPtr->readyQ);
+        pollQ  = IocpListPopAll(&lockedTsdPtr->pollQ);
+        deferQ = IocpListPopAll(&lockedTsdPtr->deferQ);
         IocpThreadDataUnlock(lockedTsdPtr);
         ckfree(lockedTsdPtr);
 
+        while ((linkPtr = IocpListPopFront(&pollQ)) != NULL) {
+            IocpListAppend(&readyQ, linkPtr);
+        }
+        while ((linkPtr = IocpListPopFront(&deferQ)) != NULL) {
+            IocpListAppend(&readyQ, linkPtr);
+        }
         while ((linkPtr = IocpListPopFront(&readyQ)) != NULL) {
             IocpReadyQEntry *rqePtr = CONTAINING_RECORD(linkPtr, IocpReadyQEntry, link);
             if (rqePtr->chanPtr != NULL) {
                 IocpChannelLock(rqePtr->chanPtr);
+                rqePtr->chanPtr->flags &= ~(IOCP_CHAN_F_POLL_QUEUED | IOCP_CHAN_F_SCHED_DEFERRED);
                 IocpChannelDrop(rqePtr->chanPtr);
             }
             IocpReadyQEntryFree(rqePtr);
@@ -828,6 +1746,8 @@ IocpThreadDataGet()
  *    Adds a channel to the ready queue for the thread owning the channel.
  *    If the channel is already on the ready queue for the thread, an
  *    additional entry is added only if the force parameter is true.
+ *    Channels registered with iocp::watch are added to the poll queue
+ *    instead, at most once.
  *
  *    Caller must be holding a lock on lockedChanPtr but NOT ON the the
  *    target thread's TSD (only an issue when called from the same thread)
@@ -869,7 +1789,13 @@ void IocpReadyQAdd(
      * dispatch within target thread and new owner is handled by the channel
      * attach/detach code.
      */
-    if (lockedChanPtr->owningThread == lockedChanPtr->readyQThread && !force) {
+    if (lockedChanPtr->flags & IOCP_CHAN_F_POLLED) {
+        /* iocp::poll computes readiness afresh so one entry suffices */
+        if (lockedChanPtr->flags & IOCP_CHAN_F_POLL_QUEUED) {
+            IOCP_TRACE(("IocpReadyQAdd Return (already on poll queue): lockedChanPtr=%p\n", lockedChanPtr));
+            return;
+        }
+    } else if (lockedChanPtr->owningThread == lockedChanPtr->readyQThread && !force) {
         IOCP_TRACE(("IocpReadyQAdd Return (already queued and !force): lockedChanPtr=%p\n", lockedChanPtr));
         return;
     }
@@ -888,20 +1814,34 @@ void IocpReadyQAdd(
         IocpThreadDataUnlock(tsdPtr);
         IocpReadyQEntryFree(rqePtr);
         IOCP_TRACE(("IocpReadyQAdd Return (TSD owningThread=0): lockedChanPtr=%p\n", lockedChanPtr));
+    } else if (lockedChanPtr->flags & IOCP_CHAN_F_POLLED) {
+        rqePtr->chanPtr = lockedChanPtr;
+        lockedChanPtr->numRefs += 1; /* Will be unrefed on dequeing from pollQ */
+        lockedChanPtr->flags |= IOCP_CHAN_F_POLL_QUEUED;
+        IocpListAppend(&tsdPtr->pollQ, &rqePtr->link);
+        /* Wake the thread if it is waiting in iocp::poll */
+        WakeConditionVariable(&tsdPtr->pollCv);
+        IocpThreadDataUnlock(tsdPtr);
+        IOCP_TRACE(("IocpReadyQAdd Return (Entry added to poll queue of thread %d): lockedChanPtr=%p\n", lockedChanPtr->owningThread, lockedChanPtr));
     } else {
         Tcl_ThreadId tid = tsdPtr->threadId; /* needed after unlocking */
+        int          busyPolling = tsdPtr->busyPolling;
 
         rqePtr->chanPtr = lockedChanPtr;
         lockedChanPtr->numRefs += 1; /* Will be unrefed on dequeing from readyq */
 
         /* Remember last thread to which the channel was queued. */
         lockedChanPtr->readyQThread = lockedChanPtr->owningThread;
-        IocpListAppend(&tsdPtr->readyQ, &rqePtr->link);
+        rqePtr->priority = lockedChanPtr->priority;
+        IocpReadyQInsert(&tsdPtr->readyQ, rqePtr);
 
         IocpThreadDataUnlock(tsdPtr);
 
-        /* If not queueing to current thread, need to poke the target thread */
-        if (tid != Tcl_GetCurrentThread()) {
+        /*
+         * If not queueing to current thread, need to poke the target thread
+         * unless it is busy polling and will see the entry anyways.
+         */
+        if (tid != Tcl_GetCurrentThread() && !busyPolling) {
             Tcl_ThreadAlert(tid); /* Poke the thread to look for work */
         }
 
@@ -909,6 +1849,87 @@ void IocpReadyQAdd(
     }
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpReadyQInsert --
+ *
+ *    Inserts a ready queue entry in priority order. Entries of the same
+ *    priority are kept in FIFO order. Since nearly all channels are
+ *    normal priority, the list is scanned from the end that is closest
+ *    to the insertion point.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The entry is linked into the list.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpReadyQInsert(
+    IocpList        *listPtr,   /* Ready queue. Owning tsd must be locked */
+    IocpReadyQEntry *rqePtr)    /* Entry to insert */
+{
+    IocpLink *linkPtr;
+
+    if (rqePtr->priority == IOCP_PRIORITY_HIGH) {
+        /* Before the first entry of lower priority */
+        for (linkPtr = listPtr->headPtr; linkPtr; linkPtr = linkPtr->nextPtr) {
+            if (CONTAINING_RECORD(linkPtr, IocpReadyQEntry, link)->priority != IOCP_PRIORITY_HIGH)
+                break;
+        }
+        IocpListInsertBefore(listPtr, linkPtr, &rqePtr->link);
+    } else if (rqePtr->priority == IOCP_PRIORITY_NORMAL) {
+        /* After the last entry of equal or higher priority */
+        for (linkPtr = listPtr->tailPtr; linkPtr; linkPtr = linkPtr->prevPtr) {
+            if (CONTAINING_RECORD(linkPtr, IocpReadyQEntry, link)->priority != IOCP_PRIORITY_LOW)
+                break;
+        }
+        IocpListInsertBefore(listPtr,
+                             linkPtr ? linkPtr->nextPtr : listPtr->headPtr,
+                             &rqePtr->link);
+    } else {
+        IocpListAppend(listPtr, &rqePtr->link);
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpReadyQRestore --
+ *
+ *    Puts back entries previously popped off a ready queue. Each is
+ *    placed at the head of its priority class, in the original order,
+ *    so that it is not overtaken by entries queued since.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The entries are moved from leftPtr, which is left empty, to listPtr.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpReadyQRestore(
+    IocpList *listPtr,          /* Ready queue. Owning tsd must be locked */
+    IocpList *leftPtr)          /* Entries in priority order */
+{
+    IocpLink *posPtr = listPtr->headPtr;
+    IocpLink *linkPtr;
+
+    /* Both lists are in priority order so a single merge pass suffices */
+    while ((linkPtr = IocpListPopFront(leftPtr)) != NULL) {
+        int priority = CONTAINING_RECORD(linkPtr, IocpReadyQEntry, link)->priority;
+        while (posPtr &&
+               CONTAINING_RECORD(posPtr, IocpReadyQEntry, link)->priority < priority)
+            posPtr = posPtr->nextPtr;
+        IocpListInsertBefore(listPtr, posPtr, linkPtr);
+    }
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -925,7 +1946,7 @@ void IocpReadyQAdd(
  *
  *------------------------------------------------------------------------
  */
-static void
+void
 IocpRequestEventPoll(
     IocpChannel *lockedChanPtr  /* Must be locked on entry */
     )
@@ -946,6 +1967,8 @@ Iocp_DoOnceState iocpProcessCleanupFlag;
 static IocpTclCode IocpProcessCleanup(ClientData clientdata)
 {
     if (iocpModuleState.initialized) {
+        IocpPortsShutdown();
+
         /* Tell completion port thread to exit and wait for it */
         PostQueuedCompletionStatus(iocpModuleState.completion_port, 0, 0, 0);
         if (WaitForSingleObject(iocpModuleState.completion_thread, 500)
@@ -972,10 +1995,15 @@ IocpThreadExitHandler(ClientData unused)
     IocpThreadData *tsdPtr = IocpThreadDataGet();
     if (tsdPtr) {
         /* NOTE: tsdPtr is already LOCKED by IocpThreadDataGet! */
+        IocpPort *portPtr = tsdPtr->portPtr;
+        tsdPtr->portPtr = NULL;
         TlsSetValue(iocpModuleState.tlsIndex, NULL);
         tsdPtr->threadId = 0; /* So IOCP thread knows this is an orphan */
         IocpThreadDataDrop(tsdPtr);
         Tcl_DeleteEventSource(IocpEventSourceSetup, IocpEventSourceCheck, NULL);
+        /* Port and its completion thread stay alive for remaining handles */
+        if (portPtr)
+            IocpPortRelease(portPtr);
     }
 }
 
@@ -1091,10 +2119,29 @@ IocpChannelClose (
 
     IocpChannelLock(chanPtr);
 
+    /* Break any splices so the peer stops forwarding to us */
+    if (chanPtr->spliceToPtr || chanPtr->spliceFromPtr)
+        IocpSpliceDetach(chanPtr);
+
+    /* Let the TLS peer know no more data will be sent */
+    if (chanPtr->tlsPtr)
+        IocpTlsShutdown(chanPtr);
+
+    /* Terminate the compressed stream */
+    if (chanPtr->compressPtr)
+        IocpCompressShutdown(chanPtr);
+
     /* Call specific IOCP type to close OS handles */
     ret = (chanPtr->vtblPtr->shutdown)(interp, chanPtr,
                                              TCL_CLOSE_READ|TCL_CLOSE_WRITE);
 
+    /* Detached from the thread so no rate timer is pending */
+    IocpRateRelease(chanPtr);
+
+    /* Coroutines waiting on the channel must not wait forever */
+    if (chanPtr->coReadPtr || chanPtr->coWritePtr)
+        IocpCoChannelClosed(chanPtr);
+
     /* Irrespective of errors in above call, we're done with this channel */
     chanPtr->state   = IOCP_STATE_CLOSED;
     chanPtr->channel = NULL;
@@ -1201,8 +2248,19 @@ IocpChannelInput (
             bytesRead     = -1;
             goto vamoose;
         }
-        /* Blocking connection. Wait for incoming data or eof */
-        winError = IocpChannelPostReads(chanPtr); /* Ensure read is posted */
+        /*
+         * Blocking connection. Wait for incoming data or eof. With a rate
+         * limit, first wait for tokens. Repeat if a shared bucket was
+         * drained by another channel in the meanwhile.
+         */
+        do {
+            if (chanPtr->readBucketPtr)
+                IocpRateAwait(chanPtr, IOCP_CHAN_F_RATE_READ_WAIT); /* Unlocks and relocks! */
+            winError = IocpChannelPostReads(chanPtr); /* Ensure read is posted */
+        } while (winError == 0 && chanPtr->pendingReads == 0 &&
+                 chanPtr->inputBuffers.headPtr == NULL &&
+                 chanPtr->state == IOCP_STATE_OPEN &&
+                 (chanPtr->flags & IOCP_CHAN_F_RATE_READ_WAIT));
         if (winError != 0) {
             IOCP_TRACE(("IocpChannelInput returning (error on posting reads): chanPtr=%p, state=0x%x, winError=0x%x\n", chanPtr, chanPtr->state, winError));
             bytesRead = -1;
@@ -1219,6 +2277,15 @@ IocpChannelInput (
          */
     }
 
+    /* Let other channels have a turn if this one has had its share */
+    if ((chanPtr->flags & IOCP_CHAN_F_NONBLOCKING) &&
+        chanPtr->inputBuffers.headPtr && IocpSchedOverBudget(chanPtr)) {
+        IOCP_TRACE(("IocpChannelInput returning (over budget, EAGAIN): chanPtr=%p\n", chanPtr));
+        *errorCodePtr = EAGAIN;
+        bytesRead     = -1;
+        goto vamoose;
+    }
+
     /*
      * At this point, a NULL inputBuffers queue implies error or eof. Note
      * there is no need to check channel state. As long as there is input data
@@ -1228,6 +2295,7 @@ IocpChannelInput (
     while (remaining && chanPtr->inputBuffers.headPtr) {
         IocpBuffer *bufPtr = CONTAINING_RECORD(chanPtr->inputBuffers.headPtr, IocpBuffer, link);
         int numCopied;
+        int isDatagram = (bufPtr->flags & IOCP_BUFFER_F_DATAGRAM) != 0;
         winError = bufPtr->winError;
         if (winError == 0) {
             IOCP_TRACE(("IocpChannelInput (copying from buffer): chanPtr=%p state=0x%x bufPtr=%p bufPtr->data.len=%d\n", chanPtr, chanPtr->state, bufPtr, bufPtr->data.len));
@@ -1236,13 +2304,18 @@ IocpChannelInput (
             outPtr    += numCopied;
             remaining -= numCopied;
             bytesRead += numCopied;
+            chanPtr->inputBytes -= numCopied;
             if (IocpBufferLength(bufPtr) == 0) {
                 /* No more bytes in that buffer. Free it after removing from list */
                 IocpListPopFront(&chanPtr->inputBuffers);
                 /* TBD - optimize to reuse buffer for next receive */
                 IocpBufferFree(bufPtr);
+            } else if (chanPtr->readDelimiterLen) {
+                /* Only count the records remaining in the buffer */
+                bufPtr->context[0].i = IocpBufferCountRecords(chanPtr, bufPtr, -1);
             }
-            if (numCopied == 0) {
+            /* Empty datagrams are valid and do not signify EOF */
+            if (numCopied == 0 && !isDatagram) {
                 chanPtr->flags |= IOCP_CHAN_F_REMOTE_EOF;
                 break;
             }
@@ -1271,6 +2344,8 @@ IocpChannelInput (
         }
     }
 
+    chanPtr->passBytes += bytesRead; /* See IocpSchedOverBudget */
+
     if ((chanPtr->flags & IOCP_CHAN_F_REMOTE_EOF) == 0 &&
         chanPtr->state == IOCP_STATE_OPEN) {
         /* No remote EOF seen, post additional reads. */
@@ -1379,8 +2454,32 @@ IocpChannelOutput (
          * We loop because for blocking case we will keep retrying.
          */
         while (chanPtr->state == IOCP_STATE_OPEN) {
+            /* Hold back the write while the rate limit is exceeded */
+            if (chanPtr->writeBucketPtr) {
+                if (chanPtr->flags & IOCP_CHAN_F_NONBLOCKING) {
+                    if (IocpRateThrottled(chanPtr, IOCP_CHAN_F_RATE_WRITE_WAIT)) {
+                        *errorCodePtr = EAGAIN;
+                        written = -1;
+                        break;
+                    }
+                } else {
+                    IocpRateAwait(chanPtr, IOCP_CHAN_F_RATE_WRITE_WAIT); /* Unlocks and relocks! */
+                    if (chanPtr->state != IOCP_STATE_OPEN)
+                        break;
+                }
+            }
             IOCP_TRACE(("IocpChannelOutput Posting write: chanPtr=%p, state=%d, nbytes=%d\n", chanPtr, chanPtr->state, nbytes));
-            winError = chanPtr->vtblPtr->postwrite(chanPtr, bytes, nbytes, &written);
+            if (chanPtr->compressPtr) {
+                winError = IocpCompressPostWrite(chanPtr, bytes, nbytes, &written);
+            } else if (chanPtr->tlsPtr == NULL) {
+                winError = chanPtr->vtblPtr->postwrite(chanPtr, bytes, nbytes, &written);
+            } else if (chanPtr->flags & IOCP_CHAN_F_TLS_HANDSHAKE) {
+                /* Data can only be encrypted once the handshake completes */
+                winError = ERROR_SUCCESS;
+                written  = 0;
+            } else {
+                winError = IocpTlsPostWrite(chanPtr, bytes, nbytes, &written);
+            }
             IOCP_TRACE(("IocpChannelOutput Posted write returned: winError=0x%x, chanPtr=%p, state=%d, written=%d\n", winError, chanPtr, chanPtr->state, written));
             if (winError != ERROR_SUCCESS) {
                 IocpSetTclErrnoFromWin32(winError);
@@ -1388,8 +2487,11 @@ IocpChannelOutput (
                 written = -1;
                 break;
             }
-            if (written != 0)
+            if (written != 0) {
+                if (chanPtr->writeBucketPtr)
+                    IocpRateConsume(chanPtr->writeBucketPtr, written);
                 break;              /* Wrote some data */
+            }
             /*
              * Would block. If non-blocking, advise caller to try later.
              * If blocking socket, wait for previous writes to complete.
@@ -1581,28 +2683,13 @@ IocpChannelGetOption (
 /*
  *------------------------------------------------------------------------
  *
- * IocpChannelFileEventMask
- *
- *    If the Tcl channel system has registered interest in file events
- *    and generates the mask to pass to Tcl_NotifyChannel based on current
- *    channel state.
- *
- *    For reading, inform if
- *    1. Tcl in watching the input side AND
- *    2. the channel is not shutdown for reads AND
- *    3. one of the following two conditions is met
- *       a) end of file, OR
- *       b) input data is available
+ * IocpBufferCountRecords --
  *
- *    For writing, inform if
- *    1. Tcl in watching the output side AND
- *    2. the channel is not shutdown for writes AND
- *    3. one of the following two condition is met
- *       a) end of file, OR
- *       b) an unnotified write has completed AND there is room for more writes
+ *    Counts the read delimiters ending within the unconsumed data in a
+ *    buffer. The buffer need not be on the channel's input queue.
  *
  * Results:
- *    None.
+ *    Number of delimiters found.
  *
  * Side effects:
  *    None.
@@ -1610,27 +2697,360 @@ IocpChannelGetOption (
  *------------------------------------------------------------------------
  */
 static int
-IocpChannelFileEventMask(
-    IocpChannel *lockedChanPtr  /* Must be locked on entry */
-    )
+IocpBufferCountRecords(
+    IocpChannel      *lockedChanPtr, /* Must be locked, delimiter set */
+    const IocpBuffer *bufPtr,        /* Buffer to scan */
+    int               prevByte)      /* Byte preceding the buffer data in
+                                      * the stream, -1 if unknown. Only used
+                                      * if no data has been consumed. */
 {
-    int readyMask = 0;
-    IOCP_TRACE(("IocpChannelFileEventMask Enter: chanPtr=%p chanPtr->flags=0x%x inputBuffers.headPtr=%p pendingWrites=%d maxPendingWrites=%d.\n", lockedChanPtr, lockedChanPtr->flags, lockedChanPtr->inputBuffers.headPtr, lockedChanPtr->pendingWrites, lockedChanPtr->maxPendingWrites));
-    if ((lockedChanPtr->flags & IOCP_CHAN_F_WATCH_INPUT) &&
-        !(lockedChanPtr->flags & IOCP_CHAN_F_WRITEONLY) &&
-        ((lockedChanPtr->flags & IOCP_CHAN_F_REMOTE_EOF) ||
-         lockedChanPtr->inputBuffers.headPtr)) {
-        readyMask |= TCL_READABLE;
+    const char *start = bufPtr->data.bytes;
+    const char *p;
+    const char *end;
+    char        last;
+    int         count = 0;
+
+    if (start == NULL || bufPtr->winError != ERROR_SUCCESS)
+        return 0;
+    p    = start + bufPtr->data.begin;
+    end  = p + bufPtr->data.len;
+    last = lockedChanPtr->readDelimiter[lockedChanPtr->readDelimiterLen - 1];
+
+    /*
+     * memchr is vectorized in the C runtime so locate the last byte of the
+     * delimiter with it and then check any preceding byte. Consumed bytes
+     * are still present in the buffer so p[-1] is valid except at the
+     * start of the buffer.
+     */
+    while (p < end && (p = memchr(p, last, end - p)) != NULL) {
+        if (lockedChanPtr->readDelimiterLen == 1)
+            ++count;
+        else if (p > start) {
+            if (p[-1] == lockedChanPtr->readDelimiter[0])
+                ++count;
+        } else if (prevByte == (unsigned char) lockedChanPtr->readDelimiter[0])
+            ++count;
+        ++p;
     }
-    if ((lockedChanPtr->flags & IOCP_CHAN_F_WATCH_OUTPUT) &&        /* 1 */
-        !(lockedChanPtr->flags & IOCP_CHAN_F_READONLY) &&           /* 2 */
-        ((lockedChanPtr->flags & IOCP_CHAN_F_REMOTE_EOF) ||         /* 3a */
-         ((lockedChanPtr->flags & IOCP_CHAN_F_NOTIFY_WRITES) &&        /* 3b */
-          lockedChanPtr->pendingWrites < lockedChanPtr->maxPendingWrites))) {
-        readyMask |= TCL_WRITABLE;
+    return count;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelQueueInput --
+ *
+ *    Appends a buffer of received data to the channel's input queue.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The buffer is owned by the channel. If a read delimiter is set, the
+ *    records ending in the buffer are counted.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpChannelQueueInput(
+    IocpChannel *lockedChanPtr, /* Must be locked */
+    IocpBuffer  *bufPtr)        /* Buffer to queue */
+{
+    if (lockedChanPtr->readDelimiterLen)
+        bufPtr->context[0].i = IocpBufferCountRecords(
+            lockedChanPtr, bufPtr, lockedChanPtr->lastInputByte);
+    if (bufPtr->winError == ERROR_SUCCESS && bufPtr->data.len > 0) {
+        lockedChanPtr->lastInputByte = (unsigned char)
+            bufPtr->data.bytes[bufPtr->data.begin + bufPtr->data.len - 1];
+        lockedChanPtr->inputBytes += bufPtr->data.len;
     }
-    IOCP_TRACE(("IocpChannelFileEventMask return: readyMask=0x%x.\n", readyMask));
-    return readyMask;
+    IocpListAppend(&lockedChanPtr->inputBuffers, &bufPtr->link);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelSetReadDelimiter --
+ *
+ *    Sets the record delimiter for the channel. The delimiter may be empty
+ *    to turn off record detection or one or two ASCII characters.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    Records in already queued input are recounted.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode
+IocpChannelSetReadDelimiter(
+    Tcl_Interp  *interp,        /* For error reporting. May be NULL */
+    IocpChannel *lockedChanPtr, /* Locked on entry, locked on exit */
+    const char  *delimPtr)      /* New delimiter */
+{
+    size_t    len = strlen(delimPtr);
+    size_t    i;
+    IocpLink *linkPtr;
+    int       prevByte = -1;
+
+    for (i = 0; i < len; ++i) {
+        if (delimPtr[i] & 0x80)
+            break;
+    }
+    if (len > sizeof(lockedChanPtr->readDelimiter) || i != len) {
+        if (interp)
+            Tcl_SetResult(interp, "Invalid read delimiter. Must be empty or one or two ASCII characters.", TCL_STATIC);
+        Tcl_SetErrno(EINVAL);
+        return TCL_ERROR;
+    }
+    memcpy(lockedChanPtr->readDelimiter, delimPtr, len);
+    lockedChanPtr->readDelimiterLen = (int) len;
+    if (len == 0)
+        return TCL_OK;
+
+    for (linkPtr = lockedChanPtr->inputBuffers.headPtr;
+         linkPtr != NULL;
+         linkPtr = linkPtr->nextPtr) {
+        IocpBuffer *bufPtr = CONTAINING_RECORD(linkPtr, IocpBuffer, link);
+        bufPtr->context[0].i = IocpBufferCountRecords(lockedChanPtr, bufPtr, prevByte);
+        if (bufPtr->winError == ERROR_SUCCESS && bufPtr->data.len > 0)
+            prevByte = (unsigned char)
+                bufPtr->data.bytes[bufPtr->data.begin + bufPtr->data.len - 1];
+    }
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelRecordCount --
+ *
+ *    Returns the number of complete records queued on the channel input.
+ *
+ * Results:
+ *    Number of records or 0 if no read delimiter is set.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+int
+IocpChannelRecordCount(
+    IocpChannel *lockedChanPtr) /* Must be locked */
+{
+    IocpLink *linkPtr;
+    int       count = 0;
+
+    if (lockedChanPtr->readDelimiterLen == 0)
+        return 0;
+    for (linkPtr = lockedChanPtr->inputBuffers.headPtr;
+         linkPtr != NULL;
+         linkPtr = linkPtr->nextPtr) {
+        count += CONTAINING_RECORD(linkPtr, IocpBuffer, link)->context[0].i;
+    }
+    return count;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelRecordReady --
+ *
+ *    Checks whether the queued input contains a complete record, end of
+ *    file or an error. To bound memory, input is also treated as ready
+ *    if too much data without a delimiter has been queued.
+ *
+ * Results:
+ *    Non-0 if ready, 0 otherwise.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static int
+IocpChannelRecordReady(
+    IocpChannel *lockedChanPtr) /* Must be locked */
+{
+    IocpLink *linkPtr;
+    int       queued = 0;
+
+    for (linkPtr = lockedChanPtr->inputBuffers.headPtr;
+         linkPtr != NULL;
+         linkPtr = linkPtr->nextPtr) {
+        IocpBuffer *bufPtr = CONTAINING_RECORD(linkPtr, IocpBuffer, link);
+        if (bufPtr->winError != ERROR_SUCCESS || bufPtr->data.len == 0 ||
+            bufPtr->context[0].i > 0)
+            return 1;
+        queued += bufPtr->data.len;
+        if (queued >= IOCP_READ_DELIMITER_MAX_QUEUED)
+            return 1;
+    }
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelBelowLowat --
+ *
+ *    Checks whether the input queued on the channel is short of its
+ *    receive low watermark. The input queue is never below the watermark
+ *    if its last buffer marks end of file or an error since no more data
+ *    will follow.
+ *
+ * Results:
+ *    Non-0 if below the watermark, 0 otherwise.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+int
+IocpChannelBelowLowat(
+    IocpChannel *lockedChanPtr) /* Must be locked */
+{
+    IocpBuffer *bufPtr;
+
+    if (lockedChanPtr->rcvLowat <= 1 ||
+        lockedChanPtr->frameHeaderSize != 0 ||
+        lockedChanPtr->readDelimiterLen != 0 ||
+        lockedChanPtr->inputBytes >= lockedChanPtr->rcvLowat)
+        return 0;
+    if (lockedChanPtr->inputBuffers.tailPtr == NULL)
+        return 1;
+    bufPtr = CONTAINING_RECORD(lockedChanPtr->inputBuffers.tailPtr, IocpBuffer, link);
+    return bufPtr->winError == ERROR_SUCCESS && bufPtr->data.len != 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelInputReady --
+ *
+ *    Checks whether the queued input should be reported to Tcl taking into
+ *    account any message framing or read delimiter.
+ *
+ * Results:
+ *    Non-0 if ready, 0 otherwise.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+int
+IocpChannelInputReady(
+    IocpChannel *lockedChanPtr) /* Must be locked */
+{
+    if (lockedChanPtr->frameHeaderSize != 0)
+        return IocpFrameReady(lockedChanPtr);
+    if (lockedChanPtr->readDelimiterLen != 0)
+        return IocpChannelRecordReady(lockedChanPtr);
+    return lockedChanPtr->inputBuffers.headPtr != NULL &&
+        !IocpChannelBelowLowat(lockedChanPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelFileEventMask
+ *
+ *    If the Tcl channel system has registered interest in file events
+ *    and generates the mask to pass to Tcl_NotifyChannel based on current
+ *    channel state.
+ *
+ *    For reading, inform if
+ *    1. Tcl in watching the input side AND
+ *    2. the channel is not shutdown for reads AND
+ *    3. one of the following two conditions is met
+ *       a) end of file, OR
+ *       b) input data is available. If message framing or a read
+ *          delimiter is enabled, a complete message or record (or an
+ *          error) must be available.
+ *
+ *    For writing, inform if
+ *    1. Tcl in watching the output side AND
+ *    2. the channel is not shutdown for writes AND
+ *    3. one of the following two condition is met
+ *       a) end of file, OR
+ *       b) an unnotified write has completed AND there is room for more writes
+ *          AND writes are not held back by a rate limit or TLS handshake
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static int
+IocpChannelFileEventMask(
+    IocpChannel *lockedChanPtr  /* Must be locked on entry */
+    )
+{
+    int readyMask = 0;
+    IOCP_TRACE(("IocpChannelFileEventMask Enter: chanPtr=%p chanPtr->flags=0x%x inputBuffers.headPtr=%p pendingWrites=%d maxPendingWrites=%d.\n", lockedChanPtr, lockedChanPtr->flags, lockedChanPtr->inputBuffers.headPtr, lockedChanPtr->pendingWrites, lockedChanPtr->maxPendingWrites));
+    if ((lockedChanPtr->flags & IOCP_CHAN_F_WATCH_INPUT) &&
+        !(lockedChanPtr->flags & IOCP_CHAN_F_WRITEONLY) &&
+        ((lockedChanPtr->flags & IOCP_CHAN_F_REMOTE_EOF) ||
+         IocpChannelInputReady(lockedChanPtr))) {
+        readyMask |= TCL_READABLE;
+    }
+    if ((lockedChanPtr->flags & IOCP_CHAN_F_WATCH_OUTPUT) &&        /* 1 */
+        !(lockedChanPtr->flags & IOCP_CHAN_F_READONLY) &&           /* 2 */
+        ((lockedChanPtr->flags & IOCP_CHAN_F_REMOTE_EOF) ||         /* 3a */
+         ((lockedChanPtr->flags & IOCP_CHAN_F_NOTIFY_WRITES) &&        /* 3b */
+          !(lockedChanPtr->flags & (IOCP_CHAN_F_RATE_WRITE_WAIT|IOCP_CHAN_F_TLS_HANDSHAKE)) &&
+          lockedChanPtr->pendingWrites < lockedChanPtr->maxPendingWrites))) {
+        readyMask |= TCL_WRITABLE;
+    }
+    IOCP_TRACE(("IocpChannelFileEventMask return: readyMask=0x%x.\n", readyMask));
+    return readyMask;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelUpdateWatch --
+ *
+ *    Sets the IOCP_CHAN_F_WATCH_* flags, which control whether the owning
+ *    thread is alerted on I/O completion, from the events of interest to
+ *    Tcl, iocp::watch and suspended iocp::co commands.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    Channel flags are updated.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpChannelUpdateWatch(
+    IocpChannel *lockedChanPtr)  /* Must be locked */
+{
+    int mask;
+
+    /* Events registered with iocp::watch take precedence over Tcl's */
+    if (lockedChanPtr->flags & IOCP_CHAN_F_POLLED)
+        mask = lockedChanPtr->pollMask;
+    else
+        mask = lockedChanPtr->watchMask;
+    if (lockedChanPtr->coReadPtr)
+        mask |= TCL_READABLE;
+    if (lockedChanPtr->coWritePtr)
+        mask |= TCL_WRITABLE;
+
+    lockedChanPtr->flags &= ~ (IOCP_CHAN_F_WATCH_INPUT | IOCP_CHAN_F_WATCH_OUTPUT);
+    if (mask & TCL_READABLE)
+        lockedChanPtr->flags |= IOCP_CHAN_F_WATCH_INPUT;
+    if (mask & TCL_WRITABLE)
+        lockedChanPtr->flags |= IOCP_CHAN_F_WATCH_OUTPUT;
 }
 
 static void
@@ -1657,16 +3077,15 @@ IocpChannelWatch(
      */
     chanPtr->numRefs += 1;
 
-    chanPtr->flags &= ~ (IOCP_CHAN_F_WATCH_INPUT | IOCP_CHAN_F_WATCH_OUTPUT);
-    if (mask & TCL_READABLE)
-        chanPtr->flags |= IOCP_CHAN_F_WATCH_INPUT;
+    chanPtr->watchMask = mask;
     if (mask & TCL_WRITABLE) {
         /*
          * Writeable event notifications are only posted if a previous
          * write completed and app is watching output.
          */
-        chanPtr->flags |= IOCP_CHAN_F_NOTIFY_WRITES | IOCP_CHAN_F_WATCH_OUTPUT;
+        chanPtr->flags |= IOCP_CHAN_F_NOTIFY_WRITES;
     }
+    IocpChannelUpdateWatch(chanPtr);
 
     /*
      * If any events are pending, mark the channel as ready and
@@ -1712,6 +3131,11 @@ IocpChannelClose2 (
      */
     chanPtr->numRefs += 1;
 
+    if ((flags & TCL_CLOSE_WRITE) && chanPtr->tlsPtr)
+        IocpTlsShutdown(chanPtr);
+    if ((flags & TCL_CLOSE_WRITE) && chanPtr->compressPtr)
+        IocpCompressShutdown(chanPtr);
+
     /* Call specific IOCP type to close OS handles */
     ret = (chanPtr->vtblPtr->shutdown)(interp, chanPtr, flags);
 
@@ -1819,6 +3243,11 @@ void IocpChannelThreadAction(
         break;
 
     case TCL_CHANNEL_THREAD_REMOVE:
+        /* The rate timer belongs to this thread. Next owner reschedules. */
+        IocpRateCancelTimer(chanPtr);
+        /* iocp::watch registrations are specific to the thread */
+        chanPtr->flags &= ~(IOCP_CHAN_F_POLLED | IOCP_CHAN_F_POLL_QUEUED);
+        chanPtr->pollMask = 0;
         chanPtr->owningThread = 0;
         chanPtr->owningTsdPtr = NULL;
         break;
@@ -1832,122 +3261,403 @@ void IocpChannelThreadAction(
 /*
  *------------------------------------------------------------------------
  *
- * IocpNotifyChannel --
+ * IocpChannelReportCompletions --
  *
- *    Notifies the Tcl channel subsystem of file events if it has asked
- *    for them. The notification is made through Tcl_NotifyChannel which
- *    can call back into the driver so lockedChanPtr is unlocked before
- *    calling that function and relocked on return. Caller has to ensure
- *    it is holding a reference to lockedChanPtr so it does not disappear
- *    while unlocked. In case of EOF, Tcl_NotifyChannel will be called
- *    continuously until the callback closes the channel.
+ *    Invokes the completion procedures for all IOCP_BUFFER_OP_TRANSMIT
+ *    operations queued on the channel by the completion thread.
  *
  * Results:
  *    None.
  *
  * Side effects:
- *    File event callbacks are invoked, the IocpChannel state may change.
+ *    The completion procedures may run scripts which may change channel
+ *    state, including closing the channel. Caller must hold a reference.
  *
  *------------------------------------------------------------------------
  */
-static void IocpNotifyChannel(
+static void IocpChannelReportCompletions(
     IocpChannel *lockedChanPtr  /* Locked on entry, locked on return but
-                                 * unlocked in between */
+                                 * may be unlocked in between */
     )
 {
-    int         readyMask;
-    Tcl_Channel channel;
-
-    IOCP_TRACE(("IocpNotifyChannel Enter: chanPtr=%p, chanPtr->state=0x%x, chanPtr->channel=%p\n", lockedChanPtr, lockedChanPtr->state, lockedChanPtr->channel));
-    channel = lockedChanPtr->channel; /* Get before unlocking */
-    if (channel == NULL)
-        return;                 /* Tcl channel has gone away */
-    readyMask = IocpChannelFileEventMask(lockedChanPtr);
-    IOCP_TRACE(("IocpNotifyChannel : chanPtr=%p, chanPtr->state=0x%x, readyMask=0x%x\n", lockedChanPtr, lockedChanPtr->state, readyMask));
-    if (readyMask == 0) {
-        IOCP_TRACE(("IocpNotifyChannel return: chanPtr=%p, readyMask=0x%x\n", lockedChanPtr, readyMask));
-        return;                 /* Nothing to notify */
-    }
-
-    if (readyMask & TCL_WRITABLE) {
-        /*
-         * We do not want to keep notifying if we have already notified
-         * of writes unless more writes complete. The NOTIFY_WRITES flag
-         * is set when the write IOCPs complete. We reset it here if we
-         * notify Tcl that channel is writable and then we will not again
-         * trigger notification unless more write IOCPs complete.
-         */
-        lockedChanPtr->flags &= ~ IOCP_CHAN_F_NOTIFY_WRITES;
-    }
-
-    /*
-     * Unlock before calling Tcl_NotifyChannel which may recurse via the
-     * callback script which again calls us through the channel commands.
-     * Note the IocpChannel will not be freed when unlocked as caller
-     * should hold a reference to it.
-     */
-    IocpChannelUnlock(lockedChanPtr);
-    Tcl_NotifyChannel(channel, readyMask);
-    IocpChannelLock(lockedChanPtr);
-
-    IOCP_TRACE(("IocpNotifyChannel after Tcl_NotifyChannel: chanPtr=%p, chanPtr->state=0x%x, chanPtr->flags=0x%x\n", lockedChanPtr, lockedChanPtr->state, lockedChanPtr->flags));
-
-#ifdef TBD  /* Needed? */
-    if (lockedChanPtr->flags & IOCP_CHAN_F_REMOTE_EOF) {
-        /*
-         * In case of EOF, we have to keep notifying until application closes
-         * the channel. Originally we were looping calling Tcl_NotifyChannel.
-         * However that does not work in the case of applications that do
-         * not close the channel in the callback but rather set some vwait
-         * variable and close it after the vwait completes. A hard loop
-         * here will not allow them to do that so we post an event to
-         * the Tcl event loop instead.
-         */
+    IocpLink *linkPtr;
 
-        /* Recompute ready mask in case callback turned off handlers */
-        readyMask = IocpChannelFileEventMask(lockedChanPtr);
-        IOCP_TRACE(("IocpNotifyChannel EOF: chanPtr=%p, chanPtr->state=0x%x, chanPtr->flags=0x%x, readyMask=0x%x\n", lockedChanPtr, lockedChanPtr->state, lockedChanPtr->flags, readyMask));
-        if (readyMask != 0) {
-            IocpChannelEnqueueEvent(lockedChanPtr, IOCP_EVENT_NOTIFY_CHANNEL, 1);
-        }
+    while (lockedChanPtr->state != IOCP_STATE_CLOSED &&
+           (linkPtr = IocpListPopFront(&lockedChanPtr->completions)) != NULL) {
+        IocpBuffer *bufPtr = CONTAINING_RECORD(linkPtr, IocpBuffer, link);
+        bufPtr->completionProc(lockedChanPtr, bufPtr);
     }
-#endif
-    IOCP_TRACE(("IocpNotifyChannel return: chanPtr=%p, chanPtr->state=0x%x, chanPtr->flags=0x%x\n", lockedChanPtr, lockedChanPtr->state, lockedChanPtr->flags));
 }
 
-
 /*
  *------------------------------------------------------------------------
  *
- * IocpEventHandler --
+ * IocpChannelRemoveCompletion --
  *
- *    Called from the event loop. Processes all ready channels and notifies
- *    the Tcl channel subsystem of state changes.
+ *    Removes a specific buffer from the channel's completions queue. Used
+ *    by callers that wait synchronously for a IOCP_BUFFER_OP_TRANSMIT
+ *    operation to complete.
  *
  * Results:
- *    Returns 0 if the event is to be kept on the event loop queue, and
- *    1 if it can be discarded.
+ *    1 if the buffer was found and removed, 0 if it is not on the queue,
+ *    i.e. the operation has not completed yet.
  *
  * Side effects:
- *    All channels marked as ready may change state. Tcl channel subsystem
- *    may be notified as appropriate.
+ *    The buffer is unlinked from the queue.
  *
  *------------------------------------------------------------------------
  */
-static int
-IocpEventHandler(
-    Tcl_Event *evPtr,           /* Pointer to the Tcl_Event structure.
-                                 * Contents immaterial */
-    int        flags            /* TCL_FILE_EVENTS */
-    )
+int IocpChannelRemoveCompletion(
+    IocpChannel *lockedChanPtr, /* Must be locked on entry */
+    IocpBuffer  *bufPtr)        /* Buffer to remove */
 {
-    IocpChannel *chanPtr;
-
-    IOCP_TRACE(("IocpEventHandler Enter: chanPtr=%p, flags=0x%x.\n", ((IocpTclEvent *)evPtr)->chanPtr, flags));
-
-    if (!(flags & TCL_FILE_EVENTS)) {
-        IOCP_TRACE(("IocpEventHandler return: chanPtr=%p, ! TCL_FILE_EVENTS.\n", ((IocpTclEvent *)evPtr)->chanPtr));
-        return 0;               /* We are not to process file/network events */
+    IocpLink *linkPtr;
+
+    for (linkPtr = lockedChanPtr->completions.headPtr;
+         linkPtr != NULL;
+         linkPtr = linkPtr->nextPtr) {
+        if (linkPtr == &bufPtr->link) {
+            IocpListRemove(&lockedChanPtr->completions, linkPtr);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelInvokeCallback --
+ *
+ *    Runs an application callback for an asynchronous channel operation
+ *    from a completion procedure. The channel is unlocked while the
+ *    callback runs as the script may call back into the channel.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The script is run and any error reported as a background error.
+ *    The reference to cmdObj is released.
+ *
+ *------------------------------------------------------------------------
+ */
+void IocpChannelInvokeCallback(
+    IocpChannel *lockedChanPtr, /* Locked on entry and return but unlocked
+                                 * in between. Caller must hold a reference */
+    Tcl_Interp  *interp,        /* Interpreter in which to run the script */
+    Tcl_Obj     *cmdObj)        /* Script. Reference released on return */
+{
+    IocpTclCode code;
+
+    IocpChannelUnlock(lockedChanPtr);
+    Tcl_Preserve(interp);
+    code = Tcl_EvalObjEx(interp, cmdObj, TCL_EVAL_GLOBAL);
+    if (code != TCL_OK)
+        Tcl_BackgroundException(interp, code);
+    Tcl_Release(interp);
+    Tcl_DecrRefCount(cmdObj);
+    IocpChannelLock(lockedChanPtr);
+}
+
+/*
+ * Event queued to release an interpreter from its own thread. See
+ * IocpInterpRelease.
+ */
+typedef struct IocpInterpReleaseEvent {
+    Tcl_Event   event;          /* Must be first */
+    Tcl_Interp *interp;         /* Interpreter to release */
+} IocpInterpReleaseEvent;
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpInterpReleaseHandler --
+ *
+ *    Event handler for events queued by IocpInterpRelease.
+ *
+ * Results:
+ *    Always 1 so the event is removed.
+ *
+ * Side effects:
+ *    The interpreter is released and may be freed.
+ *
+ *------------------------------------------------------------------------
+ */
+static int
+IocpInterpReleaseHandler(
+    Tcl_Event *evPtr,           /* IocpInterpReleaseEvent */
+    int        flags)           /* Not used */
+{
+    Tcl_Release(((IocpInterpReleaseEvent *) evPtr)->interp);
+    return 1;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpInterpRelease --
+ *
+ *    Releases an interpreter preserved by an asynchronous operation. The
+ *    state of such operations may be freed by the completion thread or
+ *    whichever thread drops the last channel reference. Since the last
+ *    release of a deleted interpreter runs its deletion, the release is
+ *    passed on to the interpreter's thread in that case.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The interpreter is released, possibly later from its own thread.
+ *
+ *------------------------------------------------------------------------
+ */
+void IocpInterpRelease(
+    Tcl_Interp  *interp,        /* Interpreter preserved with Tcl_Preserve */
+    Tcl_ThreadId threadId)      /* Thread to which interp belongs */
+{
+    IocpInterpReleaseEvent *evPtr;
+
+    if (threadId == Tcl_GetCurrentThread()) {
+        Tcl_Release(interp);
+        return;
+    }
+    evPtr = ckalloc(sizeof(*evPtr));
+    evPtr->event.proc = IocpInterpReleaseHandler;
+    evPtr->interp     = interp;
+    Tcl_ThreadQueueEvent(threadId, &evPtr->event, TCL_QUEUE_TAIL);
+    Tcl_ThreadAlert(threadId);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelReadyMask --
+ *
+ *    Computes the events to be reported for a channel to the Tcl channel
+ *    subsystem or iocp::poll. Also does the housekeeping that has to be
+ *    done in the owning thread before reporting.
+ *
+ * Results:
+ *    Mask of TCL_READABLE and TCL_WRITABLE.
+ *
+ * Side effects:
+ *    Rate limit timers may be scheduled and reads posted. If writable is
+ *    reported, it will not be reported again until more writes complete.
+ *
+ *------------------------------------------------------------------------
+ */
+static int IocpChannelReadyMask(
+    IocpChannel *lockedChanPtr  /* Must be locked on entry */
+    )
+{
+    int readyMask;
+
+    /* Rate limit timers are scheduled here when requested by other threads */
+    if ((lockedChanPtr->flags & IOCP_CHAN_F_RATE_WAIT_MASK) &&
+        lockedChanPtr->rateTimer == NULL) {
+        IocpRateSchedule(lockedChanPtr);
+    }
+
+    /*
+     * With message framing, a read delimiter or a receive low watermark,
+     * the application is not notified, and hence does not read, until
+     * enough input has arrived. Reads are normally reposted when the
+     * application reads so post them here instead to receive the rest.
+     */
+    if ((lockedChanPtr->frameHeaderSize != 0 ||
+         lockedChanPtr->readDelimiterLen != 0 ||
+         lockedChanPtr->rcvLowat > 1) &&
+        lockedChanPtr->state == IOCP_STATE_OPEN &&
+        (lockedChanPtr->flags & (IOCP_CHAN_F_REMOTE_EOF|IOCP_CHAN_F_WRITEONLY)) == 0 &&
+        lockedChanPtr->spliceToPtr == NULL &&
+        !IocpChannelInputReady(lockedChanPtr)) {
+        IocpChannelPostReads(lockedChanPtr);
+    }
+
+    readyMask = IocpChannelFileEventMask(lockedChanPtr);
+
+    if (readyMask & TCL_WRITABLE) {
+        /*
+         * We do not want to keep notifying if we have already notified
+         * of writes unless more writes complete. The NOTIFY_WRITES flag
+         * is set when the write IOCPs complete. We reset it here if we
+         * notify Tcl that channel is writable and then we will not again
+         * trigger notification unless more write IOCPs complete.
+         */
+        lockedChanPtr->flags &= ~ IOCP_CHAN_F_NOTIFY_WRITES;
+    }
+    return readyMask;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpNotifyChannel --
+ *
+ *    Notifies the Tcl channel subsystem of file events if it has asked
+ *    for them. The notification is made through Tcl_NotifyChannel which
+ *    can call back into the driver so lockedChanPtr is unlocked before
+ *    calling that function and relocked on return. Caller has to ensure
+ *    it is holding a reference to lockedChanPtr so it does not disappear
+ *    while unlocked. In case of EOF, Tcl_NotifyChannel will be called
+ *    continuously until the callback closes the channel.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    File event callbacks are invoked, the IocpChannel state may change.
+ *
+ *------------------------------------------------------------------------
+ */
+static void IocpNotifyChannel(
+    IocpChannel *lockedChanPtr  /* Locked on entry, locked on return but
+                                 * unlocked in between */
+    )
+{
+    int         readyMask;
+    Tcl_Channel channel;
+
+    IOCP_TRACE(("IocpNotifyChannel Enter: chanPtr=%p, chanPtr->state=0x%x, chanPtr->channel=%p\n", lockedChanPtr, lockedChanPtr->state, lockedChanPtr->channel));
+    channel = lockedChanPtr->channel; /* Get before unlocking */
+    if (channel == NULL)
+        return;                 /* Tcl channel has gone away */
+
+    readyMask = IocpChannelReadyMask(lockedChanPtr);
+    IOCP_TRACE(("IocpNotifyChannel : chanPtr=%p, chanPtr->state=0x%x, readyMask=0x%x\n", lockedChanPtr, lockedChanPtr->state, readyMask));
+    if (readyMask == 0) {
+        IOCP_TRACE(("IocpNotifyChannel return: chanPtr=%p, readyMask=0x%x\n", lockedChanPtr, readyMask));
+        return;                 /* Nothing to notify */
+    }
+
+    /*
+     * Unlock before calling Tcl_NotifyChannel which may recurse via the
+     * callback script which again calls us through the channel commands.
+     * Note the IocpChannel will not be freed when unlocked as caller
+     * should hold a reference to it.
+     */
+    IocpChannelUnlock(lockedChanPtr);
+    Tcl_NotifyChannel(channel, readyMask);
+    IocpChannelLock(lockedChanPtr);
+
+    IOCP_TRACE(("IocpNotifyChannel after Tcl_NotifyChannel: chanPtr=%p, chanPtr->state=0x%x, chanPtr->flags=0x%x\n", lockedChanPtr, lockedChanPtr->state, lockedChanPtr->flags));
+
+#ifdef TBD  /* Needed? */
+    if (lockedChanPtr->flags & IOCP_CHAN_F_REMOTE_EOF) {
+        /*
+         * In case of EOF, we have to keep notifying until application closes
+         * the channel. Originally we were looping calling Tcl_NotifyChannel.
+         * However that does not work in the case of applications that do
+         * not close the channel in the callback but rather set some vwait
+         * variable and close it after the vwait completes. A hard loop
+         * here will not allow them to do that so we post an event to
+         * the Tcl event loop instead.
+         */
+
+        /* Recompute ready mask in case callback turned off handlers */
+        readyMask = IocpChannelFileEventMask(lockedChanPtr);
+        IOCP_TRACE(("IocpNotifyChannel EOF: chanPtr=%p, chanPtr->state=0x%x, chanPtr->flags=0x%x, readyMask=0x%x\n", lockedChanPtr, lockedChanPtr->state, lockedChanPtr->flags, readyMask));
+        if (readyMask != 0) {
+            IocpChannelEnqueueEvent(lockedChanPtr, IOCP_EVENT_NOTIFY_CHANNEL, 1);
+        }
+    }
+#endif
+    IOCP_TRACE(("IocpNotifyChannel return: chanPtr=%p, chanPtr->state=0x%x, chanPtr->flags=0x%x\n", lockedChanPtr, lockedChanPtr->state, lockedChanPtr->flags));
+}
+
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelService --
+ *
+ *    Takes the action required for a ready channel owned by the current
+ *    thread, either from IocpEventHandler or IocpDispatchReady.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    Channel state may change and Tcl callbacks may be invoked. The
+ *    channel is unlocked in between. Caller must hold a reference.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpChannelService(
+    IocpChannel *lockedChanPtr) /* Locked on entry, locked on return but
+                                 * possibly unlocked in between */
+{
+    switch (lockedChanPtr->state) {
+    case IOCP_STATE_LISTENING:
+        if (lockedChanPtr->vtblPtr->accept) {
+            lockedChanPtr->vtblPtr->accept(lockedChanPtr);
+        }
+        break;
+
+    case IOCP_STATE_CONNECTING:
+    case IOCP_STATE_CONNECT_RETRY:
+    case IOCP_STATE_CONNECTED:
+        IocpChannelConnectionStep(lockedChanPtr, 0); /* May change state */
+        break;
+
+    case IOCP_STATE_OPEN:
+    case IOCP_STATE_CONNECT_FAILED:
+    case IOCP_STATE_DISCONNECTED:
+        IocpChannelReportCompletions(lockedChanPtr); /* May change state */
+        if (lockedChanPtr->state == IOCP_STATE_CLOSED)
+            break;
+        if (lockedChanPtr->flags & IOCP_CHAN_F_POLLED) {
+            /* Queued before iocp::watch. Hand over to iocp::poll. */
+            IocpReadyQAdd(lockedChanPtr, 0);
+        } else {
+            /* Notify Tcl channel subsystem if it has asked for it */
+            IocpNotifyChannel(lockedChanPtr); /* May change state */
+            /* Resume coroutines in iocp::co commands */
+            if ((lockedChanPtr->coReadPtr || lockedChanPtr->coWritePtr) &&
+                lockedChanPtr->state != IOCP_STATE_CLOSED)
+                IocpCoResume(lockedChanPtr); /* May change state */
+        }
+        break;
+    default: /* INIT and CLOSED */
+        /* Late arrival */
+        break;
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpEventHandler --
+ *
+ *    Called from the event loop. Processes all ready channels and notifies
+ *    the Tcl channel subsystem of state changes.
+ *
+ * Results:
+ *    Returns 0 if the event is to be kept on the event loop queue, and
+ *    1 if it can be discarded.
+ *
+ * Side effects:
+ *    All channels marked as ready may change state. Tcl channel subsystem
+ *    may be notified as appropriate.
+ *
+ *------------------------------------------------------------------------
+ */
+static int
+IocpEventHandler(
+    Tcl_Event *evPtr,           /* Pointer to the Tcl_Event structure.
+                                 * Contents immaterial */
+    int        flags            /* TCL_FILE_EVENTS */
+    )
+{
+    IocpChannel *chanPtr;
+
+    IOCP_TRACE(("IocpEventHandler Enter: chanPtr=%p, flags=0x%x.\n", ((IocpTclEvent *)evPtr)->chanPtr, flags));
+
+    if (!(flags & TCL_FILE_EVENTS)) {
+        IOCP_TRACE(("IocpEventHandler return: chanPtr=%p, ! TCL_FILE_EVENTS.\n", ((IocpTclEvent *)evPtr)->chanPtr));
+        return 0;               /* We are not to process file/network events */
     }
 
     chanPtr = ((IocpTclEvent *)evPtr)->chanPtr;
@@ -1966,30 +3676,7 @@ IocpEventHandler(
         IOCP_TRACE(("IocpEventHandler: chanPtr=%p, chanPtr->state=0x%x\n", chanPtr, chanPtr->state));
         /* Indicate that another event may be queued (optimization) */
         chanPtr->eventQThread = 0;
-
-        switch (chanPtr->state) {
-        case IOCP_STATE_LISTENING:
-            if (chanPtr->vtblPtr->accept) {
-                chanPtr->vtblPtr->accept(chanPtr);
-            }
-            break;
-
-        case IOCP_STATE_CONNECTING:
-        case IOCP_STATE_CONNECT_RETRY:
-        case IOCP_STATE_CONNECTED:
-            IocpChannelConnectionStep(chanPtr, 0); /* May change state */
-            break;
-
-        case IOCP_STATE_OPEN:
-        case IOCP_STATE_CONNECT_FAILED:
-        case IOCP_STATE_DISCONNECTED:
-            /* Notify Tcl channel subsystem if it has asked for it */
-            IocpNotifyChannel(chanPtr); /* May change state */
-            break;
-        default: /* INIT and CLOSED */
-            /* Late arrival */
-            break;
-        }
+        IocpChannelService(chanPtr); /* May change state */
     }
 
     /* Drop the reference corresponding to queueing to the event q. */
@@ -2025,6 +3712,9 @@ DWORD IocpChannelPostReads(
 {
     DWORD winError = 0;
     while (lockedChanPtr->pendingReads < lockedChanPtr->maxPendingReads) {
+        if (lockedChanPtr->readBucketPtr &&
+            IocpRateThrottled(lockedChanPtr, IOCP_CHAN_F_RATE_READ_WAIT))
+            break;              /* Resumed when tokens are available */
         winError = lockedChanPtr->vtblPtr->postread(lockedChanPtr);
         if (winError)
             break;
@@ -2033,6 +3723,557 @@ DWORD IocpChannelPostReads(
     return (lockedChanPtr->pendingReads > 0) ? 0 : winError;
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * Iocp_WatchObjCmd --
+ *
+ *    Implements the iocp::watch command.
+ *
+ *      watch CHAN ?EVENTS?
+ *
+ *    Registers the events, a list containing readable and/or writable,
+ *    for which the channel is reported by iocp::poll. An empty list
+ *    unregisters the channel and reverts to file event notifications.
+ *
+ * Results:
+ *    A standard Tcl result. If EVENTS is not specified, the interpreter
+ *    result holds the currently registered events.
+ *
+ * Side effects:
+ *    While registered, readiness of the channel is reported only through
+ *    iocp::poll and not through the Tcl event loop.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Iocp_WatchObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    static const char *const events[] = {"readable", "writable", NULL};
+    Tcl_Channel  chan;
+    IocpChannel *chanPtr;
+    Tcl_Obj    **eventObjs;
+    Tcl_Size     nevents;
+    Tcl_Size     i;
+    int          mask;
+    int          index;
+
+    if (objc != 2 && objc != 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "CHAN ?EVENTS?");
+        return TCL_ERROR;
+    }
+    chan = Tcl_GetChannel(interp, Tcl_GetString(objv[1]), NULL);
+    if (chan == NULL)
+        return TCL_ERROR;
+    chanPtr = IocpChannelFromTclChannel(chan);
+    if (chanPtr == NULL) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" is not an iocp channel.", Tcl_GetString(objv[1])));
+        return TCL_ERROR;
+    }
+
+    if (objc == 2) {
+        Tcl_Obj *resultObj = Tcl_NewListObj(0, NULL);
+        IocpChannelLock(chanPtr);
+        mask = chanPtr->pollMask;
+        IocpChannelUnlock(chanPtr);
+        for (i = 0; events[i]; ++i) {
+            if (mask & (TCL_READABLE << i))
+                Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewStringObj(events[i], -1));
+        }
+        Tcl_SetObjResult(interp, resultObj);
+        return TCL_OK;
+    }
+
+    if (Tcl_ListObjGetElements(interp, objv[2], &nevents, &eventObjs) != TCL_OK)
+        return TCL_ERROR;
+    mask = 0;
+    for (i = 0; i < nevents; ++i) {
+        if (Tcl_GetIndexFromObj(interp, eventObjs[i], events, "event", 0, &index) != TCL_OK)
+            return TCL_ERROR;
+        mask |= TCL_READABLE << index; /* TCL_WRITABLE == TCL_READABLE << 1 */
+    }
+
+    IocpChannelLock(chanPtr);
+    if (chanPtr->state == IOCP_STATE_LISTENING) {
+        IocpChannelUnlock(chanPtr);
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" is a listening socket.", Tcl_GetString(objv[1])));
+        return TCL_ERROR;
+    }
+    if (mask) {
+        chanPtr->flags   |= IOCP_CHAN_F_POLLED;
+        chanPtr->pollMask = mask;
+    } else {
+        chanPtr->flags   &= ~IOCP_CHAN_F_POLLED;
+        chanPtr->pollMask = 0;
+        mask = chanPtr->watchMask; /* Back to what Tcl asked for */
+    }
+    if (mask & TCL_WRITABLE)
+        chanPtr->flags |= IOCP_CHAN_F_NOTIFY_WRITES;
+    IocpChannelUpdateWatch(chanPtr);
+
+    if (chanPtr->flags & IOCP_CHAN_F_POLLED) {
+        /* Let the next iocp::poll check the current state */
+        IocpReadyQAdd(chanPtr, 0);
+    } else if (IocpChannelFileEventMask(chanPtr)) {
+        IocpRequestEventPoll(chanPtr);
+    }
+    IocpChannelUnlock(chanPtr);
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Iocp_PollObjCmd --
+ *
+ *    Implements the iocp::poll command.
+ *
+ *      poll ?-timeout MS? ?-max COUNT?
+ *
+ *    Dequeues channels registered with iocp::watch from the calling
+ *    thread's poll queue and returns those that are ready. If none are
+ *    queued, waits up to MS milliseconds (default 0, negative for no
+ *    limit) for one to be queued. Readable channels are queued again so
+ *    they are reported until their input is consumed.
+ *
+ * Results:
+ *    A standard Tcl result. The interpreter result is a list of pairs
+ *    containing a channel name and the list of its ready events.
+ *
+ * Side effects:
+ *    Pending completions for the channels are processed, possibly
+ *    invoking callbacks. The Tcl event loop is not run.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Iocp_PollObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    static const char *const pollOptions[] = {"-max", "-timeout", NULL};
+    enum pollOptions {POLL_MAX, POLL_TIMEOUT};
+    IocpThreadData *tsdPtr;
+    IocpList        requeue;
+    IocpLink       *linkPtr;
+    Tcl_Obj        *resultObj;
+    Tcl_ThreadId    threadId;
+    ULONGLONG       deadline;
+    int             timeout  = 0;
+    int             maxCount = 0;
+    int             count    = 0;
+    int             optIndex;
+    int             i;
+
+    if ((objc & 1) == 0) {
+        Tcl_WrongNumArgs(interp, 1, objv, "?-timeout MS? ?-max COUNT?");
+        return TCL_ERROR;
+    }
+    for (i = 1; i < objc; i += 2) {
+        if (Tcl_GetIndexFromObj(interp, objv[i], pollOptions, "option",
+                                TCL_EXACT, &optIndex) != TCL_OK)
+            return TCL_ERROR;
+        if (Tcl_GetIntFromObj(interp, objv[i+1],
+                              optIndex == POLL_MAX ? &maxCount : &timeout)
+            != TCL_OK)
+            return TCL_ERROR;
+    }
+    if (maxCount < 0) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Integer value %d out of range.", maxCount));
+        return TCL_ERROR;
+    }
+
+    threadId  = Tcl_GetCurrentThread();
+    resultObj = Tcl_NewListObj(0, NULL);
+    IocpListInit(&requeue);
+
+    tsdPtr = IocpThreadDataGet(); /* Note: tsdPtr is locked */
+    deadline = GetTickCount64() + (timeout > 0 ? timeout : 0);
+    /*
+     * Queued channels may turn out to not be ready, e.g. the entry added
+     * by iocp::watch, so keep waiting until one is or the time is up.
+     */
+    for (;;) {
+        while (timeout != 0 && tsdPtr->pollQ.headPtr == NULL) {
+            DWORD wait = INFINITE;
+            if (timeout > 0) {
+                ULONGLONG now = GetTickCount64();
+                if (now >= deadline)
+                    break;
+                wait = (DWORD) (deadline - now);
+            }
+            IocpConditionVariableWaitExclusive(&tsdPtr->pollCv, &tsdPtr->lock, wait);
+        }
+
+        while ((maxCount == 0 || count < maxCount) &&
+               (linkPtr = IocpListPopFront(&tsdPtr->pollQ)) != NULL) {
+            IocpReadyQEntry *rqePtr  = CONTAINING_RECORD(linkPtr, IocpReadyQEntry, link);
+            IocpChannel     *chanPtr = rqePtr->chanPtr;
+            int              readyMask = 0;
+
+            /*
+             * Unlock the thread data since processing may requeue the channel
+             * (lock hierarchy) and invoke callbacks.
+             */
+            IocpThreadDataUnlock(tsdPtr);
+            IocpChannelLock(chanPtr);
+            /* Entries left over from before a thread transfer are discarded */
+            if (chanPtr->owningThread == threadId)
+                chanPtr->flags &= ~IOCP_CHAN_F_POLL_QUEUED;
+            if (chanPtr->owningThread == threadId &&
+                (chanPtr->flags & IOCP_CHAN_F_POLLED)) {
+                /* Same processing as IocpEventHandler */
+                switch (chanPtr->state) {
+                case IOCP_STATE_CONNECTING:
+                case IOCP_STATE_CONNECT_RETRY:
+                case IOCP_STATE_CONNECTED:
+                    IocpChannelConnectionStep(chanPtr, 0); /* May requeue */
+                    break;
+                case IOCP_STATE_OPEN:
+                case IOCP_STATE_CONNECT_FAILED:
+                case IOCP_STATE_DISCONNECTED:
+                    IocpChannelReportCompletions(chanPtr); /* May change state */
+                    if (chanPtr->state == IOCP_STATE_CLOSED ||
+                        chanPtr->channel == NULL)
+                        break;
+                    readyMask = IocpChannelReadyMask(chanPtr);
+                    /* Input already moved into the Tcl channel buffers */
+                    if ((chanPtr->pollMask & TCL_READABLE) &&
+                        Tcl_InputBuffered(chanPtr->channel) > 0)
+                        readyMask |= TCL_READABLE;
+                    break;
+                default:
+                    break;
+                }
+            }
+            if (readyMask) {
+                Tcl_Obj *objs[2];
+                objs[0] = Tcl_NewStringObj(Tcl_GetChannelName(chanPtr->channel), -1);
+                objs[1] = Tcl_NewListObj(0, NULL);
+                if (readyMask & TCL_READABLE)
+                    Tcl_ListObjAppendElement(NULL, objs[1], Tcl_NewStringObj("readable", -1));
+                if (readyMask & TCL_WRITABLE)
+                    Tcl_ListObjAppendElement(NULL, objs[1], Tcl_NewStringObj("writable", -1));
+                Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewListObj(2, objs));
+                ++count;
+            }
+            if ((readyMask & TCL_READABLE) &&
+                !(chanPtr->flags & IOCP_CHAN_F_POLL_QUEUED)) {
+                /* Level triggered. Keep the entry and its channel reference. */
+                chanPtr->flags |= IOCP_CHAN_F_POLL_QUEUED;
+                IocpListAppend(&requeue, &rqePtr->link);
+                IocpChannelUnlock(chanPtr);
+            } else {
+                rqePtr->chanPtr = NULL;
+                IocpChannelDrop(chanPtr); /* Deref from rqePtr */
+                IocpReadyQEntryFree(rqePtr);
+            }
+            IocpThreadDataLock(tsdPtr);
+        }
+        if (count > 0 || timeout == 0 ||
+            (timeout > 0 && GetTickCount64() >= deadline))
+            break;
+    }
+    while ((linkPtr = IocpListPopFront(&requeue)) != NULL) {
+        IocpListAppend(&tsdPtr->pollQ, linkPtr);
+    }
+    IocpThreadDataUnlock(tsdPtr);
+
+    Tcl_SetObjResult(interp, resultObj);
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Iocp_DispatchObjCmd --
+ *
+ *    Implements the iocp::dispatch command.
+ *
+ *      dispatch ?BUDGET?
+ *
+ *    Sets the maximum number of ready channels that are notified directly
+ *    from the event source in each pass of the calling thread's event
+ *    loop. A BUDGET of 0 (default) queues a Tcl event for each ready
+ *    channel instead.
+ *
+ * Results:
+ *    A standard Tcl result. The interpreter result holds the budget in
+ *    effect.
+ *
+ * Side effects:
+ *    Changes how channel events are dispatched in the calling thread.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Iocp_DispatchObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    IocpThreadData *tsdPtr;
+    int             budget;
+
+    if (objc > 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "?BUDGET?");
+        return TCL_ERROR;
+    }
+    if (objc == 2) {
+        if (Tcl_GetIntFromObj(interp, objv[1], &budget) != TCL_OK)
+            return TCL_ERROR;
+        if (budget < 0) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("expected non-negative integer but got \"%s\"", Tcl_GetString(objv[1])));
+            return TCL_ERROR;
+        }
+    }
+
+    tsdPtr = IocpThreadDataGet(); /* Note: tsdPtr is locked */
+    if (objc == 2)
+        tsdPtr->dispatchBudget = budget;
+    budget = tsdPtr->dispatchBudget;
+    IocpThreadDataUnlock(tsdPtr);
+    Tcl_SetObjResult(interp, Tcl_NewIntObj(budget));
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Iocp_ScheduleObjCmd --
+ *
+ *    Implements the iocp::schedule command.
+ *
+ *      schedule ?-bytes MAXBYTES? ?-callbacks MAXCALLBACKS?
+ *
+ *    Sets the budgets applied in each pass of the calling thread's event
+ *    loop. MAXBYTES limits the data read from each non-blocking channel
+ *    and MAXCALLBACKS the number of channels notified. A channel that
+ *    exceeds its byte budget reports no more data until the next pass.
+ *    Channels beyond the callback budget are notified in the next pass.
+ *    A value of 0 (default) means no limit.
+ *
+ * Results:
+ *    A standard Tcl result. The interpreter result holds a dictionary
+ *    of the settings in effect.
+ *
+ * Side effects:
+ *    Changes the scheduling of channel events in the calling thread.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Iocp_ScheduleObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    static const char *const opts[] = {"-bytes", "-callbacks", NULL};
+    enum { SCHED_BYTES, SCHED_CALLBACKS };
+    IocpThreadData *tsdPtr;
+    Tcl_Obj        *objs[4];
+    int             values[2] = {-1, -1};
+    int             i, opt;
+
+    if (objc % 2 == 0) {
+        Tcl_WrongNumArgs(interp, 1, objv, "?-bytes MAXBYTES? ?-callbacks MAXCALLBACKS?");
+        return TCL_ERROR;
+    }
+    for (i = 1; i < objc; i += 2) {
+        if (Tcl_GetIndexFromObj(interp, objv[i], opts, "option", 0, &opt) != TCL_OK)
+            return TCL_ERROR;
+        if (Tcl_GetIntFromObj(interp, objv[i+1], &values[opt]) != TCL_OK)
+            return TCL_ERROR;
+        if (values[opt] < 0) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("expected non-negative integer but got \"%s\"", Tcl_GetString(objv[i+1])));
+            return TCL_ERROR;
+        }
+    }
+
+    tsdPtr = IocpThreadDataGet(); /* Note: tsdPtr is locked */
+    if (values[SCHED_BYTES] >= 0)
+        tsdPtr->schedBytes = values[SCHED_BYTES];
+    if (values[SCHED_CALLBACKS] >= 0)
+        tsdPtr->schedCallbacks = values[SCHED_CALLBACKS];
+    values[SCHED_BYTES]     = tsdPtr->schedBytes;
+    values[SCHED_CALLBACKS] = tsdPtr->schedCallbacks;
+    IocpThreadDataUnlock(tsdPtr);
+
+    objs[0] = Tcl_NewStringObj("-bytes", -1);
+    objs[1] = Tcl_NewIntObj(values[SCHED_BYTES]);
+    objs[2] = Tcl_NewStringObj("-callbacks", -1);
+    objs[3] = Tcl_NewIntObj(values[SCHED_CALLBACKS]);
+    Tcl_SetObjResult(interp, Tcl_NewListObj(4, objs));
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Iocp_SpinObjCmd --
+ *
+ *    Implements the iocp::spin command.
+ *
+ *      spin ?MAXMICROSECONDS?
+ *
+ *    Sets the maximum time blocking channel operations spin waiting for
+ *    an I/O completion before sleeping. The actual time adapts to the
+ *    recent waits of each channel. A value of 0 (default) disables
+ *    spinning.
+ *
+ * Results:
+ *    A standard Tcl result. The interpreter result holds the maximum in
+ *    effect.
+ *
+ * Side effects:
+ *    Changes the process-wide spin setting.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Iocp_SpinObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    int spinMax;
+
+    if (objc > 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "?MAXMICROSECONDS?");
+        return TCL_ERROR;
+    }
+    if (objc == 2) {
+        if (Tcl_GetIntFromObj(interp, objv[1], &spinMax) != TCL_OK)
+            return TCL_ERROR;
+        if (spinMax < 0 || spinMax > IOCP_SPIN_MAX_LIMIT) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Integer value %d out of range.", spinMax));
+            return TCL_ERROR;
+        }
+        (void) IocpSpinInit(); /* Before any waits read the frequency */
+        iocpSpinMax = spinMax;
+    }
+    Tcl_SetObjResult(interp, Tcl_NewIntObj(iocpSpinMax));
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Iocp_ConfigureObjCmd --
+ *
+ *    Implements the iocp::configure command.
+ *
+ *      configure ?-busypoll MICROSECONDS? ?-completionport shared|thread?
+ *      configure OPTION
+ *
+ *    Sets or retrieves settings for the calling thread. -busypoll sets
+ *    the time the thread polls for ready channels before the event loop
+ *    blocks. A value of 0 (default) disables busy polling.
+ *    -completionport thread gives the thread its own completion port for
+ *    channels it creates subsequently. It cannot be reverted to shared
+ *    (default) as the handles already attached cannot be moved.
+ *
+ * Results:
+ *    A standard Tcl result. The interpreter result holds the value of
+ *    OPTION if only that is specified and a dictionary of all settings
+ *    otherwise.
+ *
+ * Side effects:
+ *    Changes the settings of the calling thread.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Iocp_ConfigureObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    static const char *const opts[] = {"-busypoll", "-completionport", NULL};
+    static const char *const portTypes[] = {"shared", "thread", NULL};
+    enum { CONFIG_BUSYPOLL, CONFIG_COMPLETIONPORT };
+    IocpThreadData *tsdPtr;
+    IocpPort       *portPtr = NULL;
+    Tcl_Obj        *objs[4];
+    int             busyPoll = -1;
+    int             threadPort = -1;
+    int             i, opt;
+
+    if (objc == 2) {
+        if (Tcl_GetIndexFromObj(interp, objv[1], opts, "option", 0, &opt) != TCL_OK)
+            return TCL_ERROR;
+    } else if (objc % 2 == 0) {
+        Tcl_WrongNumArgs(interp, 1, objv, "?-busypoll MICROSECONDS? ?-completionport shared|thread?");
+        return TCL_ERROR;
+    }
+    for (i = 1; i + 1 < objc; i += 2) {
+        if (Tcl_GetIndexFromObj(interp, objv[i], opts, "option", 0, &opt) != TCL_OK)
+            return TCL_ERROR;
+        switch (opt) {
+        case CONFIG_BUSYPOLL:
+            if (Tcl_GetIntFromObj(interp, objv[i+1], &busyPoll) != TCL_OK)
+                return TCL_ERROR;
+            if (busyPoll < 0 || busyPoll > IOCP_BUSYPOLL_MAX_LIMIT) {
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Integer value %d out of range.", busyPoll));
+                return TCL_ERROR;
+            }
+            break;
+        case CONFIG_COMPLETIONPORT:
+            if (Tcl_GetIndexFromObj(interp, objv[i+1], portTypes, "completion port type", 0, &threadPort) != TCL_OK)
+                return TCL_ERROR;
+            break;
+        }
+    }
+
+    (void) IocpSpinInit(); /* Before any polls read the frequency */
+    tsdPtr = IocpThreadDataGet(); /* Note: tsdPtr is locked */
+    if (threadPort == 0 && tsdPtr->portPtr) {
+        IocpThreadDataUnlock(tsdPtr);
+        Tcl_SetResult(interp, "completion port cannot be changed once set to thread.", TCL_STATIC);
+        return TCL_ERROR;
+    }
+    if (threadPort == 1 && tsdPtr->portPtr == NULL) {
+        /* Do not hold the lock while creating threads etc. */
+        IocpThreadDataUnlock(tsdPtr);
+        portPtr = IocpPortAcquire(interp);
+        if (portPtr == NULL)
+            return TCL_ERROR;
+        /* Keep completion processing close to the thread's caches */
+        SetThreadIdealProcessor(portPtr->thread, GetCurrentProcessorNumber());
+        IocpThreadDataLock(tsdPtr);
+        tsdPtr->portPtr = portPtr;
+    }
+    if (busyPoll >= 0)
+        tsdPtr->busyPoll = busyPoll;
+    busyPoll = tsdPtr->busyPoll;
+    threadPort = tsdPtr->portPtr != NULL;
+    IocpThreadDataUnlock(tsdPtr);
+
+    if (objc == 2) {
+        if (opt == CONFIG_BUSYPOLL)
+            Tcl_SetObjResult(interp, Tcl_NewIntObj(busyPoll));
+        else
+            Tcl_SetObjResult(interp, Tcl_NewStringObj(portTypes[threadPort], -1));
+    } else {
+        objs[0] = Tcl_NewStringObj("-busypoll", -1);
+        objs[1] = Tcl_NewIntObj(busyPoll);
+        objs[2] = Tcl_NewStringObj("-completionport", -1);
+        objs[3] = Tcl_NewStringObj(portTypes[threadPort], -1);
+        Tcl_SetObjResult(interp, Tcl_NewListObj(4, objs));
+    }
+    return TCL_OK;
+}
+
 /* Returns statistics */
 IocpTclCode
 Iocp_StatsObjCmd (
@@ -2041,7 +4282,7 @@ Iocp_StatsObjCmd (
     int objc,				/* Number of arguments. */
     Tcl_Obj *CONST objv[])		/* Argument objects. */
 {
-    Tcl_Obj *stats[12];
+    Tcl_Obj *stats[32];
     int n;
 #define ADDSTATS(field_) do { \
     stats[n++] = Tcl_NewStringObj(# field_, -1); \
@@ -2060,6 +4301,16 @@ Iocp_StatsObjCmd (
     ADDSTATS(BufferFrees);
     ADDSTATS(DataBufferAllocs);
     ADDSTATS(DataBufferFrees);
+    ADDSTATS(SocketCacheHits);
+    ADDSTATS(SocketCacheMisses);
+    ADDSTATS(SocketCachePuts);
+    ADDSTATS(SharedDataAllocs);
+    ADDSTATS(SharedDataFrees);
+    ADDSTATS(SpinHits);
+    ADDSTATS(SpinMisses);
+    ADDSTATS(BusyPollHits);
+    ADDSTATS(BusyPollMisses);
+    ADDSTATS(ThreadPortCompletions);
 
     IOCP_ASSERT(n <= sizeof(stats)/sizeof(stats[0]));
 
@@ -2113,6 +4364,14 @@ Iocp_Init (Tcl_Interp *interp)
     Tcl_CreateObjCommand(interp, "iocp::bt_init", Iocp_BtInitObjCmd, 0L, 0L);
 
     Tcl_CreateObjCommand(interp, "iocp::stats", Iocp_StatsObjCmd, 0L, 0L);
+    Tcl_CreateObjCommand(interp, "iocp::poll", Iocp_PollObjCmd, 0L, 0L);
+    Tcl_CreateObjCommand(interp, "iocp::watch", Iocp_WatchObjCmd, 0L, 0L);
+    Tcl_CreateObjCommand(interp, "iocp::dispatch", Iocp_DispatchObjCmd, 0L, 0L);
+    Tcl_CreateObjCommand(interp, "iocp::schedule", Iocp_ScheduleObjCmd, 0L, 0L);
+    Tcl_CreateObjCommand(interp, "iocp::spin", Iocp_SpinObjCmd, 0L, 0L);
+    Tcl_CreateObjCommand(interp, "iocp::configure", Iocp_ConfigureObjCmd, 0L, 0L);
+    if (Co_ModuleInitialize(interp) != TCL_OK)
+        return TCL_ERROR;
 
     Tcl_PkgProvide(interp, PACKAGE_NAME, PACKAGE_VERSION);
 
@@ -116,8 +116,13 @@ typedef struct IocpList        IocpList;
 typedef struct IocpThreadData  IocpThreadData;
 typedef struct IocpChannel     IocpChannel;
 typedef struct IocpChannelVtbl IocpChannelVtbl;
+typedef struct IocpRateBucket IocpRateBucket;
+typedef struct IocpTls         IocpTls;
+typedef struct IocpCompress    IocpCompress;
+typedef struct IocpCoWait      IocpCoWait;
 typedef struct IocpDataBuffer  IocpDataBuffer;
 typedef struct IocpBuffer      IocpBuffer;
+typedef struct IocpSharedData  IocpSharedData;
 
 /*
  * Typedefs used by one-time initialization utilities.
@@ -179,6 +184,20 @@ typedef struct IocpDataBuffer {
     int   len;         /* Number of bytes of data */
 } IocpDataBuffer;
 #define IOCP_BUFFER_DEFAULT_SIZE 4096
+
+/*
+ * Immutable data block shared by the write buffers of several channels,
+ * e.g. for a broadcast. Unlike IocpBuffer, it is reference counted since
+ * the writes complete in arbitrary order on the completion thread. Each
+ * IOCP_BUFFER_F_SHARED buffer holds one reference and the block is freed
+ * when the last one is released. numRefs is modified with interlocked
+ * operations only.
+ */
+typedef struct IocpSharedData {
+    volatile LONG numRefs;  /* Number of buffers (and creator) referencing */
+    int           len;      /* Number of bytes of data */
+    char          bytes[1]; /* Actually of size len */
+} IocpSharedData;
 IOCP_INLINE int IocpDataBufferLength(const IocpDataBuffer *dataBufPtr) {
     return dataBufPtr->len;
 }
@@ -190,8 +209,19 @@ enum IocpBufferOp {
     IOCP_BUFFER_OP_CONNECT,
     IOCP_BUFFER_OP_DISCONNECT,
     IOCP_BUFFER_OP_ACCEPT,
+    IOCP_BUFFER_OP_TRANSMIT,  /* Write whose completion is reported to the
+                               * Tcl thread through completionProc */
 };
 
+/*
+ * Called in the Tcl thread owning a channel to process a completed
+ * IOCP_BUFFER_OP_TRANSMIT operation. If lockedChanPtr is NULL, the channel
+ * is being closed or freed and the function should only release resources.
+ * The function must free bufPtr. lockedChanPtr may be unlocked and relocked
+ * by the function, e.g. to invoke scripts. The caller holds a reference.
+ */
+typedef void IocpCompletionProc(IocpChannel *lockedChanPtr, IocpBuffer *bufPtr);
+
 /*
  * An IocpBuffer is used to queue I/O requests and pass data between
  * the channel, Windows, and the completion thread. Each instance is
@@ -245,9 +275,21 @@ typedef struct IocpBuffer {
     } context[2];                  /* For buffer users. Not initialized and
                                     * not used by buffer functions */
     enum IocpBufferOp operation;   /* I/O operation */
+    IocpCompletionProc *completionProc; /* Only for IOCP_BUFFER_OP_TRANSMIT */
     int               flags;
 #define IOCP_BUFFER_F_WINSOCK 0x1 /* Buffer used for a Winsock operation.
                                    *  (meaning wsaOverlap, not overlap) */
+#define IOCP_BUFFER_F_RECYCLED 0x2 /* Accept socket in context[0] came from
+                                    * the socket cache */
+#define IOCP_BUFFER_F_DATAGRAM 0x4 /* Holds a single datagram. A zero length
+                                    * does not indicate EOF. */
+#define IOCP_BUFFER_F_SEQUENCED 0x8 /* Read whose data must be passed on in
+                                     * the order posted. context[1].i holds
+                                     * the sequence number. See
+                                     * IocpCompleteRead */
+#define IOCP_BUFFER_F_SHARED 0x10 /* data.bytes points into an
+                                   * IocpSharedData block, not storage
+                                   * owned by the buffer. */
 } IocpBuffer;
 
 /* State values for IOCP channels. Used as bit masks. */
@@ -345,6 +387,9 @@ typedef struct IocpChannel {
     Tcl_Channel  channel;      /* Tcl channel */
     IocpList     inputBuffers; /* Input buffers whose data is to be
                                 * passed up to the Tcl channel layer. */
+    IocpList     completions;  /* IOCP_BUFFER_OP_TRANSMIT buffers whose
+                                * completion is to be reported in the
+                                * owning Tcl thread. */
     CONDITION_VARIABLE cv;     /* Used to wake up blocked Tcl thread waiting
                                 * a completion */
     IocpLock           lock;   /* Synchronization */
@@ -358,6 +403,9 @@ typedef struct IocpChannel {
     Tcl_ThreadId eventQThread; /* Similar to above except pertains to the
                                   Tcl event queue */
     LONG      numRefs;         /* Reference count */
+    HANDLE    port;            /* Completion port for the channel's handles.
+                                * Fixed at creation as handles cannot be
+                                * moved between ports. */
 
     enum IocpState state;      /* IOCP_STATE_* */
     IocpWinError  winError;    /* Last error code on I/O */
@@ -369,6 +417,136 @@ typedef struct IocpChannel {
     int maxPendingWrites;             /* Max allowed pending posted writes */
 #define IOCP_MAX_PENDING_WRITES_DEFAULT 3
 
+    /*
+     * Reads on devices like files may complete in a different order from
+     * the one they were posted in. Channel types that post several such
+     * reads number them from 0 and mark them IOCP_BUFFER_F_SEQUENCED.
+     * Completions that arrive ahead of an earlier read are held back
+     * until the earlier one completes.
+     */
+    IocpList heldBuffers;             /* Sequenced reads completed early */
+    int      readSeqNext;             /* Sequence number of next read to
+                                       * pass on */
+
+    /*
+     * Splice state. When spliceToPtr is set, data received on this channel
+     * is written to spliceToPtr by the completion thread instead of being
+     * queued on inputBuffers. The target's spliceFromPtr points back to this
+     * channel. Both are counted references and are set and cleared only
+     * in the Tcl thread. See tclWinIocpSplice.c.
+     */
+    IocpChannel *spliceToPtr;       /* Channel receiving our input */
+    IocpChannel *spliceFromPtr;     /* Channel whose input we receive */
+    IocpBuffer  *spliceDoneBufPtr;  /* Queued on completions when the splice
+                                     * from this channel ends. NULL if no
+                                     * splice is active or it has ended. */
+    Tcl_WideInt  splicedBytes;      /* Number of bytes forwarded */
+
+    /*
+     * Message framing. When frameHeaderSize is not 0, input is a sequence
+     * of messages each preceded by a length header of that many bytes.
+     * The channel is then only reported readable once a complete message
+     * is queued on inputBuffers. See tclWinIocpFrame.c.
+     */
+    int frameHeaderSize;            /* 0 (no framing), 1, 2 or 4 */
+    int frameMaxLength;             /* Longer messages are rejected */
+    int frameFlags;
+#define IOCP_FRAME_F_LITTLE_ENDIAN 0x1 /* Header is little-endian */
+
+    /*
+     * Record delimiter for line oriented input. When readDelimiterLen is
+     * not 0, the number of delimiters ending in each queued input buffer
+     * is counted as it is queued and stored in its context[0].i. The
+     * channel is then only reported readable once a complete record is
+     * queued. See IocpChannelQueueInput.
+     */
+    char readDelimiter[2];
+    int  readDelimiterLen;          /* 0 (none), 1 or 2 */
+    int  lastInputByte;             /* Last byte queued on inputBuffers or
+                                     * -1 if none */
+#define IOCP_READ_DELIMITER_MAX_QUEUED (1024*1024) /* Input is reported
+                                                    * readable beyond this
+                                                    * even without a
+                                                    * delimiter */
+
+    /*
+     * Receive low watermark. inputBytes is the number of data bytes queued
+     * on inputBuffers. It is updated as input is queued by
+     * IocpChannelQueueInput and as it is consumed. When rcvLowat is greater
+     * than 1 and neither framing nor a read delimiter is set, the channel
+     * is only reported readable once rcvLowat bytes, end of file or an
+     * error are queued.
+     */
+    int inputBytes;                 /* Bytes of data queued on inputBuffers */
+    int rcvLowat;                   /* Receive low watermark */
+#define IOCP_RCVLOWAT_MAX IOCP_READ_DELIMITER_MAX_QUEUED
+
+    /*
+     * Scheduling. priority orders the channel on the ready queue of the
+     * owning thread. passBytes is the data read from a non-blocking
+     * channel during event loop pass passId of the owning thread. Once it
+     * reaches the byte budget set with iocp::schedule, reads return EAGAIN
+     * and the channel is deferred to the next pass.
+     */
+    int          priority;
+#define IOCP_PRIORITY_HIGH   0
+#define IOCP_PRIORITY_NORMAL 1
+#define IOCP_PRIORITY_LOW    2
+    unsigned int passId;
+    int          passBytes;
+
+    /*
+     * Blocking waits first spin for up to spinUsecs microseconds before
+     * sleeping on the condition variable. spinUsecs adapts to the recent
+     * wait times of the channel, bounded by the iocp::spin setting. See
+     * IocpChannelAwaitCompletion.
+     */
+    int          spinUsecs;
+
+    /*
+     * Rate limits. Reads are not posted and writes not accepted while the
+     * corresponding token bucket is empty. Buckets may be shared between
+     * channels. rateTimer, only accessed in the owning thread, resumes
+     * held back I/O. See tclWinIocpRate.c.
+     */
+    IocpRateBucket *readBucketPtr;
+    IocpRateBucket *writeBucketPtr;
+    Tcl_TimerToken  rateTimer;
+
+    /*
+     * Native TLS. When tlsPtr is set, received data is decrypted by the
+     * completion thread before being queued on inputBuffers and written
+     * data is encrypted before it is posted. IOCP_CHAN_F_TLS_HANDSHAKE is
+     * set while a handshake is in progress. See tclWinIocpTls.c.
+     */
+    IocpTls *tlsPtr;
+
+    /*
+     * Compression. When compressPtr is set, received data is decompressed
+     * by the completion thread before being queued on inputBuffers and
+     * written data is compressed before it is posted. Mutually exclusive
+     * with tlsPtr. See tclWinIocpCompress.c.
+     */
+    IocpCompress *compressPtr;
+
+    /*
+     * Event masks (TCL_READABLE etc.). watchMask is the mask last passed
+     * by Tcl to the channel watch procedure. pollMask is the mask
+     * registered with iocp::watch. While IOCP_CHAN_F_POLLED is set, the
+     * latter determines the watched events and readiness is reported
+     * through iocp::poll instead of the Tcl event loop.
+     */
+    int       watchMask;
+    int       pollMask;
+
+    /*
+     * Coroutines suspended in iocp::co commands waiting for input or for
+     * output to drain. They are resumed from IocpEventHandler. See
+     * tclWinIocpCo.c.
+     */
+    IocpCoWait *coReadPtr;
+    IocpCoWait *coWritePtr;
+
     int       flags;
 
 #define IOCP_CHAN_F_NOTIFY_WRITES   0x0004 /* One or more writes notified */
@@ -382,6 +560,21 @@ typedef struct IocpChannel {
 #define IOCP_CHAN_F_BLOCKED_READ    0x0400 /* Blocked for read completion */
 #define IOCP_CHAN_F_BLOCKED_WRITE   0x0800 /* Blocked for write completion */
 #define IOCP_CHAN_F_BLOCKED_CONNECT 0x1000 /* Blocked for connect completion */
+#define IOCP_CHAN_F_SPLICE_STALLED  0x2000 /* Splice reads held back as
+                                            * target has too many writes */
+#define IOCP_CHAN_F_SPLICE_HOLD     0x4000 /* Splice being set up, queue
+                                            * reads on inputBuffers */
+#define IOCP_CHAN_F_RATE_READ_WAIT  0x8000 /* Reads held back by rate limit */
+#define IOCP_CHAN_F_RATE_WRITE_WAIT 0x10000 /* Writes held back by rate limit */
+#define IOCP_CHAN_F_TLS_HANDSHAKE   0x20000 /* TLS handshake in progress */
+#define IOCP_CHAN_F_POLLED          0x40000 /* Registered with iocp::watch */
+#define IOCP_CHAN_F_POLL_QUEUED     0x80000 /* On the poll queue of the
+                                             * owning thread */
+#define IOCP_CHAN_F_SCHED_DEFERRED  0x100000 /* Over byte budget, on the
+                                              * defer queue of the owning
+                                              * thread */
+#define IOCP_CHAN_F_RATE_WAIT_MASK \
+    (IOCP_CHAN_F_RATE_READ_WAIT | IOCP_CHAN_F_RATE_WRITE_WAIT)
 #define IOCP_CHAN_F_BLOCKED_MASK \
     (IOCP_CHAN_F_BLOCKED_READ | IOCP_CHAN_F_BLOCKED_WRITE | IOCP_CHAN_F_BLOCKED_CONNECT)
 } IocpChannel;
@@ -476,8 +669,9 @@ typedef struct IocpChannelVtbl {
      * appropriate action such as closing sockets.
      */
     void (*disconnected)(       /* May be NULL */
-        IocpChannel *lockedChanPtr); /* Locked on entry. Must be locked on
+        IocpChannel *lockedChanPtr,  /* Locked on entry. Must be locked on
                                       * return. */
+        IocpWinError winError);      /* Status of the disconnect request */
 
     /*
      * postread() is called to post an I/O call to read more data.
@@ -499,6 +693,19 @@ typedef struct IocpChannelVtbl {
         int          nbytes,        /* Number of bytes to write */
         int         *countPtr);     /* Where to store number written */
 
+    /*
+     * postbuffer() is called to write the data in an already filled
+     * IocpBuffer, for example one received on another channel, without
+     * copying. bufPtr->operation will be IOCP_BUFFER_OP_WRITE. Unlike
+     * postwrite(), the maxPendingWrites limit is not checked. On success,
+     * the function should return 0 and the buffer is owned by the channel.
+     * On error, it should return a Windows error code and the caller
+     * retains ownership of bufPtr.
+     */
+    IocpWinError (*postbuffer)( /* May be NULL if splicing not supported */
+        IocpChannel *lockedChanPtr, /* Locked on entry, locked on return */
+        IocpBuffer  *bufPtr);       /* Buffer to write */
+
     /*
      * gethandle() retrieves the operating system handle associated with the
      * channel. On success, the function should return TCL_OK and store the
@@ -575,6 +782,17 @@ typedef struct IocpStats {
     volatile long IocpBufferFrees;
     volatile long IocpDataBufferAllocs;
     volatile long IocpDataBufferFrees;
+    volatile long IocpSocketCacheHits;   /* Sockets reused from socket cache */
+    volatile long IocpSocketCacheMisses; /* Sockets created with cache empty */
+    volatile long IocpSocketCachePuts;   /* Sockets returned to socket cache */
+    volatile long IocpSharedDataAllocs;  /* Shared data blocks allocated */
+    volatile long IocpSharedDataFrees;   /* Shared data blocks freed */
+    volatile long IocpSpinHits;    /* Blocking waits satisfied by spinning */
+    volatile long IocpSpinMisses;  /* Blocking waits that slept after spinning */
+    volatile long IocpBusyPollHits;   /* Busy polls that found a ready channel */
+    volatile long IocpBusyPollMisses; /* Busy polls that timed out */
+    volatile long IocpThreadPortCompletions; /* Completions processed on
+                                              * per-thread ports */
 } IocpStats;
 extern IocpStats iocpStats;
 /* Wrapper in case we switch to 64bit counters in the future */
@@ -585,6 +803,8 @@ extern IocpStats iocpStats;
 #else
 #define IOCP_STATS_INCR(field_) (void) 0
 #endif
+/* Counters that are maintained in release builds as well */
+#define IOCP_STATS_INCR_ALWAYS(field_) InterlockedIncrement(&iocpStats.field_)
 
 #ifdef BUILD_iocp
 
@@ -620,6 +840,7 @@ Tcl_Obj *IocpNewWincharObj(const WCHAR *wstr, IocpSizeT len);
 /* List utilities */
 void IocpListAppend(IocpList *listPtr, IocpLink *linkPtr);
 void IocpListPrepend(IocpList *listPtr, IocpLink *linkPtr);
+void IocpListInsertBefore(IocpList *listPtr, IocpLink *beforePtr, IocpLink *linkPtr);
 void IocpListRemove(IocpList *listPtr, IocpLink *linkPtr);
 IocpLink *IocpListPopFront(IocpList *listPtr);
 IocpList IocpListPopAll(IocpList *listPtr);
@@ -649,7 +870,10 @@ IOCP_INLINE void IocpDataBufferCopyIn(IocpDataBuffer *bufPtr, const char *inPtr,
     bufPtr->len = len;
 }
 IocpBuffer *IocpBufferNew(int capacity, enum IocpBufferOp, int);
+IocpBuffer *IocpBufferNewShared(IocpSharedData *sharedPtr, enum IocpBufferOp, int);
 void IocpBufferFree(IocpBuffer *bufPtr);
+IocpSharedData *IocpSharedDataNew(const char *bytes, int len);
+void IocpSharedDataDrop(IocpSharedData *sharedPtr);
 IOCP_INLINE int IocpBufferLength(const IocpBuffer *bufPtr) {
     return IocpDataBufferLength(&bufPtr->data);
 }
@@ -661,12 +885,8 @@ IOCP_INLINE void IocpBufferCopyIn(IocpBuffer *bufPtr, const char *inPtr, int len
 }
 
 /* IOCP wrappers */
-IOCP_INLINE HANDLE IocpAttachDefaultPort(HANDLE h) {
-    return CreateIoCompletionPort(h,
-                                  iocpModuleState.completion_port,
-                                  0, /* Completion key - unused */
-                                  0);
-}
+HANDLE IocpAttachDefaultPort(HANDLE h);
+HANDLE IocpChannelAttachPort(IocpChannel *chanPtr, HANDLE h);
 
 /* Callback utilities */
 void IocpRegisterAcceptCallbackCleanup(Tcl_Interp *, IocpAcceptCallback *);
@@ -682,9 +902,74 @@ int          IocpChannelWakeAfterCompletion(IocpChannel *lockedChanPtr, int bloc
 void         IocpChannelDrop(IocpChannel *lockedChanPtr);
 DWORD        IocpChannelPostReads(IocpChannel *lockedChanPtr);
 void         IocpChannelNudgeThread(IocpChannel *lockedChanPtr, int blockMask, int force);
+void         IocpRequestEventPoll(IocpChannel *lockedChanPtr);
+void         IocpChannelUpdateWatch(IocpChannel *lockedChanPtr);
+int          IocpChannelInputReady(IocpChannel *lockedChanPtr);
+IocpTclCode  IocpChannelSetPriority(Tcl_Interp *interp, IocpChannel *lockedChanPtr, const char *value);
+void         IocpChannelGetPriority(IocpChannel *lockedChanPtr, Tcl_DString *dsPtr);
+void         IocpChannelQueueInput(IocpChannel *lockedChanPtr, IocpBuffer *bufPtr);
+IocpTclCode  IocpChannelSetReadDelimiter(Tcl_Interp *interp,
+                                         IocpChannel *lockedChanPtr,
+                                         const char *delimPtr);
+int          IocpChannelRecordCount(IocpChannel *lockedChanPtr);
+int          IocpChannelBelowLowat(IocpChannel *lockedChanPtr);
+int          IocpChannelRemoveCompletion(IocpChannel *lockedChanPtr, IocpBuffer *bufPtr);
+void         IocpChannelInvokeCallback(IocpChannel *lockedChanPtr,
+                                       Tcl_Interp *interp, Tcl_Obj *cmdObj);
+void         IocpInterpRelease(Tcl_Interp *interp, Tcl_ThreadId threadId);
 
 IocpTclCode IocpSetChannelDefaults(Tcl_Channel channel);
 
+/* Splice functions */
+int  IocpSpliceForward(IocpChannel *lockedFromPtr, IocpBuffer *bufPtr);
+void IocpSpliceWriteCompleted(IocpChannel *lockedToPtr, IocpBuffer *bufPtr);
+void IocpSpliceDetach(IocpChannel *lockedChanPtr);
+IocpChannel *IocpChannelFromTclChannel(Tcl_Channel channel);
+
+/* Message framing functions */
+int          IocpFrameReady(IocpChannel *lockedChanPtr);
+IocpTclCode  IocpFrameSetSpec(Tcl_Interp *interp, IocpChannel *lockedChanPtr,
+                              const char *specPtr);
+void         IocpFrameGetSpec(IocpChannel *lockedChanPtr, Tcl_DString *dsPtr);
+
+/* Rate limiting functions */
+int          IocpRateThrottled(IocpChannel *lockedChanPtr, int waitFlag);
+void         IocpRateAwait(IocpChannel *lockedChanPtr, int waitFlag);
+void         IocpRateConsume(IocpRateBucket *bucketPtr, int count);
+void         IocpRateSchedule(IocpChannel *lockedChanPtr);
+void         IocpRateCancelTimer(IocpChannel *lockedChanPtr);
+void         IocpRateRelease(IocpChannel *lockedChanPtr);
+IocpTclCode  IocpRateSetSpec(Tcl_Interp *interp, IocpChannel *lockedChanPtr,
+                             const char *specPtr);
+void         IocpRateGetSpec(IocpChannel *lockedChanPtr, Tcl_DString *dsPtr);
+
+/* TLS functions */
+int          IocpTlsReceive(IocpChannel *lockedChanPtr, IocpBuffer *bufPtr);
+IocpWinError IocpTlsPostWrite(IocpChannel *lockedChanPtr, const char *bytes,
+                              int nbytes, int *countPtr);
+void         IocpTlsShutdown(IocpChannel *lockedChanPtr);
+void         IocpTlsRelease(IocpChannel *lockedChanPtr);
+IocpTclCode  IocpTlsSetSpec(Tcl_Interp *interp, IocpChannel *lockedChanPtr,
+                            const char *specPtr);
+void         IocpTlsGetSpec(IocpChannel *lockedChanPtr, Tcl_DString *dsPtr);
+void         IocpTlsGetStatus(IocpChannel *lockedChanPtr, Tcl_DString *dsPtr);
+
+/* Compression functions */
+int          IocpCompressReceive(IocpChannel *lockedChanPtr, IocpBuffer *bufPtr);
+IocpWinError IocpCompressPostWrite(IocpChannel *lockedChanPtr, const char *bytes,
+                                   int nbytes, int *countPtr);
+IocpWinError IocpCompressPostBuffer(IocpChannel *lockedChanPtr, IocpBuffer *bufPtr);
+void         IocpCompressShutdown(IocpChannel *lockedChanPtr);
+void         IocpCompressRelease(IocpChannel *lockedChanPtr);
+IocpTclCode  IocpCompressSetSpec(Tcl_Interp *interp, IocpChannel *lockedChanPtr,
+                                 const char *specPtr);
+void         IocpCompressGetSpec(IocpChannel *lockedChanPtr, Tcl_DString *dsPtr);
+void         IocpCompressGetStats(IocpChannel *lockedChanPtr, Tcl_DString *dsPtr);
+
+/* Coroutine functions */
+void IocpCoResume(IocpChannel *lockedChanPtr);
+void IocpCoChannelClosed(IocpChannel *lockedChanPtr);
+
 /* Completion thread */
 DWORD WINAPI IocpCompletionThread (LPVOID lpParam);
 
@@ -717,6 +1002,15 @@ void AcceptCallbackProc(ClientData callbackData, Tcl_Channel chan,
 
 /* Module initializations */
 IocpTclCode Tcp_ModuleInitialize(Tcl_Interp *interp);
+IocpTclCode Pool_ModuleInitialize(Tcl_Interp *interp);
+IocpTclCode Splice_ModuleInitialize(Tcl_Interp *interp);
+IocpTclCode Udp_ModuleInitialize(Tcl_Interp *interp);
+IocpTclCode Unix_ModuleInitialize(Tcl_Interp *interp);
+IocpTclCode Pipe_ModuleInitialize(Tcl_Interp *interp);
+IocpTclCode File_ModuleInitialize(Tcl_Interp *interp);
+IocpTclCode Frame_ModuleInitialize(Tcl_Interp *interp);
+IocpTclCode Rate_ModuleInitialize(Tcl_Interp *interp);
+IocpTclCode Co_ModuleInitialize(Tcl_Interp *interp);
 #if IOCP_ENABLE_BLUETOOTH
 IocpTclCode BT_ModuleInitialize(Tcl_Interp *interp);
 #endif
@@ -965,6 +965,9 @@ BT_FormatAddressObjCmd (
  * Implementation of Bluetooth channels.
  */
 static IocpWinError BtClientBlockingConnect(IocpChannel *);
+static IocpTclCode  BtClientSetOption(IocpChannel *lockedChanPtr,
+                                      Tcl_Interp *interp, int opt,
+                                      const char *valuePtr);
 
 static IocpChannelVtbl btClientVtbl =  {
     /* "Virtual" functions */
@@ -978,9 +981,10 @@ static IocpChannelVtbl btClientVtbl =  {
     WinsockClientDisconnected,
     WinsockClientPostRead,
     WinsockClientPostWrite,
+    WinsockClientPostBuffer,
     WinsockClientGetHandle,
     WinsockClientGetOption,
-    WinsockClientSetOption,
+    BtClientSetOption,
     WinsockClientTranslateError,
     /* Data members */
     iocpWinsockOptionNames,
@@ -1040,7 +1044,7 @@ BtClientBlockingConnect(
             /* Sockets should not be inherited by children */
             SetHandleInformation((HANDLE)so, HANDLE_FLAG_INHERIT, 0);
 
-            if (IocpAttachDefaultPort((HANDLE)so) != NULL) {
+            if (IocpChannelAttachPort(WinsockClientToIocpChannel(btPtr), (HANDLE)so) != NULL) {
                 btPtr->base.state = IOCP_STATE_OPEN;
                 btPtr->so         = so;
                 /*
@@ -1066,6 +1070,45 @@ error_handler:
     return winError;
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * BtClientSetOption --
+ *
+ *    Sets the value of the given option. TLS and compression are only
+ *    supported on TCP sockets. All other options are handled as for other
+ *    Winsock clients.
+ *
+ * Results:
+ *    Returns TCL_OK on succes and TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    See WinsockClientSetOption.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+BtClientSetOption(
+    IocpChannel *lockedChanPtr, /* Locked on entry, locked on exit */
+    Tcl_Interp  *interp,        /* For error reporting. May be NULL */
+    int          opt,           /* Index into option table for option of interest */
+    const char  *valuePtr)      /* Option value */
+{
+    switch (opt) {
+    case IOCP_WINSOCK_OPT_TLS:
+        if (interp)
+            Tcl_SetResult(interp, "TLS is not supported on this channel.", TCL_STATIC);
+        Tcl_SetErrno(EINVAL);
+        return TCL_ERROR;
+    case IOCP_WINSOCK_OPT_COMPRESS:
+        if (interp)
+            Tcl_SetResult(interp, "Compression is not supported on this channel.", TCL_STATIC);
+        Tcl_SetErrno(EINVAL);
+        return TCL_ERROR;
+    }
+    return WinsockClientSetOption(lockedChanPtr, interp, opt, valuePtr);
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -1124,7 +1167,7 @@ BtClientPostConnect(
         return WSAGetLastError();
     }
 
-    if (IocpAttachDefaultPort((HANDLE) btPtr->so) == NULL) {
+    if (IocpChannelAttachPort(WinsockClientToIocpChannel(btPtr), (HANDLE) btPtr->so) == NULL) {
         return GetLastError(); /* NOT WSAGetLastError() ! */
     }
 
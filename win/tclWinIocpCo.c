@@ -0,0 +1,874 @@
+/*
+ * tclWinIocpCo.c --
+ *
+ *	Coroutine-aware read and write commands for iocp channels.
+ *
+ * Copyright (c) 2026 agent.
+ *
+ * See the file "license.terms" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+#include "tclWinIocp.h"
+#include <limits.h>
+
+/*
+ * The iocp::co::read, iocp::co::gets and iocp::co::write commands behave
+ * like their Tcl counterparts except that when a non-blocking channel
+ * cannot satisfy the request, the calling coroutine is suspended instead
+ * of the command returning partial results. Unlike the script level
+ * idiom of a fileevent handler that resumes the coroutine, no handler
+ * script is registered or evaluated.
+ *
+ * The commands are implemented with the NRE API. When the operation would
+ * block, an IocpCoWait is attached to the coReadPtr or coWritePtr field of
+ * the IocpChannel and the command yields. The channel is marked as watched
+ * so the completion thread queues a Tcl event when data arrives or
+ * writes complete. IocpEventHandler then calls IocpCoResume which resumes
+ * the coroutine directly if the channel has enough input or the Tcl
+ * output buffers have drained. On resumption, IocpCoYieldCallback retries
+ * the operation and either completes the command or yields again.
+ *
+ * An IocpCoWait holds a reference to the IocpChannel while it is attached.
+ * It is attached only while its coroutine is suspended in the command so
+ * the IocpCoWait is always valid when referenced from the channel. If the
+ * channel is closed, the waits are detached and the coroutines resumed
+ * from an idle callback with an error.
+ *
+ * At most one coroutine may wait for input and one for output on a channel
+ * at any time. Channels registered with iocp::watch are not supported as
+ * their readiness is reported only through iocp::poll.
+ */
+
+enum IocpCoOp {
+    IOCP_CO_READ,
+    IOCP_CO_GETS,
+    IOCP_CO_WRITE
+};
+
+struct IocpCoWait {
+    Tcl_Interp   *interp;
+    Tcl_Obj      *coroObj;      /* Fully qualified name of the coroutine */
+    Tcl_Obj      *chanNameObj;  /* Channel name as passed to the command */
+    Tcl_Obj      *dataObj;      /* READ - data read so far.
+                                 * WRITE - data to write. */
+    Tcl_Obj      *varNameObj;   /* GETS - variable to store line. May be NULL */
+    IocpChannel  *chanPtr;      /* Channel the wait is attached to. NULL if
+                                 * not attached. */
+    Tcl_WideInt   toRead;       /* READ - characters wanted, -1 for all */
+    Tcl_WideInt   numRead;      /* READ - characters read so far */
+    enum IocpCoOp op;
+    int           flags;
+#define IOCP_CO_F_WRITTEN 0x1   /* Data handed to the Tcl channel */
+#define IOCP_CO_F_CLOSED  0x2   /* Channel closed while waiting */
+#define IOCP_CO_F_IDLE    0x4   /* Idle callback pending */
+#define IOCP_CO_F_BLOCKED 0x8   /* Last attempt would have blocked */
+};
+
+static void IocpCoWaitFree(IocpCoWait *waitPtr);
+static void IocpCoResumeCoroutine(Tcl_Interp *interp, Tcl_Obj *coroObj);
+static Tcl_IdleProc IocpCoIdleResume;
+static Tcl_NRPostProc IocpCoYieldCallback;
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCoWaitSlot --
+ *
+ *    Returns the location in the channel where a wait is attached.
+ *
+ * Results:
+ *    Pointer to the coReadPtr or coWritePtr field.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpCoWait **
+IocpCoWaitSlot(
+    IocpChannel  *lockedChanPtr, /* Must be locked */
+    enum IocpCoOp op)
+{
+    return op == IOCP_CO_WRITE ? &lockedChanPtr->coWritePtr : &lockedChanPtr->coReadPtr;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCoCurrent --
+ *
+ *    Returns the name of the current coroutine.
+ *
+ * Results:
+ *    A Tcl_Obj whose reference count has been incremented or NULL if not
+ *    running in a coroutine or the coroutine is being deleted.
+ *
+ * Side effects:
+ *    The interpreter result is reset.
+ *
+ *------------------------------------------------------------------------
+ */
+static Tcl_Obj *
+IocpCoCurrent(
+    Tcl_Interp *interp)
+{
+    Tcl_Obj *coroObj = NULL;
+
+    if (Tcl_EvalEx(interp, "::info coroutine", -1, 0) == TCL_OK) {
+        coroObj = Tcl_GetObjResult(interp);
+        if (Tcl_GetCharLength(coroObj) == 0)
+            coroObj = NULL;
+        else
+            Tcl_IncrRefCount(coroObj);
+    }
+    Tcl_ResetResult(interp);
+    return coroObj;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCoReady --
+ *
+ *    Checks whether a coroutine waiting on a channel should be resumed.
+ *    Input waits are resumed when input is ready to be read or at end of
+ *    file. Output waits are resumed when the Tcl channel has no buffered
+ *    output. Both are resumed if the connection is no longer usable so
+ *    the error can be reported.
+ *
+ * Results:
+ *    Non-0 if ready, 0 otherwise.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static int
+IocpCoReady(
+    IocpChannel  *lockedChanPtr, /* Must be locked */
+    enum IocpCoOp op)
+{
+    if (lockedChanPtr->state & (IOCP_STATE_DISCONNECTED |
+                                IOCP_STATE_CONNECT_FAILED |
+                                IOCP_STATE_CLOSED))
+        return 1;
+    if (lockedChanPtr->state != IOCP_STATE_OPEN)
+        return 0;               /* Connection still being set up */
+    if (op == IOCP_CO_WRITE) {
+        return (lockedChanPtr->flags & IOCP_CHAN_F_READONLY) ||
+            lockedChanPtr->channel == NULL ||
+            Tcl_OutputBuffered(lockedChanPtr->channel) == 0;
+    } else {
+        return (lockedChanPtr->flags & (IOCP_CHAN_F_REMOTE_EOF | IOCP_CHAN_F_WRITEONLY)) ||
+            IocpChannelInputReady(lockedChanPtr);
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCoWaitAttach --
+ *
+ *    Attaches a wait to a channel if not already attached so the owning
+ *    coroutine is resumed when the channel is ready.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The channel is watched for the corresponding event and an event is
+ *    queued if it is already ready.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpCoWaitAttach(
+    IocpCoWait  *waitPtr,
+    IocpChannel *chanPtr)       /* Must NOT be locked */
+{
+    IocpChannelLock(chanPtr);
+    if (waitPtr->chanPtr == NULL) {
+        *IocpCoWaitSlot(chanPtr, waitPtr->op) = waitPtr;
+        chanPtr->numRefs++;     /* Released in IocpCoWaitFree */
+        waitPtr->chanPtr = chanPtr;
+        IocpChannelUpdateWatch(chanPtr);
+    }
+    /* Data may have arrived after the last attempt */
+    if (IocpCoReady(chanPtr, waitPtr->op))
+        IocpRequestEventPoll(chanPtr);
+    IocpChannelUnlock(chanPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCoWaitFree --
+ *
+ *    Detaches a wait from its channel, if attached, and frees it.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The channel reference held by the wait is released.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpCoWaitFree(
+    IocpCoWait *waitPtr)
+{
+    IocpChannel *chanPtr = waitPtr->chanPtr;
+
+    if (chanPtr) {
+        IocpCoWait **slotPtr;
+        IocpChannelLock(chanPtr);
+        slotPtr = IocpCoWaitSlot(chanPtr, waitPtr->op);
+        if (*slotPtr == waitPtr)
+            *slotPtr = NULL;
+        IocpChannelUpdateWatch(chanPtr);
+        IocpChannelDrop(chanPtr); /* Unlocks */
+    }
+    if (waitPtr->flags & IOCP_CO_F_IDLE)
+        Tcl_CancelIdleCall(IocpCoIdleResume, waitPtr);
+    if (waitPtr->coroObj)
+        Tcl_DecrRefCount(waitPtr->coroObj);
+    Tcl_DecrRefCount(waitPtr->chanNameObj);
+    if (waitPtr->dataObj)
+        Tcl_DecrRefCount(waitPtr->dataObj);
+    if (waitPtr->varNameObj)
+        Tcl_DecrRefCount(waitPtr->varNameObj);
+    ckfree(waitPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCoStep --
+ *
+ *    Attempts to complete the operation for a wait.
+ *
+ * Results:
+ *    A standard Tcl result code. If TCL_OK and IOCP_CO_F_BLOCKED is set
+ *    in the wait, the operation could not be completed without blocking
+ *    and the interpreter result is unchanged. Otherwise, the interpreter
+ *    holds the command result or error message.
+ *
+ * Side effects:
+ *    Data is read from or written to the channel.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+IocpCoStep(
+    Tcl_Interp *interp,
+    IocpCoWait *waitPtr)
+{
+    Tcl_Channel chan;
+    Tcl_Obj    *lineObj;
+    Tcl_Size    nchars;
+
+    waitPtr->flags &= ~IOCP_CO_F_BLOCKED;
+    if (waitPtr->flags & IOCP_CO_F_CLOSED) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" was closed.", Tcl_GetString(waitPtr->chanNameObj)));
+        return TCL_ERROR;
+    }
+    chan = Tcl_GetChannel(interp, Tcl_GetString(waitPtr->chanNameObj), NULL);
+    if (chan == NULL)
+        return TCL_ERROR;
+
+    switch (waitPtr->op) {
+    case IOCP_CO_READ:
+        while (waitPtr->toRead < 0 || waitPtr->numRead < waitPtr->toRead) {
+            Tcl_WideInt want = -1;
+            if (waitPtr->toRead >= 0) {
+                want = waitPtr->toRead - waitPtr->numRead;
+                if (want > INT_MAX)
+                    want = INT_MAX;
+            }
+            nchars = Tcl_ReadChars(chan, waitPtr->dataObj, (Tcl_Size) want, 1);
+            if (nchars < 0)
+                goto readError;
+            waitPtr->numRead += nchars;
+            if (Tcl_Eof(chan))
+                break;
+            if (Tcl_InputBlocked(chan)) {
+                waitPtr->flags |= IOCP_CO_F_BLOCKED;
+                return TCL_OK;
+            }
+        }
+        Tcl_SetObjResult(interp, waitPtr->dataObj);
+        return TCL_OK;
+
+    case IOCP_CO_GETS:
+        lineObj = Tcl_NewObj();
+        Tcl_IncrRefCount(lineObj);
+        nchars = Tcl_GetsObj(chan, lineObj);
+        if (nchars < 0) {
+            if (Tcl_InputBlocked(chan)) {
+                /* Partial line remains in the channel buffers */
+                Tcl_DecrRefCount(lineObj);
+                waitPtr->flags |= IOCP_CO_F_BLOCKED;
+                return TCL_OK;
+            }
+            if (!Tcl_Eof(chan)) {
+                Tcl_DecrRefCount(lineObj);
+                goto readError;
+            }
+            nchars = -1;
+        }
+        if (waitPtr->varNameObj) {
+            if (Tcl_ObjSetVar2(interp, waitPtr->varNameObj, NULL, lineObj,
+                               TCL_LEAVE_ERR_MSG) == NULL) {
+                Tcl_DecrRefCount(lineObj);
+                return TCL_ERROR;
+            }
+            Tcl_SetObjResult(interp, Tcl_NewWideIntObj(nchars));
+        } else {
+            Tcl_SetObjResult(interp, lineObj);
+        }
+        Tcl_DecrRefCount(lineObj);
+        return TCL_OK;
+
+    case IOCP_CO_WRITE:
+        if (!(waitPtr->flags & IOCP_CO_F_WRITTEN)) {
+            waitPtr->flags |= IOCP_CO_F_WRITTEN;
+            if (Tcl_WriteObj(chan, waitPtr->dataObj) < 0)
+                goto writeError;
+        }
+        /* Also picks up errors from background flushes on later attempts */
+        if (Tcl_Flush(chan) != TCL_OK)
+            goto writeError;
+        if (Tcl_OutputBuffered(chan) > 0) {
+            waitPtr->flags |= IOCP_CO_F_BLOCKED;
+            return TCL_OK;
+        }
+        Tcl_ResetResult(interp);
+        return TCL_OK;
+    }
+
+    Iocp_Panic("IocpCoStep: unknown operation %d", waitPtr->op);
+    return TCL_ERROR;
+
+writeError:
+    Tcl_SetObjResult(interp, Tcl_ObjPrintf("error writing \"%s\": %s", Tcl_GetString(waitPtr->chanNameObj), Tcl_PosixError(interp)));
+    return TCL_ERROR;
+
+readError:
+    Tcl_SetObjResult(interp, Tcl_ObjPrintf("error reading \"%s\": %s", Tcl_GetString(waitPtr->chanNameObj), Tcl_PosixError(interp)));
+    return TCL_ERROR;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCoYield --
+ *
+ *    Suspends the current coroutine until the channel is ready.
+ *
+ * Results:
+ *    A standard Tcl result code.
+ *
+ * Side effects:
+ *    The wait is attached to the channel and IocpCoYieldCallback is
+ *    scheduled to run when the coroutine is resumed.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+IocpCoYield(
+    Tcl_Interp  *interp,
+    IocpCoWait  *waitPtr,
+    IocpChannel *chanPtr)       /* Must NOT be locked */
+{
+    IocpCoWaitAttach(waitPtr, chanPtr);
+    Tcl_NRAddCallback(interp, IocpCoYieldCallback, waitPtr, chanPtr, NULL, NULL);
+    return Tcl_NREvalObj(interp, Tcl_NewStringObj("::yield", -1), 0);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCoYieldCallback --
+ *
+ *    Called when a coroutine suspended in an iocp::co command is resumed.
+ *    Retries the operation and yields again if it would still block.
+ *
+ * Results:
+ *    A standard Tcl result code.
+ *
+ * Side effects:
+ *    The wait is freed once the command completes.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+IocpCoYieldCallback(
+    ClientData  data[],
+    Tcl_Interp *interp,
+    int         result)
+{
+    IocpCoWait  *waitPtr = (IocpCoWait *)data[0];
+    IocpChannel *chanPtr = (IocpChannel *)data[1];
+
+    if (result == TCL_OK) {
+        /*
+         * A coroutine deleted while suspended is also resumed. Do not
+         * retry in that case. Otherwise pick up any rename.
+         */
+        Tcl_Obj *coroObj = IocpCoCurrent(interp);
+        if (coroObj == NULL) {
+            IocpCoWaitFree(waitPtr);
+            return TCL_ERROR;
+        }
+        Tcl_DecrRefCount(waitPtr->coroObj);
+        waitPtr->coroObj = coroObj;
+        result = IocpCoStep(interp, waitPtr);
+        if (result == TCL_OK && (waitPtr->flags & IOCP_CO_F_BLOCKED))
+            return IocpCoYield(interp, waitPtr, chanPtr);
+    }
+    IocpCoWaitFree(waitPtr);
+    return result;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCoResumeCoroutine --
+ *
+ *    Resumes a coroutine suspended in an iocp::co command.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    Errors are reported as background errors.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpCoResumeCoroutine(
+    Tcl_Interp *interp,
+    Tcl_Obj    *coroObj)
+{
+    int code;
+
+    Tcl_Preserve(interp);
+    Tcl_IncrRefCount(coroObj);
+    code = Tcl_EvalObjv(interp, 1, &coroObj, TCL_EVAL_GLOBAL);
+    if (code != TCL_OK)
+        Tcl_BackgroundException(interp, code);
+    Tcl_ResetResult(interp);
+    Tcl_DecrRefCount(coroObj);
+    Tcl_Release(interp);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCoResume --
+ *
+ *    Called from IocpEventHandler to resume coroutines waiting on a
+ *    channel that is ready.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    Coroutines are resumed. The channel is unlocked while they run so
+ *    its state may change. Caller must hold a reference to the channel.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpCoResume(
+    IocpChannel *lockedChanPtr) /* Locked on entry, locked on return but
+                                 * unlocked in between */
+{
+    static const enum IocpCoOp ops[] = {IOCP_CO_READ, IOCP_CO_WRITE};
+    int i;
+
+    for (i = 0; i < sizeof(ops)/sizeof(ops[0]); ++i) {
+        IocpCoWait *waitPtr;
+        Tcl_Interp *interp;
+        Tcl_Obj    *coroObj;
+
+        if (lockedChanPtr->state == IOCP_STATE_CLOSED)
+            break;
+        waitPtr = *IocpCoWaitSlot(lockedChanPtr, ops[i]);
+        if (waitPtr == NULL || !IocpCoReady(lockedChanPtr, ops[i]))
+            continue;
+        /* The wait may be freed by the coroutine so copy what we need */
+        interp  = waitPtr->interp;
+        coroObj = waitPtr->coroObj;
+        Tcl_IncrRefCount(coroObj);
+        IocpChannelUnlock(lockedChanPtr);
+        IocpCoResumeCoroutine(interp, coroObj);
+        Tcl_DecrRefCount(coroObj);
+        IocpChannelLock(lockedChanPtr);
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCoIdleResume --
+ *
+ *    Idle callback to resume a coroutine whose channel was closed.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The coroutine is resumed and the command returns an error.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpCoIdleResume(
+    ClientData clientData)
+{
+    IocpCoWait *waitPtr = (IocpCoWait *)clientData;
+    waitPtr->flags &= ~IOCP_CO_F_IDLE;
+    IocpCoResumeCoroutine(waitPtr->interp, waitPtr->coroObj);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCoChannelClosed --
+ *
+ *    Called when a channel is closed to detach any coroutines waiting on
+ *    it.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The coroutines are resumed from the event loop and their commands
+ *    return an error.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpCoChannelClosed(
+    IocpChannel *lockedChanPtr) /* Must be locked */
+{
+    IocpCoWait **slots[2];
+    int i;
+
+    slots[0] = &lockedChanPtr->coReadPtr;
+    slots[1] = &lockedChanPtr->coWritePtr;
+    for (i = 0; i < 2; ++i) {
+        IocpCoWait *waitPtr = *slots[i];
+        if (waitPtr == NULL)
+            continue;
+        *slots[i] = NULL;
+        waitPtr->chanPtr = NULL;
+        /* Caller still holds the Tcl channel reference so cannot hit 0 */
+        lockedChanPtr->numRefs--;
+        waitPtr->flags |= IOCP_CO_F_CLOSED | IOCP_CO_F_IDLE;
+        Tcl_DoWhenIdle(IocpCoIdleResume, waitPtr);
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCoCommand --
+ *
+ *    Common implementation of the iocp::co commands.
+ *
+ * Results:
+ *    A standard Tcl result code.
+ *
+ * Side effects:
+ *    The calling coroutine may be suspended. On return, ownership of
+ *    waitPtr has passed to this function.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+IocpCoCommand(
+    Tcl_Interp *interp,
+    Tcl_Obj    *cmdObj,         /* Command name for error messages */
+    IocpCoWait *waitPtr)        /* Operation specific fields initialized */
+{
+    Tcl_Channel  chan;
+    IocpChannel *chanPtr;
+    const char  *chanName = Tcl_GetString(waitPtr->chanNameObj);
+    int          mode;
+    int          code;
+
+    waitPtr->interp  = interp;
+    waitPtr->chanPtr = NULL;
+    waitPtr->numRead = 0;
+    waitPtr->flags   = 0;
+
+    chan = Tcl_GetChannel(interp, chanName, &mode);
+    if (chan == NULL)
+        goto error_return;
+    if (waitPtr->op == IOCP_CO_WRITE) {
+        if (!(mode & TCL_WRITABLE)) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" wasn't opened for writing", chanName));
+            goto error_return;
+        }
+    } else {
+        if (!(mode & TCL_READABLE)) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" wasn't opened for reading", chanName));
+            goto error_return;
+        }
+    }
+    chanPtr = IocpChannelFromTclChannel(chan);
+    if (chanPtr == NULL) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" is not an iocp channel.", chanName));
+        goto error_return;
+    }
+
+    /* Cannot resume without knowing the coroutine */
+    waitPtr->coroObj = IocpCoCurrent(interp);
+    if (waitPtr->coroObj == NULL) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("%s must be called from within a coroutine.", Tcl_GetString(cmdObj)));
+        goto error_return;
+    }
+
+    IocpChannelLock(chanPtr);
+    if (chanPtr->flags & IOCP_CHAN_F_POLLED) {
+        IocpChannelUnlock(chanPtr);
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" is registered with iocp::watch.", chanName));
+        goto error_return;
+    }
+    if (*IocpCoWaitSlot(chanPtr, waitPtr->op) != NULL) {
+        IocpChannelUnlock(chanPtr);
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" is already in use by another coroutine.", chanName));
+        goto error_return;
+    }
+    IocpChannelUnlock(chanPtr);
+
+    code = IocpCoStep(interp, waitPtr);
+    if (code == TCL_OK && (waitPtr->flags & IOCP_CO_F_BLOCKED))
+        return IocpCoYield(interp, waitPtr, chanPtr);
+    IocpCoWaitFree(waitPtr);
+    return code;
+
+error_return:
+    IocpCoWaitFree(waitPtr);
+    return TCL_ERROR;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCoWaitNew --
+ *
+ *    Allocates a wait for an iocp::co command.
+ *
+ * Results:
+ *    Pointer to the allocated IocpCoWait.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpCoWait *
+IocpCoWaitNew(
+    enum IocpCoOp op,
+    Tcl_Obj      *chanNameObj)
+{
+    IocpCoWait *waitPtr = ckalloc(sizeof(*waitPtr));
+    waitPtr->op          = op;
+    waitPtr->chanNameObj = chanNameObj;
+    Tcl_IncrRefCount(chanNameObj);
+    waitPtr->coroObj     = NULL;
+    waitPtr->dataObj     = NULL;
+    waitPtr->varNameObj  = NULL;
+    waitPtr->toRead      = -1;
+    return waitPtr;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Co_ReadNRObjCmd --
+ *
+ *    Implements the iocp::co::read command.
+ *
+ *      read CHAN ?NUMCHARS?
+ *
+ *    Reads NUMCHARS characters, or all data until end of file if NUMCHARS
+ *    is not specified, suspending the calling coroutine as needed.
+ *
+ * Results:
+ *    A standard Tcl result code. Fewer than NUMCHARS characters are only
+ *    returned at end of file.
+ *
+ * Side effects:
+ *    Data is read from the channel.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Co_ReadNRObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    IocpCoWait *waitPtr;
+    Tcl_WideInt toRead = -1;
+
+    if (objc != 2 && objc != 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "CHAN ?NUMCHARS?");
+        return TCL_ERROR;
+    }
+    if (objc == 3) {
+        if (Tcl_GetWideIntFromObj(interp, objv[2], &toRead) != TCL_OK)
+            return TCL_ERROR;
+        if (toRead < 0) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("expected non-negative integer but got \"%s\"", Tcl_GetString(objv[2])));
+            return TCL_ERROR;
+        }
+    }
+    waitPtr = IocpCoWaitNew(IOCP_CO_READ, objv[1]);
+    waitPtr->toRead  = toRead;
+    waitPtr->dataObj = Tcl_NewObj();
+    Tcl_IncrRefCount(waitPtr->dataObj);
+    return IocpCoCommand(interp, objv[0], waitPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Co_GetsNRObjCmd --
+ *
+ *    Implements the iocp::co::gets command.
+ *
+ *      gets CHAN ?VARNAME?
+ *
+ *    Reads the next line from the channel, suspending the calling
+ *    coroutine until a complete line or end of file is seen.
+ *
+ * Results:
+ *    A standard Tcl result code. The result is the line or, if VARNAME is
+ *    specified, the number of characters in the line or -1 at end of file.
+ *
+ * Side effects:
+ *    Data is read from the channel.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Co_GetsNRObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    IocpCoWait *waitPtr;
+
+    if (objc != 2 && objc != 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "CHAN ?VARNAME?");
+        return TCL_ERROR;
+    }
+    waitPtr = IocpCoWaitNew(IOCP_CO_GETS, objv[1]);
+    if (objc == 3) {
+        waitPtr->varNameObj = objv[2];
+        Tcl_IncrRefCount(waitPtr->varNameObj);
+    }
+    return IocpCoCommand(interp, objv[0], waitPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Co_WriteNRObjCmd --
+ *
+ *    Implements the iocp::co::write command.
+ *
+ *      write CHAN DATA
+ *
+ *    Writes and flushes DATA, suspending the calling coroutine until the
+ *    channel has accepted all of it.
+ *
+ * Results:
+ *    A standard Tcl result code.
+ *
+ * Side effects:
+ *    Data is written to the channel.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Co_WriteNRObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    IocpCoWait *waitPtr;
+
+    if (objc != 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "CHAN DATA");
+        return TCL_ERROR;
+    }
+    waitPtr = IocpCoWaitNew(IOCP_CO_WRITE, objv[1]);
+    waitPtr->dataObj = objv[2];
+    Tcl_IncrRefCount(waitPtr->dataObj);
+    return IocpCoCommand(interp, objv[0], waitPtr);
+}
+
+/* Non-NRE entry points. Only usable from a coroutine so invoke via NRE. */
+static IocpTclCode
+Co_ReadObjCmd (
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST objv[])
+{
+    return Tcl_NRCallObjProc(interp, Co_ReadNRObjCmd, clientData, objc, objv);
+}
+
+static IocpTclCode
+Co_GetsObjCmd (
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST objv[])
+{
+    return Tcl_NRCallObjProc(interp, Co_GetsNRObjCmd, clientData, objc, objv);
+}
+
+static IocpTclCode
+Co_WriteObjCmd (
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *CONST objv[])
+{
+    return Tcl_NRCallObjProc(interp, Co_WriteNRObjCmd, clientData, objc, objv);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Co_ModuleInitialize --
+ *
+ *    Initializes the coroutine module.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    Creates the iocp::co commands.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode Co_ModuleInitialize (Tcl_Interp *interp)
+{
+    Tcl_NRCreateCommand(interp, "iocp::co::read", Co_ReadObjCmd, Co_ReadNRObjCmd, 0L, 0L);
+    Tcl_NRCreateCommand(interp, "iocp::co::gets", Co_GetsObjCmd, Co_GetsNRObjCmd, 0L, 0L);
+    Tcl_NRCreateCommand(interp, "iocp::co::write", Co_WriteObjCmd, Co_WriteNRObjCmd, 0L, 0L);
+    return TCL_OK;
+}
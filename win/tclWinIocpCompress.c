@@ -0,0 +1,613 @@
+/*
+ * tclWinIocpCompress.c --
+ *
+ *	Streaming compression for IOCP socket channels.
+ *
+ * Copyright (c) 2026 agent.
+ *
+ * See the file "license.terms" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+#include "tclWinIocp.h"
+
+/*
+ * The -compress option compresses all data written to a socket and
+ * decompresses all data received with a pair of zlib streams provided
+ * by the Tcl core.
+ *
+ * Data written through the channel is compressed in the Tcl thread by
+ * IocpCompressPostWrite. Each call from the Tcl channel layer, i.e. each
+ * time the channel buffer is flushed, ends with a zlib sync flush so the
+ * peer can decompress everything written so far. The compressed data is
+ * posted with the channel's postbuffer() as a single write.
+ *
+ * Received data is decompressed by the completion thread in
+ * IocpCompressReceive before being queued on inputBuffers so the rest of
+ * the channel, including -framing and -readdelimiter, only sees the
+ * decompressed data. The Tcl objects used by the streams are only accessed
+ * under the channel lock and never shared. All state is protected by the
+ * channel lock.
+ */
+
+typedef struct IocpCompress {
+    Tcl_ZlibStream deflater;    /* Compresses output */
+    Tcl_ZlibStream inflater;    /* Decompresses input */
+    char          *spec;        /* Normalized option value */
+    int            inputDone;   /* End of compressed input stream seen or
+                                 * decompression failed. Further data is
+                                 * discarded. */
+    int            outputDone;  /* Compressed stream finalized */
+    Tcl_WideInt    bytesIn;     /* Decompressed bytes received */
+    Tcl_WideInt    wireIn;      /* Compressed bytes received */
+    Tcl_WideInt    bytesOut;    /* Bytes written by application */
+    Tcl_WideInt    wireOut;     /* Compressed bytes posted */
+} IocpCompress;
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCompressFree --
+ *
+ *    Releases all resources held by a IocpCompress structure.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The structure is freed.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpCompressFree(IocpCompress *compressPtr)
+{
+    if (compressPtr->deflater)
+        Tcl_ZlibStreamClose(compressPtr->deflater);
+    if (compressPtr->inflater)
+        Tcl_ZlibStreamClose(compressPtr->inflater);
+    if (compressPtr->spec)
+        ckfree(compressPtr->spec);
+    ckfree(compressPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCompressPost --
+ *
+ *    Compresses data and posts the result to the channel as a single
+ *    write. The maxPendingWrites limit is not applied.
+ *
+ * Results:
+ *    0 on success or a Windows error code.
+ *
+ * Side effects:
+ *    A write is posted unless the compressor did not produce any output.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+IocpCompressPost(
+    IocpChannel *lockedChanPtr, /* Locked on entry and return */
+    const char  *bytes,
+    int          nbytes,
+    int          flush)         /* TCL_ZLIB_FLUSH or TCL_ZLIB_FINALIZE */
+{
+    IocpCompress  *compressPtr = lockedChanPtr->compressPtr;
+    IocpBuffer    *bufPtr;
+    Tcl_Obj       *objPtr;
+    unsigned char *outPtr;
+    Tcl_Size       outLen;
+    IocpWinError   winError = ERROR_SUCCESS;
+
+    objPtr = Tcl_NewByteArrayObj((unsigned char *)bytes, nbytes);
+    Tcl_IncrRefCount(objPtr);
+    if (Tcl_ZlibStreamPut(compressPtr->deflater, objPtr, flush) != TCL_OK)
+        winError = ERROR_INVALID_DATA;
+    Tcl_DecrRefCount(objPtr);
+    if (winError != ERROR_SUCCESS)
+        return winError;
+    compressPtr->bytesOut += nbytes;
+
+    /* Tcl may return the output in pieces so loop until drained */
+    do {
+        objPtr = Tcl_NewObj();
+        Tcl_IncrRefCount(objPtr);
+        if (Tcl_ZlibStreamGet(compressPtr->deflater, objPtr, -1) != TCL_OK) {
+            Tcl_DecrRefCount(objPtr);
+            return ERROR_INVALID_DATA;
+        }
+        outPtr = Tcl_GetByteArrayFromObj(objPtr, &outLen);
+        if (outLen > 0) {
+            bufPtr = IocpBufferNew((int) outLen, IOCP_BUFFER_OP_WRITE,
+                                   IOCP_BUFFER_F_WINSOCK);
+            if (bufPtr == NULL) {
+                winError = WSAENOBUFS;
+            } else {
+                IocpBufferCopyIn(bufPtr, (char *)outPtr, (int) outLen);
+                winError = lockedChanPtr->vtblPtr->postbuffer(lockedChanPtr, bufPtr);
+                if (winError != ERROR_SUCCESS)
+                    IocpBufferFree(bufPtr);
+                else
+                    compressPtr->wireOut += outLen;
+            }
+        }
+        Tcl_DecrRefCount(objPtr);
+    } while (outLen > 0 && winError == ERROR_SUCCESS);
+    return winError;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCompressPostWrite --
+ *
+ *    Compresses data and posts it to the channel. Follows the conventions
+ *    of the postwrite() function in IocpChannelVtbl.
+ *
+ * Results:
+ *    If data is written, returns 0 and stores nbytes in *countPtr. If
+ *    the write would block, returns 0 and stores 0 in *countPtr. On
+ *    error, returns a Windows error code.
+ *
+ * Side effects:
+ *    A write is posted.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpWinError
+IocpCompressPostWrite(
+    IocpChannel *lockedChanPtr, /* Locked on entry and return */
+    const char  *bytes,         /* Uncompressed data */
+    int          nbytes,        /* Number of bytes */
+    int         *countPtr)      /* Output - number of bytes consumed */
+{
+    IocpWinError winError;
+
+    if (lockedChanPtr->compressPtr->outputDone)
+        return WSAESHUTDOWN;
+    if (lockedChanPtr->pendingWrites >= lockedChanPtr->maxPendingWrites) {
+        *countPtr = 0;
+        return ERROR_SUCCESS;
+    }
+    winError = IocpCompressPost(lockedChanPtr, bytes, nbytes, TCL_ZLIB_FLUSH);
+    if (winError != ERROR_SUCCESS)
+        return winError;
+    *countPtr = nbytes;
+    return ERROR_SUCCESS;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCompressPostBuffer --
+ *
+ *    Compresses the content of a buffer and posts the result. Used for
+ *    writes that bypass the Tcl channel layer, e.g. [writemsg].
+ *
+ * Results:
+ *    0 on success or a Windows error code.
+ *
+ * Side effects:
+ *    On success, bufPtr is freed. On error, it is still owned by the
+ *    caller as for the postbuffer() function in IocpChannelVtbl.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpWinError
+IocpCompressPostBuffer(
+    IocpChannel *lockedChanPtr, /* Locked on entry and return */
+    IocpBuffer  *bufPtr)        /* Uncompressed data */
+{
+    IocpWinError winError;
+
+    if (lockedChanPtr->compressPtr->outputDone)
+        return WSAESHUTDOWN;
+    winError = IocpCompressPost(lockedChanPtr,
+                                bufPtr->data.bytes + bufPtr->data.begin,
+                                bufPtr->data.len, TCL_ZLIB_FLUSH);
+    if (winError == ERROR_SUCCESS)
+        IocpBufferFree(bufPtr);
+    return winError;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCompressShutdown --
+ *
+ *    Finalizes the compressed output stream. Called when the channel is
+ *    closed or shut down for writing.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The end of stream marker, and the trailer for the gzip format, is
+ *    sent. No further writes are permitted.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpCompressShutdown(
+    IocpChannel *lockedChanPtr) /* Locked on entry and return */
+{
+    IocpCompress *compressPtr = lockedChanPtr->compressPtr;
+
+    if (compressPtr == NULL || compressPtr->outputDone)
+        return;
+    if (lockedChanPtr->state == IOCP_STATE_OPEN &&
+        (lockedChanPtr->flags & IOCP_CHAN_F_READONLY) == 0) {
+        IocpCompressPost(lockedChanPtr, NULL, 0, TCL_ZLIB_FINALIZE);
+    }
+    compressPtr->outputDone = 1;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCompressReceive --
+ *
+ *    Processes a completed read on a channel with compression enabled.
+ *    Called from the completion thread in place of queueing the buffer on
+ *    inputBuffers.
+ *
+ * Results:
+ *    Non-0 if data, EOF or an error was queued on inputBuffers and the
+ *    reader needs to be notified.
+ *
+ * Side effects:
+ *    bufPtr is no longer owned by the caller. If no data was produced,
+ *    reads are posted to receive more.
+ *
+ *------------------------------------------------------------------------
+ */
+int
+IocpCompressReceive(
+    IocpChannel *lockedChanPtr, /* Locked on entry and return */
+    IocpBuffer  *bufPtr)        /* Completed read, chanPtr already cleared */
+{
+    IocpCompress  *compressPtr = lockedChanPtr->compressPtr;
+    Tcl_Obj       *objPtr;
+    unsigned char *outPtr;
+    Tcl_Size       outLen = 0;
+    IocpWinError   winError;
+    int            queued = 0;
+
+    if (bufPtr->winError != ERROR_SUCCESS || bufPtr->data.len == 0) {
+        /* EOF or error on the connection is passed up as is */
+        if (compressPtr->inputDone && bufPtr->winError == ERROR_SUCCESS) {
+            /* EOF already queued at end of the compressed stream */
+            IocpBufferFree(bufPtr);
+            return 0;
+        }
+        compressPtr->inputDone = 1;
+        IocpChannelQueueInput(lockedChanPtr, bufPtr);
+        return 1;
+    }
+    if (compressPtr->inputDone) {
+        /* Nothing may follow the end of the compressed stream */
+        IocpBufferFree(bufPtr);
+        return 0;
+    }
+
+    compressPtr->wireIn += bufPtr->data.len;
+    objPtr = Tcl_NewByteArrayObj(
+        (unsigned char *)bufPtr->data.bytes + bufPtr->data.begin,
+        bufPtr->data.len);
+    Tcl_IncrRefCount(objPtr);
+    winError = ERROR_SUCCESS;
+    if (Tcl_ZlibStreamPut(compressPtr->inflater, objPtr, TCL_ZLIB_NO_FLUSH) != TCL_OK)
+        winError = ERROR_INVALID_DATA;
+    Tcl_DecrRefCount(objPtr);
+    IocpBufferFree(bufPtr);
+
+    /* Tcl limits the amount returned per call so loop until drained */
+    while (winError == ERROR_SUCCESS) {
+        objPtr = Tcl_NewObj();
+        Tcl_IncrRefCount(objPtr);
+        if (Tcl_ZlibStreamGet(compressPtr->inflater, objPtr, -1) != TCL_OK) {
+            winError = ERROR_INVALID_DATA;
+        } else {
+            outPtr = Tcl_GetByteArrayFromObj(objPtr, &outLen);
+            if (outLen > 0) {
+                bufPtr = IocpBufferNew((int) outLen, IOCP_BUFFER_OP_READ,
+                                       IOCP_BUFFER_F_WINSOCK);
+                if (bufPtr == NULL) {
+                    winError = WSAENOBUFS;
+                } else {
+                    IocpBufferCopyIn(bufPtr, (char *)outPtr, (int) outLen);
+                    compressPtr->bytesIn += outLen;
+                    IocpChannelQueueInput(lockedChanPtr, bufPtr);
+                    queued = 1;
+                }
+            }
+        }
+        Tcl_DecrRefCount(objPtr);
+        if (outLen == 0)
+            break;
+    }
+
+    if (winError != ERROR_SUCCESS) {
+        IOCP_TRACE(("IocpCompressReceive: lockedChanPtr=%p winError=0x%x\n", lockedChanPtr, winError));
+        compressPtr->inputDone = 1;
+        bufPtr = IocpBufferNew(0, IOCP_BUFFER_OP_READ, IOCP_BUFFER_F_WINSOCK);
+        if (bufPtr) {
+            bufPtr->winError = winError;
+            IocpChannelQueueInput(lockedChanPtr, bufPtr);
+        }
+        return 1;
+    }
+
+    if (Tcl_ZlibStreamEof(compressPtr->inflater)) {
+        /* Peer finalized its stream. Queue a zero length buffer as EOF. */
+        compressPtr->inputDone = 1;
+        bufPtr = IocpBufferNew(0, IOCP_BUFFER_OP_READ, IOCP_BUFFER_F_WINSOCK);
+        if (bufPtr)
+            IocpChannelQueueInput(lockedChanPtr, bufPtr);
+        return 1;
+    }
+
+    if (queued)
+        return 1;
+
+    /*
+     * Nothing was produced, e.g. only part of a deflate block has arrived.
+     * The Tcl thread is not woken so it will not repost reads. Post them
+     * here instead.
+     */
+    if (lockedChanPtr->state == IOCP_STATE_OPEN &&
+        (lockedChanPtr->flags & (IOCP_CHAN_F_REMOTE_EOF|IOCP_CHAN_F_WRITEONLY)) == 0) {
+        winError = IocpChannelPostReads(lockedChanPtr);
+        if (winError != ERROR_SUCCESS) {
+            compressPtr->inputDone = 1;
+            bufPtr = IocpBufferNew(0, IOCP_BUFFER_OP_READ, IOCP_BUFFER_F_WINSOCK);
+            if (bufPtr) {
+                bufPtr->winError = winError;
+                IocpChannelQueueInput(lockedChanPtr, bufPtr);
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCompressRelease --
+ *
+ *    Releases the compression state of a channel. Called when the channel
+ *    is freed.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The zlib streams are closed.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpCompressRelease(
+    IocpChannel *lockedChanPtr) /* Locked on entry and return */
+{
+    if (lockedChanPtr->compressPtr) {
+        IocpCompressFree(lockedChanPtr->compressPtr);
+        lockedChanPtr->compressPtr = NULL;
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCompressSetSpec --
+ *
+ *    Enables compression on a connected channel from a -compress option
+ *    value. The value is a list whose first element is the format,
+ *    deflate, gzip or zlib, optionally followed by the key level and the
+ *    compression level 0-9. An empty value is accepted if compression is
+ *    not enabled.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    All data written and received after the call is compressed.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode
+IocpCompressSetSpec(
+    Tcl_Interp  *interp,        /* For error reporting. May be NULL */
+    IocpChannel *lockedChanPtr, /* Locked on entry, locked on exit */
+    const char  *specPtr)       /* Option value */
+{
+    static const char *const formats[] = { "deflate", "gzip", "zlib", NULL };
+    static const int formatValues[] = {
+        TCL_ZLIB_FORMAT_RAW, TCL_ZLIB_FORMAT_GZIP, TCL_ZLIB_FORMAT_ZLIB
+    };
+    static const char *const specKeys[] = { "level", NULL };
+    Tcl_Obj      *specObj;
+    Tcl_Obj     **objs;
+    Tcl_Size      nobjs;
+    Tcl_Size      i;
+    int           keyIndex;
+    int           format;
+    int           level = -1;
+    IocpCompress *compressPtr = NULL;
+    Tcl_DString   ds;
+    IocpTclCode   ret = TCL_ERROR;
+
+    specObj = Tcl_NewStringObj(specPtr, -1);
+    Tcl_IncrRefCount(specObj);
+    Tcl_DStringInit(&ds);
+
+    if (Tcl_ListObjGetElements(interp, specObj, &nobjs, &objs) != TCL_OK)
+        goto vamoose;
+    if (nobjs == 0) {
+        if (lockedChanPtr->compressPtr == NULL) {
+            ret = TCL_OK;
+        } else if (interp) {
+            Tcl_SetResult(interp, "Compression cannot be disabled once enabled.", TCL_STATIC);
+        }
+        goto vamoose;
+    }
+    if ((nobjs & 1) == 0) {
+        if (interp)
+            Tcl_SetResult(interp, "Invalid compression configuration. Must be a format optionally followed by the level key and value.", TCL_STATIC);
+        goto vamoose;
+    }
+    if (Tcl_GetIndexFromObj(interp, objs[0], formats, "compression format",
+                            TCL_EXACT, &format) != TCL_OK)
+        goto vamoose;
+    for (i = 1; i < nobjs; i += 2) {
+        if (Tcl_GetIndexFromObj(interp, objs[i], specKeys, "compression key",
+                                TCL_EXACT, &keyIndex) != TCL_OK)
+            goto vamoose;
+        if (Tcl_GetIntFromObj(interp, objs[i+1], &level) != TCL_OK)
+            goto vamoose;
+        if (level < 0 || level > 9) {
+            if (interp)
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Compression level %d out of range 0-9.", level));
+            goto vamoose;
+        }
+    }
+
+    if (lockedChanPtr->compressPtr) {
+        if (interp)
+            Tcl_SetResult(interp, "Compression is already enabled on the channel.", TCL_STATIC);
+        goto vamoose;
+    }
+    if (lockedChanPtr->vtblPtr->postbuffer == NULL) {
+        if (interp)
+            Tcl_SetResult(interp, "Compression is not supported on this channel.", TCL_STATIC);
+        goto vamoose;
+    }
+    if (lockedChanPtr->tlsPtr) {
+        if (interp)
+            Tcl_SetResult(interp, "Compression cannot be combined with TLS.", TCL_STATIC);
+        goto vamoose;
+    }
+    if (lockedChanPtr->spliceToPtr || lockedChanPtr->spliceFromPtr) {
+        if (interp)
+            Tcl_SetResult(interp, "Compression cannot be enabled on a spliced channel.", TCL_STATIC);
+        goto vamoose;
+    }
+    if (lockedChanPtr->state != IOCP_STATE_OPEN) {
+        if (interp)
+            Tcl_SetResult(interp, "Compression can only be enabled on a connected socket.", TCL_STATIC);
+        goto vamoose;
+    }
+
+    compressPtr = ckalloc(sizeof(*compressPtr));
+    memset(compressPtr, 0, sizeof(*compressPtr));
+    /*
+     * No interp is passed so the streams are not bound to a script level
+     * command. They are owned by the channel alone, which may outlive the
+     * interp or move to another thread.
+     */
+    if (Tcl_ZlibStreamInit(NULL, TCL_ZLIB_STREAM_DEFLATE,
+                           formatValues[format], level, NULL,
+                           &compressPtr->deflater) != TCL_OK ||
+        Tcl_ZlibStreamInit(NULL, TCL_ZLIB_STREAM_INFLATE,
+                           formatValues[format], 0, NULL,
+                           &compressPtr->inflater) != TCL_OK) {
+        if (interp)
+            Tcl_SetResult(interp, "Could not initialize compression stream.", TCL_STATIC);
+        goto vamoose;
+    }
+
+    Tcl_DStringAppendElement(&ds, formats[format]);
+    if (level >= 0) {
+        char levelSpace[TCL_INTEGER_SPACE];
+        sprintf_s(levelSpace, sizeof(levelSpace), "%d", level);
+        Tcl_DStringAppendElement(&ds, "level");
+        Tcl_DStringAppendElement(&ds, levelSpace);
+    }
+    compressPtr->spec = ckalloc(Tcl_DStringLength(&ds) + 1);
+    memcpy(compressPtr->spec, Tcl_DStringValue(&ds), Tcl_DStringLength(&ds) + 1);
+
+    /*
+     * Data already queued was received before compression was enabled and
+     * is passed up as is. Reads completing from now on are decompressed.
+     */
+    lockedChanPtr->compressPtr = compressPtr;
+    compressPtr = NULL;         /* Now owned by the channel */
+    ret = TCL_OK;
+
+vamoose:
+    if (compressPtr)
+        IocpCompressFree(compressPtr);
+    Tcl_DStringFree(&ds);
+    Tcl_DecrRefCount(specObj);
+    if (ret != TCL_OK)
+        Tcl_SetErrno(EINVAL);
+    return ret;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCompressGetSpec --
+ *
+ *    Returns the -compress option value of a channel.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The value is appended to dsPtr.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpCompressGetSpec(
+    IocpChannel *lockedChanPtr, /* Locked on entry and return */
+    Tcl_DString *dsPtr)
+{
+    if (lockedChanPtr->compressPtr)
+        Tcl_DStringAppend(dsPtr, lockedChanPtr->compressPtr->spec, -1);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCompressGetStats --
+ *
+ *    Returns the byte counts of a channel with compression enabled as a
+ *    dictionary with the keys bytesin, wirein, bytesout and wireout.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The value is appended to dsPtr.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpCompressGetStats(
+    IocpChannel *lockedChanPtr, /* Locked on entry and return */
+    Tcl_DString *dsPtr)
+{
+    IocpCompress *compressPtr = lockedChanPtr->compressPtr;
+    char          numSpace[TCL_INTEGER_SPACE];
+    Tcl_WideInt   counts[4] = {0, 0, 0, 0};
+    static const char *const names[] = {
+        "bytesin", "wirein", "bytesout", "wireout"
+    };
+    int           i;
+
+    if (compressPtr) {
+        counts[0] = compressPtr->bytesIn;
+        counts[1] = compressPtr->wireIn;
+        counts[2] = compressPtr->bytesOut;
+        counts[3] = compressPtr->wireOut;
+    }
+    for (i = 0; i < 4; ++i) {
+        sprintf_s(numSpace, sizeof(numSpace), "%" TCL_LL_MODIFIER "d", counts[i]);
+        Tcl_DStringAppendElement(dsPtr, names[i]);
+        Tcl_DStringAppendElement(dsPtr, numSpace);
+    }
+}
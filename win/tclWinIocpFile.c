@@ -0,0 +1,827 @@
+/*
+ * tclWinIocpFile.c --
+ *
+ *	Asynchronous file channels for Windows IOCP.
+ *
+ * Copyright (c) 2026 agent.
+ *
+ * See the file "license.terms" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+#include "tclWinIocp.h"
+
+/*
+ * Files are opened for overlapped I/O and attached to the completion port
+ * so disk reads and writes never block the Tcl event loop. Reads are
+ * posted ahead of the application's requests, up to maxPendingReads of
+ * them, each at the file offset following the previous one. Unlike
+ * sockets, overlapped file reads can complete out of order so the reads
+ * are marked IOCP_BUFFER_F_SEQUENCED and the completion thread passes
+ * them on in the order posted. Writes are posted at the offset following
+ * the previous write, or at the end of file in append mode.
+ *
+ * The channels are streams. There is no seek support but reading may
+ * start at any offset specified when the file is opened.
+ */
+
+#define IOCP_FILE_NAME_PREFIX    "iocpfile"
+#define IOCP_FILE_MAX_RECEIVES   4       /* Default number of posted reads */
+#define IOCP_FILE_MAX_SENDS      4       /* Default number of posted writes */
+#define IOCP_FILE_MAX_PENDING    64      /* Limit for -maxpending{reads,writes} */
+#define IOCP_FILE_READ_SIZE      65536   /* Default size of each posted read */
+#define IOCP_FILE_MIN_READ_SIZE  4096
+#define IOCP_FILE_MAX_READ_SIZE  (16*1024*1024)
+
+/* File channel state */
+typedef struct FileChannel {
+    IocpChannel   base;         /* Common IOCP channel structure. Must be
+                                 * first because of how structures are
+                                 * allocated and freed */
+    HANDLE        hFile;        /* File handle */
+    Tcl_WideInt   readOffset;   /* Offset for the next posted read */
+    Tcl_WideInt   writeOffset;  /* Offset for the next posted write */
+    int           readSize;     /* Size of each posted read */
+    int           readSeqPost;  /* Sequence number for next posted read */
+    int           flags;
+#define IOCP_FILE_F_APPEND     0x1 /* Writes go to end of file */
+#define IOCP_FILE_F_EOF_POSTED 0x2 /* A read at or beyond EOF was posted.
+                                    * No further reads are posted. */
+} FileChannel;
+
+IOCP_INLINE IocpChannel *FileChannelToIocpChannel(FileChannel *filePtr) {
+    return (IocpChannel *) filePtr;
+}
+IOCP_INLINE FileChannel *IocpChannelToFileChannel(IocpChannel *chanPtr) {
+    return (FileChannel *) chanPtr;
+}
+
+static void         FileInit(IocpChannel *chanPtr);
+static void         FileFinit(IocpChannel *chanPtr);
+static int          FileShutdown(Tcl_Interp *, IocpChannel *lockedChanPtr,
+                                 int flags);
+static IocpWinError FilePostRead(IocpChannel *lockedChanPtr);
+static IocpWinError FilePostWrite(IocpChannel *lockedChanPtr, const char *bytes,
+                                  int nbytes, int *countPtr);
+static IocpWinError FilePostBuffer(IocpChannel *lockedChanPtr, IocpBuffer *bufPtr);
+static IocpTclCode  FileGetHandle(IocpChannel *lockedChanPtr, int direction,
+                                  ClientData *handlePtr);
+static IocpTclCode  FileGetOption(IocpChannel *lockedChanPtr, Tcl_Interp *interp,
+                                  int optIndex, Tcl_DString *dsPtr);
+static IocpTclCode  FileSetOption(IocpChannel *lockedChanPtr, Tcl_Interp *interp,
+                                  int optIndex, const char *valuePtr);
+static IocpWinError FileTranslateError(IocpChannel *lockedChanPtr,
+                                       IocpBuffer *bufPtr);
+
+/*
+ * File channel options. Note order must match order of string option names
+ * in the fileOptionNames array.
+ */
+enum FileOption {
+    FILE_OPT_MAXPENDINGREADS,
+    FILE_OPT_MAXPENDINGWRITES,
+    FILE_OPT_READSIZE,
+    FILE_OPT_SIZE,
+    FILE_OPT_INVALID            /* Must be last */
+};
+static const char *fileOptionNames[] = {
+    "-maxpendingreads",
+    "-maxpendingwrites",
+    "-readsize",
+    "-size",
+    NULL
+};
+
+static IocpChannelVtbl fileVtbl =  {
+    /* "Virtual" functions */
+    FileInit,
+    FileFinit,
+    FileShutdown,
+    NULL,                       /* Accept */
+    NULL,                       /* BlockingConnect */
+    NULL,                       /* AsyncConnected */
+    NULL,                       /* AsyncConnectFailed */
+    NULL,                       /* Disconnected */
+    FilePostRead,
+    FilePostWrite,
+    FilePostBuffer,
+    FileGetHandle,
+    FileGetOption,
+    FileSetOption,
+    FileTranslateError,
+    /* Data members */
+    fileOptionNames,
+    sizeof(FileChannel)
+};
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * FileSetOverlapOffset --
+ *
+ *    Stores a file offset in the OVERLAPPED structure of a buffer.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The OVERLAPPED structure is reset and the offset fields set.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+FileSetOverlapOffset(IocpBuffer *bufPtr, Tcl_WideInt offset)
+{
+    memset(&bufPtr->u, 0, sizeof(bufPtr->u));
+    bufPtr->u.overlap.Offset     = (DWORD) (offset & 0xFFFFFFFF);
+    bufPtr->u.overlap.OffsetHigh = (DWORD) (offset >> 32);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * FileInit --
+ *
+ *    Initializes the FileChannel part of a IocpChannel structure.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static void FileInit(IocpChannel *chanPtr)
+{
+    FileChannel *filePtr = IocpChannelToFileChannel(chanPtr);
+
+    filePtr->hFile       = INVALID_HANDLE_VALUE;
+    filePtr->readOffset  = 0;
+    filePtr->writeOffset = 0;
+    filePtr->readSize    = IOCP_FILE_READ_SIZE;
+    filePtr->readSeqPost = 0;
+    filePtr->flags       = 0;
+    filePtr->base.maxPendingReads  = IOCP_FILE_MAX_RECEIVES;
+    filePtr->base.maxPendingWrites = IOCP_FILE_MAX_SENDS;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * FileFinit --
+ *
+ *    Finalizer for a file channel.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    File handle closed if open.
+ *
+ *------------------------------------------------------------------------
+ */
+static void FileFinit(IocpChannel *chanPtr)
+{
+    FileChannel *filePtr = IocpChannelToFileChannel(chanPtr);
+
+    if (filePtr->hFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(filePtr->hFile);
+        filePtr->hFile = INVALID_HANDLE_VALUE;
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * FileShutdown --
+ *
+ *    Conforms to the IocpChannel shutdown interface. Files cannot be half
+ *    closed.
+ *
+ * Results:
+ *    0 on success, else a POSIX error code.
+ *
+ * Side effects:
+ *    Waits for posted writes to complete and closes the file handle.
+ *    Pending reads are discarded.
+ *
+ *------------------------------------------------------------------------
+ */
+static int FileShutdown(
+    Tcl_Interp   *interp,       /* May be NULL */
+    IocpChannel *lockedChanPtr, /* Locked pointer to the base IocpChannel */
+    int          flags)         /* Combination of TCL_CLOSE_{READ,WRITE} */
+{
+    FileChannel *lockedFilePtr = IocpChannelToFileChannel(lockedChanPtr);
+    HANDLE       hFile;
+    IocpWinError winError = 0;
+
+    if ((flags & (TCL_CLOSE_READ|TCL_CLOSE_WRITE)) != (TCL_CLOSE_READ|TCL_CLOSE_WRITE))
+        return EINVAL;
+
+    /*
+     * Unlike sockets, there is no peer to receive data already handed to
+     * the system so wait for posted writes to be done with before closing.
+     */
+    while (lockedChanPtr->pendingWrites > 0) {
+        IocpChannelAwaitCompletion(lockedChanPtr, IOCP_CHAN_F_BLOCKED_WRITE);
+    }
+    if (lockedChanPtr->winError != ERROR_SUCCESS)
+        winError = lockedChanPtr->winError; /* From a failed write */
+
+    hFile = lockedFilePtr->hFile;
+    lockedFilePtr->hFile = INVALID_HANDLE_VALUE;
+    if (hFile != INVALID_HANDLE_VALUE && ! CloseHandle(hFile))
+        winError = GetLastError();
+    if (winError != ERROR_SUCCESS) {
+        IocpSetTclErrnoFromWin32(winError);
+        return Tcl_GetErrno();
+    }
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * FilePostRead --
+ *
+ *    Allocates a buffer and posts a read for the next block of the file.
+ *    Implements the behavior defined for postread() in IocpChannel vtbl.
+ *
+ * Results:
+ *    Returns 0 on success or a Windows error code. ERROR_HANDLE_EOF is
+ *    returned once a read at the end of file has been posted.
+ *
+ * Side effects:
+ *    The read is queued to the file from where it will be retrieved by
+ *    the IO completion thread. The read offset and the pending reads
+ *    count in the IocpChannel are incremented.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+FilePostRead(IocpChannel *lockedChanPtr)
+{
+    FileChannel *lockedFilePtr = IocpChannelToFileChannel(lockedChanPtr);
+    IocpBuffer  *bufPtr;
+    IocpWinError winError;
+
+    IOCP_ASSERT(lockedChanPtr->state == IOCP_STATE_OPEN);
+
+    if (lockedFilePtr->flags & IOCP_FILE_F_EOF_POSTED)
+        return ERROR_HANDLE_EOF;
+
+    bufPtr = IocpBufferNew(lockedFilePtr->readSize, IOCP_BUFFER_OP_READ,
+                           IOCP_BUFFER_F_SEQUENCED);
+    if (bufPtr == NULL)
+        return ERROR_NOT_ENOUGH_MEMORY;
+    FileSetOverlapOffset(bufPtr, lockedFilePtr->readOffset);
+    bufPtr->context[1].i = lockedFilePtr->readSeqPost;
+
+    bufPtr->chanPtr = lockedChanPtr;
+    lockedChanPtr->numRefs += 1; /* Reversed when buffer is unlinked from channel */
+
+    if (ReadFile(lockedFilePtr->hFile, bufPtr->data.bytes,
+                 bufPtr->data.capacity, NULL, &bufPtr->u.overlap) == FALSE
+        && (winError = GetLastError()) != ERROR_IO_PENDING) {
+        if (winError != ERROR_HANDLE_EOF ||
+            ! PostQueuedCompletionStatus(lockedChanPtr->port, 0, 0,
+                                         &bufPtr->u.overlap)) {
+            lockedChanPtr->numRefs -= 1;
+            bufPtr->chanPtr = NULL;
+            IocpBufferFree(bufPtr);
+            return winError;
+        }
+        /*
+         * No completion is queued for reads that fail immediately. Queue
+         * one for a zero length read so the EOF is passed on in sequence.
+         */
+        lockedFilePtr->flags |= IOCP_FILE_F_EOF_POSTED;
+    }
+
+    lockedFilePtr->readSeqPost += 1;
+    lockedFilePtr->readOffset  += lockedFilePtr->readSize;
+    lockedChanPtr->pendingReads++;
+
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * FilePostWrite --
+ *
+ *    Allocates a buffer, copies passed data to it and posts it to the
+ *    file. Implements the behaviour expected of the postwrite() function
+ *    in IocpChannel vtbl.
+ *
+ * Results:
+ *    If data is successfully written, return 0 and stores written count
+ *    into *countPtr. If no data could be written because device would block
+ *    returns 0 and stores 0 in *countPtr. On error, returns a Windows error.
+ *
+ * Side effects:
+ *    The write buffer is queued to the file from where it will be
+ *    retrieved by the IO completion thread. The pending writes count
+ *    in the IocpChannel is incremented.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+FilePostWrite(
+    IocpChannel *lockedChanPtr, /* Must be locked on entry */
+    const char  *bytes,         /* Pointer to data to write */
+    int          nbytes,        /* Number of data bytes to write */
+    int         *countPtr)      /* Output - Number of bytes written */
+{
+    IocpBuffer  *bufPtr;
+    IocpWinError winError;
+
+    IOCP_ASSERT(lockedChanPtr->state == IOCP_STATE_OPEN);
+
+    /* If we have already too many outstanding writes */
+    if (lockedChanPtr->pendingWrites >= lockedChanPtr->maxPendingWrites) {
+        /* Not an error but indicate nothing written */
+        *countPtr = 0;
+        return ERROR_SUCCESS;
+    }
+
+    bufPtr = IocpBufferNew(nbytes, IOCP_BUFFER_OP_WRITE, 0);
+    if (bufPtr == NULL)
+        return ERROR_NOT_ENOUGH_MEMORY;
+    IocpBufferCopyIn(bufPtr, bytes, nbytes);
+
+    winError = FilePostBuffer(lockedChanPtr, bufPtr);
+    if (winError != ERROR_SUCCESS) {
+        IocpBufferFree(bufPtr);
+        *countPtr = -1;
+        return winError;
+    }
+    *countPtr = nbytes;
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * FilePostBuffer --
+ *
+ *    Posts the data in an already filled buffer to the file. Implements
+ *    the behaviour expected of the postbuffer() function in IocpChannel
+ *    vtbl.
+ *
+ * Results:
+ *    0 on success or a Windows error code. On error, the caller retains
+ *    ownership of bufPtr.
+ *
+ * Side effects:
+ *    On success the buffer is posted to the file, the write offset
+ *    advanced and the pending write count for the channel incremented.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+FilePostBuffer(
+    IocpChannel *lockedChanPtr, /* Must be locked on entry */
+    IocpBuffer  *bufPtr)        /* Buffer containing data to write */
+{
+    FileChannel *lockedFilePtr = IocpChannelToFileChannel(lockedChanPtr);
+    IocpWinError winError;
+
+    IOCP_ASSERT(lockedChanPtr->state == IOCP_STATE_OPEN);
+    IOCP_ASSERT(bufPtr->operation == IOCP_BUFFER_OP_WRITE);
+
+    /* Buffer may have been used for an earlier I/O */
+    if (lockedFilePtr->flags & IOCP_FILE_F_APPEND) {
+        memset(&bufPtr->u, 0, sizeof(bufPtr->u));
+        bufPtr->u.overlap.Offset     = 0xFFFFFFFF; /* End of file */
+        bufPtr->u.overlap.OffsetHigh = 0xFFFFFFFF;
+    } else {
+        FileSetOverlapOffset(bufPtr, lockedFilePtr->writeOffset);
+    }
+    bufPtr->chanPtr = lockedChanPtr;
+    lockedChanPtr->numRefs += 1; /* Reversed when buffer is unlinked from channel */
+    if (WriteFile(lockedFilePtr->hFile,
+                  bufPtr->data.bytes + bufPtr->data.begin, bufPtr->data.len,
+                  NULL, &bufPtr->u.overlap) == FALSE
+        && (winError = GetLastError()) != ERROR_IO_PENDING) {
+        lockedChanPtr->numRefs -= 1;
+        bufPtr->chanPtr = NULL;
+        return winError;
+    }
+    lockedFilePtr->writeOffset += bufPtr->data.len;
+    lockedChanPtr->pendingWrites++;
+
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * FileGetHandle --
+ *
+ *    Implements IocpChannel's gethandle(). See comments there.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on error.
+ *
+ * Side effects:
+ *    The file handle is returned in *handlePtr.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+FileGetHandle(
+    IocpChannel *lockedChanPtr,
+    int direction,
+    ClientData *handlePtr)
+{
+    HANDLE hFile = IocpChannelToFileChannel(lockedChanPtr)->hFile;
+    if (hFile == INVALID_HANDLE_VALUE)
+        return TCL_ERROR;
+    *handlePtr = (ClientData) hFile;
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * FileTranslateError --
+ *
+ *    Conforms to the IocpChannel vtbl translateerror API. Reads at or
+ *    beyond the end of file are mapped to success with zero bytes which
+ *    the channel layer treats as EOF.
+ *
+ * Results:
+ *    ERROR_SUCCESS for reads at end of file, else bufPtr->winError.
+ *
+ * Side effects:
+ *    Marks the channel so no further reads are posted after end of file.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+FileTranslateError(IocpChannel *lockedChanPtr, IocpBuffer *bufPtr)
+{
+    if (bufPtr->operation == IOCP_BUFFER_OP_READ &&
+        bufPtr->winError == ERROR_HANDLE_EOF) {
+        IocpChannelToFileChannel(lockedChanPtr)->flags |= IOCP_FILE_F_EOF_POSTED;
+        bufPtr->data.len = 0;
+        return ERROR_SUCCESS;
+    }
+    if (bufPtr->operation == IOCP_BUFFER_OP_WRITE)
+        lockedChanPtr->winError = bufPtr->winError; /* Reported on close */
+    return bufPtr->winError;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * FileGetOption --
+ *
+ *    Returns the value of the given option.
+ *
+ * Results:
+ *    Returns TCL_OK on succes and TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    On success the value of the option is stored in *dsPtr.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+FileGetOption(
+    IocpChannel *lockedChanPtr, /* Locked on entry, locked on exit */
+    Tcl_Interp  *interp,        /* For error reporting. May be NULL */
+    int          opt,           /* Index into option table for option of interest */
+    Tcl_DString *dsPtr)         /* Where to store the value */
+{
+    FileChannel   *lockedFilePtr = IocpChannelToFileChannel(lockedChanPtr);
+    char           integerSpace[TCL_INTEGER_SPACE];
+    Tcl_WideInt    value;
+    LARGE_INTEGER  fileSize;
+
+    switch (opt) {
+    case FILE_OPT_MAXPENDINGREADS:
+        value = lockedChanPtr->maxPendingReads;
+        break;
+    case FILE_OPT_MAXPENDINGWRITES:
+        value = lockedChanPtr->maxPendingWrites;
+        break;
+    case FILE_OPT_READSIZE:
+        value = lockedFilePtr->readSize;
+        break;
+    case FILE_OPT_SIZE:
+        if (lockedFilePtr->hFile == INVALID_HANDLE_VALUE) {
+            if (interp)
+                Tcl_SetResult(interp, "No file associated with channel.", TCL_STATIC);
+            return TCL_ERROR;
+        }
+        if (! GetFileSizeEx(lockedFilePtr->hFile, &fileSize))
+            return Iocp_ReportLastWindowsError(interp, "couldn't get file size: ");
+        value = fileSize.QuadPart;
+        break;
+    default:
+        if (interp) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Internal error: invalid file option index %d", opt));
+        }
+        return TCL_ERROR;
+    }
+    sprintf_s(integerSpace, sizeof(integerSpace), "%" TCL_LL_MODIFIER "d", value);
+    Tcl_DStringAppend(dsPtr, integerSpace, -1);
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * FileSetOption --
+ *
+ *    Sets the value of the given option.
+ *
+ * Results:
+ *    Returns TCL_OK on succes and TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    The option value is updated. Raising -maxpendingreads posts
+ *    additional reads.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+FileSetOption(
+    IocpChannel *lockedChanPtr, /* Locked on entry, locked on exit */
+    Tcl_Interp  *interp,        /* For error reporting. May be NULL */
+    int          opt,           /* Index into option table for option of interest */
+    const char  *valuePtr)      /* Option value */
+{
+    FileChannel *lockedFilePtr = IocpChannelToFileChannel(lockedChanPtr);
+    int intValue, minValue, maxValue;
+
+    switch (opt) {
+    case FILE_OPT_MAXPENDINGREADS:
+    case FILE_OPT_MAXPENDINGWRITES:
+        minValue = 1;
+        maxValue = IOCP_FILE_MAX_PENDING;
+        break;
+    case FILE_OPT_READSIZE:
+        minValue = IOCP_FILE_MIN_READ_SIZE;
+        maxValue = IOCP_FILE_MAX_READ_SIZE;
+        break;
+    default:
+        return Tcl_BadChannelOption(interp, fileOptionNames[opt],
+                                    "-maxpendingreads -maxpendingwrites -readsize");
+    }
+
+    if (Tcl_GetInt(interp, valuePtr, &intValue) != TCL_OK) {
+        Tcl_SetErrno(EINVAL);
+        return TCL_ERROR;
+    }
+    if (intValue < minValue || intValue > maxValue) {
+        if (interp)
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Integer value %d out of range.", intValue));
+        Tcl_SetErrno(EINVAL);
+        return TCL_ERROR;
+    }
+    switch (opt) {
+    case FILE_OPT_MAXPENDINGREADS:
+        lockedChanPtr->maxPendingReads = intValue;
+        if (lockedChanPtr->state == IOCP_STATE_OPEN &&
+            (lockedChanPtr->flags & IOCP_CHAN_F_WRITEONLY) == 0)
+            IocpChannelPostReads(lockedChanPtr);
+        break;
+    case FILE_OPT_MAXPENDINGWRITES:
+        lockedChanPtr->maxPendingWrites = intValue;
+        break;
+    case FILE_OPT_READSIZE:
+        /* Applies to reads posted from now on */
+        lockedFilePtr->readSize = intValue;
+        break;
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Iocp_OpenFile --
+ *
+ *	Opens a file for overlapped I/O and creates a channel around it.
+ *
+ * Results:
+ *	The channel or NULL if failed. An error message is returned in the
+ *	interpreter on failure.
+ *
+ * Side effects:
+ *	Opens the file and creates a new channel. For readable channels,
+ *	reads are posted starting at the specified offset.
+ *
+ *----------------------------------------------------------------------
+ */
+static Tcl_Channel
+Iocp_OpenFile(
+    Tcl_Interp *interp,         /* For error reporting; can be NULL. */
+    Tcl_Obj    *pathObj,        /* File path */
+    int         mode,           /* TCL_READABLE or TCL_WRITABLE */
+    int         append,         /* If true, writes go to end of file */
+    Tcl_WideInt offset)         /* Starting offset for reads or writes */
+{
+    FileChannel *filePtr;
+    HANDLE       hFile;
+    IocpWinError winError;
+    Tcl_Channel  channel;
+    const void  *nativePath;
+    DWORD        access, disposition, flags;
+
+    nativePath = Tcl_FSGetNativePath(pathObj);
+    if (nativePath == NULL) {
+        if (interp)
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("couldn't open \"%s\": invalid path.", Tcl_GetString(pathObj)));
+        return NULL;
+    }
+    flags = FILE_FLAG_OVERLAPPED;
+    if (mode == TCL_READABLE) {
+        access      = GENERIC_READ;
+        disposition = OPEN_EXISTING;
+        flags      |= FILE_FLAG_SEQUENTIAL_SCAN;
+    } else if (append) {
+        /* Without FILE_WRITE_DATA so writes can only extend the file */
+        access      = FILE_APPEND_DATA | SYNCHRONIZE;
+        disposition = OPEN_ALWAYS;
+    } else {
+        access      = GENERIC_WRITE;
+        disposition = CREATE_ALWAYS;
+    }
+    hFile = CreateFileW((const WCHAR *) nativePath, access,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                        disposition, flags, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        Iocp_ReportLastWindowsError(interp, "couldn't open file: ");
+        return NULL;
+    }
+    if (IocpAttachDefaultPort(hFile) == NULL) {
+        winError = GetLastError();
+        CloseHandle(hFile);
+        Iocp_ReportWindowsError(interp, winError, "couldn't attach file to completion port: ");
+        return NULL;
+    }
+
+    filePtr = (FileChannel *) IocpChannelNew(&fileVtbl);
+    if (filePtr == NULL) {
+        CloseHandle(hFile);
+        if (interp != NULL) {
+            Tcl_SetResult(interp, "couldn't allocate FileChannel", TCL_STATIC);
+        }
+        return NULL;
+    }
+    filePtr->hFile       = hFile;
+    filePtr->readOffset  = offset;
+    filePtr->writeOffset = offset;
+    if (append)
+        filePtr->flags |= IOCP_FILE_F_APPEND;
+    filePtr->base.state = IOCP_STATE_OPEN;
+    filePtr->base.flags |=
+        mode == TCL_READABLE ? IOCP_CHAN_F_READONLY : IOCP_CHAN_F_WRITEONLY;
+
+    IocpChannelLock(FileChannelToIocpChannel(filePtr));
+    if (mode == TCL_READABLE) {
+        winError = IocpChannelPostReads(FileChannelToIocpChannel(filePtr));
+        if (winError) {
+            Iocp_ReportWindowsError(interp, winError, "couldn't post read on file: ");
+            goto closeAndDrop;
+        }
+    }
+
+    channel = IocpMakeTclChannel(interp, FileChannelToIocpChannel(filePtr),
+                                 IOCP_FILE_NAME_PREFIX, mode);
+    if (channel == NULL)
+        goto closeAndDrop;
+
+    /*
+     * IocpMakeTclChannel has added a reference for the Tcl channel so drop
+     * the one from the allocation.
+     */
+    IocpChannelDrop(FileChannelToIocpChannel(filePtr));
+    filePtr = NULL; /* Ensure not accessed beyond here */
+
+    if (IocpSetChannelDefaults(channel) == TCL_ERROR) {
+        Tcl_Close(NULL, channel);
+        return NULL;
+    }
+
+    return channel;
+
+closeAndDrop:
+    /* filePtr must be locked. Posted reads complete once the handle closes. */
+    CloseHandle(filePtr->hFile);
+    filePtr->hFile      = INVALID_HANDLE_VALUE;
+    filePtr->base.state = IOCP_STATE_CLOSED;
+    IocpChannelDrop(FileChannelToIocpChannel(filePtr));
+    return NULL;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * File_OpenObjCmd --
+ *
+ *    Implements the iocp::file::open command.
+ *
+ *      open ?-offset OFFSET? PATH ?ACCESS?
+ *
+ * Results:
+ *    A standard Tcl result with the channel handle stored in interp result.
+ *
+ * Side effects:
+ *    A new file channel is created.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+File_OpenObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    static const char *const openOptions[] = {
+        "-offset", NULL
+    };
+    enum openOptions {
+        FILE_OFFSET
+    };
+    static const char *const accessModes[] = {
+        "r", "w", "a", NULL
+    };
+    enum accessModes {
+        FILE_ACCESS_READ, FILE_ACCESS_WRITE, FILE_ACCESS_APPEND
+    };
+    Tcl_WideInt offset = 0;
+    int         optionIndex, accessIndex = FILE_ACCESS_READ;
+    int         a;
+    Tcl_Channel chan;
+
+    for (a = 1; a < objc && Tcl_GetString(objv[a])[0] == '-'; a++) {
+        if (Tcl_GetIndexFromObj(interp, objv[a], openOptions, "option",
+                                TCL_EXACT, &optionIndex) != TCL_OK)
+            return TCL_ERROR;
+        switch ((enum openOptions) optionIndex) {
+        case FILE_OFFSET:
+            if (++a >= objc)
+                goto wrongNumArgs;
+            if (Tcl_GetWideIntFromObj(interp, objv[a], &offset) != TCL_OK)
+                return TCL_ERROR;
+            if (offset < 0) {
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Invalid offset %s.", Tcl_GetString(objv[a])));
+                return TCL_ERROR;
+            }
+            break;
+        default:
+            Iocp_Panic("File_OpenObjCmd: bad option index to openOptions");
+        }
+    }
+    if (a != objc - 1 && a != objc - 2) {
+    wrongNumArgs:
+        Tcl_WrongNumArgs(interp, 1, objv, "?-offset OFFSET? PATH ?ACCESS?");
+        return TCL_ERROR;
+    }
+    if (a == objc - 2 &&
+        Tcl_GetIndexFromObj(interp, objv[a+1], accessModes, "access mode",
+                            TCL_EXACT, &accessIndex) != TCL_OK)
+        return TCL_ERROR;
+    if (accessIndex == FILE_ACCESS_APPEND && offset != 0) {
+        Tcl_SetResult(interp, "Option -offset cannot be used in append mode.", TCL_STATIC);
+        return TCL_ERROR;
+    }
+
+    chan = Iocp_OpenFile(interp, objv[a],
+                         accessIndex == FILE_ACCESS_READ ? TCL_READABLE : TCL_WRITABLE,
+                         accessIndex == FILE_ACCESS_APPEND, offset);
+    if (chan == NULL)
+        return TCL_ERROR;
+
+    Tcl_RegisterChannel(interp, chan);
+    Tcl_SetObjResult(interp, Tcl_NewStringObj(Tcl_GetChannelName(chan), -1));
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * File_ModuleInitialize --
+ *
+ *    Initializes the file channel module.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    Creates the file channel related Tcl commands.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode File_ModuleInitialize (Tcl_Interp *interp)
+{
+    Tcl_CreateObjCommand(interp, "iocp::file::open", File_OpenObjCmd, 0L, 0L);
+    return TCL_OK;
+}
@@ -0,0 +1,717 @@
+/*
+ * tclWinIocpFrame.c --
+ *
+ *	Length-prefixed message framing for IOCP stream channels.
+ *
+ * Copyright (c) 2026 agent.
+ *
+ * See the file "license.terms" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+#include "tclWinIocp.h"
+#include <limits.h>
+
+/*
+ * When the -framing option is set on a channel, the byte stream is treated
+ * as a sequence of messages, each preceded by a header containing the
+ * message length. Messages are assembled from the buffers on the channel's
+ * inputBuffers queue directly so the script neither sees partial messages
+ * nor parses headers. The channel is only reported as readable when a
+ * complete message is queued (see IocpChannelFileEventMask).
+ *
+ * Messages are read with iocp::inet::readmsg and written with
+ * iocp::inet::writemsg. Both bypass the Tcl channel buffers and translation
+ * so they cannot be mixed with read, gets etc. while data is buffered
+ * at the Tcl level.
+ */
+
+#define IOCP_FRAME_MAX_LENGTH_DEFAULT (16*1024*1024)
+
+/* Result of scanning the input queue for a message. */
+enum IocpFrameScan {
+    IOCP_FRAME_INCOMPLETE,      /* No complete message */
+    IOCP_FRAME_COMPLETE,        /* Complete message queued */
+    IOCP_FRAME_EOF,             /* End of input reached before a message */
+    IOCP_FRAME_ERROR,           /* Error reached before a message */
+    IOCP_FRAME_TOO_LONG         /* Message exceeds frameMaxLength */
+};
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpFrameDecodeLength --
+ *
+ *    Decodes a message length header as per the channel framing settings.
+ *
+ * Results:
+ *    The message length.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static unsigned long
+IocpFrameDecodeLength(
+    IocpChannel *lockedChanPtr,
+    const unsigned char *headerPtr)
+{
+    unsigned long length = 0;
+    int i;
+
+    if (lockedChanPtr->frameFlags & IOCP_FRAME_F_LITTLE_ENDIAN) {
+        for (i = lockedChanPtr->frameHeaderSize - 1; i >= 0; --i)
+            length = (length << 8) | headerPtr[i];
+    } else {
+        for (i = 0; i < lockedChanPtr->frameHeaderSize; ++i)
+            length = (length << 8) | headerPtr[i];
+    }
+    return length;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpFrameEncodeLength --
+ *
+ *    Encodes a message length header as per the channel framing settings.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    frameHeaderSize bytes are stored at headerPtr.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpFrameEncodeLength(
+    IocpChannel *lockedChanPtr,
+    unsigned long length,
+    unsigned char *headerPtr)
+{
+    int size = lockedChanPtr->frameHeaderSize;
+    int i;
+
+    for (i = 0; i < size; ++i) {
+        if (lockedChanPtr->frameFlags & IOCP_FRAME_F_LITTLE_ENDIAN)
+            headerPtr[i] = (unsigned char) (length >> (8 * i));
+        else
+            headerPtr[size - 1 - i] = (unsigned char) (length >> (8 * i));
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpFrameScan --
+ *
+ *    Checks whether the channel's input queue holds a complete message.
+ *
+ * Results:
+ *    One of the IocpFrameScan values. For IOCP_FRAME_COMPLETE and
+ *    IOCP_FRAME_TOO_LONG the message length is stored in *lengthPtr. For
+ *    IOCP_FRAME_EOF, *lengthPtr is the number of bytes of a partial
+ *    message before the end of input.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static enum IocpFrameScan
+IocpFrameScan(
+    IocpChannel   *lockedChanPtr, /* Must be locked */
+    unsigned long *lengthPtr)     /* Output message length */
+{
+    unsigned char header[4];
+    int           headerSize = lockedChanPtr->frameHeaderSize;
+    int           haveHeader = 0;
+    unsigned long have = 0;       /* Bytes of message (incl. header) seen */
+    unsigned long length = 0;
+    IocpLink     *linkPtr;
+
+    for (linkPtr = lockedChanPtr->inputBuffers.headPtr;
+         linkPtr != NULL;
+         linkPtr = linkPtr->nextPtr) {
+        IocpBuffer *bufPtr = CONTAINING_RECORD(linkPtr, IocpBuffer, link);
+        int         len;
+
+        if (bufPtr->winError != ERROR_SUCCESS)
+            return IOCP_FRAME_ERROR;
+        len = IocpBufferLength(bufPtr);
+        if (len == 0)
+            break;              /* Zero length buffer => EOF */
+        if (haveHeader < headerSize) {
+            int count = headerSize - haveHeader;
+            if (count > len)
+                count = len;
+            memcpy(header + haveHeader,
+                   bufPtr->data.bytes + bufPtr->data.begin, count);
+            haveHeader += count;
+            if (haveHeader == headerSize) {
+                length = IocpFrameDecodeLength(lockedChanPtr, header);
+                *lengthPtr = length;
+                if (length > (unsigned long) lockedChanPtr->frameMaxLength)
+                    return IOCP_FRAME_TOO_LONG;
+            }
+        }
+        have += len;
+        if (haveHeader == headerSize && have >= headerSize + length)
+            return IOCP_FRAME_COMPLETE;
+    }
+
+    if (linkPtr != NULL ||
+        (lockedChanPtr->flags & IOCP_CHAN_F_REMOTE_EOF) ||
+        (lockedChanPtr->state != IOCP_STATE_OPEN &&
+         !IocpStateConnectionInProgress(lockedChanPtr->state))) {
+        *lengthPtr = have;
+        return IOCP_FRAME_EOF;
+    }
+    return IOCP_FRAME_INCOMPLETE;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpFrameMoveOut --
+ *
+ *    Moves data from the front of the channel's input queue. The caller
+ *    must have verified, with IocpFrameScan, that the data is queued.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    len bytes are copied to outPtr and emptied buffers are freed.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpFrameMoveOut(
+    IocpChannel *lockedChanPtr, /* Must be locked */
+    char        *outPtr,        /* Where to store data */
+    int          len)           /* Number of bytes to move */
+{
+    while (len > 0) {
+        IocpBuffer *bufPtr = CONTAINING_RECORD(
+            lockedChanPtr->inputBuffers.headPtr, IocpBuffer, link);
+        int count = IocpBufferMoveOut(bufPtr, outPtr, len);
+        outPtr += count;
+        len    -= count;
+        lockedChanPtr->inputBytes -= count;
+        if (IocpBufferLength(bufPtr) == 0) {
+            IocpListPopFront(&lockedChanPtr->inputBuffers);
+            IocpBufferFree(bufPtr);
+        }
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpFrameDiscardData --
+ *
+ *    Discards data buffers at the front of the channel's input queue up
+ *    to the first buffer marking end of file or an error.
+ *
+ * Results:
+ *    Number of bytes discarded.
+ *
+ * Side effects:
+ *    Buffers are removed from the input queue and freed.
+ *
+ *------------------------------------------------------------------------
+ */
+static int
+IocpFrameDiscardData(
+    IocpChannel *lockedChanPtr) /* Must be locked */
+{
+    IocpLink *linkPtr;
+    int       discarded = 0;
+
+    while ((linkPtr = lockedChanPtr->inputBuffers.headPtr) != NULL) {
+        IocpBuffer *bufPtr = CONTAINING_RECORD(linkPtr, IocpBuffer, link);
+        if (bufPtr->winError != ERROR_SUCCESS || IocpBufferLength(bufPtr) == 0)
+            break;
+        discarded += IocpBufferLength(bufPtr);
+        IocpListPopFront(&lockedChanPtr->inputBuffers);
+        IocpBufferFree(bufPtr);
+    }
+    lockedChanPtr->inputBytes -= discarded;
+    return discarded;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpFrameReady --
+ *
+ *    Checks whether a readmsg call on the channel would return without
+ *    waiting for more input.
+ *
+ * Results:
+ *    Non-0 if a complete message, end of input or an error is queued,
+ *    0 otherwise.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+int IocpFrameReady(IocpChannel *lockedChanPtr)
+{
+    unsigned long length;
+    return IocpFrameScan(lockedChanPtr, &length) != IOCP_FRAME_INCOMPLETE;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpFrameSetSpec --
+ *
+ *    Parses a framing specification and stores it in the channel. The
+ *    specification is either the empty string, which turns off framing,
+ *    or a list of the form
+ *
+ *      length SIZE ?big|little? ?MAXLENGTH?
+ *
+ *    where SIZE is 1, 2 or 4.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    The framing settings of the channel are updated.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode IocpFrameSetSpec(
+    Tcl_Interp  *interp,        /* For error reporting. May be NULL */
+    IocpChannel *lockedChanPtr, /* Locked on entry, locked on exit */
+    const char  *specPtr)       /* Framing specification */
+{
+    Tcl_Obj  *specObj;
+    Tcl_Obj **elemObjs;
+    Tcl_Size  numElems;
+    int       headerSize, maxLength, flags = 0;
+
+    specObj = Tcl_NewStringObj(specPtr, -1);
+    Tcl_IncrRefCount(specObj);
+    if (Tcl_ListObjGetElements(NULL, specObj, &numElems, &elemObjs) != TCL_OK)
+        goto invalidSpec;
+    if (numElems == 0) {
+        Tcl_DecrRefCount(specObj);
+        lockedChanPtr->frameHeaderSize = 0;
+        return TCL_OK;
+    }
+    if (numElems < 2 || numElems > 4 ||
+        strcmp(Tcl_GetString(elemObjs[0]), "length") ||
+        Tcl_GetIntFromObj(NULL, elemObjs[1], &headerSize) != TCL_OK ||
+        (headerSize != 1 && headerSize != 2 && headerSize != 4))
+        goto invalidSpec;
+    if (numElems > 2) {
+        const char *order = Tcl_GetString(elemObjs[2]);
+        if (strcmp(order, "little") == 0)
+            flags |= IOCP_FRAME_F_LITTLE_ENDIAN;
+        else if (strcmp(order, "big"))
+            goto invalidSpec;
+    }
+    maxLength = IOCP_FRAME_MAX_LENGTH_DEFAULT;
+    if (numElems > 3 &&
+        (Tcl_GetIntFromObj(NULL, elemObjs[3], &maxLength) != TCL_OK ||
+         maxLength < 0))
+        goto invalidSpec;
+    /* The limit cannot exceed what the header can express */
+    if (headerSize < 4 && maxLength >= (1 << (8 * headerSize)))
+        maxLength = (1 << (8 * headerSize)) - 1;
+
+    Tcl_DecrRefCount(specObj);
+    lockedChanPtr->frameHeaderSize = headerSize;
+    lockedChanPtr->frameMaxLength  = maxLength;
+    lockedChanPtr->frameFlags      = flags;
+    return TCL_OK;
+
+invalidSpec:
+    Tcl_DecrRefCount(specObj);
+    if (interp)
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Invalid framing \"%s\". Must be empty or a list of the form \"length 1|2|4 ?big|little? ?MAXLENGTH?\".", specPtr));
+    Tcl_SetErrno(EINVAL);
+    return TCL_ERROR;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpFrameGetSpec --
+ *
+ *    Returns the framing specification for the channel.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The specification is appended to *dsPtr. Nothing is appended if
+ *    framing is not enabled.
+ *
+ *------------------------------------------------------------------------
+ */
+void IocpFrameGetSpec(
+    IocpChannel *lockedChanPtr, /* Locked on entry, locked on exit */
+    Tcl_DString *dsPtr)         /* Where to store the value */
+{
+    char integerSpace[TCL_INTEGER_SPACE];
+
+    if (lockedChanPtr->frameHeaderSize == 0)
+        return;
+    sprintf_s(integerSpace, sizeof(integerSpace), "%d",
+              lockedChanPtr->frameHeaderSize);
+    Tcl_DStringAppendElement(dsPtr, "length");
+    Tcl_DStringAppendElement(dsPtr, integerSpace);
+    Tcl_DStringAppendElement(
+        dsPtr,
+        lockedChanPtr->frameFlags & IOCP_FRAME_F_LITTLE_ENDIAN ? "little" : "big");
+    sprintf_s(integerSpace, sizeof(integerSpace), "%d",
+              lockedChanPtr->frameMaxLength);
+    Tcl_DStringAppendElement(dsPtr, integerSpace);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * FrameChannelFromObj --
+ *
+ *    Returns the IocpChannel for a Tcl channel name after verifying it
+ *    has message framing enabled.
+ *
+ * Results:
+ *    The IocpChannel, unlocked, or NULL on error with an error message in
+ *    interp.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpChannel *
+FrameChannelFromObj(
+    Tcl_Interp  *interp,
+    Tcl_Obj     *nameObj,
+    int          direction,     /* TCL_READABLE or TCL_WRITABLE */
+    Tcl_Channel *channelPtr)    /* Output Tcl channel */
+{
+    IocpChannel *chanPtr;
+    int          mode;
+
+    *channelPtr = Tcl_GetChannel(interp, Tcl_GetString(nameObj), &mode);
+    if (*channelPtr == NULL)
+        return NULL;
+    if ((mode & direction) == 0) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" wasn't opened for %s", Tcl_GetString(nameObj), direction == TCL_READABLE ? "reading" : "writing"));
+        return NULL;
+    }
+    chanPtr = IocpChannelFromTclChannel(*channelPtr);
+    if (chanPtr == NULL || chanPtr->frameHeaderSize == 0) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" does not have message framing enabled.", Tcl_GetString(nameObj)));
+        return NULL;
+    }
+    return chanPtr;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Frame_ReadmsgObjCmd --
+ *
+ *    Implements the iocp::inet::readmsg command.
+ *
+ *      readmsg CHAN ?VARNAME?
+ *
+ *    Returns the next message received on the channel without its
+ *    header. Blocking channels wait for a complete message. If no
+ *    complete message is available because the channel is non-blocking
+ *    or at end of file, the empty string is returned. If VARNAME is
+ *    specified, the message is stored in the variable and the command
+ *    returns the message length or -1 if no message was available.
+ *
+ * Results:
+ *    A standard Tcl result.
+ *
+ * Side effects:
+ *    The message is removed from the channel input queue and reads are
+ *    reposted. At end of file, the Tcl channel is marked as such.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Frame_ReadmsgObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    Tcl_Channel        channel;
+    IocpChannel       *chanPtr;
+    enum IocpFrameScan scan;
+    unsigned long      length = 0;
+    unsigned char      header[4];
+    unsigned char     *bytes;
+    IocpWinError       winError = ERROR_SUCCESS;
+    Tcl_Obj           *msgObj = NULL;
+    IocpTclCode        ret = TCL_OK;
+    char               eofByte;
+
+    if (objc < 2 || objc > 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "CHANNEL ?VARNAME?");
+        return TCL_ERROR;
+    }
+    chanPtr = FrameChannelFromObj(interp, objv[1], TCL_READABLE, &channel);
+    if (chanPtr == NULL)
+        return TCL_ERROR;
+    if (Tcl_InputBuffered(channel) > 0) {
+        Tcl_SetResult(interp, "Channel has buffered input. Messages cannot be read after read or gets.", TCL_STATIC);
+        return TCL_ERROR;
+    }
+
+    IocpChannelLock(chanPtr);
+    chanPtr->numRefs += 1;  /* Hold on to it across waits */
+    while (1) {
+        scan = IocpFrameScan(chanPtr, &length);
+        if (scan != IOCP_FRAME_INCOMPLETE)
+            break;
+        /* Async connects are completed by the channel layer, not here */
+        if ((chanPtr->flags & IOCP_CHAN_F_NONBLOCKING) ||
+            chanPtr->state != IOCP_STATE_OPEN)
+            break;
+        if (chanPtr->readBucketPtr)
+            IocpRateAwait(chanPtr, IOCP_CHAN_F_RATE_READ_WAIT); /* Unlocks and relocks! */
+        winError = IocpChannelPostReads(chanPtr);
+        if (winError != ERROR_SUCCESS)
+            break;
+        if (chanPtr->pendingReads == 0)
+            continue;       /* Completed meanwhile or held back by rate limit */
+        IocpChannelAwaitCompletion(chanPtr, IOCP_CHAN_F_BLOCKED_READ); /* Unlocks and relocks! */
+    }
+
+    switch (scan) {
+    case IOCP_FRAME_COMPLETE:
+        msgObj = Tcl_NewByteArrayObj(NULL, 0);
+        bytes  = Tcl_SetByteArrayLength(msgObj, (Tcl_Size) length);
+        IocpFrameMoveOut(chanPtr, (char *) header, chanPtr->frameHeaderSize);
+        IocpFrameMoveOut(chanPtr, (char *) bytes, (int) length);
+        break;
+    case IOCP_FRAME_ERROR:
+        {
+            /* Any data preceding the error is a partial message */
+            IocpBuffer *bufPtr;
+            int discarded = IocpFrameDiscardData(chanPtr);
+            bufPtr = CONTAINING_RECORD(chanPtr->inputBuffers.headPtr,
+                                       IocpBuffer, link);
+            IocpListPopFront(&chanPtr->inputBuffers);
+            winError = bufPtr->winError;
+            IocpBufferFree(bufPtr);
+            chanPtr->winError = winError;
+            if (winError == WSAECONNRESET) {
+                /* Treat as EOF as for IocpChannelInput */
+                chanPtr->flags |= IOCP_CHAN_F_REMOTE_EOF;
+                winError = ERROR_SUCCESS;
+                scan     = IOCP_FRAME_EOF;
+                length   = discarded;
+            }
+        }
+        break;
+    case IOCP_FRAME_EOF:
+        if (length != 0) {
+            /* Discard the partial message so the next call sees EOF */
+            IocpFrameDiscardData(chanPtr);
+        }
+        break;
+    case IOCP_FRAME_TOO_LONG:
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Message length %lu exceeds the limit %d.", length, chanPtr->frameMaxLength));
+        ret = TCL_ERROR;
+        break;
+    default:
+        break;
+    }
+    if (scan == IOCP_FRAME_EOF && length != 0) {
+        Tcl_SetResult(interp, "Incomplete message at end of file.", TCL_STATIC);
+        ret = TCL_ERROR;
+    }
+    if (chanPtr->state == IOCP_STATE_OPEN &&
+        (chanPtr->flags & IOCP_CHAN_F_REMOTE_EOF) == 0 &&
+        scan != IOCP_FRAME_EOF) {
+        IocpWinError postError = IocpChannelPostReads(chanPtr);
+        if (winError == ERROR_SUCCESS && msgObj == NULL)
+            winError = postError;
+    }
+    IocpChannelDrop(chanPtr);   /* Release the reference held above */
+
+    if (ret != TCL_OK) {
+        IOCP_ASSERT(msgObj == NULL);
+        return ret;
+    }
+    if (winError != ERROR_SUCCESS) {
+        IOCP_ASSERT(msgObj == NULL);
+        IocpSetTclErrnoFromWin32(winError);
+        return Iocp_ReportWindowsError(interp, winError, "error reading message: ");
+    }
+    if (scan == IOCP_FRAME_EOF) {
+        /*
+         * Let the Tcl channel read the end of file marker so eof returns
+         * true. The input queue holds no data at this point so nothing is
+         * transferred into the channel buffers.
+         */
+        Tcl_ReadRaw(channel, &eofByte, 1);
+    }
+
+    if (objc == 3) {
+        Tcl_WideInt msgLength = msgObj ? (Tcl_WideInt) length : -1;
+        if (Tcl_ObjSetVar2(interp, objv[2], NULL,
+                           msgObj ? msgObj : Tcl_NewObj(),
+                           TCL_LEAVE_ERR_MSG) == NULL)
+            return TCL_ERROR;
+        Tcl_SetObjResult(interp, Tcl_NewWideIntObj(msgLength));
+    } else if (msgObj) {
+        Tcl_SetObjResult(interp, msgObj);
+    }
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Frame_WritemsgObjCmd --
+ *
+ *    Implements the iocp::inet::writemsg command.
+ *
+ *      writemsg CHAN MESSAGE ?MESSAGE ...?
+ *
+ *    Each message is preceded by a length header as per the channel's
+ *    -framing option and all are posted to the channel in a single
+ *    write without regard to -maxpendingwrites. Data buffered in the
+ *    Tcl channel is flushed first.
+ *
+ * Results:
+ *    A standard Tcl result.
+ *
+ * Side effects:
+ *    The messages are queued for writing.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Frame_WritemsgObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    Tcl_Channel    channel;
+    IocpChannel   *chanPtr;
+    IocpBuffer    *bufPtr;
+    IocpWinError   winError;
+    unsigned long  total;
+    char          *outPtr;
+    int            i;
+
+    if (objc < 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "CHANNEL MESSAGE ?MESSAGE ...?");
+        return TCL_ERROR;
+    }
+    chanPtr = FrameChannelFromObj(interp, objv[1], TCL_WRITABLE, &channel);
+    if (chanPtr == NULL)
+        return TCL_ERROR;
+
+    /* Preserve ordering with respect to earlier puts */
+    if (Tcl_Flush(channel) != TCL_OK) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("error flushing channel: %s", Tcl_PosixError(interp)));
+        return TCL_ERROR;
+    }
+    if (Tcl_OutputBuffered(channel) > 0) {
+        Tcl_SetResult(interp, "Channel has buffered output that could not be flushed.", TCL_STATIC);
+        return TCL_ERROR;
+    }
+
+    IocpChannelLock(chanPtr);
+    if (chanPtr->tlsPtr) {
+        /* The message buffer is posted as is, bypassing encryption */
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" has TLS enabled.", Tcl_GetString(objv[1])));
+        IocpChannelUnlock(chanPtr);
+        return TCL_ERROR;
+    }
+    total = 0;
+    for (i = 2; i < objc; ++i) {
+        Tcl_Size len;
+        if (Tcl_GetByteArrayFromObj(objv[i], &len) == NULL) {
+            IocpChannelUnlock(chanPtr);
+            return TCL_ERROR;
+        }
+        if ((unsigned long) len > (unsigned long) chanPtr->frameMaxLength) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Message length %" TCL_LL_MODIFIER "d exceeds the limit %d.", (Tcl_WideInt) len, chanPtr->frameMaxLength));
+            IocpChannelUnlock(chanPtr);
+            return TCL_ERROR;
+        }
+        total += chanPtr->frameHeaderSize + (unsigned long) len;
+        if (total > INT_MAX) {
+            Tcl_SetResult(interp, "Total message length too large.", TCL_STATIC);
+            IocpChannelUnlock(chanPtr);
+            return TCL_ERROR;
+        }
+    }
+    if (chanPtr->state != IOCP_STATE_OPEN ||
+        (chanPtr->flags & IOCP_CHAN_F_READONLY)) {
+        IocpChannelUnlock(chanPtr);
+        IocpSetTclErrnoFromWin32(WSAENOTCONN);
+        return Iocp_ReportWindowsError(interp, WSAENOTCONN, "error writing message: ");
+    }
+    bufPtr = IocpBufferNew((int) total, IOCP_BUFFER_OP_WRITE, 0);
+    if (bufPtr == NULL) {
+        IocpChannelUnlock(chanPtr);
+        return Iocp_ReportWindowsError(interp, ERROR_NOT_ENOUGH_MEMORY, "error writing message: ");
+    }
+    outPtr = bufPtr->data.bytes;
+    for (i = 2; i < objc; ++i) {
+        Tcl_Size len;
+        unsigned char *bytes = Tcl_GetByteArrayFromObj(objv[i], &len);
+        IocpFrameEncodeLength(chanPtr, (unsigned long) len, (unsigned char *)outPtr);
+        outPtr += chanPtr->frameHeaderSize;
+        memcpy(outPtr, bytes, len);
+        outPtr += len;
+    }
+    bufPtr->data.len = (int) total;
+    if (chanPtr->compressPtr)
+        winError = IocpCompressPostBuffer(chanPtr, bufPtr);
+    else
+        winError = chanPtr->vtblPtr->postbuffer(chanPtr, bufPtr);
+    if (winError != ERROR_SUCCESS)
+        IocpBufferFree(bufPtr);
+    IocpChannelUnlock(chanPtr);
+
+    if (winError != ERROR_SUCCESS) {
+        IocpSetTclErrnoFromWin32(winError);
+        return Iocp_ReportWindowsError(interp, winError, "error writing message: ");
+    }
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Frame_ModuleInitialize --
+ *
+ *    Initializes the message framing module.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    Creates the message related Tcl commands.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode Frame_ModuleInitialize (Tcl_Interp *interp)
+{
+    Tcl_CreateObjCommand(interp, "iocp::inet::readmsg", Frame_ReadmsgObjCmd, 0L, 0L);
+    Tcl_CreateObjCommand(interp, "iocp::inet::writemsg", Frame_WritemsgObjCmd, 0L, 0L);
+    return TCL_OK;
+}
@@ -0,0 +1,1353 @@
+/*
+ * tclWinIocpPipe.c --
+ *
+ *	Named pipe support for Windows IOCP.
+ *
+ * Copyright (c) 2026 agent.
+ *
+ * See the file "license.terms" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+#include "tclWinIocp.h"
+
+/*
+ * Named pipes are opened for overlapped I/O and attached to the same
+ * completion port as sockets. Reads and writes are posted with ReadFile and
+ * WriteFile using the plain OVERLAPPED member of IocpBuffer so the generic
+ * channel code handles them exactly like socket I/O. Pipes are created in
+ * byte mode so there are no message boundaries to preserve.
+ *
+ * A listening channel keeps a number of pipe instances with overlapped
+ * ConnectNamedPipe calls posted on them, the equivalent of AcceptEx on
+ * sockets. Completed connects are queued as IOCP_BUFFER_OP_ACCEPT buffers
+ * on the listener's input queue and turned into channels in the Tcl thread
+ * by PipeListenerAccept. The handles of the posted instances are kept in
+ * the listener, not the buffers, so the shutdown can close them to cancel
+ * the connects without racing the completion thread for the handles.
+ */
+
+#define IOCP_PIPE_NAME_PREFIX    "pipe"
+#define IOCP_PIPE_NAMESPACE      "\\\\.\\pipe\\"
+#define IOCP_PIPE_MAX_NAME       256  /* Max length of a pipe name */
+#define IOCP_PIPE_MAX_RECEIVES   3    /* Default number of posted reads */
+#define IOCP_PIPE_MAX_SENDS      3    /* Default number of posted writes */
+#define IOCP_PIPE_MAX_PENDING    64   /* Limit for -maxpending{reads,writes} */
+#define IOCP_PIPE_CONNECT_WAIT   5000 /* Default wait (ms) for a client
+                                       * when all instances are busy */
+#define IOCP_PIPE_CONNECT_TRIES  3    /* Attempts to grab a free instance */
+#define IOCP_PIPE_INSTANCES_DEFAULT 4 /* Default number of instances awaiting
+                                       * connections on a listener */
+#define IOCP_PIPE_INSTANCES_MAX  64   /* Limit for -maxpendingaccepts */
+
+/* Pipe connection channel state */
+typedef struct PipeChannel {
+    IocpChannel base;           /* Common IOCP channel structure. Must be
+                                 * first because of how structures are
+                                 * allocated and freed */
+    HANDLE      hPipe;          /* Pipe handle */
+    char       *name;           /* Pipe name (UTF-8). ckalloc'ed */
+    int         flags;
+#define IOCP_PIPE_F_SERVER 0x1  /* Server end of the pipe */
+} PipeChannel;
+
+/* Listening pipe channel state */
+typedef struct PipeListener {
+    IocpChannel        base;           /* Common IOCP channel structure. Must
+                                        * be first */
+    Tcl_TcpAcceptProc *acceptProc;     /* Callback to notify of new connection */
+    ClientData         acceptProcData; /* Data for the callback. */
+    char              *name;           /* Pipe name (UTF-8). ckalloc'ed */
+    Tcl_DString        nativeName;     /* Pipe name in system encoding */
+    int                maxInstances;   /* Number of instances to keep
+                                        * awaiting connections */
+    int                numCreated;     /* Number of instances created so far */
+    HANDLE             instances[IOCP_PIPE_INSTANCES_MAX];
+                                       /* Instances with a connect posted.
+                                        * INVALID_HANDLE_VALUE if the slot
+                                        * is free. Only accessed under lock
+                                        * from the Tcl thread. */
+} PipeListener;
+
+IOCP_INLINE IocpChannel *PipeChannelToIocpChannel(PipeChannel *pipePtr) {
+    return (IocpChannel *) pipePtr;
+}
+IOCP_INLINE PipeChannel *IocpChannelToPipeChannel(IocpChannel *chanPtr) {
+    return (PipeChannel *) chanPtr;
+}
+IOCP_INLINE IocpChannel *PipeListenerToIocpChannel(PipeListener *listenerPtr) {
+    return (IocpChannel *) listenerPtr;
+}
+IOCP_INLINE PipeListener *IocpChannelToPipeListener(IocpChannel *chanPtr) {
+    return (PipeListener *) chanPtr;
+}
+
+static void         PipeInit(IocpChannel *chanPtr);
+static void         PipeFinit(IocpChannel *chanPtr);
+static int          PipeShutdown(Tcl_Interp *, IocpChannel *lockedChanPtr,
+                                 int flags);
+static IocpWinError PipePostRead(IocpChannel *lockedChanPtr);
+static IocpWinError PipePostWrite(IocpChannel *lockedChanPtr, const char *bytes,
+                                  int nbytes, int *countPtr);
+static IocpWinError PipePostBuffer(IocpChannel *lockedChanPtr, IocpBuffer *bufPtr);
+static IocpTclCode  PipeGetHandle(IocpChannel *lockedChanPtr, int direction,
+                                  ClientData *handlePtr);
+static IocpTclCode  PipeGetOption(IocpChannel *lockedChanPtr, Tcl_Interp *interp,
+                                  int optIndex, Tcl_DString *dsPtr);
+static IocpTclCode  PipeSetOption(IocpChannel *lockedChanPtr, Tcl_Interp *interp,
+                                  int optIndex, const char *valuePtr);
+static IocpWinError PipeTranslateError(IocpChannel *lockedChanPtr,
+                                       IocpBuffer *bufPtr);
+
+static void         PipeListenerInit(IocpChannel *chanPtr);
+static void         PipeListenerFinit(IocpChannel *chanPtr);
+static int          PipeListenerShutdown(Tcl_Interp *,
+                                         IocpChannel *lockedChanPtr, int flags);
+static IocpWinError PipeListenerAccept(IocpChannel *lockedChanPtr);
+static IocpWinError PipeListenerPostAccepts(PipeListener *lockedListenerPtr);
+
+/*
+ * Pipe channel options. Note order must match order of string option names
+ * in the pipeOptionNames array. Connections and listeners share the table.
+ * Options that do not apply return an error from getoption and are thus
+ * left out of the fconfigure option list.
+ */
+enum PipeOption {
+    PIPE_OPT_MAXPENDINGACCEPTS,
+    PIPE_OPT_MAXPENDINGREADS,
+    PIPE_OPT_MAXPENDINGWRITES,
+    PIPE_OPT_NAME,
+    PIPE_OPT_PEERPID,
+    PIPE_OPT_INVALID            /* Must be last */
+};
+static const char *pipeOptionNames[] = {
+    "-maxpendingaccepts",
+    "-maxpendingreads",
+    "-maxpendingwrites",
+    "-name",
+    "-peerpid",
+    NULL
+};
+
+static IocpChannelVtbl pipeVtbl =  {
+    /* "Virtual" functions */
+    PipeInit,
+    PipeFinit,
+    PipeShutdown,
+    NULL,                       /* Accept */
+    NULL,                       /* BlockingConnect - connects are synchronous */
+    NULL,                       /* AsyncConnected */
+    NULL,                       /* AsyncConnectFailed */
+    NULL,                       /* Disconnected */
+    PipePostRead,
+    PipePostWrite,
+    PipePostBuffer,
+    PipeGetHandle,
+    PipeGetOption,
+    PipeSetOption,
+    PipeTranslateError,
+    /* Data members */
+    pipeOptionNames,
+    sizeof(PipeChannel)
+};
+
+static IocpChannelVtbl pipeListenerVtbl =  {
+    /* "Virtual" functions */
+    PipeListenerInit,
+    PipeListenerFinit,
+    PipeListenerShutdown,
+    PipeListenerAccept,
+    NULL,                       /* BlockingConnect */
+    NULL,                       /* AsyncConnected */
+    NULL,                       /* AsyncConnectFailed */
+    NULL,                       /* Disconnected */
+    NULL,                       /* PostRead */
+    NULL,                       /* PostWrite */
+    NULL,                       /* PostBuffer */
+    NULL,                       /* GetHandle */
+    PipeGetOption,
+    PipeSetOption,
+    NULL,                       /* TranslateError */
+    /* Data members */
+    pipeOptionNames,
+    sizeof(PipeListener)
+};
+IOCP_INLINE int IocpIsPipeListener(IocpChannel *chanPtr) {
+    return (chanPtr->vtblPtr == &pipeListenerVtbl);
+}
+
+/* Just to ensure consistency */
+static const char *gPipeOpenErrorMessage = "couldn't open pipe: ";
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipeInit --
+ *
+ *    Initializes the PipeChannel part of a IocpChannel structure.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static void PipeInit(IocpChannel *chanPtr)
+{
+    PipeChannel *pipePtr = IocpChannelToPipeChannel(chanPtr);
+
+    pipePtr->hPipe = INVALID_HANDLE_VALUE;
+    pipePtr->name  = NULL;
+    pipePtr->flags = 0;
+    pipePtr->base.maxPendingReads  = IOCP_PIPE_MAX_RECEIVES;
+    pipePtr->base.maxPendingWrites = IOCP_PIPE_MAX_SENDS;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipeFinit --
+ *
+ *    Finalizer for a pipe channel. Caller has to ensure synchronization
+ *    either by holding a lock on the containing IocpChannel or ensuring
+ *    the structure is not accessible from any other thread.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    Pipe handle closed if open. The name is freed.
+ *
+ *------------------------------------------------------------------------
+ */
+static void PipeFinit(IocpChannel *chanPtr)
+{
+    PipeChannel *pipePtr = IocpChannelToPipeChannel(chanPtr);
+
+    if (pipePtr->hPipe != INVALID_HANDLE_VALUE) {
+        CloseHandle(pipePtr->hPipe);
+        pipePtr->hPipe = INVALID_HANDLE_VALUE;
+    }
+    if (pipePtr->name) {
+        ckfree(pipePtr->name);
+        pipePtr->name = NULL;
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipeShutdown --
+ *
+ *    Conforms to the IocpChannel shutdown interface. Pipes cannot be half
+ *    closed.
+ *
+ * Results:
+ *    0 on success, else a POSIX error code.
+ *
+ * Side effects:
+ *    The pipe handle is closed. Pending I/O completes with errors. Data
+ *    already written remains readable by the peer.
+ *
+ *------------------------------------------------------------------------
+ */
+static int PipeShutdown(
+    Tcl_Interp   *interp,       /* May be NULL */
+    IocpChannel *lockedChanPtr, /* Locked pointer to the base IocpChannel */
+    int          flags)         /* Combination of TCL_CLOSE_{READ,WRITE} */
+{
+    PipeChannel *lockedPipePtr = IocpChannelToPipeChannel(lockedChanPtr);
+
+    if ((flags & (TCL_CLOSE_READ|TCL_CLOSE_WRITE)) != (TCL_CLOSE_READ|TCL_CLOSE_WRITE))
+        return EINVAL;
+    if (lockedPipePtr->hPipe != INVALID_HANDLE_VALUE) {
+        /*
+         * Note no DisconnectNamedPipe on the server end as that would
+         * discard data not yet read by the client.
+         */
+        HANDLE hPipe = lockedPipePtr->hPipe;
+        lockedPipePtr->hPipe = INVALID_HANDLE_VALUE;
+        if (! CloseHandle(hPipe)) {
+            IocpSetTclErrnoFromWin32(GetLastError());
+            return Tcl_GetErrno();
+        }
+    }
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipePostRead --
+ *
+ *    Allocates a receive buffer and posts it to the pipe. Implements the
+ *    behavior defined for postread() in IocpChannel vtbl.
+ *
+ * Results:
+ *    Returns 0 on success or a Windows error code.
+ *
+ * Side effects:
+ *    The receive buffer is queued to the pipe from where it will be
+ *    retrieved by the IO completion thread. The pending reads count
+ *    in the IocpChannel is incremented.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+PipePostRead(IocpChannel *lockedChanPtr)
+{
+    PipeChannel *lockedPipePtr = IocpChannelToPipeChannel(lockedChanPtr);
+    IocpBuffer  *bufPtr;
+    IocpWinError winError;
+
+    IOCP_ASSERT(lockedChanPtr->state == IOCP_STATE_OPEN);
+    IOCP_ASSERT(lockedPipePtr->hPipe != INVALID_HANDLE_VALUE);
+
+    bufPtr = IocpBufferNew(IOCP_BUFFER_DEFAULT_SIZE, IOCP_BUFFER_OP_READ, 0);
+    if (bufPtr == NULL)
+        return ERROR_NOT_ENOUGH_MEMORY;
+
+    bufPtr->chanPtr = lockedChanPtr;
+    lockedChanPtr->numRefs += 1; /* Reversed when buffer is unlinked from channel */
+
+    if (ReadFile(lockedPipePtr->hPipe, bufPtr->data.bytes,
+                 bufPtr->data.capacity, NULL, &bufPtr->u.overlap) == FALSE
+        && (winError = GetLastError()) != ERROR_IO_PENDING) {
+        if (winError == ERROR_BROKEN_PIPE &&
+            lockedChanPtr->pendingReads == 0 &&
+            PostQueuedCompletionStatus(lockedChanPtr->port, 0, 0,
+                                       &bufPtr->u.overlap)) {
+            /*
+             * Peer has already closed. No completion is queued for reads
+             * that fail immediately so queue one for a zero length read.
+             * If reads are pending, those will complete with the EOF.
+             */
+            lockedChanPtr->pendingReads++;
+            return 0;
+        }
+        lockedChanPtr->numRefs -= 1;
+        bufPtr->chanPtr = NULL;
+        IocpBufferFree(bufPtr);
+        return winError;
+    }
+    lockedChanPtr->pendingReads++;
+
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipePostWrite --
+ *
+ *    Allocates a buffer, copies passed data to it and posts it to the
+ *    pipe. Implements the behaviour expected of the postwrite() function
+ *    in IocpChannel vtbl.
+ *
+ * Results:
+ *    If data is successfully written, return 0 and stores written count
+ *    into *countPtr. If no data could be written because device would block
+ *    returns 0 and stores 0 in *countPtr. On error, returns a Windows error.
+ *
+ * Side effects:
+ *    The write buffer is queued to the pipe from where it will be
+ *    retrieved by the IO completion thread. The pending writes count
+ *    in the IocpChannel is incremented.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+PipePostWrite(
+    IocpChannel *lockedChanPtr, /* Must be locked on entry */
+    const char  *bytes,         /* Pointer to data to write */
+    int          nbytes,        /* Number of data bytes to write */
+    int         *countPtr)      /* Output - Number of bytes written */
+{
+    IocpBuffer  *bufPtr;
+    IocpWinError winError;
+
+    IOCP_ASSERT(lockedChanPtr->state == IOCP_STATE_OPEN);
+
+    /* If we have already too many outstanding writes */
+    if (lockedChanPtr->pendingWrites >= lockedChanPtr->maxPendingWrites) {
+        /* Not an error but indicate nothing written */
+        *countPtr = 0;
+        return ERROR_SUCCESS;
+    }
+
+    bufPtr = IocpBufferNew(nbytes, IOCP_BUFFER_OP_WRITE, 0);
+    if (bufPtr == NULL)
+        return ERROR_NOT_ENOUGH_MEMORY;
+    IocpBufferCopyIn(bufPtr, bytes, nbytes);
+
+    winError = PipePostBuffer(lockedChanPtr, bufPtr);
+    if (winError != ERROR_SUCCESS) {
+        IocpBufferFree(bufPtr);
+        *countPtr = -1;
+        return winError;
+    }
+    *countPtr = nbytes;
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipePostBuffer --
+ *
+ *    Posts the data in an already filled buffer to the pipe. Implements
+ *    the behaviour expected of the postbuffer() function in IocpChannel
+ *    vtbl.
+ *
+ * Results:
+ *    0 on success or a Windows error code. On error, the caller retains
+ *    ownership of bufPtr.
+ *
+ * Side effects:
+ *    On success the buffer is posted to the pipe and the pending write
+ *    count for the channel incremented.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+PipePostBuffer(
+    IocpChannel *lockedChanPtr, /* Must be locked on entry */
+    IocpBuffer  *bufPtr)        /* Buffer containing data to write */
+{
+    PipeChannel *lockedPipePtr = IocpChannelToPipeChannel(lockedChanPtr);
+    IocpWinError winError;
+
+    IOCP_ASSERT(lockedChanPtr->state == IOCP_STATE_OPEN);
+    IOCP_ASSERT(bufPtr->operation == IOCP_BUFFER_OP_WRITE);
+
+    /* Buffer may have been used for an earlier I/O */
+    memset(&bufPtr->u, 0, sizeof(bufPtr->u));
+    bufPtr->chanPtr = lockedChanPtr;
+    lockedChanPtr->numRefs += 1; /* Reversed when buffer is unlinked from channel */
+    if (WriteFile(lockedPipePtr->hPipe,
+                  bufPtr->data.bytes + bufPtr->data.begin, bufPtr->data.len,
+                  NULL, &bufPtr->u.overlap) == FALSE
+        && (winError = GetLastError()) != ERROR_IO_PENDING) {
+        lockedChanPtr->numRefs -= 1;
+        bufPtr->chanPtr = NULL;
+        return winError;
+    }
+    lockedChanPtr->pendingWrites++;
+
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipeGetHandle --
+ *
+ *    Implements IocpChannel's gethandle(). See comments there.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on error.
+ *
+ * Side effects:
+ *    The pipe handle is returned in *handlePtr.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+PipeGetHandle(
+    IocpChannel *lockedChanPtr,
+    int direction,
+    ClientData *handlePtr)
+{
+    HANDLE hPipe = IocpChannelToPipeChannel(lockedChanPtr)->hPipe;
+    if (hPipe == INVALID_HANDLE_VALUE)
+        return TCL_ERROR;
+    *handlePtr = (ClientData) hPipe;
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipeTranslateError --
+ *
+ *    Conforms to the IocpChannel vtbl translateerror API. A read failing
+ *    because the peer closed its end is the pipe equivalent of a graceful
+ *    socket close and is mapped to success. With the zero byte count this
+ *    then signals EOF.
+ *
+ * Results:
+ *    ERROR_SUCCESS for reads ended by the peer closing, else
+ *    bufPtr->winError.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+PipeTranslateError(IocpChannel *lockedChanPtr, IocpBuffer *bufPtr)
+{
+    if (bufPtr->operation == IOCP_BUFFER_OP_READ) {
+        switch (bufPtr->winError) {
+        case ERROR_BROKEN_PIPE:
+        case ERROR_PIPE_NOT_CONNECTED:
+        case ERROR_HANDLE_EOF:
+            bufPtr->data.len = 0;
+            return ERROR_SUCCESS;
+        }
+    }
+    return bufPtr->winError;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipeGetOption --
+ *
+ *    Returns the value of the given option for pipe connections and
+ *    listeners.
+ *
+ * Results:
+ *    Returns TCL_OK on succes and TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    On success the value of the option is stored in *dsPtr.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+PipeGetOption(
+    IocpChannel *lockedChanPtr, /* Locked on entry, locked on exit */
+    Tcl_Interp  *interp,        /* For error reporting. May be NULL */
+    int          opt,           /* Index into option table for option of interest */
+    Tcl_DString *dsPtr)         /* Where to store the value */
+{
+    char  integerSpace[TCL_INTEGER_SPACE];
+    ULONG ul;
+    int   isListener = IocpIsPipeListener(lockedChanPtr);
+
+    switch (opt) {
+    case PIPE_OPT_NAME:
+        Tcl_DStringAppend(dsPtr,
+                          isListener ?
+                          IocpChannelToPipeListener(lockedChanPtr)->name :
+                          IocpChannelToPipeChannel(lockedChanPtr)->name,
+                          -1);
+        return TCL_OK;
+    case PIPE_OPT_MAXPENDINGACCEPTS:
+        if (! isListener)
+            goto notApplicable;
+        ul = IocpChannelToPipeListener(lockedChanPtr)->maxInstances;
+        break;
+    case PIPE_OPT_MAXPENDINGREADS:
+    case PIPE_OPT_MAXPENDINGWRITES:
+        if (isListener)
+            goto notApplicable;
+        ul = opt == PIPE_OPT_MAXPENDINGREADS ?
+            lockedChanPtr->maxPendingReads : lockedChanPtr->maxPendingWrites;
+        break;
+    case PIPE_OPT_PEERPID:
+        {
+            PipeChannel *lockedPipePtr;
+            BOOL ok;
+            if (isListener)
+                goto notApplicable;
+            lockedPipePtr = IocpChannelToPipeChannel(lockedChanPtr);
+            if (lockedPipePtr->hPipe == INVALID_HANDLE_VALUE) {
+                if (interp)
+                    Tcl_SetResult(interp, "No pipe associated with channel.", TCL_STATIC);
+                return TCL_ERROR;
+            }
+            if (lockedPipePtr->flags & IOCP_PIPE_F_SERVER)
+                ok = GetNamedPipeClientProcessId(lockedPipePtr->hPipe, &ul);
+            else
+                ok = GetNamedPipeServerProcessId(lockedPipePtr->hPipe, &ul);
+            if (! ok)
+                return Iocp_ReportLastWindowsError(interp, "could not get peer process id: ");
+        }
+        break;
+    default:
+        if (interp) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Internal error: invalid pipe option index %d", opt));
+        }
+        return TCL_ERROR;
+    }
+    sprintf_s(integerSpace, sizeof(integerSpace), "%lu", ul);
+    Tcl_DStringAppend(dsPtr, integerSpace, -1);
+    return TCL_OK;
+
+notApplicable:
+    return Tcl_BadChannelOption(interp, pipeOptionNames[opt],
+                                isListener ? "-maxpendingaccepts -name" :
+                                "-maxpendingreads -maxpendingwrites -name -peerpid");
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipeSetOption --
+ *
+ *    Sets the value of the given option.
+ *
+ * Results:
+ *    Returns TCL_OK on succes and TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    The option value is updated. Raising -maxpendingreads posts
+ *    additional reads and raising -maxpendingaccepts creates additional
+ *    pipe instances.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+PipeSetOption(
+    IocpChannel *lockedChanPtr, /* Locked on entry, locked on exit */
+    Tcl_Interp  *interp,        /* For error reporting. May be NULL */
+    int          opt,           /* Index into option table for option of interest */
+    const char  *valuePtr)      /* Option value */
+{
+    int intValue;
+    int isListener = IocpIsPipeListener(lockedChanPtr);
+
+    switch (opt) {
+    case PIPE_OPT_MAXPENDINGACCEPTS:
+    case PIPE_OPT_MAXPENDINGREADS:
+    case PIPE_OPT_MAXPENDINGWRITES:
+        if (isListener != (opt == PIPE_OPT_MAXPENDINGACCEPTS))
+            break;
+        if (Tcl_GetInt(interp, valuePtr, &intValue) != TCL_OK) {
+            Tcl_SetErrno(EINVAL);
+            return TCL_ERROR;
+        }
+        if (intValue <= 0 ||
+            intValue > (isListener ? IOCP_PIPE_INSTANCES_MAX : IOCP_PIPE_MAX_PENDING)) {
+            if (interp)
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Integer value %d out of range.", intValue));
+            Tcl_SetErrno(EINVAL);
+            return TCL_ERROR;
+        }
+        if (isListener) {
+            /* Excess instances are not replaced once connected */
+            IocpChannelToPipeListener(lockedChanPtr)->maxInstances = intValue;
+            if (lockedChanPtr->state == IOCP_STATE_LISTENING)
+                PipeListenerPostAccepts(IocpChannelToPipeListener(lockedChanPtr));
+        } else if (opt == PIPE_OPT_MAXPENDINGREADS) {
+            lockedChanPtr->maxPendingReads = intValue;
+            if (lockedChanPtr->state == IOCP_STATE_OPEN &&
+                (lockedChanPtr->flags & IOCP_CHAN_F_REMOTE_EOF) == 0)
+                IocpChannelPostReads(lockedChanPtr);
+        } else {
+            lockedChanPtr->maxPendingWrites = intValue;
+        }
+        return TCL_OK;
+    default:
+        break;
+    }
+    return Tcl_BadChannelOption(interp, pipeOptionNames[opt],
+                                isListener ? "-maxpendingaccepts" :
+                                "-maxpendingreads -maxpendingwrites");
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipeListenerInit --
+ *
+ *    Initializes the PipeListener part of a IocpChannel structure.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static void PipeListenerInit(IocpChannel *chanPtr)
+{
+    PipeListener *listenerPtr = IocpChannelToPipeListener(chanPtr);
+    int i;
+
+    listenerPtr->acceptProc     = NULL;
+    listenerPtr->acceptProcData = NULL;
+    listenerPtr->name           = NULL;
+    Tcl_DStringInit(&listenerPtr->nativeName);
+    listenerPtr->maxInstances   = IOCP_PIPE_INSTANCES_DEFAULT;
+    listenerPtr->numCreated     = 0;
+    for (i = 0; i < IOCP_PIPE_INSTANCES_MAX; ++i)
+        listenerPtr->instances[i] = INVALID_HANDLE_VALUE;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipeListenerCloseInstances --
+ *
+ *    Closes all pipe instances awaiting connections.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    Posted connects complete with errors.
+ *
+ *------------------------------------------------------------------------
+ */
+static void PipeListenerCloseInstances(
+    PipeListener *listenerPtr)  /* Must be locked or otherwise race-free */
+{
+    int i;
+    for (i = 0; i < IOCP_PIPE_INSTANCES_MAX; ++i) {
+        if (listenerPtr->instances[i] != INVALID_HANDLE_VALUE) {
+            CloseHandle(listenerPtr->instances[i]);
+            listenerPtr->instances[i] = INVALID_HANDLE_VALUE;
+        }
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipeListenerFinit --
+ *
+ *    Finalizer for a pipe listener. Cleans up any resources.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    Pipe instances are closed and queued connect completions freed.
+ *
+ *------------------------------------------------------------------------
+ */
+static void PipeListenerFinit(
+    IocpChannel *chanPtr)       /* Must be locked or otherwise made race-free */
+{
+    PipeListener *listenerPtr = IocpChannelToPipeListener(chanPtr);
+    IocpLink     *linkPtr;
+
+    /* The handles are in instances[], not the buffers. See PipeListenerAccept */
+    while ((linkPtr = IocpListPopFront(&chanPtr->inputBuffers)) != NULL) {
+        IocpBufferFree(CONTAINING_RECORD(linkPtr, IocpBuffer, link));
+    }
+    PipeListenerCloseInstances(listenerPtr);
+    Tcl_DStringFree(&listenerPtr->nativeName);
+    if (listenerPtr->name) {
+        ckfree(listenerPtr->name);
+        listenerPtr->name = NULL;
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipeListenerShutdown --
+ *
+ *    Conforms to the IocpChannel shutdown interface.
+ *
+ * Results:
+ *    Always 0.
+ *
+ * Side effects:
+ *    All pipe instances awaiting connections are closed.
+ *
+ *------------------------------------------------------------------------
+ */
+static int PipeListenerShutdown(
+    Tcl_Interp   *interp,       /* May be NULL */
+    IocpChannel *lockedChanPtr, /* Locked pointer to the base IocpChannel */
+    int          flags)         /* Combination of TCL_CLOSE_{READ,WRITE} */
+{
+    PipeListenerCloseInstances(IocpChannelToPipeListener(lockedChanPtr));
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipeListenerPostAccepts --
+ *
+ *    Creates pipe instances and posts overlapped ConnectNamedPipe calls on
+ *    them for every free slot below the listener's maxInstances.
+ *
+ * Results:
+ *    0 if at least one instance is awaiting a connection, else a Windows
+ *    error code.
+ *
+ * Side effects:
+ *    New pipe instances are created and attached to the completion port.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError PipeListenerPostAccepts(
+    PipeListener *lockedListenerPtr) /* Caller must ensure exclusivity */
+{
+    IocpWinError winError = 0;
+    int          i, numPending;
+
+    IOCP_ASSERT(lockedListenerPtr->base.state == IOCP_STATE_LISTENING);
+
+    for (i = 0; i < lockedListenerPtr->maxInstances; ++i) {
+        IocpBuffer *bufPtr;
+        HANDLE      hPipe;
+        DWORD       openMode;
+
+        if (lockedListenerPtr->instances[i] != INVALID_HANDLE_VALUE)
+            continue;
+
+        /*
+         * The first instance is created exclusively so a name already in
+         * use by another server is reported as an error.
+         */
+        openMode = PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED;
+        if (lockedListenerPtr->numCreated == 0)
+            openMode |= FILE_FLAG_FIRST_PIPE_INSTANCE;
+        hPipe = CreateNamedPipeA(
+            Tcl_DStringValue(&lockedListenerPtr->nativeName),
+            openMode,
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT |
+            PIPE_REJECT_REMOTE_CLIENTS,
+            PIPE_UNLIMITED_INSTANCES,
+            IOCP_BUFFER_DEFAULT_SIZE, /* Output buffer size hint */
+            IOCP_BUFFER_DEFAULT_SIZE, /* Input buffer size hint */
+            IOCP_PIPE_CONNECT_WAIT,   /* Default wait for WaitNamedPipe */
+            NULL);
+        if (hPipe == INVALID_HANDLE_VALUE) {
+            winError = GetLastError();
+            break;
+        }
+        lockedListenerPtr->numCreated += 1;
+        if (IocpChannelAttachPort(PipeListenerToIocpChannel(lockedListenerPtr), hPipe) == NULL) {
+            winError = GetLastError();
+            CloseHandle(hPipe);
+            break;
+        }
+
+        bufPtr = IocpBufferNew(0, IOCP_BUFFER_OP_ACCEPT, 0);
+        if (bufPtr == NULL) {
+            CloseHandle(hPipe);
+            winError = ERROR_NOT_ENOUGH_MEMORY;
+            break;
+        }
+        bufPtr->context[0].i = i; /* Slot holding the instance handle */
+        bufPtr->chanPtr      = PipeListenerToIocpChannel(lockedListenerPtr);
+        lockedListenerPtr->base.numRefs += 1; /* Reversed when bufPtr is unlinked from channel */
+
+        if (ConnectNamedPipe(hPipe, &bufPtr->u.overlap) == FALSE) {
+            winError = GetLastError();
+            if (winError == ERROR_PIPE_CONNECTED) {
+                /*
+                 * A client connected between the create and the connect. No
+                 * completion is queued in this case so queue one ourselves
+                 * to have it processed like any other.
+                 */
+                if (PostQueuedCompletionStatus(lockedListenerPtr->base.port,
+                                               0, 0, &bufPtr->u.overlap))
+                    winError = ERROR_IO_PENDING;
+                else
+                    winError = GetLastError();
+            }
+            if (winError != ERROR_IO_PENDING) {
+                lockedListenerPtr->base.numRefs -= 1;
+                bufPtr->chanPtr = NULL;
+                IocpBufferFree(bufPtr);
+                CloseHandle(hPipe);
+                break;
+            }
+            winError = 0;
+        }
+        lockedListenerPtr->instances[i] = hPipe;
+    }
+
+    /* Return error only if no pending accepts */
+    for (numPending = 0, i = 0; i < IOCP_PIPE_INSTANCES_MAX; ++i) {
+        if (lockedListenerPtr->instances[i] != INVALID_HANDLE_VALUE)
+            ++numPending;
+    }
+    return numPending == 0 ? winError : 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipeListenerAccept --
+ *
+ *    Processes all connections queued by the completion thread. New
+ *    channels are constructed for these connections and the application
+ *    callback invoked.
+ *
+ *    Conforms to the IocpChannel accept interface.
+ *
+ * Results:
+ *    0 on success or a Windows error code.
+ *
+ * Side effects:
+ *    The accept callback for the listening channel is invoked for every
+ *    new connection. Replacement pipe instances are created.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError PipeListenerAccept(
+    IocpChannel *lockedChanPtr  /* Locked pointer to the base channel */
+    )
+{
+    PipeListener *lockedListenerPtr = IocpChannelToPipeListener(lockedChanPtr);
+    IocpLink     *linkPtr;
+
+    if (lockedChanPtr->channel == NULL) {
+        /* Channel was closed. Queues cleaned up when the channel is freed. */
+        return 0;
+    }
+
+    while ((linkPtr = IocpListPopFront(&lockedChanPtr->inputBuffers)) != NULL) {
+        IocpBuffer  *bufPtr = CONTAINING_RECORD(linkPtr, IocpBuffer, link);
+        int          slot   = bufPtr->context[0].i;
+        IocpWinError winError = bufPtr->winError;
+        HANDLE       hPipe;
+        PipeChannel *pipePtr;
+        Tcl_Channel  channel;
+        Tcl_Size     nameLen;
+
+        IOCP_ASSERT(bufPtr->operation == IOCP_BUFFER_OP_ACCEPT);
+        IocpBufferFree(bufPtr);
+
+        /* Take over the instance. Not valid if closed by a shutdown. */
+        hPipe = lockedListenerPtr->instances[slot];
+        lockedListenerPtr->instances[slot] = INVALID_HANDLE_VALUE;
+        if (hPipe == INVALID_HANDLE_VALUE)
+            continue;
+
+        if (winError != ERROR_SUCCESS && winError != ERROR_PIPE_CONNECTED) {
+            /* Client went away before we got to it. Just replace it. */
+            CloseHandle(hPipe);
+            PipeListenerPostAccepts(lockedListenerPtr);
+            continue;
+        }
+
+        pipePtr = (PipeChannel *) IocpChannelNew(&pipeVtbl);
+        if (pipePtr == NULL) {
+            /* TBD - notify background error ? */
+            CloseHandle(hPipe);
+            PipeListenerPostAccepts(lockedListenerPtr);
+            continue;
+        }
+        /* The instance was attached to the listener's completion port */
+        pipePtr->base.port = lockedListenerPtr->base.port;
+        pipePtr->hPipe  = hPipe;
+        pipePtr->flags |= IOCP_PIPE_F_SERVER;
+        nameLen         = Tclh_strlen(lockedListenerPtr->name) + 1;
+        pipePtr->name   = ckalloc(nameLen);
+        memcpy(pipePtr->name, lockedListenerPtr->name, nameLen);
+        pipePtr->base.state = IOCP_STATE_OPEN;
+
+        channel = IocpCreateTclChannel(PipeChannelToIocpChannel(pipePtr),
+                                       IOCP_PIPE_NAME_PREFIX,
+                                       (TCL_READABLE | TCL_WRITABLE));
+        /* Lock needed before posting reads or dropping. See TcpListenerAccept */
+        IocpChannelLock(PipeChannelToIocpChannel(pipePtr));
+        if (channel == NULL) {
+            pipePtr->base.state = IOCP_STATE_DISCONNECTED;
+            IocpChannelDrop(PipeChannelToIocpChannel(pipePtr)); /* Closes hPipe */
+            PipeListenerPostAccepts(lockedListenerPtr);
+            continue;
+        }
+        /* Reference now owned by the Tcl channel. Only unlock from here on. */
+        pipePtr->base.channel = channel;
+
+        if (IocpSetChannelDefaults(channel) != TCL_OK) {
+            IocpChannelUnlock(PipeChannelToIocpChannel(pipePtr));
+            Tcl_Close(NULL, channel);
+            PipeListenerPostAccepts(lockedListenerPtr);
+            continue;
+        }
+        winError = IocpChannelPostReads(PipeChannelToIocpChannel(pipePtr));
+        IocpChannelUnlock(PipeChannelToIocpChannel(pipePtr));
+        /* Do NOT access pipePtr hereon */
+
+        PipeListenerPostAccepts(lockedListenerPtr);
+
+        if (winError != ERROR_SUCCESS) {
+            /* TBD - notify background error ? */
+            Tcl_Close(NULL, channel);
+            continue;
+        }
+
+        if (lockedListenerPtr->acceptProc != NULL) {
+            /*
+             * Unlock as the callback may recurse to close the listener. The
+             * caller's reference keeps lockedListenerPtr valid.
+             */
+            IocpChannelUnlock(lockedChanPtr);
+            lockedListenerPtr->acceptProc(lockedListenerPtr->acceptProcData,
+                                          channel, lockedListenerPtr->name, 0);
+            IocpChannelLock(lockedChanPtr);
+        }
+    }
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * PipeNativeName --
+ *
+ *    Converts a pipe name to its full form in the system encoding. Names
+ *    not starting with \\ are placed in the local pipe namespace \\.\pipe\.
+ *
+ * Results:
+ *    TCL_OK on success with the full name (UTF-8) in fullNamePtr and the
+ *    system encoded form in nativeNamePtr. TCL_ERROR with an error message
+ *    in interp on failure. Both Tcl_DStrings must be initialized by the
+ *    caller and freed irrespective of the return value.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+PipeNativeName(
+    Tcl_Interp  *interp,        /* For error messages. May be NULL */
+    const char  *name,          /* Pipe name as passed by application */
+    Tcl_DString *fullNamePtr,   /* Output full name */
+    Tcl_DString *nativeNamePtr) /* Output full name in system encoding */
+{
+    Tcl_Size len;
+
+    if (name[0] != '\\' || name[1] != '\\')
+        Tcl_DStringAppend(fullNamePtr, IOCP_PIPE_NAMESPACE, -1);
+    Tcl_DStringAppend(fullNamePtr, name, -1);
+    Tcl_UtfToExternalDString(NULL, Tcl_DStringValue(fullNamePtr),
+                             Tcl_DStringLength(fullNamePtr), nativeNamePtr);
+    len = Tcl_DStringLength(nativeNamePtr);
+    if (name[0] == '\0' || len > IOCP_PIPE_MAX_NAME) {
+        if (interp)
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+                                 "Invalid pipe name \"%s\". Must be 1-%d bytes long.",
+                                 name, IOCP_PIPE_MAX_NAME));
+        return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Iocp_OpenPipeClient --
+ *
+ *	Connects to a named pipe and creates a channel around it.
+ *
+ * Results:
+ *	The channel or NULL if failed. An error message is returned in the
+ *	interpreter on failure.
+ *
+ * Side effects:
+ *	Opens the client end of a named pipe and creates a new channel.
+ *	If all server instances are busy, waits for one to become free.
+ *
+ *----------------------------------------------------------------------
+ */
+static Tcl_Channel
+Iocp_OpenPipeClient(
+    Tcl_Interp *interp,         /* For error reporting; can be NULL. */
+    const char *name)           /* Pipe name */
+{
+    PipeChannel *pipePtr;
+    HANDLE       hPipe = INVALID_HANDLE_VALUE;
+    IocpWinError winError;
+    Tcl_Channel  channel;
+    Tcl_DString  fullName, nativeName;
+    int          tries;
+
+    Tcl_DStringInit(&fullName);
+    Tcl_DStringInit(&nativeName);
+    if (PipeNativeName(interp, name, &fullName, &nativeName) != TCL_OK)
+        goto fail;
+
+    for (tries = 0; tries < IOCP_PIPE_CONNECT_TRIES; ++tries) {
+        /* Handle not inheritable as no security attributes passed */
+        hPipe = CreateFileA(Tcl_DStringValue(&nativeName),
+                            GENERIC_READ | GENERIC_WRITE,
+                            0,    /* No sharing */
+                            NULL, /* Security attributes */
+                            OPEN_EXISTING,
+                            FILE_FLAG_OVERLAPPED,
+                            NULL);
+        if (hPipe != INVALID_HANDLE_VALUE)
+            break;
+        winError = GetLastError();
+        /*
+         * All instances busy. Wait for one to be free. Another client may
+         * grab it first so retry a limited number of times.
+         */
+        if (winError != ERROR_PIPE_BUSY ||
+            ! WaitNamedPipeA(Tcl_DStringValue(&nativeName),
+                             NMPWAIT_USE_DEFAULT_WAIT))
+            break;
+    }
+    if (hPipe == INVALID_HANDLE_VALUE) {
+        IocpSetInterpPosixErrorFromWin32(interp, winError, gPipeOpenErrorMessage);
+        goto fail;
+    }
+
+    if (IocpAttachDefaultPort(hPipe) == NULL) {
+        winError = GetLastError();
+        CloseHandle(hPipe);
+        IocpSetInterpPosixErrorFromWin32(interp, winError, gPipeOpenErrorMessage);
+        goto fail;
+    }
+
+    pipePtr = (PipeChannel *) IocpChannelNew(&pipeVtbl);
+    if (pipePtr == NULL) {
+        CloseHandle(hPipe);
+        if (interp != NULL) {
+            Tcl_SetResult(interp, "couldn't allocate PipeChannel", TCL_STATIC);
+        }
+        goto fail;
+    }
+    pipePtr->hPipe = hPipe;
+    pipePtr->name  = ckalloc(Tcl_DStringLength(&fullName) + 1);
+    memcpy(pipePtr->name, Tcl_DStringValue(&fullName),
+           Tcl_DStringLength(&fullName) + 1);
+    pipePtr->base.state = IOCP_STATE_OPEN;
+    Tcl_DStringFree(&fullName);
+    Tcl_DStringFree(&nativeName);
+
+    IocpChannelLock(PipeChannelToIocpChannel(pipePtr));
+    winError = IocpChannelPostReads(PipeChannelToIocpChannel(pipePtr));
+    if (winError) {
+        Iocp_ReportWindowsError(interp, winError, "couldn't post read on pipe: ");
+        goto closeAndDrop;
+    }
+
+    channel = IocpMakeTclChannel(interp, PipeChannelToIocpChannel(pipePtr),
+                                 IOCP_PIPE_NAME_PREFIX,
+                                 (TCL_READABLE | TCL_WRITABLE));
+    if (channel == NULL)
+        goto closeAndDrop;
+
+    /*
+     * IocpMakeTclChannel has added a reference for the Tcl channel so drop
+     * the one from the allocation.
+     */
+    IocpChannelDrop(PipeChannelToIocpChannel(pipePtr));
+    pipePtr = NULL; /* Ensure not accessed beyond here */
+
+    if (IocpSetChannelDefaults(channel) == TCL_ERROR) {
+        Tcl_Close(NULL, channel);
+        return NULL;
+    }
+
+    return channel;
+
+closeAndDrop:
+    /*
+     * pipePtr must be locked. Closing the handle completes any posted
+     * reads which then release their references.
+     */
+    CloseHandle(pipePtr->hPipe);
+    pipePtr->hPipe      = INVALID_HANDLE_VALUE;
+    pipePtr->base.state = IOCP_STATE_CLOSED;
+    IocpChannelDrop(PipeChannelToIocpChannel(pipePtr));
+    return NULL;
+
+fail:
+    Tcl_DStringFree(&fullName);
+    Tcl_DStringFree(&nativeName);
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Iocp_OpenPipeServer --
+ *
+ *	Creates a named pipe listener and a channel around it.
+ *
+ * Results:
+ *	The channel or NULL if failed. An error message is returned in the
+ *	interpreter on failure.
+ *
+ * Side effects:
+ *	Creates pipe instances awaiting connections and a new channel.
+ *
+ *----------------------------------------------------------------------
+ */
+static Tcl_Channel
+Iocp_OpenPipeServer(
+    Tcl_Interp *interp,              /* For error reporting; can be NULL. */
+    const char *name,                /* Pipe name */
+    Tcl_TcpAcceptProc *acceptProc,   /* Callback for new connections */
+    ClientData acceptProcData)       /* Data for the callback. */
+{
+    PipeListener *listenerPtr;
+    Tcl_Channel   channel;
+    IocpWinError  winError;
+    Tcl_DString   fullName;
+
+    listenerPtr = (PipeListener *) IocpChannelNew(&pipeListenerVtbl);
+    if (listenerPtr == NULL) {
+        if (interp != NULL) {
+            Tcl_SetResult(interp, "couldn't allocate PipeListener", TCL_STATIC);
+        }
+        return NULL;
+    }
+
+    Tcl_DStringInit(&fullName);
+    if (PipeNativeName(interp, name, &fullName,
+                       &listenerPtr->nativeName) != TCL_OK) {
+        Tcl_DStringFree(&fullName);
+        goto fail;
+    }
+    listenerPtr->name = ckalloc(Tcl_DStringLength(&fullName) + 1);
+    memcpy(listenerPtr->name, Tcl_DStringValue(&fullName),
+           Tcl_DStringLength(&fullName) + 1);
+    Tcl_DStringFree(&fullName);
+
+    listenerPtr->acceptProc     = acceptProc;
+    listenerPtr->acceptProcData = acceptProcData;
+    listenerPtr->base.state     = IOCP_STATE_LISTENING;
+    listenerPtr->base.flags    |= IOCP_CHAN_F_WATCH_ACCEPT;
+
+    IocpChannelLock(PipeListenerToIocpChannel(listenerPtr));
+    winError = PipeListenerPostAccepts(listenerPtr);
+    IocpChannelUnlock(PipeListenerToIocpChannel(listenerPtr));
+    if (winError != 0) {
+        IocpSetInterpPosixErrorFromWin32(interp, winError, gPipeOpenErrorMessage);
+        goto fail;
+    }
+
+    /* Unlocked as channel creation calls back into us. See WinsockListenerOpen */
+    channel = IocpCreateTclChannel(PipeListenerToIocpChannel(listenerPtr),
+                                   IOCP_PIPE_NAME_PREFIX, 0);
+    if (channel == NULL)
+        goto fail;
+    IocpChannelLock(PipeListenerToIocpChannel(listenerPtr));
+    listenerPtr->base.channel = channel;
+    IocpChannelUnlock(PipeListenerToIocpChannel(listenerPtr));
+
+    /* Allocation reference now owned by the Tcl channel */
+    return channel;
+
+fail:
+    IocpChannelLock(PipeListenerToIocpChannel(listenerPtr));
+    listenerPtr->base.state = IOCP_STATE_CLOSED;
+    /* Cancels posted connects so their buffers release references */
+    PipeListenerCloseInstances(listenerPtr);
+    IocpChannelDrop(PipeListenerToIocpChannel(listenerPtr));
+    return NULL;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Pipe_OpenObjCmd --
+ *
+ *    Implements the iocp::pipe::open command.
+ *
+ *      open NAME
+ *      open -server CMDPREFIX NAME
+ *
+ * Results:
+ *    A standard Tcl result with the channel handle stored in interp result.
+ *
+ * Side effects:
+ *    A new server or client pipe channel is created.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Pipe_OpenObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    static const char *const openOptions[] = {
+        "-server", NULL
+    };
+    enum openOptions {
+        PIPE_SERVER
+    };
+    const char *script = NULL;
+    const char *name;
+    int         optionIndex, a;
+    Tcl_Channel chan;
+
+    for (a = 1; a < objc - 1; a++) {
+        if (Tcl_GetIndexFromObj(interp, objv[a], openOptions, "option",
+                                TCL_EXACT, &optionIndex) != TCL_OK)
+            return TCL_ERROR;
+        switch ((enum openOptions) optionIndex) {
+        case PIPE_SERVER:
+            if (++a >= objc - 1)
+                goto wrongNumArgs;
+            script = Tcl_GetString(objv[a]);
+            break;
+        default:
+            Iocp_Panic("Pipe_OpenObjCmd: bad option index to openOptions");
+        }
+    }
+    if (a != objc - 1) {
+    wrongNumArgs:
+        Tcl_WrongNumArgs(interp, 1, objv, "?-server CMDPREFIX? NAME");
+        return TCL_ERROR;
+    }
+    name = Tcl_GetString(objv[a]);
+
+    if (script) {
+        IocpAcceptCallback *acceptCallbackPtr;
+        IocpSizeT           len;
+        char               *copyScript;
+
+        len        = Tclh_strlen(script) + 1;
+        copyScript = ckalloc(len);
+        memcpy(copyScript, script, len);
+        acceptCallbackPtr         = ckalloc(sizeof(*acceptCallbackPtr));
+        acceptCallbackPtr->script = copyScript;
+        acceptCallbackPtr->interp = interp;
+
+        chan = Iocp_OpenPipeServer(interp, name, AcceptCallbackProc,
+                                   acceptCallbackPtr);
+        if (chan == NULL) {
+            ckfree(copyScript);
+            ckfree(acceptCallbackPtr);
+            return TCL_ERROR;
+        }
+
+        /* See Tcp_SocketObjCmd for why these are needed */
+        IocpRegisterAcceptCallbackCleanup(interp, acceptCallbackPtr);
+        Tcl_CreateCloseHandler(chan, IocpUnregisterAcceptCallbackCleanupOnClose,
+                               acceptCallbackPtr);
+    } else {
+        chan = Iocp_OpenPipeClient(interp, name);
+        if (chan == NULL)
+            return TCL_ERROR;
+    }
+
+    Tcl_RegisterChannel(interp, chan);
+    Tcl_SetObjResult(interp, Tcl_NewStringObj(Tcl_GetChannelName(chan), -1));
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Pipe_ModuleInitialize --
+ *
+ *    Initializes the named pipe module.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    Creates the named pipe related Tcl commands.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode Pipe_ModuleInitialize (Tcl_Interp *interp)
+{
+    Tcl_CreateObjCommand(interp, "iocp::pipe::open", Pipe_OpenObjCmd, 0L, 0L);
+    return TCL_OK;
+}
@@ -0,0 +1,961 @@
+/*
+ * tclWinIocpPool.c --
+ *
+ *	Pools of reusable outbound TCP connections for iocp_inet.
+ *
+ * Copyright (c) 2026 agent.
+ *
+ * See the file "license.terms" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+#include "tclWinIocp.h"
+#include "tclWinIocpWinsock.h"
+
+/*
+ * A connection pool keeps connected client channels per remote endpoint
+ * so that request/response style clients do not pay for name resolution,
+ * socket creation and the TCP handshake on every request. Connections are
+ * handed out with "acquire" and handed back with "release". While idle in
+ * the pool, channels are detached from the interpreter so they are not
+ * visible to (or closeable by) scripts. A close handler on every pooled
+ * channel keeps the pool bookkeeping correct no matter how the channel is
+ * eventually closed.
+ *
+ * Pools are per-interpreter and must only be used from the thread owning
+ * the interpreter. No locking is therefore needed for the pool structures
+ * themselves.
+ */
+
+typedef struct TcpPool         TcpPool;
+typedef struct TcpPoolEndpoint TcpPoolEndpoint;
+
+/* A connection belonging to a pool, either handed out or idle. */
+typedef struct TcpPoolConn {
+    IocpLink         link;        /* Links idle connections of an endpoint */
+    TcpPool         *poolPtr;     /* Owning pool */
+    TcpPoolEndpoint *endpointPtr; /* Remote endpoint of the connection */
+    Tcl_Channel      channel;     /* Channel for the connection */
+    Tcl_WideInt      idleSince;   /* Time (ms) when released. Only valid
+                                   * when idle is true */
+    int              idle;        /* If true, connection is on the idle list
+                                   * of its endpoint and detached from the
+                                   * interpreter. */
+    Tcl_Obj         *optionsObj;  /* Option names and values at the time the
+                                   * connection was opened. Restored on
+                                   * release. See TcpPoolConnResetOptions */
+} TcpPoolConn;
+
+/*
+ * Options restored when a connection is released so the next user gets
+ * the connection as newly opened. -tls and -compress are not included as
+ * they are part of the state of the stream and cannot be turned off.
+ */
+static const char *const tcpPoolResetOptions[] = {
+    "-blocking", "-buffering", "-buffersize", "-encoding", "-eofchar",
+    "-translation", "-maxpendingreads", "-maxpendingwrites", "-sosndbuf",
+    "-sorcvbuf", "-keepalive", "-nagle", "-framing", "-readdelimiter",
+    "-rcvlowat", "-ratelimit", "-priority", NULL
+};
+
+/* Per-endpoint state within a pool */
+typedef struct TcpPoolEndpoint {
+    Tcl_HashEntry *hePtr;         /* Entry in TcpPool.endpoints */
+    char          *host;          /* Remote host as passed to acquire */
+    int            port;          /* Remote port */
+    IocpList       idleConns;     /* Idle connections, most recently released
+                                   * first so warmest connections are reused */
+    int            numIdle;       /* Number of entries in idleConns */
+    int            numActive;     /* Number of connections handed out */
+    Tcl_WideInt    numConnects;   /* Number of new connections made */
+    Tcl_WideInt    numReuses;     /* Number of idle connections reused */
+} TcpPoolEndpoint;
+
+/* Pool statistics. See TcpPoolStats for the meaning. */
+typedef struct TcpPoolStats {
+    Tcl_WideInt acquires;
+    Tcl_WideInt hits;
+    Tcl_WideInt misses;
+    Tcl_WideInt releases;
+    Tcl_WideInt evictions;
+    Tcl_WideInt expirations;
+    Tcl_WideInt discards;
+    Tcl_WideInt limitfailures;
+} TcpPoolStats;
+
+typedef struct TcpPool {
+    Tcl_Interp    *interp;         /* Interpreter owning the pool */
+    Tcl_HashEntry *hePtr;          /* Entry in the interpreter's pool table */
+    Tcl_HashTable  endpoints;      /* "host port" -> TcpPoolEndpoint */
+    Tcl_HashTable  conns;          /* Tcl_Channel -> TcpPoolConn */
+    char          *myaddr;         /* Local address to bind. May be NULL */
+    int            maxPerEndpoint; /* Max connections (idle + active) per
+                                    * endpoint */
+#define IOCP_POOL_MAX_PER_ENDPOINT_DEFAULT 16
+    int            maxIdle;        /* Max idle connections per endpoint */
+#define IOCP_POOL_MAX_IDLE_DEFAULT 8
+    int            idleTimeout;    /* Idle connections older than this (ms)
+                                    * are closed. 0 -> no limit */
+#define IOCP_POOL_IDLE_TIMEOUT_DEFAULT 60000
+    TcpPoolStats   stats;
+} TcpPool;
+
+/* Per-interpreter table of pools. Stored as interpreter associated data. */
+typedef struct TcpPoolTable {
+    Tcl_HashTable pools;        /* Pool name -> TcpPool */
+    int           nextId;       /* Used to generate pool names */
+} TcpPoolTable;
+#define IOCP_POOL_ASSOC_KEY "iocp::inet::pool"
+
+static void TcpPoolConnClosed(ClientData clientData);
+static void TcpPoolDelete(TcpPool *poolPtr);
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolNow --
+ *
+ *    Returns the current time in milliseconds.
+ *
+ * Results:
+ *    Time in milliseconds.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static Tcl_WideInt TcpPoolNow(void)
+{
+    Tcl_Time now;
+    Tcl_GetTime(&now);
+    return (1000 * (Tcl_WideInt) now.sec) + (now.usec / 1000);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolTableDelete --
+ *
+ *    Called when an interpreter is deleted to clean up all its pools.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    All pools are deleted and idle connections closed.
+ *
+ *------------------------------------------------------------------------
+ */
+static void TcpPoolTableDelete(
+    ClientData clientData,      /* TcpPoolTable */
+    Tcl_Interp *interp)         /* Interpreter being deleted */
+{
+    TcpPoolTable   *tablePtr = (TcpPoolTable *) clientData;
+    Tcl_HashEntry  *hePtr;
+    Tcl_HashSearch  hSearch;
+
+    /* TcpPoolDelete removes the hash entry so always restart the search */
+    while ((hePtr = Tcl_FirstHashEntry(&tablePtr->pools, &hSearch)) != NULL) {
+        TcpPoolDelete((TcpPool *) Tcl_GetHashValue(hePtr));
+    }
+    Tcl_DeleteHashTable(&tablePtr->pools);
+    ckfree(tablePtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolTableGet --
+ *
+ *    Returns the pool table for an interpreter, creating it if necessary.
+ *
+ * Results:
+ *    Pointer to the interpreter's TcpPoolTable.
+ *
+ * Side effects:
+ *    The table is allocated and attached to the interpreter on first call.
+ *
+ *------------------------------------------------------------------------
+ */
+static TcpPoolTable *TcpPoolTableGet(Tcl_Interp *interp)
+{
+    TcpPoolTable *tablePtr;
+
+    tablePtr = Tcl_GetAssocData(interp, IOCP_POOL_ASSOC_KEY, NULL);
+    if (tablePtr == NULL) {
+        tablePtr = ckalloc(sizeof(*tablePtr));
+        Tcl_InitHashTable(&tablePtr->pools, TCL_STRING_KEYS);
+        tablePtr->nextId = 0;
+        Tcl_SetAssocData(interp, IOCP_POOL_ASSOC_KEY, TcpPoolTableDelete,
+                         tablePtr);
+    }
+    return tablePtr;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolFromObj --
+ *
+ *    Maps a pool name to the pool.
+ *
+ * Results:
+ *    Pointer to the TcpPool or NULL with an error message in interp if
+ *    the pool does not exist.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static TcpPool *TcpPoolFromObj(Tcl_Interp *interp, Tcl_Obj *objPtr)
+{
+    TcpPoolTable  *tablePtr = TcpPoolTableGet(interp);
+    Tcl_HashEntry *hePtr;
+
+    hePtr = Tcl_FindHashEntry(&tablePtr->pools, Tcl_GetString(objPtr));
+    if (hePtr == NULL) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("connection pool \"%s\" not found.",
+                                               Tcl_GetString(objPtr)));
+        return NULL;
+    }
+    return (TcpPool *) Tcl_GetHashValue(hePtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolConnIsHealthy --
+ *
+ *    Checks whether an idle pooled connection is still usable. A connection
+ *    is not usable if the remote end has closed it or reset it, or if it
+ *    has unsolicited data queued (which would mean the request/response
+ *    stream is out of sync). Since reads are kept posted on idle channels,
+ *    a remote close shows up as a zero length (or error) buffer on the
+ *    channel's inputBuffers queue even though Tcl has not read it yet.
+ *
+ * Results:
+ *    1 if the connection may be reused, 0 otherwise.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static int TcpPoolConnIsHealthy(TcpPoolConn *connPtr)
+{
+    IocpChannel *chanPtr;
+    int          healthy;
+
+    /* Data or EOF already pulled up into the Tcl channel buffers */
+    if (Tcl_InputBuffered(connPtr->channel) != 0 || Tcl_Eof(connPtr->channel))
+        return 0;
+
+    chanPtr = IocpChannelFromTclChannel(connPtr->channel);
+    if (chanPtr == NULL)
+        return 0;
+
+    IocpChannelLock(chanPtr);
+    healthy = chanPtr->state == IOCP_STATE_OPEN &&
+              chanPtr->winError == ERROR_SUCCESS &&
+              chanPtr->inputBuffers.headPtr == NULL &&
+              (chanPtr->flags & (IOCP_CHAN_F_REMOTE_EOF | IOCP_CHAN_F_READONLY |
+                                 IOCP_CHAN_F_WRITEONLY)) == 0;
+    IocpChannelUnlock(chanPtr);
+
+    return healthy;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolConnSaveOptions --
+ *
+ *    Records the values of the options in tcpPoolResetOptions for a newly
+ *    opened connection.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    connPtr->optionsObj is set to a list of option names and values.
+ *
+ *------------------------------------------------------------------------
+ */
+static void TcpPoolConnSaveOptions(TcpPoolConn *connPtr)
+{
+    Tcl_DString ds;
+    int         i;
+
+    connPtr->optionsObj = Tcl_NewListObj(0, NULL);
+    Tcl_IncrRefCount(connPtr->optionsObj);
+    Tcl_DStringInit(&ds);
+    for (i = 0; tcpPoolResetOptions[i]; ++i) {
+        Tcl_DStringSetLength(&ds, 0);
+        if (Tcl_GetChannelOption(NULL, connPtr->channel,
+                                 tcpPoolResetOptions[i], &ds) != TCL_OK)
+            continue;
+        Tcl_ListObjAppendElement(NULL, connPtr->optionsObj,
+                                 Tcl_NewStringObj(tcpPoolResetOptions[i], -1));
+        Tcl_ListObjAppendElement(NULL, connPtr->optionsObj,
+                                 Tcl_NewStringObj(Tcl_DStringValue(&ds),
+                                                  Tcl_DStringLength(&ds)));
+    }
+    Tcl_DStringFree(&ds);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolConnResetOptions --
+ *
+ *    Restores the options recorded by TcpPoolConnSaveOptions. Only options
+ *    whose value has changed are set so that, for example, the socket
+ *    buffer sizes are not fixed when they were left to the system.
+ *
+ * Results:
+ *    TCL_OK if all options were restored, TCL_ERROR otherwise.
+ *
+ * Side effects:
+ *    Channel options are changed.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode TcpPoolConnResetOptions(TcpPoolConn *connPtr)
+{
+    Tcl_Obj   **objs;
+    Tcl_Size    nobjs;
+    Tcl_Size    i;
+    Tcl_DString ds;
+    IocpTclCode ret = TCL_OK;
+
+    if (Tcl_ListObjGetElements(NULL, connPtr->optionsObj, &nobjs, &objs) != TCL_OK)
+        return TCL_ERROR;
+    Tcl_DStringInit(&ds);
+    for (i = 0; i < nobjs && ret == TCL_OK; i += 2) {
+        const char *name  = Tcl_GetString(objs[i]);
+        const char *value = Tcl_GetString(objs[i+1]);
+        Tcl_DStringSetLength(&ds, 0);
+        if (Tcl_GetChannelOption(NULL, connPtr->channel, name, &ds) == TCL_OK &&
+            strcmp(Tcl_DStringValue(&ds), value) == 0)
+            continue;
+        ret = Tcl_SetChannelOption(NULL, connPtr->channel, name, value);
+    }
+    Tcl_DStringFree(&ds);
+    return ret;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolConnCloseIdle --
+ *
+ *    Closes an idle connection. The connection's close handler takes care
+ *    of removing it from the pool.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The channel is closed and connPtr is freed.
+ *
+ *------------------------------------------------------------------------
+ */
+static void TcpPoolConnCloseIdle(TcpPoolConn *connPtr)
+{
+    IOCP_ASSERT(connPtr->idle);
+    /* Drops the pool's reference, closing the channel. */
+    Tcl_UnregisterChannel(NULL, connPtr->channel);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolConnClosed --
+ *
+ *    Close handler registered for every pooled channel. Removes the
+ *    connection from the pool.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The TcpPoolConn is unlinked and freed.
+ *
+ *------------------------------------------------------------------------
+ */
+static void TcpPoolConnClosed(ClientData clientData)
+{
+    TcpPoolConn     *connPtr     = (TcpPoolConn *) clientData;
+    TcpPoolEndpoint *endpointPtr = connPtr->endpointPtr;
+    Tcl_HashEntry   *hePtr;
+
+    if (connPtr->idle) {
+        IocpListRemove(&endpointPtr->idleConns, &connPtr->link);
+        endpointPtr->numIdle -= 1;
+    } else {
+        endpointPtr->numActive -= 1;
+    }
+    hePtr = Tcl_FindHashEntry(&connPtr->poolPtr->conns,
+                              (char *) connPtr->channel);
+    if (hePtr)
+        Tcl_DeleteHashEntry(hePtr);
+    Tcl_DecrRefCount(connPtr->optionsObj);
+    ckfree(connPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolEndpointGet --
+ *
+ *    Returns the endpoint structure for a host and port, creating it if
+ *    it does not exist.
+ *
+ * Results:
+ *    Pointer to the TcpPoolEndpoint.
+ *
+ * Side effects:
+ *    A new endpoint may be added to the pool.
+ *
+ *------------------------------------------------------------------------
+ */
+static TcpPoolEndpoint *TcpPoolEndpointGet(
+    TcpPool    *poolPtr,
+    const char *host,
+    int         port)
+{
+    TcpPoolEndpoint *endpointPtr;
+    Tcl_HashEntry   *hePtr;
+    Tcl_DString      ds;
+    char             portSpace[TCL_INTEGER_SPACE];
+    int              newEntry;
+    IocpSizeT        len;
+
+    sprintf_s(portSpace, sizeof(portSpace), "%d", port);
+    Tcl_DStringInit(&ds);
+    Tcl_DStringAppendElement(&ds, host);
+    Tcl_DStringAppendElement(&ds, portSpace);
+    hePtr = Tcl_CreateHashEntry(&poolPtr->endpoints, Tcl_DStringValue(&ds),
+                                &newEntry);
+    Tcl_DStringFree(&ds);
+    if (! newEntry)
+        return (TcpPoolEndpoint *) Tcl_GetHashValue(hePtr);
+
+    endpointPtr = ckalloc(sizeof(*endpointPtr));
+    len = Tclh_strlen(host) + 1;
+    endpointPtr->host = ckalloc(len);
+    memcpy(endpointPtr->host, host, len);
+    endpointPtr->port        = port;
+    endpointPtr->hePtr       = hePtr;
+    endpointPtr->numIdle     = 0;
+    endpointPtr->numActive   = 0;
+    endpointPtr->numConnects = 0;
+    endpointPtr->numReuses   = 0;
+    IocpListInit(&endpointPtr->idleConns);
+    Tcl_SetHashValue(hePtr, endpointPtr);
+    return endpointPtr;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolDelete --
+ *
+ *    Deletes a pool. Idle connections are closed. Connections that are
+ *    currently handed out remain open and are owned by the application.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The pool and all its endpoints are freed.
+ *
+ *------------------------------------------------------------------------
+ */
+static void TcpPoolDelete(TcpPool *poolPtr)
+{
+    Tcl_HashEntry  *hePtr;
+    Tcl_HashSearch  hSearch;
+
+    /*
+     * Close idle connections and detach handed out ones. Each step removes
+     * the entry from the conns table so restart the search every time.
+     */
+    while ((hePtr = Tcl_FirstHashEntry(&poolPtr->conns, &hSearch)) != NULL) {
+        TcpPoolConn *connPtr = (TcpPoolConn *) Tcl_GetHashValue(hePtr);
+        if (connPtr->idle) {
+            TcpPoolConnCloseIdle(connPtr); /* Frees connPtr, removes hePtr */
+        } else {
+            Tcl_DeleteCloseHandler(connPtr->channel, TcpPoolConnClosed,
+                                   connPtr);
+            Tcl_DeleteHashEntry(hePtr);
+            Tcl_DecrRefCount(connPtr->optionsObj);
+            ckfree(connPtr);
+        }
+    }
+    Tcl_DeleteHashTable(&poolPtr->conns);
+
+    for (hePtr = Tcl_FirstHashEntry(&poolPtr->endpoints, &hSearch);
+         hePtr != NULL;
+         hePtr = Tcl_NextHashEntry(&hSearch)) {
+        TcpPoolEndpoint *endpointPtr = Tcl_GetHashValue(hePtr);
+        IOCP_ASSERT(endpointPtr->idleConns.headPtr == NULL);
+        ckfree(endpointPtr->host);
+        ckfree(endpointPtr);
+    }
+    Tcl_DeleteHashTable(&poolPtr->endpoints);
+
+    Tcl_DeleteHashEntry(poolPtr->hePtr);
+    if (poolPtr->myaddr)
+        ckfree(poolPtr->myaddr);
+    ckfree(poolPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolCreate --
+ *
+ *    Implements the "pool create" subcommand.
+ *
+ * Results:
+ *    TCL_OK with the pool name in interp or TCL_ERROR.
+ *
+ * Side effects:
+ *    A new pool is created.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode TcpPoolCreate(
+    Tcl_Interp     *interp,
+    int             objc,       /* Number of option arguments */
+    Tcl_Obj *CONST  objv[])     /* Option arguments */
+{
+    static const char *const createOptions[] = {
+        "-idletimeout", "-maxidle", "-maxperendpoint", "-myaddr", NULL
+    };
+    enum createOptions {
+        POOL_IDLETIMEOUT, POOL_MAXIDLE, POOL_MAXPERENDPOINT, POOL_MYADDR
+    };
+    TcpPoolTable  *tablePtr;
+    TcpPool       *poolPtr;
+    Tcl_HashEntry *hePtr;
+    const char    *myaddr         = NULL;
+    int            maxIdle        = IOCP_POOL_MAX_IDLE_DEFAULT;
+    int            maxPerEndpoint = IOCP_POOL_MAX_PER_ENDPOINT_DEFAULT;
+    int            idleTimeout    = IOCP_POOL_IDLE_TIMEOUT_DEFAULT;
+    int            optionIndex;
+    int            newEntry;
+    int            i;
+    char           poolName[40];
+
+    if (objc & 1) {
+        Tcl_WrongNumArgs(interp, 0, NULL,
+                         "iocp::inet::pool create ?-option value ...?");
+        return TCL_ERROR;
+    }
+    for (i = 0; i < objc; i += 2) {
+        int *intPtr = NULL;
+        if (Tcl_GetIndexFromObj(interp, objv[i], createOptions, "option",
+                                TCL_EXACT, &optionIndex) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        switch ((enum createOptions) optionIndex) {
+        case POOL_IDLETIMEOUT:    intPtr = &idleTimeout; break;
+        case POOL_MAXIDLE:        intPtr = &maxIdle; break;
+        case POOL_MAXPERENDPOINT: intPtr = &maxPerEndpoint; break;
+        case POOL_MYADDR:
+            myaddr = Tcl_GetString(objv[i+1]);
+            break;
+        }
+        if (intPtr) {
+            if (Tcl_GetIntFromObj(interp, objv[i+1], intPtr) != TCL_OK)
+                return TCL_ERROR;
+            if (*intPtr < 0 ||
+                (*intPtr == 0 && optionIndex == POOL_MAXPERENDPOINT)) {
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Integer value %d out of range.", *intPtr));
+                return TCL_ERROR;
+            }
+        }
+    }
+
+    tablePtr = TcpPoolTableGet(interp);
+    sprintf_s(poolName, sizeof(poolName), "iocppool%d", tablePtr->nextId++);
+    hePtr = Tcl_CreateHashEntry(&tablePtr->pools, poolName, &newEntry);
+    IOCP_ASSERT(newEntry);
+
+    poolPtr = ckalloc(sizeof(*poolPtr));
+    memset(poolPtr, 0, sizeof(*poolPtr));
+    poolPtr->interp         = interp;
+    poolPtr->hePtr          = hePtr;
+    poolPtr->maxIdle        = maxIdle;
+    poolPtr->maxPerEndpoint = maxPerEndpoint;
+    poolPtr->idleTimeout    = idleTimeout;
+    if (myaddr) {
+        IocpSizeT len = Tclh_strlen(myaddr) + 1;
+        poolPtr->myaddr = ckalloc(len);
+        memcpy(poolPtr->myaddr, myaddr, len);
+    }
+    Tcl_InitHashTable(&poolPtr->endpoints, TCL_STRING_KEYS);
+    Tcl_InitHashTable(&poolPtr->conns, TCL_ONE_WORD_KEYS);
+    Tcl_SetHashValue(hePtr, poolPtr);
+
+    Tcl_SetObjResult(interp, Tcl_NewStringObj(poolName, -1));
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolAcquire --
+ *
+ *    Implements the "pool acquire" subcommand. Returns an idle connection
+ *    to the endpoint if a healthy one is available, otherwise opens a
+ *    new connection subject to the per-endpoint limit.
+ *
+ * Results:
+ *    TCL_OK with the channel name in interp or TCL_ERROR.
+ *
+ * Side effects:
+ *    Stale idle connections are closed. The returned channel is registered
+ *    in the interpreter.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode TcpPoolAcquire(
+    Tcl_Interp *interp,
+    TcpPool    *poolPtr,
+    Tcl_Obj    *hostObj,
+    Tcl_Obj    *portObj)
+{
+    TcpPoolEndpoint *endpointPtr;
+    TcpPoolConn     *connPtr;
+    Tcl_HashEntry   *hePtr;
+    Tcl_Channel      channel;
+    Tcl_WideInt      now;
+    int              port;
+    int              newEntry;
+
+    if (TclSockGetPort(interp, Tcl_GetString(portObj), "tcp", &port) != TCL_OK)
+        return TCL_ERROR;
+
+    poolPtr->stats.acquires++;
+    endpointPtr = TcpPoolEndpointGet(poolPtr, Tcl_GetString(hostObj), port);
+
+    now = TcpPoolNow();
+    while (endpointPtr->idleConns.headPtr) {
+        connPtr = CONTAINING_RECORD(endpointPtr->idleConns.headPtr,
+                                    TcpPoolConn, link);
+        if (poolPtr->idleTimeout &&
+            (now - connPtr->idleSince) >= poolPtr->idleTimeout) {
+            poolPtr->stats.expirations++;
+            TcpPoolConnCloseIdle(connPtr);
+            continue;
+        }
+        if (! TcpPoolConnIsHealthy(connPtr)) {
+            poolPtr->stats.evictions++;
+            TcpPoolConnCloseIdle(connPtr);
+            continue;
+        }
+        /* Good to go. Move from idle to active and attach to interp. */
+        IocpListPopFront(&endpointPtr->idleConns);
+        endpointPtr->numIdle   -= 1;
+        endpointPtr->numActive += 1;
+        endpointPtr->numReuses += 1;
+        connPtr->idle = 0;
+        Tcl_RegisterChannel(interp, connPtr->channel);
+        Tcl_UnregisterChannel(NULL, connPtr->channel); /* Pool's reference */
+        poolPtr->stats.hits++;
+        Tcl_SetObjResult(interp,
+                         Tcl_NewStringObj(Tcl_GetChannelName(connPtr->channel), -1));
+        return TCL_OK;
+    }
+
+    if ((endpointPtr->numActive + endpointPtr->numIdle) >= poolPtr->maxPerEndpoint) {
+        poolPtr->stats.limitfailures++;
+        Tcl_SetObjResult(
+            interp,
+            Tcl_ObjPrintf("connection limit %d reached for endpoint %s %d.",
+                          poolPtr->maxPerEndpoint, endpointPtr->host, port));
+        return TCL_ERROR;
+    }
+
+    channel = Iocp_OpenTcpClient(interp, port, endpointPtr->host,
+                                 poolPtr->myaddr, 0, 0, 0, NULL, 0);
+    if (channel == NULL)
+        return TCL_ERROR;
+    Tcl_RegisterChannel(interp, channel);
+
+    connPtr = ckalloc(sizeof(*connPtr));
+    IocpLinkInit(&connPtr->link);
+    connPtr->poolPtr     = poolPtr;
+    connPtr->endpointPtr = endpointPtr;
+    connPtr->channel     = channel;
+    connPtr->idleSince   = 0;
+    connPtr->idle        = 0;
+    TcpPoolConnSaveOptions(connPtr);
+    hePtr = Tcl_CreateHashEntry(&poolPtr->conns, (char *) channel, &newEntry);
+    IOCP_ASSERT(newEntry);
+    Tcl_SetHashValue(hePtr, connPtr);
+    Tcl_CreateCloseHandler(channel, TcpPoolConnClosed, connPtr);
+
+    endpointPtr->numActive   += 1;
+    endpointPtr->numConnects += 1;
+    poolPtr->stats.misses++;
+
+    Tcl_SetObjResult(interp, Tcl_NewStringObj(Tcl_GetChannelName(channel), -1));
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolRelease --
+ *
+ *    Implements the "pool release" subcommand. Returns a connection to
+ *    the pool for reuse, or closes it if discard is requested, the
+ *    connection is no longer healthy or the endpoint already has the
+ *    maximum number of idle connections.
+ *
+ * Results:
+ *    TCL_OK or TCL_ERROR.
+ *
+ * Side effects:
+ *    The channel is detached from the interpreter, with its options reset,
+ *    or closed.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode TcpPoolRelease(
+    Tcl_Interp *interp,
+    TcpPool    *poolPtr,
+    Tcl_Obj    *chanObj,
+    int         discard)        /* If true, close instead of pooling */
+{
+    TcpPoolConn     *connPtr;
+    TcpPoolEndpoint *endpointPtr;
+    Tcl_HashEntry   *hePtr;
+    Tcl_Channel      channel;
+
+    channel = Tcl_GetChannel(interp, Tcl_GetString(chanObj), NULL);
+    if (channel == NULL)
+        return TCL_ERROR;
+    hePtr = Tcl_FindHashEntry(&poolPtr->conns, (char *) channel);
+    if (hePtr == NULL) {
+        Tcl_SetObjResult(interp,
+                         Tcl_ObjPrintf("channel \"%s\" was not acquired from pool.",
+                                       Tcl_GetString(chanObj)));
+        return TCL_ERROR;
+    }
+    connPtr = Tcl_GetHashValue(hePtr);
+    IOCP_ASSERT(! connPtr->idle);
+    endpointPtr = connPtr->endpointPtr;
+
+    poolPtr->stats.releases++;
+
+    /*
+     * Pending output belongs to the current user of the connection. So do
+     * the option settings, which are reset before the next user gets it.
+     */
+    if (! discard &&
+        (Tcl_Flush(channel) != TCL_OK ||
+         TcpPoolConnResetOptions(connPtr) != TCL_OK))
+        discard = 1;
+
+    if (discard ||
+        endpointPtr->numIdle >= poolPtr->maxIdle ||
+        ! TcpPoolConnIsHealthy(connPtr)) {
+        poolPtr->stats.discards++;
+        /* Close handler will clean up connPtr */
+        return Tcl_UnregisterChannel(interp, channel);
+    }
+
+    /* Hold our own reference and detach from the interpreter */
+    Tcl_RegisterChannel(NULL, channel);
+    Tcl_UnregisterChannel(interp, channel);
+
+    connPtr->idle      = 1;
+    connPtr->idleSince = TcpPoolNow();
+    endpointPtr->numActive -= 1;
+    endpointPtr->numIdle   += 1;
+    IocpListPrepend(&endpointPtr->idleConns, &connPtr->link);
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpPoolStatsObj --
+ *
+ *    Returns the statistics for a pool as a dictionary.
+ *
+ * Results:
+ *    Tcl_Obj containing the dictionary.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static Tcl_Obj *TcpPoolStatsObj(TcpPool *poolPtr)
+{
+    Tcl_Obj        *objs[18];
+    Tcl_Obj        *endpointsObj;
+    Tcl_HashEntry  *hePtr;
+    Tcl_HashSearch  hSearch;
+    int             n = 0;
+#define ADDPOOLSTAT(field_) do {                                 \
+        objs[n++] = Tcl_NewStringObj(# field_, -1);              \
+        objs[n++] = Tcl_NewWideIntObj(poolPtr->stats.field_);    \
+    } while (0)
+
+    ADDPOOLSTAT(acquires);
+    ADDPOOLSTAT(hits);
+    ADDPOOLSTAT(misses);
+    ADDPOOLSTAT(releases);
+    ADDPOOLSTAT(evictions);
+    ADDPOOLSTAT(expirations);
+    ADDPOOLSTAT(discards);
+    ADDPOOLSTAT(limitfailures);
+#undef ADDPOOLSTAT
+
+    endpointsObj = Tcl_NewListObj(0, NULL);
+    for (hePtr = Tcl_FirstHashEntry(&poolPtr->endpoints, &hSearch);
+         hePtr != NULL;
+         hePtr = Tcl_NextHashEntry(&hSearch)) {
+        TcpPoolEndpoint *endpointPtr = Tcl_GetHashValue(hePtr);
+        Tcl_Obj *epObjs[8];
+        epObjs[0] = Tcl_NewStringObj("active", -1);
+        epObjs[1] = Tcl_NewIntObj(endpointPtr->numActive);
+        epObjs[2] = Tcl_NewStringObj("idle", -1);
+        epObjs[3] = Tcl_NewIntObj(endpointPtr->numIdle);
+        epObjs[4] = Tcl_NewStringObj("connects", -1);
+        epObjs[5] = Tcl_NewWideIntObj(endpointPtr->numConnects);
+        epObjs[6] = Tcl_NewStringObj("reuses", -1);
+        epObjs[7] = Tcl_NewWideIntObj(endpointPtr->numReuses);
+        Tcl_ListObjAppendElement(
+            NULL, endpointsObj,
+            Tcl_NewStringObj(Tcl_GetHashKey(&poolPtr->endpoints, hePtr), -1));
+        Tcl_ListObjAppendElement(NULL, endpointsObj, Tcl_NewListObj(8, epObjs));
+    }
+    objs[n++] = Tcl_NewStringObj("endpoints", -1);
+    objs[n++] = endpointsObj;
+
+    IOCP_ASSERT(n <= sizeof(objs)/sizeof(objs[0]));
+    return Tcl_NewListObj(n, objs);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Tcp_PoolObjCmd --
+ *
+ *    Implements the iocp::inet::pool command.
+ *
+ *      pool create ?-maxperendpoint N? ?-maxidle N? ?-idletimeout MS? ?-myaddr ADDR?
+ *      pool acquire POOL HOST PORT
+ *      pool release POOL CHAN ?-discard?
+ *      pool stats POOL
+ *      pool destroy POOL
+ *
+ * Results:
+ *    A standard Tcl result.
+ *
+ * Side effects:
+ *    As per the subcommand.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Tcp_PoolObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    static const char *const poolCommands[] = {
+        "acquire", "create", "destroy", "release", "stats", NULL
+    };
+    enum poolCommands {
+        POOL_ACQUIRE, POOL_CREATE, POOL_DESTROY, POOL_RELEASE, POOL_STATS
+    };
+    TcpPool *poolPtr;
+    int      cmdIndex;
+
+    if (objc < 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "subcommand ?arg ...?");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], poolCommands, "subcommand",
+                            0, &cmdIndex) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    if (cmdIndex == POOL_CREATE)
+        return TcpPoolCreate(interp, objc-2, objv+2);
+
+    if (objc < 3) {
+        Tcl_WrongNumArgs(interp, 2, objv, "POOL ?arg ...?");
+        return TCL_ERROR;
+    }
+    poolPtr = TcpPoolFromObj(interp, objv[2]);
+    if (poolPtr == NULL)
+        return TCL_ERROR;
+
+    switch ((enum poolCommands) cmdIndex) {
+    case POOL_ACQUIRE:
+        if (objc != 5) {
+            Tcl_WrongNumArgs(interp, 2, objv, "POOL HOST PORT");
+            return TCL_ERROR;
+        }
+        return TcpPoolAcquire(interp, poolPtr, objv[3], objv[4]);
+    case POOL_RELEASE:
+        if (objc == 5 && !strcmp("-discard", Tcl_GetString(objv[4]))) {
+            return TcpPoolRelease(interp, poolPtr, objv[3], 1);
+        }
+        if (objc != 4) {
+            Tcl_WrongNumArgs(interp, 2, objv, "POOL CHAN ?-discard?");
+            return TCL_ERROR;
+        }
+        return TcpPoolRelease(interp, poolPtr, objv[3], 0);
+    case POOL_STATS:
+        if (objc != 3) {
+            Tcl_WrongNumArgs(interp, 2, objv, "POOL");
+            return TCL_ERROR;
+        }
+        Tcl_SetObjResult(interp, TcpPoolStatsObj(poolPtr));
+        return TCL_OK;
+    case POOL_DESTROY:
+        if (objc != 3) {
+            Tcl_WrongNumArgs(interp, 2, objv, "POOL");
+            return TCL_ERROR;
+        }
+        TcpPoolDelete(poolPtr);
+        return TCL_OK;
+    default:
+        Iocp_Panic("Tcp_PoolObjCmd: bad subcommand index %d", cmdIndex);
+        return TCL_ERROR;
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Pool_ModuleInitialize --
+ *
+ *    Initializes the connection pool module.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    Creates the iocp::inet::pool command.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode Pool_ModuleInitialize (Tcl_Interp *interp)
+{
+    Tcl_CreateObjCommand(interp, "iocp::inet::pool", Tcp_PoolObjCmd, 0L, 0L);
+    return TCL_OK;
+}
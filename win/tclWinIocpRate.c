@@ -0,0 +1,962 @@
+/*
+ * tclWinIocpRate.c --
+ *
+ *	Token bucket rate limiting for IOCP channels.
+ *
+ * Copyright (c) 2026 agent.
+ *
+ * See the file "license.terms" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+#include "tclWinIocp.h"
+#include <limits.h>
+
+/*
+ * The -ratelimit option attaches a token bucket to the input and/or output
+ * side of a channel. Buckets are filled at the configured rate up to the
+ * burst size. Received data is charged against the read bucket by the
+ * completion thread and written data against the write bucket when the
+ * write is posted. Charges are allowed to overdraw the bucket since the
+ * amount of data a read will return is not known when it is posted.
+ *
+ * While a bucket is empty, IocpChannelPostReads does not post reads and
+ * IocpChannelOutput does not post writes. The channel is marked with
+ * IOCP_CHAN_F_RATE_READ_WAIT or IOCP_CHAN_F_RATE_WRITE_WAIT and a Tcl
+ * timer in the owning thread resumes I/O once tokens are available.
+ * Blocking channels simply sleep until then.
+ *
+ * Buckets created with iocp::inet::ratelimit are named and may be shared
+ * by any number of channels to cap their aggregate bandwidth. The names
+ * are per interpreter so only channels configured in that interpreter can
+ * refer to a bucket. A channel keeps its bucket when it is transferred to
+ * another thread, and buckets are charged from the completion thread, so
+ * buckets are reference counted and protected by their own lock which, as
+ * the innermost lock, may be acquired while a channel lock is held.
+ */
+
+typedef struct IocpRateBucket {
+    IocpLock    lock;
+    int         numRefs;        /* Channels using the bucket plus one while
+                                 * it has a name */
+    Tcl_WideInt rate;           /* Bytes per second */
+    Tcl_WideInt burst;          /* Maximum tokens that can accumulate */
+    double      tokens;         /* Available tokens, negative if overdrawn */
+    Tcl_WideInt lastRefill;     /* Time (us) tokens were last added */
+    Tcl_WideInt bytes;          /* Total bytes charged */
+    Tcl_WideInt throttles;      /* Number of times I/O was held back */
+    char        name[40];       /* Empty if private to a channel */
+} IocpRateBucket;
+
+/* Per-interpreter table of named buckets. Stored as associated data. */
+typedef struct IocpRateTable {
+    Tcl_HashTable buckets;      /* Name -> IocpRateBucket */
+    int           nextId;       /* Used to generate bucket names */
+} IocpRateTable;
+#define IOCP_RATE_ASSOC_KEY "iocp::inet::ratelimit"
+
+/* Default burst size as a fraction of the rate, i.e. 100ms worth. */
+#define IOCP_RATE_BURST_DIVISOR 10
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateNow --
+ *
+ *    Returns a monotonic time in microseconds.
+ *
+ * Results:
+ *    Time in microseconds.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static Tcl_WideInt IocpRateNow(void)
+{
+    static LARGE_INTEGER frequency; /* Races are benign, same value */
+    LARGE_INTEGER        counter;
+
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (Tcl_WideInt) ((counter.QuadPart / frequency.QuadPart) * 1000000
+                          + ((counter.QuadPart % frequency.QuadPart) * 1000000)
+                          / frequency.QuadPart);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateBucketNew --
+ *
+ *    Allocates a new token bucket. The bucket starts out full.
+ *
+ * Results:
+ *    Pointer to the bucket with a reference count of 1.
+ *
+ * Side effects:
+ *    Memory is allocated.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpRateBucket *
+IocpRateBucketNew(
+    Tcl_WideInt rate,           /* Bytes per second. Must be > 0 */
+    Tcl_WideInt burst)          /* Bucket size. Default if <= 0 */
+{
+    IocpRateBucket *bucketPtr = ckalloc(sizeof(*bucketPtr));
+
+    if (burst <= 0) {
+        burst = rate / IOCP_RATE_BURST_DIVISOR;
+        if (burst == 0)
+            burst = 1;
+    }
+    IocpLockInit(&bucketPtr->lock);
+    bucketPtr->numRefs    = 1;
+    bucketPtr->rate       = rate;
+    bucketPtr->burst      = burst;
+    bucketPtr->tokens     = (double) burst;
+    bucketPtr->lastRefill = IocpRateNow();
+    bucketPtr->bytes      = 0;
+    bucketPtr->throttles  = 0;
+    bucketPtr->name[0]    = '\0';
+    return bucketPtr;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateBucketDrop --
+ *
+ *    Releases a reference to a bucket.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The bucket is freed when the last reference is dropped.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpRateBucketDrop(
+    IocpRateBucket *bucketPtr)  /* Must NOT be locked */
+{
+    int numRefs;
+
+    IocpLockAcquireExclusive(&bucketPtr->lock);
+    numRefs = --bucketPtr->numRefs;
+    IocpLockReleaseExclusive(&bucketPtr->lock);
+    if (numRefs <= 0) {
+        IocpLockDelete(&bucketPtr->lock);
+        ckfree(bucketPtr);
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateBucketRefill --
+ *
+ *    Adds the tokens accumulated since the last refill.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The bucket's token count is updated, capped at the burst size.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpRateBucketRefill(
+    IocpRateBucket *lockedBucketPtr) /* Must be locked */
+{
+    Tcl_WideInt now     = IocpRateNow();
+    Tcl_WideInt elapsed = now - lockedBucketPtr->lastRefill;
+
+    if (elapsed <= 0)
+        return;
+    lockedBucketPtr->tokens +=
+        (double) lockedBucketPtr->rate * (double) elapsed / 1000000.0;
+    if (lockedBucketPtr->tokens > (double) lockedBucketPtr->burst)
+        lockedBucketPtr->tokens = (double) lockedBucketPtr->burst;
+    lockedBucketPtr->lastRefill = now;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateBucketDelay --
+ *
+ *    Returns how long I/O has to be held back for the bucket to have
+ *    tokens available.
+ *
+ * Results:
+ *    Delay in milliseconds, 0 if tokens are available.
+ *
+ * Side effects:
+ *    The bucket is refilled. If countThrottle is true and the delay is
+ *    not 0, the bucket's throttle count is incremented.
+ *
+ *------------------------------------------------------------------------
+ */
+static int
+IocpRateBucketDelay(
+    IocpRateBucket *bucketPtr,     /* Must NOT be locked */
+    int             countThrottle) /* Whether to count a non-0 delay */
+{
+    double delay;
+
+    IocpLockAcquireExclusive(&bucketPtr->lock);
+    IocpRateBucketRefill(bucketPtr);
+    if (bucketPtr->tokens > 0) {
+        IocpLockReleaseExclusive(&bucketPtr->lock);
+        return 0;
+    }
+    delay = (1.0 - bucketPtr->tokens) * 1000.0 / (double) bucketPtr->rate;
+    if (countThrottle)
+        bucketPtr->throttles += 1;
+    IocpLockReleaseExclusive(&bucketPtr->lock);
+
+    if (delay < 1.0)
+        return 1;
+    if (delay > (double) INT_MAX)
+        return INT_MAX;
+    return (int) (delay + 0.5);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateConsume --
+ *
+ *    Charges transferred data against a bucket.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The token count of the bucket is reduced, possibly below 0.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpRateConsume(
+    IocpRateBucket *bucketPtr,  /* Must NOT be locked */
+    int             count)      /* Number of bytes transferred */
+{
+    IocpLockAcquireExclusive(&bucketPtr->lock);
+    IocpRateBucketRefill(bucketPtr);
+    bucketPtr->tokens -= count;
+    bucketPtr->bytes  += count;
+    IocpLockReleaseExclusive(&bucketPtr->lock);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateTimerProc --
+ *
+ *    Timer callback that resumes I/O held back by a rate limit.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    Reads are reposted and the channel is marked writable as needed.
+ *    The thread is nudged so file events are generated. If a bucket is
+ *    still empty, the timer is rescheduled.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpRateTimerProc(
+    ClientData clientData)      /* IocpChannel holding a reference for us */
+{
+    IocpChannel *chanPtr = (IocpChannel *) clientData;
+    int          waitFlags;
+
+    IocpChannelLock(chanPtr);
+    chanPtr->rateTimer = NULL;
+    waitFlags = chanPtr->flags & IOCP_CHAN_F_RATE_WAIT_MASK;
+    chanPtr->flags &= ~IOCP_CHAN_F_RATE_WAIT_MASK;
+    if (chanPtr->state == IOCP_STATE_OPEN &&
+        chanPtr->owningThread == Tcl_GetCurrentThread()) {
+        if ((waitFlags & IOCP_CHAN_F_RATE_READ_WAIT) &&
+            (chanPtr->flags & (IOCP_CHAN_F_REMOTE_EOF|IOCP_CHAN_F_WRITEONLY)) == 0) {
+            IocpChannelPostReads(chanPtr); /* Reschedules if still empty */
+        }
+        if (waitFlags & IOCP_CHAN_F_RATE_WRITE_WAIT)
+            chanPtr->flags |= IOCP_CHAN_F_NOTIFY_WRITES;
+        IocpChannelNudgeThread(chanPtr, 0, 0);
+    }
+    IocpChannelDrop(chanPtr);   /* Reference from the timer */
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateSchedule --
+ *
+ *    Arranges for I/O held back by the channel's rate limits to be resumed
+ *    once the corresponding buckets have tokens.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    A timer is created if called in the owning thread. Otherwise the
+ *    owning thread is nudged and schedules the timer when it processes
+ *    the channel event. Nothing is done if the channel is not attached
+ *    to a thread as it is rescheduled when attached.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpRateSchedule(
+    IocpChannel *lockedChanPtr) /* Must be locked. Caller must hold a
+                                 * reference as it may be unlocked and
+                                 * relocked if not in the owning thread */
+{
+    int delay = 0;
+    int bucketDelay;
+
+    if (lockedChanPtr->rateTimer != NULL ||
+        (lockedChanPtr->flags & IOCP_CHAN_F_RATE_WAIT_MASK) == 0 ||
+        lockedChanPtr->owningThread == 0)
+        return;
+
+    if (lockedChanPtr->owningThread != Tcl_GetCurrentThread()) {
+        IocpChannelNudgeThread(lockedChanPtr, 0, 1);
+        return;
+    }
+
+    if ((lockedChanPtr->flags & IOCP_CHAN_F_RATE_READ_WAIT) &&
+        lockedChanPtr->readBucketPtr) {
+        delay = IocpRateBucketDelay(lockedChanPtr->readBucketPtr, 0);
+    }
+    if ((lockedChanPtr->flags & IOCP_CHAN_F_RATE_WRITE_WAIT) &&
+        lockedChanPtr->writeBucketPtr) {
+        bucketDelay = IocpRateBucketDelay(lockedChanPtr->writeBucketPtr, 0);
+        if (bucketDelay > delay)
+            delay = bucketDelay;
+    }
+    lockedChanPtr->numRefs += 1; /* For the timer */
+    lockedChanPtr->rateTimer =
+        Tcl_CreateTimerHandler(delay, IocpRateTimerProc, lockedChanPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateThrottled --
+ *
+ *    Checks whether I/O in one direction has to be held back because its
+ *    bucket is empty.
+ *
+ * Results:
+ *    Non-0 if the I/O must not be posted, 0 otherwise.
+ *
+ * Side effects:
+ *    If throttled, the channel is marked with waitFlag and resumption is
+ *    scheduled. See IocpRateSchedule.
+ *
+ *------------------------------------------------------------------------
+ */
+int
+IocpRateThrottled(
+    IocpChannel *lockedChanPtr, /* Must be locked. See IocpRateSchedule */
+    int          waitFlag)      /* IOCP_CHAN_F_RATE_READ_WAIT or
+                                 * IOCP_CHAN_F_RATE_WRITE_WAIT */
+{
+    IocpRateBucket *bucketPtr;
+
+    bucketPtr = waitFlag == IOCP_CHAN_F_RATE_READ_WAIT ?
+        lockedChanPtr->readBucketPtr : lockedChanPtr->writeBucketPtr;
+    if (bucketPtr == NULL || IocpRateBucketDelay(bucketPtr, 1) == 0)
+        return 0;
+    lockedChanPtr->flags |= waitFlag;
+    IocpRateSchedule(lockedChanPtr);
+    return 1;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateAwait --
+ *
+ *    Waits until the bucket for one direction of a blocking channel has
+ *    tokens available.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The channel is unlocked while sleeping. Caller must hold a reference.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpRateAwait(
+    IocpChannel *lockedChanPtr, /* Locked on entry and exit */
+    int          waitFlag)      /* IOCP_CHAN_F_RATE_READ_WAIT or
+                                 * IOCP_CHAN_F_RATE_WRITE_WAIT */
+{
+    int countThrottle = 1;
+
+    while (lockedChanPtr->state == IOCP_STATE_OPEN) {
+        IocpRateBucket *bucketPtr;
+        int             delay;
+        bucketPtr = waitFlag == IOCP_CHAN_F_RATE_READ_WAIT ?
+            lockedChanPtr->readBucketPtr : lockedChanPtr->writeBucketPtr;
+        if (bucketPtr == NULL)
+            break;
+        delay = IocpRateBucketDelay(bucketPtr, countThrottle);
+        if (delay == 0)
+            break;
+        countThrottle = 0;
+        IocpChannelUnlock(lockedChanPtr);
+        Sleep(delay);
+        IocpChannelLock(lockedChanPtr);
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateCancelTimer --
+ *
+ *    Cancels a pending rate limit timer. Must be called in the thread
+ *    that owns the channel, e.g. when it is detached from the thread.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The wait flags are left as they are so the next owning thread
+ *    reschedules the timer when it processes the channel.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpRateCancelTimer(
+    IocpChannel *lockedChanPtr) /* Must be locked */
+{
+    if (lockedChanPtr->rateTimer) {
+        Tcl_DeleteTimerHandler(lockedChanPtr->rateTimer);
+        lockedChanPtr->rateTimer = NULL;
+        /* Tcl channel reference still held so this cannot be the last */
+        IOCP_ASSERT(lockedChanPtr->numRefs > 1);
+        lockedChanPtr->numRefs -= 1;
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateRelease --
+ *
+ *    Removes the rate limits from a channel.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    References to the channel's buckets are dropped.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpRateRelease(
+    IocpChannel *lockedChanPtr) /* Must be locked */
+{
+    IOCP_ASSERT(lockedChanPtr->rateTimer == NULL);
+    if (lockedChanPtr->readBucketPtr) {
+        IocpRateBucketDrop(lockedChanPtr->readBucketPtr);
+        lockedChanPtr->readBucketPtr = NULL;
+    }
+    if (lockedChanPtr->writeBucketPtr) {
+        IocpRateBucketDrop(lockedChanPtr->writeBucketPtr);
+        lockedChanPtr->writeBucketPtr = NULL;
+    }
+    lockedChanPtr->flags &= ~IOCP_CHAN_F_RATE_WAIT_MASK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateTableDelete --
+ *
+ *    Called when an interpreter is deleted to release its named buckets.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    Buckets still in use by channels stay alive until they are closed.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpRateTableDelete(
+    ClientData clientData,      /* IocpRateTable */
+    Tcl_Interp *interp)         /* Interpreter being deleted */
+{
+    IocpRateTable  *tablePtr = (IocpRateTable *) clientData;
+    Tcl_HashEntry  *hePtr;
+    Tcl_HashSearch  hSearch;
+
+    for (hePtr = Tcl_FirstHashEntry(&tablePtr->buckets, &hSearch);
+         hePtr != NULL;
+         hePtr = Tcl_NextHashEntry(&hSearch)) {
+        IocpRateBucket *bucketPtr = Tcl_GetHashValue(hePtr);
+        IocpLockAcquireExclusive(&bucketPtr->lock);
+        bucketPtr->name[0] = '\0';
+        IocpLockReleaseExclusive(&bucketPtr->lock);
+        IocpRateBucketDrop(bucketPtr);
+    }
+    Tcl_DeleteHashTable(&tablePtr->buckets);
+    ckfree(tablePtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateTableGet --
+ *
+ *    Returns the bucket table for an interpreter, creating it if necessary.
+ *
+ * Results:
+ *    Pointer to the interpreter's IocpRateTable.
+ *
+ * Side effects:
+ *    The table is allocated and attached to the interpreter on first call.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpRateTable *
+IocpRateTableGet(Tcl_Interp *interp)
+{
+    IocpRateTable *tablePtr;
+
+    tablePtr = Tcl_GetAssocData(interp, IOCP_RATE_ASSOC_KEY, NULL);
+    if (tablePtr == NULL) {
+        tablePtr = ckalloc(sizeof(*tablePtr));
+        Tcl_InitHashTable(&tablePtr->buckets, TCL_STRING_KEYS);
+        tablePtr->nextId = 0;
+        Tcl_SetAssocData(interp, IOCP_RATE_ASSOC_KEY, IocpRateTableDelete,
+                         tablePtr);
+    }
+    return tablePtr;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateBucketFind --
+ *
+ *    Maps a bucket name to the bucket.
+ *
+ * Results:
+ *    Pointer to the bucket or NULL with an error message in interp if
+ *    the bucket does not exist.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpRateBucket *
+IocpRateBucketFind(
+    Tcl_Interp *interp,         /* May be NULL */
+    const char *name)
+{
+    Tcl_HashEntry *hePtr = NULL;
+
+    if (interp)
+        hePtr = Tcl_FindHashEntry(&IocpRateTableGet(interp)->buckets, name);
+    if (hePtr == NULL) {
+        if (interp)
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("rate limiter \"%s\" not found.", name));
+        return NULL;
+    }
+    return (IocpRateBucket *) Tcl_GetHashValue(hePtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateParseRate --
+ *
+ *    Parses a rate or burst size which must be a positive integer.
+ *
+ * Results:
+ *    TCL_OK or TCL_ERROR with an error message in interp.
+ *
+ * Side effects:
+ *    The value is stored in *valuePtr.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+IocpRateParseRate(
+    Tcl_Interp  *interp,        /* May be NULL */
+    Tcl_Obj     *objPtr,
+    Tcl_WideInt *valuePtr)
+{
+    if (Tcl_GetWideIntFromObj(interp, objPtr, valuePtr) != TCL_OK)
+        return TCL_ERROR;
+    if (*valuePtr <= 0) {
+        if (interp)
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Integer value %s out of range.", Tcl_GetString(objPtr)));
+        return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateSetSpec --
+ *
+ *    Sets the rate limits of a channel from a -ratelimit option value.
+ *    The value is a dictionary with the optional keys "read" and "write"
+ *    whose values are either a rate in bytes per second or the name of
+ *    a bucket created with iocp::inet::ratelimit, and "burst" specifying
+ *    the bucket size for rates. An empty value removes all limits.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    The channel's buckets are replaced. Held back I/O is rescheduled.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode
+IocpRateSetSpec(
+    Tcl_Interp  *interp,        /* For error reporting. May be NULL */
+    IocpChannel *lockedChanPtr, /* Locked on entry, locked on exit */
+    const char  *specPtr)       /* Option value */
+{
+    static const char *const specKeys[] = { "burst", "read", "write", NULL };
+    enum specKeys { SPEC_BURST, SPEC_READ, SPEC_WRITE };
+    Tcl_Obj        *specObj;
+    Tcl_Obj       **objs;
+    Tcl_Size        nobjs;
+    Tcl_Size        i;
+    int             keyIndex;
+    Tcl_WideInt     burst = 0;
+    Tcl_Obj        *rateObjs[2] = {NULL, NULL}; /* read, write */
+    IocpRateBucket *bucketPtrs[2] = {NULL, NULL};
+    IocpTclCode     ret = TCL_ERROR;
+
+    specObj = Tcl_NewStringObj(specPtr, -1);
+    Tcl_IncrRefCount(specObj);
+    if (Tcl_ListObjGetElements(interp, specObj, &nobjs, &objs) != TCL_OK)
+        goto vamoose;
+    if (nobjs & 1) {
+        if (interp)
+            Tcl_SetResult(interp, "Invalid rate limit. Must be a dictionary with keys read, write and burst.", TCL_STATIC);
+        goto vamoose;
+    }
+    for (i = 0; i < nobjs; i += 2) {
+        if (Tcl_GetIndexFromObj(interp, objs[i], specKeys, "rate limit key",
+                                TCL_EXACT, &keyIndex) != TCL_OK)
+            goto vamoose;
+        switch ((enum specKeys) keyIndex) {
+        case SPEC_BURST:
+            if (IocpRateParseRate(interp, objs[i+1], &burst) != TCL_OK)
+                goto vamoose;
+            break;
+        case SPEC_READ:  rateObjs[0] = objs[i+1]; break;
+        case SPEC_WRITE: rateObjs[1] = objs[i+1]; break;
+        }
+    }
+
+    for (i = 0; i < 2; ++i) {
+        Tcl_WideInt rate;
+        if (rateObjs[i] == NULL)
+            continue;
+        if (Tcl_GetWideIntFromObj(NULL, rateObjs[i], &rate) == TCL_OK) {
+            if (IocpRateParseRate(interp, rateObjs[i], &rate) != TCL_OK)
+                goto vamoose;
+            bucketPtrs[i] = IocpRateBucketNew(rate, burst);
+        } else {
+            bucketPtrs[i] = IocpRateBucketFind(interp, Tcl_GetString(rateObjs[i]));
+            if (bucketPtrs[i] == NULL)
+                goto vamoose;
+            IocpLockAcquireExclusive(&bucketPtrs[i]->lock);
+            bucketPtrs[i]->numRefs += 1;
+            IocpLockReleaseExclusive(&bucketPtrs[i]->lock);
+        }
+    }
+
+    /* Swap in the new buckets. The old ones are released below. */
+    {
+        IocpRateBucket *oldPtr;
+        oldPtr = lockedChanPtr->readBucketPtr;
+        lockedChanPtr->readBucketPtr = bucketPtrs[0];
+        bucketPtrs[0] = oldPtr;
+        oldPtr = lockedChanPtr->writeBucketPtr;
+        lockedChanPtr->writeBucketPtr = bucketPtrs[1];
+        bucketPtrs[1] = oldPtr;
+    }
+
+    /* Resume I/O held back by the previous limits */
+    if (lockedChanPtr->flags & IOCP_CHAN_F_RATE_WAIT_MASK) {
+        IocpRateCancelTimer(lockedChanPtr);
+        IocpRateSchedule(lockedChanPtr);
+    }
+    ret = TCL_OK;
+
+vamoose:
+    for (i = 0; i < 2; ++i) {
+        if (bucketPtrs[i])
+            IocpRateBucketDrop(bucketPtrs[i]);
+    }
+    Tcl_DecrRefCount(specObj);
+    if (ret != TCL_OK)
+        Tcl_SetErrno(EINVAL);
+    return ret;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateGetSpec --
+ *
+ *    Stores the -ratelimit option value for a channel.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The value is appended to dsPtr.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpRateGetSpec(
+    IocpChannel *lockedChanPtr, /* Must be locked */
+    Tcl_DString *dsPtr)         /* Where to store the value */
+{
+    IocpRateBucket *bucketPtrs[2];
+    const char     *keys[2] = {"read", "write"};
+    Tcl_WideInt     burst = 0;
+    char            integerSpace[40];
+    int             i;
+
+    bucketPtrs[0] = lockedChanPtr->readBucketPtr;
+    bucketPtrs[1] = lockedChanPtr->writeBucketPtr;
+    for (i = 0; i < 2; ++i) {
+        IocpRateBucket *bucketPtr = bucketPtrs[i];
+        if (bucketPtr == NULL)
+            continue;
+        Tcl_DStringAppendElement(dsPtr, keys[i]);
+        IocpLockAcquireExclusive(&bucketPtr->lock);
+        if (bucketPtr->name[0]) {
+            Tcl_DStringAppendElement(dsPtr, bucketPtr->name);
+        } else {
+            sprintf_s(integerSpace, sizeof(integerSpace), "%" TCL_LL_MODIFIER "d",
+                      bucketPtr->rate);
+            Tcl_DStringAppendElement(dsPtr, integerSpace);
+            burst = bucketPtr->burst;
+        }
+        IocpLockReleaseExclusive(&bucketPtr->lock);
+    }
+    if (burst) {
+        Tcl_DStringAppendElement(dsPtr, "burst");
+        sprintf_s(integerSpace, sizeof(integerSpace), "%" TCL_LL_MODIFIER "d",
+                  burst);
+        Tcl_DStringAppendElement(dsPtr, integerSpace);
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpRateStatsObj --
+ *
+ *    Returns the settings and statistics of a bucket as a dictionary.
+ *
+ * Results:
+ *    Tcl_Obj containing the dictionary.
+ *
+ * Side effects:
+ *    The bucket is refilled.
+ *
+ *------------------------------------------------------------------------
+ */
+static Tcl_Obj *
+IocpRateStatsObj(
+    IocpRateBucket *bucketPtr)  /* Must NOT be locked */
+{
+    Tcl_Obj *objs[10];
+
+    IocpLockAcquireExclusive(&bucketPtr->lock);
+    IocpRateBucketRefill(bucketPtr);
+    objs[0] = Tcl_NewStringObj("rate", -1);
+    objs[1] = Tcl_NewWideIntObj(bucketPtr->rate);
+    objs[2] = Tcl_NewStringObj("burst", -1);
+    objs[3] = Tcl_NewWideIntObj(bucketPtr->burst);
+    objs[4] = Tcl_NewStringObj("tokens", -1);
+    objs[5] = Tcl_NewWideIntObj((Tcl_WideInt) bucketPtr->tokens);
+    objs[6] = Tcl_NewStringObj("bytes", -1);
+    objs[7] = Tcl_NewWideIntObj(bucketPtr->bytes);
+    objs[8] = Tcl_NewStringObj("throttles", -1);
+    objs[9] = Tcl_NewWideIntObj(bucketPtr->throttles);
+    IocpLockReleaseExclusive(&bucketPtr->lock);
+    return Tcl_NewListObj(10, objs);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Rate_RatelimitObjCmd --
+ *
+ *    Implements the iocp::inet::ratelimit command.
+ *
+ *      ratelimit create RATE ?BURST?
+ *      ratelimit configure LIMITER RATE ?BURST?
+ *      ratelimit stats LIMITER
+ *      ratelimit destroy LIMITER
+ *
+ * Results:
+ *    A standard Tcl result.
+ *
+ * Side effects:
+ *    As per the subcommand.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Rate_RatelimitObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    static const char *const rateCommands[] = {
+        "configure", "create", "destroy", "stats", NULL
+    };
+    enum rateCommands {
+        RATE_CONFIGURE, RATE_CREATE, RATE_DESTROY, RATE_STATS
+    };
+    IocpRateTable  *tablePtr;
+    IocpRateBucket *bucketPtr;
+    Tcl_HashEntry  *hePtr;
+    Tcl_WideInt     rate;
+    Tcl_WideInt     burst = 0;
+    int             cmdIndex;
+    int             newEntry;
+
+    if (objc < 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "subcommand ?arg ...?");
+        return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], rateCommands, "subcommand",
+                            0, &cmdIndex) != TCL_OK) {
+        return TCL_ERROR;
+    }
+
+    tablePtr = IocpRateTableGet(interp);
+    if (cmdIndex == RATE_CREATE) {
+        if (objc < 3 || objc > 4) {
+            Tcl_WrongNumArgs(interp, 2, objv, "RATE ?BURST?");
+            return TCL_ERROR;
+        }
+        if (IocpRateParseRate(interp, objv[2], &rate) != TCL_OK ||
+            (objc == 4 && IocpRateParseRate(interp, objv[3], &burst) != TCL_OK))
+            return TCL_ERROR;
+        bucketPtr = IocpRateBucketNew(rate, burst); /* Ref for table */
+        sprintf_s(bucketPtr->name, sizeof(bucketPtr->name), "iocpratelimit%d",
+                  tablePtr->nextId++);
+        hePtr = Tcl_CreateHashEntry(&tablePtr->buckets, bucketPtr->name, &newEntry);
+        IOCP_ASSERT(newEntry);
+        Tcl_SetHashValue(hePtr, bucketPtr);
+        Tcl_SetObjResult(interp, Tcl_NewStringObj(bucketPtr->name, -1));
+        return TCL_OK;
+    }
+
+    if (objc < 3) {
+        Tcl_WrongNumArgs(interp, 2, objv, "LIMITER ?arg ...?");
+        return TCL_ERROR;
+    }
+    hePtr = Tcl_FindHashEntry(&tablePtr->buckets, Tcl_GetString(objv[2]));
+    if (hePtr == NULL) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("rate limiter \"%s\" not found.",
+                                               Tcl_GetString(objv[2])));
+        return TCL_ERROR;
+    }
+    bucketPtr = (IocpRateBucket *) Tcl_GetHashValue(hePtr);
+
+    switch ((enum rateCommands) cmdIndex) {
+    case RATE_CONFIGURE:
+        if (objc < 4 || objc > 5) {
+            Tcl_WrongNumArgs(interp, 2, objv, "LIMITER RATE ?BURST?");
+            return TCL_ERROR;
+        }
+        if (IocpRateParseRate(interp, objv[3], &rate) != TCL_OK ||
+            (objc == 5 && IocpRateParseRate(interp, objv[4], &burst) != TCL_OK))
+            return TCL_ERROR;
+        if (burst == 0) {
+            burst = rate / IOCP_RATE_BURST_DIVISOR;
+            if (burst == 0)
+                burst = 1;
+        }
+        IocpLockAcquireExclusive(&bucketPtr->lock);
+        IocpRateBucketRefill(bucketPtr);
+        bucketPtr->rate  = rate;
+        bucketPtr->burst = burst;
+        if (bucketPtr->tokens > (double) burst)
+            bucketPtr->tokens = (double) burst;
+        IocpLockReleaseExclusive(&bucketPtr->lock);
+        return TCL_OK;
+    case RATE_STATS:
+        if (objc != 3) {
+            Tcl_WrongNumArgs(interp, 2, objv, "LIMITER");
+            return TCL_ERROR;
+        }
+        Tcl_SetObjResult(interp, IocpRateStatsObj(bucketPtr));
+        return TCL_OK;
+    case RATE_DESTROY:
+        if (objc != 3) {
+            Tcl_WrongNumArgs(interp, 2, objv, "LIMITER");
+            return TCL_ERROR;
+        }
+        /* Channels using the bucket continue to do so until closed */
+        Tcl_DeleteHashEntry(hePtr);
+        IocpLockAcquireExclusive(&bucketPtr->lock);
+        bucketPtr->name[0] = '\0';
+        IocpLockReleaseExclusive(&bucketPtr->lock);
+        IocpRateBucketDrop(bucketPtr);
+        return TCL_OK;
+    default:
+        Iocp_Panic("Rate_RatelimitObjCmd: bad subcommand index %d", cmdIndex);
+        return TCL_ERROR;
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Rate_ModuleInitialize --
+ *
+ *    Initializes the rate limiting module.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    Creates the iocp::inet::ratelimit command.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode Rate_ModuleInitialize (Tcl_Interp *interp)
+{
+    Tcl_CreateObjCommand(interp, "iocp::inet::ratelimit", Rate_RatelimitObjCmd, 0L, 0L);
+    return TCL_OK;
+}
@@ -0,0 +1,727 @@
+/*
+ * tclWinIocpSplice.c --
+ *
+ *	Channel to channel splicing for iocp channels.
+ *
+ * Copyright (c) 2026 agent.
+ *
+ * See the file "license.terms" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+#include "tclWinIocp.h"
+
+/*
+ * A splice forwards all data received on a source channel to a target
+ * channel without involving the Tcl thread. When a read on the source
+ * completes, the completion thread reposts the same IocpBuffer as a write
+ * on the target through the target's postbuffer() vtbl function and then
+ * posts another read on the source. If the target already has
+ * maxPendingWrites writes outstanding, further reads on the source are
+ * held back (IOCP_CHAN_F_SPLICE_STALLED) until one of the target's writes
+ * completes.
+ *
+ * The splice ends when the source reaches EOF or an error occurs on either
+ * channel. The completion thread then queues the source's spliceDoneBufPtr
+ * (a IOCP_BUFFER_OP_TRANSMIT buffer) on the source's completions queue.
+ * IocpSpliceCompleted then runs in the Tcl thread and unlinks the two
+ * channels and invokes the application callback, if any.
+ *
+ * Lock hierarchy: the completion thread holds the lock of one channel of a
+ * splice while locking the other. Therefore the Tcl thread must NEVER hold
+ * the locks of both channels at the same time. The lock order also differs
+ * between IocpSpliceForward and IocpSpliceWriteCompleted, which is only
+ * safe because both run in the single completion thread of a port. The
+ * two channels of a splice must therefore be on the same completion port
+ * (see iocp::configure -completionport).
+ */
+
+/* Callback state for a splice. Stored in the context of spliceDoneBufPtr */
+typedef struct IocpSpliceCallback {
+    Tcl_Interp   *interp;       /* Interpreter in which to run callback.
+                                 * Preserved until the state is freed. */
+    Tcl_ThreadId  threadId;     /* Thread that set up the splice */
+    char         *script;       /* Command prefix including channel names.
+                                 * NULL if no callback. */
+} IocpSpliceCallback;
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpSpliceDoneBufferFree --
+ *
+ *    Frees a splice completion buffer and its callback state.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    As above.
+ *
+ *------------------------------------------------------------------------
+ */
+static void IocpSpliceDoneBufferFree(IocpBuffer *bufPtr)
+{
+    IocpSpliceCallback *cbPtr = (IocpSpliceCallback *) bufPtr->context[0].ptr;
+    if (cbPtr->script)
+        ckfree(cbPtr->script);
+    IocpInterpRelease(cbPtr->interp, cbPtr->threadId);
+    ckfree(cbPtr);
+    IocpBufferFree(bufPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpSpliceEnd --
+ *
+ *    Marks the splice from a channel as ended and arranges for the Tcl
+ *    thread to be notified. May be called from any thread.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The splice completion buffer is queued on the channel's completions
+ *    queue and the owning thread is notified.
+ *
+ *------------------------------------------------------------------------
+ */
+static void IocpSpliceEnd(
+    IocpChannel *lockedFromPtr, /* Splice source. Locked on entry and return.
+                                 * Caller must hold a reference. */
+    IocpWinError winError)      /* Error code, 0 if source reached EOF */
+{
+    IocpBuffer *bufPtr = lockedFromPtr->spliceDoneBufPtr;
+
+    if (bufPtr == NULL)
+        return;                 /* Already ended */
+    lockedFromPtr->spliceDoneBufPtr = NULL;
+    lockedFromPtr->flags &= ~IOCP_CHAN_F_SPLICE_STALLED;
+    bufPtr->winError = winError;
+    IocpListAppend(&lockedFromPtr->completions, &bufPtr->link);
+    IocpChannelNudgeThread(lockedFromPtr, 0, 1);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpSpliceUnlink --
+ *
+ *    Removes the links between a splice source and its target. Must be
+ *    called from the Tcl thread.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The references between the two channels are released. lockedFromPtr
+ *    is unlocked and relocked in the interim.
+ *
+ *------------------------------------------------------------------------
+ */
+static void IocpSpliceUnlink(
+    IocpChannel *lockedFromPtr) /* Splice source. Locked on entry and return.
+                                 * Caller must hold a reference. */
+{
+    IocpChannel *toPtr = lockedFromPtr->spliceToPtr;
+    int          dropFrom = 0;
+
+    if (toPtr == NULL)
+        return;
+    lockedFromPtr->spliceToPtr = NULL;
+    lockedFromPtr->flags &= ~(IOCP_CHAN_F_SPLICE_STALLED | IOCP_CHAN_F_SPLICE_HOLD);
+
+    /* Never hold both locks in the Tcl thread. See lock hierarchy above. */
+    IocpChannelUnlock(lockedFromPtr);
+    IocpChannelLock(toPtr);
+    if (toPtr->spliceFromPtr == lockedFromPtr) {
+        toPtr->spliceFromPtr = NULL;
+        dropFrom = 1;
+    }
+    IocpChannelDrop(toPtr);     /* Reference from lockedFromPtr->spliceToPtr */
+    IocpChannelLock(lockedFromPtr);
+    if (dropFrom) {
+        /* Reference from toPtr->spliceFromPtr. Caller holds another. */
+        IOCP_ASSERT(lockedFromPtr->numRefs > 1);
+        lockedFromPtr->numRefs -= 1;
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpSpliceCompleted --
+ *
+ *    Completion procedure for a splice, called in the Tcl thread once the
+ *    splice from a channel has ended. See IocpCompletionProc.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The channels are unlinked, reads are posted on the source so
+ *    the Tcl channel layer sees any remaining data and EOF, and the
+ *    application callback is invoked.
+ *
+ *------------------------------------------------------------------------
+ */
+static void IocpSpliceCompleted(
+    IocpChannel *lockedFromPtr, /* Locked on entry and return. May be NULL */
+    IocpBuffer  *bufPtr)        /* The splice done buffer */
+{
+    IocpSpliceCallback *cbPtr = (IocpSpliceCallback *) bufPtr->context[0].ptr;
+    Tcl_Interp  *interp;
+    Tcl_Obj     *cmdObj;
+
+    if (lockedFromPtr == NULL) {
+        IocpSpliceDoneBufferFree(bufPtr);
+        return;
+    }
+
+    IocpSpliceUnlink(lockedFromPtr);
+    if (lockedFromPtr->state == IOCP_STATE_OPEN &&
+        (lockedFromPtr->flags & IOCP_CHAN_F_WRITEONLY) == 0) {
+        IocpChannelPostReads(lockedFromPtr);
+    }
+
+    if (cbPtr->script == NULL ||
+        cbPtr->threadId != Tcl_GetCurrentThread() ||
+        Tcl_InterpDeleted(cbPtr->interp)) {
+        IocpSpliceDoneBufferFree(bufPtr);
+        return;
+    }
+
+    interp = cbPtr->interp;
+    cmdObj = Tcl_NewStringObj(cbPtr->script, -1);
+    Tcl_IncrRefCount(cmdObj);
+    Tcl_ListObjAppendElement(NULL, cmdObj,
+                             Tcl_NewWideIntObj(lockedFromPtr->splicedBytes));
+    if (bufPtr->winError != ERROR_SUCCESS) {
+        Tcl_ListObjAppendElement(NULL, cmdObj,
+                                 Iocp_MapWindowsError(bufPtr->winError, NULL, NULL));
+    }
+    IocpChannelInvokeCallback(lockedFromPtr, interp, cmdObj);
+    IocpSpliceDoneBufferFree(bufPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpSpliceForward --
+ *
+ *    Called from the completion thread when a read completes on a splice
+ *    source. Posts the buffer as a write on the splice target.
+ *
+ * Results:
+ *    1 if the buffer was handed to the target, in which case the caller
+ *    must not access it. 0 if the buffer should be queued on the source's
+ *    inputBuffers as usual, e.g. for EOF or errors. The splice is ended
+ *    in that case.
+ *
+ * Side effects:
+ *    Another read may be posted on the source.
+ *
+ *------------------------------------------------------------------------
+ */
+int IocpSpliceForward(
+    IocpChannel *lockedFromPtr, /* Splice source. Locked on entry and return */
+    IocpBuffer  *bufPtr)        /* Completed read buffer. bufPtr->chanPtr
+                                 * must be NULL on entry. */
+{
+    IocpChannel *toPtr = lockedFromPtr->spliceToPtr;
+    IocpWinError winError;
+    int          len;
+    int          stalled;
+
+    IOCP_ASSERT(toPtr != NULL);
+    IOCP_ASSERT(bufPtr->chanPtr == NULL);
+
+    if (bufPtr->winError != ERROR_SUCCESS || bufPtr->data.len == 0) {
+        /* Leave EOF and errors for the Tcl channel layer to see */
+        IocpSpliceEnd(lockedFromPtr, bufPtr->winError);
+        return 0;
+    }
+
+    len = bufPtr->data.len;
+    IocpChannelLock(toPtr);
+    if (toPtr->state != IOCP_STATE_OPEN ||
+        (toPtr->flags & IOCP_CHAN_F_READONLY)) {
+        winError = WSAENOTCONN;
+    } else {
+        bufPtr->operation = IOCP_BUFFER_OP_WRITE;
+        winError = toPtr->vtblPtr->postbuffer(toPtr, bufPtr);
+        if (winError != ERROR_SUCCESS)
+            bufPtr->operation = IOCP_BUFFER_OP_READ;
+    }
+    stalled = toPtr->pendingWrites >= toPtr->maxPendingWrites;
+    IocpChannelUnlock(toPtr);
+
+    if (winError != ERROR_SUCCESS) {
+        IocpSpliceEnd(lockedFromPtr, winError);
+        return 0;
+    }
+
+    lockedFromPtr->splicedBytes += len;
+    if (stalled) {
+        /* Target will restart reads when its writes complete */
+        lockedFromPtr->flags |= IOCP_CHAN_F_SPLICE_STALLED;
+    } else if (lockedFromPtr->state == IOCP_STATE_OPEN) {
+        winError = IocpChannelPostReads(lockedFromPtr);
+        if (winError != ERROR_SUCCESS)
+            IocpSpliceEnd(lockedFromPtr, winError);
+    }
+    return 1;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpSpliceWriteCompleted --
+ *
+ *    Called from the completion thread when a write completes on a channel
+ *    that is the target of a splice. Resumes reads on a stalled source
+ *    and ends the splice on write errors.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    Reads may be posted on the splice source.
+ *
+ *------------------------------------------------------------------------
+ */
+void IocpSpliceWriteCompleted(
+    IocpChannel *lockedToPtr,   /* Splice target. Locked on entry and return */
+    IocpBuffer  *bufPtr)        /* Completed write buffer */
+{
+    IocpChannel *fromPtr = lockedToPtr->spliceFromPtr;
+
+    if (bufPtr->winError == ERROR_SUCCESS &&
+        lockedToPtr->pendingWrites >= lockedToPtr->maxPendingWrites)
+        return;                 /* Still no room */
+
+    IocpChannelLock(fromPtr);
+    if (fromPtr->spliceToPtr == lockedToPtr &&
+        fromPtr->spliceDoneBufPtr != NULL) {
+        if (bufPtr->winError != ERROR_SUCCESS) {
+            IocpSpliceEnd(fromPtr, bufPtr->winError);
+        } else if (fromPtr->flags & IOCP_CHAN_F_SPLICE_STALLED) {
+            fromPtr->flags &= ~IOCP_CHAN_F_SPLICE_STALLED;
+            if (fromPtr->state == IOCP_STATE_OPEN) {
+                IocpWinError winError = IocpChannelPostReads(fromPtr);
+                if (winError != ERROR_SUCCESS)
+                    IocpSpliceEnd(fromPtr, winError);
+            }
+        }
+    }
+    IocpChannelUnlock(fromPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpSpliceDetach --
+ *
+ *    Called from the Tcl thread when a channel is being closed to break
+ *    any splices it participates in. A splice from the channel is ended
+ *    without invoking the callback. A splice to the channel is ended with
+ *    an error which is reported to the source's callback.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    lockedChanPtr may be unlocked and relocked in the interim.
+ *
+ *------------------------------------------------------------------------
+ */
+void IocpSpliceDetach(
+    IocpChannel *lockedChanPtr) /* Locked on entry and return. Caller must
+                                 * hold a reference. */
+{
+    IocpChannel *fromPtr;
+
+    if (lockedChanPtr->spliceToPtr) {
+        if (lockedChanPtr->spliceDoneBufPtr) {
+            IocpSpliceDoneBufferFree(lockedChanPtr->spliceDoneBufPtr);
+            lockedChanPtr->spliceDoneBufPtr = NULL;
+        }
+        IocpSpliceUnlink(lockedChanPtr);
+    }
+
+    fromPtr = lockedChanPtr->spliceFromPtr;
+    if (fromPtr) {
+        /*
+         * fromPtr cannot go away while unlocked since we hold a reference
+         * through spliceFromPtr which is only released in this thread.
+         */
+        IocpChannelUnlock(lockedChanPtr);
+        IocpChannelLock(fromPtr);
+        if (fromPtr->spliceToPtr == lockedChanPtr)
+            IocpSpliceEnd(fromPtr, WSAENOTCONN);
+        IocpChannelUnlock(fromPtr);
+        IocpChannelLock(lockedChanPtr);
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpSpliceCancel --
+ *
+ *    Undoes a splice started by IocpSpliceStart without invoking the
+ *    callback. Called from the Tcl thread when a command fails after a
+ *    splice was started.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The channels are unlinked and reads are posted on the source so
+ *    further data is queued to the Tcl channel. Data already forwarded
+ *    is not recovered.
+ *
+ *------------------------------------------------------------------------
+ */
+static void IocpSpliceCancel(
+    IocpChannel *fromPtr)       /* Splice source. Unlocked. Caller must hold
+                                 * a reference. */
+{
+    IocpChannelLock(fromPtr);
+    /* If the splice already ended, IocpSpliceCompleted will clean up */
+    if (fromPtr->spliceToPtr && fromPtr->spliceDoneBufPtr) {
+        IocpSpliceDoneBufferFree(fromPtr->spliceDoneBufPtr);
+        fromPtr->spliceDoneBufPtr = NULL;
+        IocpSpliceUnlink(fromPtr);
+        if (fromPtr->state == IOCP_STATE_OPEN &&
+            (fromPtr->flags & IOCP_CHAN_F_WRITEONLY) == 0) {
+            IocpChannelPostReads(fromPtr);
+        }
+    }
+    IocpChannelUnlock(fromPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpSpliceStart --
+ *
+ *    Starts splicing data from one channel to another.
+ *
+ * Results:
+ *    TCL_OK or TCL_ERROR with an error message in interp.
+ *
+ * Side effects:
+ *    Data already buffered on the source is written to the target and
+ *    subsequent data is forwarded by the completion thread.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode IocpSpliceStart(
+    Tcl_Interp  *interp,
+    Tcl_Channel  fromChan,      /* Source Tcl channel */
+    IocpChannel *fromPtr,       /* Source. Unlocked */
+    Tcl_Channel  toChan,        /* Target Tcl channel */
+    IocpChannel *toPtr,         /* Target. Unlocked */
+    Tcl_Obj     *cmdObj)        /* Callback command prefix. May be NULL */
+{
+    IocpSpliceCallback *cbPtr;
+    IocpBuffer         *doneBufPtr;
+    IocpList            pending;
+    IocpLink           *linkPtr;
+    IocpWinError        winError = ERROR_SUCCESS;
+    int                 eof = 0;
+    int                 nbuffered;
+
+    /*
+     * Move data already read into the Tcl channel buffers. The channels
+     * are in binary mode so the byte counts match.
+     */
+    nbuffered = Tcl_InputBuffered(fromChan);
+    if (nbuffered > 0) {
+        char *bytes = ckalloc(nbuffered);
+        int   nread = Tcl_Read(fromChan, bytes, nbuffered);
+        if (nread > 0 && Tcl_Write(toChan, bytes, nread) != nread) {
+            ckfree(bytes);
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("error writing \"%s\": %s", Tcl_GetChannelName(toChan), Tcl_PosixError(interp)));
+            return TCL_ERROR;
+        }
+        ckfree(bytes);
+    }
+    if (Tcl_Flush(toChan) != TCL_OK) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("error flushing \"%s\": %s", Tcl_GetChannelName(toChan), Tcl_PosixError(interp)));
+        return TCL_ERROR;
+    }
+    if (Tcl_OutputBuffered(toChan) != 0) {
+        Tcl_SetErrno(EAGAIN);
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" has pending output.", Tcl_GetChannelName(toChan)));
+        return TCL_ERROR;
+    }
+
+    doneBufPtr = IocpBufferNew(0, IOCP_BUFFER_OP_TRANSMIT, 0);
+    if (doneBufPtr == NULL) {
+        Tcl_SetResult(interp, "Could not allocate buffer.", TCL_STATIC);
+        return TCL_ERROR;
+    }
+    cbPtr = ckalloc(sizeof(*cbPtr));
+    cbPtr->interp   = interp;
+    Tcl_Preserve(interp);       /* Released in IocpSpliceDoneBufferFree */
+    cbPtr->threadId = Tcl_GetCurrentThread();
+    cbPtr->script   = NULL;
+    if (cmdObj) {
+        Tcl_Obj    *scriptObj = Tcl_DuplicateObj(cmdObj);
+        const char *script;
+        IocpSizeT   len;
+        Tcl_IncrRefCount(scriptObj);
+        Tcl_ListObjAppendElement(NULL, scriptObj,
+                                 Tcl_NewStringObj(Tcl_GetChannelName(fromChan), -1));
+        Tcl_ListObjAppendElement(NULL, scriptObj,
+                                 Tcl_NewStringObj(Tcl_GetChannelName(toChan), -1));
+        script = Tcl_GetStringFromObj(scriptObj, &len);
+        cbPtr->script = ckalloc(len + 1);
+        memcpy(cbPtr->script, script, len + 1);
+        Tcl_DecrRefCount(scriptObj);
+    }
+    doneBufPtr->context[0].ptr = cbPtr;
+    doneBufPtr->completionProc = IocpSpliceCompleted;
+
+    /*
+     * Link the channels. The source is placed on hold so reads completing
+     * while queued data is moved to the target are still queued on
+     * inputBuffers, preserving order. Locks are taken one at a time.
+     */
+    IocpChannelLock(toPtr);
+    toPtr->spliceFromPtr = fromPtr;
+    toPtr->numRefs += 1;        /* For fromPtr->spliceToPtr */
+    IocpChannelUnlock(toPtr);
+
+    IocpChannelLock(fromPtr);
+    fromPtr->numRefs += 1;      /* For toPtr->spliceFromPtr */
+    fromPtr->spliceToPtr      = toPtr;
+    fromPtr->spliceDoneBufPtr = doneBufPtr;
+    fromPtr->splicedBytes     = 0;
+    fromPtr->flags |= IOCP_CHAN_F_SPLICE_HOLD;
+
+    while (1) {
+        /* Collect data buffers up to any EOF or error buffer */
+        IocpListInit(&pending);
+        while ((linkPtr = fromPtr->inputBuffers.headPtr) != NULL) {
+            IocpBuffer *bufPtr = CONTAINING_RECORD(linkPtr, IocpBuffer, link);
+            if (bufPtr->winError != ERROR_SUCCESS || bufPtr->data.len == 0) {
+                eof = 1;
+                winError = bufPtr->winError;
+                break;
+            }
+            IocpListPopFront(&fromPtr->inputBuffers);
+            fromPtr->splicedBytes += bufPtr->data.len;
+            fromPtr->inputBytes   -= bufPtr->data.len;
+            IocpListAppend(&pending, linkPtr);
+        }
+        if (pending.headPtr == NULL)
+            break;
+
+        IocpChannelUnlock(fromPtr);
+        IocpChannelLock(toPtr);
+        while ((linkPtr = IocpListPopFront(&pending)) != NULL) {
+            IocpBuffer *bufPtr = CONTAINING_RECORD(linkPtr, IocpBuffer, link);
+            IocpWinError postError = WSAENOTCONN;
+            if (toPtr->state == IOCP_STATE_OPEN &&
+                (toPtr->flags & IOCP_CHAN_F_READONLY) == 0) {
+                bufPtr->operation = IOCP_BUFFER_OP_WRITE;
+                postError = toPtr->vtblPtr->postbuffer(toPtr, bufPtr);
+            }
+            if (postError != ERROR_SUCCESS) {
+                IocpBufferFree(bufPtr);
+                if (winError == ERROR_SUCCESS) {
+                    winError = postError;
+                    eof = 1;
+                }
+            }
+        }
+        IocpChannelUnlock(toPtr);
+        IocpChannelLock(fromPtr);
+        if (eof)
+            break;
+    }
+
+    fromPtr->flags &= ~IOCP_CHAN_F_SPLICE_HOLD;
+    if (eof) {
+        IocpSpliceEnd(fromPtr, winError);
+    } else if (fromPtr->state == IOCP_STATE_OPEN) {
+        winError = IocpChannelPostReads(fromPtr);
+        if (winError != ERROR_SUCCESS)
+            IocpSpliceEnd(fromPtr, winError);
+    }
+    IocpChannelUnlock(fromPtr);
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpSpliceChannel --
+ *
+ *    Maps a channel name to a Tcl channel and IocpChannel that supports
+ *    splicing in the specified direction.
+ *
+ * Results:
+ *    TCL_OK or TCL_ERROR with an error message in interp.
+ *
+ * Side effects:
+ *    The channel is placed in binary mode.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode IocpSpliceChannel(
+    Tcl_Interp   *interp,
+    Tcl_Obj      *nameObj,      /* Channel name */
+    int           direction,    /* Required TCL_READABLE|TCL_WRITABLE mask */
+    Tcl_Channel  *chanPtr,      /* Output Tcl channel */
+    IocpChannel **iocpChanPtrPtr) /* Output IocpChannel */
+{
+    IocpChannel *iocpChanPtr;
+    int          mode;
+    int          busy;
+    const char  *transform;
+
+    *chanPtr = Tcl_GetChannel(interp, Tcl_GetString(nameObj), &mode);
+    if (*chanPtr == NULL)
+        return TCL_ERROR;
+    iocpChanPtr = IocpChannelFromTclChannel(*chanPtr);
+    if (iocpChanPtr == NULL || iocpChanPtr->vtblPtr->postbuffer == NULL ||
+        iocpChanPtr->vtblPtr->postread == NULL) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" does not support splicing.", Tcl_GetString(nameObj)));
+        return TCL_ERROR;
+    }
+    if ((mode & direction) != direction) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" wasn't opened for %s", Tcl_GetString(nameObj), (direction & TCL_WRITABLE) && !(mode & TCL_WRITABLE) ? "writing" : "reading"));
+        return TCL_ERROR;
+    }
+    IocpChannelLock(iocpChanPtr);
+    busy = ((direction & TCL_READABLE) && iocpChanPtr->spliceToPtr) ||
+           ((direction & TCL_WRITABLE) && iocpChanPtr->spliceFromPtr);
+    transform = iocpChanPtr->tlsPtr ? "TLS" :
+        iocpChanPtr->compressPtr ? "compression" : NULL;
+    IocpChannelUnlock(iocpChanPtr);
+    if (transform) {
+        /* Data is forwarded without passing through the TLS or zlib layer */
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" has %s enabled.", Tcl_GetString(nameObj), transform));
+        return TCL_ERROR;
+    }
+    if (busy) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" is already spliced.", Tcl_GetString(nameObj)));
+        return TCL_ERROR;
+    }
+    if (Tcl_SetChannelOption(interp, *chanPtr, "-translation", "binary") != TCL_OK)
+        return TCL_ERROR;
+    *iocpChanPtrPtr = iocpChanPtr;
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Iocp_SpliceObjCmd --
+ *
+ *    Implements the iocp::inet::splice command.
+ *
+ *      splice FROM TO ?-bidirectional? ?-command CMDPREFIX?
+ *
+ * Results:
+ *    A standard Tcl result.
+ *
+ * Side effects:
+ *    Data received on FROM (and TO if -bidirectional) is forwarded to
+ *    the other channel until EOF or error.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Iocp_SpliceObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    static const char *const spliceOptions[] = {
+        "-bidirectional", "-command", NULL
+    };
+    enum spliceOptions { SPLICE_BIDIRECTIONAL, SPLICE_COMMAND };
+    Tcl_Channel  fromChan, toChan;
+    IocpChannel *fromPtr, *toPtr;
+    Tcl_Obj     *cmdObj = NULL;
+    int          bidirectional = 0;
+    int          direction;
+    int          optionIndex;
+    int          i;
+
+    if (objc < 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "FROM TO ?-bidirectional? ?-command CMDPREFIX?");
+        return TCL_ERROR;
+    }
+    for (i = 3; i < objc; ++i) {
+        if (Tcl_GetIndexFromObj(interp, objv[i], spliceOptions, "option",
+                                TCL_EXACT, &optionIndex) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        switch ((enum spliceOptions) optionIndex) {
+        case SPLICE_BIDIRECTIONAL:
+            bidirectional = 1;
+            break;
+        case SPLICE_COMMAND:
+            if (++i == objc) {
+                Tcl_SetResult(interp, "No value specified for option -command.", TCL_STATIC);
+                return TCL_ERROR;
+            }
+            cmdObj = objv[i];
+            break;
+        }
+    }
+
+    direction = bidirectional ? (TCL_READABLE|TCL_WRITABLE) : TCL_READABLE;
+    if (IocpSpliceChannel(interp, objv[1], direction, &fromChan, &fromPtr) != TCL_OK)
+        return TCL_ERROR;
+    direction = bidirectional ? (TCL_READABLE|TCL_WRITABLE) : TCL_WRITABLE;
+    if (IocpSpliceChannel(interp, objv[2], direction, &toChan, &toPtr) != TCL_OK)
+        return TCL_ERROR;
+    if (fromPtr == toPtr) {
+        Tcl_SetResult(interp, "Cannot splice a channel to itself.", TCL_STATIC);
+        return TCL_ERROR;
+    }
+    /* See lock hierarchy at top. The port is fixed so no lock is needed. */
+    if (fromPtr->port != toPtr->port) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channels \"%s\" and \"%s\" use different completion ports.", Tcl_GetString(objv[1]), Tcl_GetString(objv[2])));
+        return TCL_ERROR;
+    }
+
+    if (IocpSpliceStart(interp, fromChan, fromPtr, toChan, toPtr, cmdObj) != TCL_OK)
+        return TCL_ERROR;
+    if (bidirectional &&
+        IocpSpliceStart(interp, toChan, toPtr, fromChan, fromPtr, cmdObj) != TCL_OK) {
+        /* Do not leave a half spliced pair behind */
+        IocpSpliceCancel(fromPtr);
+        return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Splice_ModuleInitialize --
+ *
+ *    Initializes the splice module.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    Creates the iocp::inet::splice command.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode Splice_ModuleInitialize (Tcl_Interp *interp)
+{
+    Tcl_CreateObjCommand(interp, "iocp::inet::splice", Iocp_SpliceObjCmd, 0L, 0L);
+    return TCL_OK;
+}
@@ -10,6 +10,7 @@
  */
 #include "tclWinIocp.h"
 #include "tclWinIocpWinsock.h"
+#include <limits.h>
 
 #if defined(BUILD_iocp)
 # define IOCP_INET_NAME_PREFIX   "tcp"
@@ -18,6 +19,13 @@
 # define IOCP_INET_NAME_PREFIX   "sock"
 #endif
 
+/* Limit on -initialdata. Larger requests should just be written. */
+#define IOCP_TCP_MAX_INITIAL_DATA 65536
+
+#ifndef TCP_FASTOPEN
+# define TCP_FASTOPEN 15        /* Missing from older SDK headers */
+#endif
+
 /****************************************************************
  * TCP client channel structures
  ****************************************************************/
@@ -31,7 +39,9 @@ static void         TcpClientInit(IocpChannel *chanPtr);
 static void         TcpClientFinit(IocpChannel *chanPtr);
 static IocpWinError TcpClientPostConnect(WinsockClient *chanPtr);
 static IocpWinError TcpClientBlockingConnect(IocpChannel *);
+static IocpWinError TcpClientAsyncConnected(IocpChannel *lockedChanPtr);
 static IocpWinError TcpClientAsyncConnectFailed(IocpChannel *lockedChanPtr);
+static IocpWinError TcpClientSendInitialData(WinsockClient *tcpPtr);
 static void         TcpClientFreeAddresses(WinsockClient *tcpPtr);
 
 static IocpChannelVtbl tcpClientVtbl =  {
@@ -41,11 +51,12 @@ static IocpChannelVtbl tcpClientVtbl =  {
     WinsockClientShutdown,
     NULL,                       /* Accept */
     TcpClientBlockingConnect,
-    WinsockClientAsyncConnected,
+    TcpClientAsyncConnected,
     TcpClientAsyncConnectFailed,
     WinsockClientDisconnected,
     WinsockClientPostRead,
     WinsockClientPostWrite,
+    WinsockClientPostBuffer,
     WinsockClientGetHandle,
     WinsockClientGetOption,
     WinsockClientSetOption,
@@ -74,9 +85,15 @@ typedef struct TcpListeningSocket {
     int                       aiSocktype; /* ... to create sockets ... */
     int                       aiProtocol; /* ... passed to _AcceptEx */
     int                       pendingAcceptPosts; /* #queued accepts posts */
-    int                       maxPendingAcceptPosts; /* Loose max of above */
-#define IOCP_WINSOCK_MAX_ACCEPTS 5  /* Even raising to 20 does not seem to
-                                       matter with apache benchmark */
+    int                       maxPendingAcceptPosts; /* Loose max of above.
+                                                      * Adapted to load
+                                                      * within the range
+                                                      * in TcpListener. */
+#define IOCP_WINSOCK_MAX_ACCEPTS 5  /* Initial value. Even raising to 20 does
+                                       not seem to matter with apache benchmark */
+    int                       acceptCount; /* Accepts in current interval */
+    int                       drainCount;  /* Times pendingAcceptPosts hit 0
+                                            * in current interval */
 } TcpListeningSocket;
 
 typedef struct TcpAcceptBuffer {
@@ -99,6 +116,21 @@ typedef struct TcpListener {
     int                 numListeners;   /* Only 0..numListeners-1 elements of
                                          * listeners[] should be examined and
                                          * can have value INVALID_SOCKET */
+    int                 acceptReceive;  /* Number of bytes to receive with
+                                         * AcceptEx. 0 -> accept immediately */
+#define IOCP_TCP_MAX_ACCEPT_RECEIVE 65536
+    int                 minAcceptPosts; /* Bounds for adapting the accept */
+    int                 maxAcceptPosts; /* depth. Equal -> fixed depth */
+#define IOCP_TCP_MIN_ACCEPTS_DEFAULT  2
+#define IOCP_TCP_MAX_ACCEPTS_DEFAULT  64
+#define IOCP_TCP_MAX_ACCEPTS_LIMIT    256
+    Tcl_TimerToken      adaptTimer;     /* Timer for periodic adaptation of
+                                         * accept depth. NULL if not running.
+                                         * Only accessed from owning thread */
+#define IOCP_TCP_ADAPT_INTERVAL_MS 1000
+    IocpChannelVtbl    *clientVtblPtr;  /* Vtbl for accepted connections */
+    const char         *clientPrefix;   /* Channel name prefix for accepted
+                                         * connections */
 } TcpListener;
 
 /*
@@ -114,6 +146,7 @@ IOCP_INLINE TcpListener *IocpChannelToTcpListener(IocpChannel *chanPtr) {
 
 static IocpWinError TcpListenerPostAccepts(TcpListener *lockedTcpPtr,
                                           int listenerIndex);
+static Tcl_TimerProc TcpListenerAdaptTimer;
 
 static void         TcpListenerInit(IocpChannel *basePtr);
 static void         TcpListenerFinit(IocpChannel *chanPtr);
@@ -139,6 +172,7 @@ static IocpChannelVtbl tcpListenerVtbl = {
     NULL, /* Disconnected */
     NULL, /* PostRead */
     NULL, /* PostWrite */
+    NULL, /* PostBuffer */
     NULL, // TBD TcpListenerGetHandle,
     TcpListenerGetOption,
     TcpListenerSetOption,
@@ -206,6 +240,40 @@ static void TcpClientFinit(IocpChannel *chanPtr)
     WinsockClientFinit(chanPtr);
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpClientCacheSlot --
+ *
+ *    Returns the socket cache slot for outbound connections from the
+ *    specified local address. Only connections from the wildcard address
+ *    and an ephemeral port are recycled since recycled sockets stay bound.
+ *
+ * Results:
+ *    Socket cache slot or -1 if sockets should not be recycled.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static int TcpClientCacheSlot(
+    const struct addrinfo *localAddr)
+{
+    const IocpSockaddr *addrPtr = (const IocpSockaddr *) localAddr->ai_addr;
+
+    if (localAddr->ai_family == AF_INET) {
+        if (addrPtr->sa4.sin_port != 0 ||
+            addrPtr->sa4.sin_addr.s_addr != INADDR_ANY)
+            return -1;
+    } else if (localAddr->ai_family == AF_INET6) {
+        if (addrPtr->sa6.sin6_port != 0 ||
+            !IN6_IS_ADDR_UNSPECIFIED(&addrPtr->sa6.sin6_addr))
+            return -1;
+    }
+    return WinsockSocketCacheSlot(localAddr->ai_family, IOCP_SOCKET_CACHE_CONNECT);
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -213,7 +281,10 @@ static void TcpClientFinit(IocpChannel *chanPtr)
  *
  *    Posts a connect request to the IO completion port for a Tcp channel.
  *    The local and remote addresses are those specified in the tcpPtr
- *    localAddr and remoteAddr fields. Neither must be NULL.
+ *    localAddr and remoteAddr fields. Neither must be NULL. Any initial
+ *    data is passed to ConnectEx to be sent as soon as the connection is
+ *    established, or with the SYN if TCP Fast Open is enabled and
+ *    supported by both ends.
  *
  *    The function does not check or modify the connection state. That is
  *    the caller's responsibility.
@@ -237,10 +308,26 @@ static IocpWinError TcpClientPostConnect(
     DWORD           nbytes;
     DWORD           winError;
 
-    /* Bind local address. Required for ConnectEx */
+    /*
+     * Bind local address. Required for ConnectEx. Recycled sockets may
+     * still be bound to their previous (wildcard) local address.
+     */
     if (bind(tcpPtr->so, tcpPtr->addresses.inet.local->ai_addr,
              (int) tcpPtr->addresses.inet.local->ai_addrlen) != 0) {
-        return WSAGetLastError();
+        winError = WSAGetLastError();
+        if (winError != WSAEINVAL || !(tcpPtr->flags & IOCP_WINSOCK_RECYCLED))
+            return winError;
+    }
+
+    /*
+     * Failure to enable Fast Open (e.g. older Windows versions or disabled
+     * through netsh) is not an error. The connection simply proceeds with
+     * a normal handshake.
+     */
+    if (tcpPtr->flags & IOCP_WINSOCK_FASTOPEN) {
+        DWORD on = 1;
+        (void) setsockopt(tcpPtr->so, IPPROTO_TCP, TCP_FASTOPEN,
+                          (char *)&on, sizeof(on));
     }
 
     /*
@@ -256,20 +343,30 @@ static IocpWinError TcpClientPostConnect(
         fnConnectEx == NULL) {
         return WSAGetLastError();
     }
-    if (IocpAttachDefaultPort((HANDLE) tcpPtr->so) == NULL) {
+    if ((tcpPtr->flags & IOCP_WINSOCK_RECYCLED) == 0 &&
+        IocpChannelAttachPort(WinsockClientToIocpChannel(tcpPtr), (HANDLE) tcpPtr->so) == NULL) {
         return GetLastError(); /* NOT WSAGetLastError() ! */
     }
 
-    bufPtr = IocpBufferNew(0, IOCP_BUFFER_OP_CONNECT, IOCP_BUFFER_F_WINSOCK);
+    bufPtr = IocpBufferNew(tcpPtr->addresses.inet.initialDataLen,
+                           IOCP_BUFFER_OP_CONNECT, IOCP_BUFFER_F_WINSOCK);
     if (bufPtr == NULL)
         return WSAENOBUFS;
+    /* Copied since the channel's copy is freed when the connection is up */
+    if (tcpPtr->addresses.inet.initialDataLen) {
+        memcpy(bufPtr->data.bytes, tcpPtr->addresses.inet.initialData,
+               tcpPtr->addresses.inet.initialDataLen);
+        bufPtr->data.len = tcpPtr->addresses.inet.initialDataLen;
+    }
 
     bufPtr->chanPtr    = WinsockClientToIocpChannel(tcpPtr);
     tcpPtr->base.numRefs += 1; /* Reversed when buffer is unlinked from channel */
 
     if (fnConnectEx(tcpPtr->so, tcpPtr->addresses.inet.remote->ai_addr,
                     (int) tcpPtr->addresses.inet.remote->ai_addrlen,
-                    NULL, 0, &nbytes, &bufPtr->u.wsaOverlap) == FALSE) {
+                    bufPtr->data.len ? bufPtr->data.bytes : NULL,
+                    bufPtr->data.len, &nbytes,
+                    &bufPtr->u.wsaOverlap) == FALSE) {
         winError = WSAGetLastError();
         if (winError != WSA_IO_PENDING) {
             bufPtr->chanPtr = NULL;
@@ -288,7 +385,7 @@ static IocpWinError TcpClientPostConnect(
  *
  * TcpClientFreeAddresses --
  *
- *    Frees the address lists associated with a channel.
+ *    Frees the address lists and initial data associated with a channel.
  *
  *    Caller must ensure no other thread can access wsPtr during this call.
  *
@@ -315,6 +412,49 @@ static void TcpClientFreeAddresses(
         tcpPtr->addresses.inet.locals = NULL;
         tcpPtr->addresses.inet.local  = NULL;
     }
+    if (tcpPtr->addresses.inet.initialData) {
+        ckfree(tcpPtr->addresses.inet.initialData);
+        tcpPtr->addresses.inet.initialData    = NULL;
+        tcpPtr->addresses.inet.initialDataLen = 0;
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpClientSendInitialData --
+ *
+ *    Sends the initial data for a channel over a socket connected with
+ *    a blocking connect() as ConnectEx was not involved. The socket is
+ *    still in blocking mode at this point.
+ *
+ * Results:
+ *    0 on success, other Windows error code.
+ *
+ * Side effects:
+ *    The initial data is sent and freed.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError TcpClientSendInitialData(
+    WinsockClient *tcpPtr)  /* Caller must ensure exclusivity */
+{
+    const char *bytes = tcpPtr->addresses.inet.initialData;
+    int         remaining = tcpPtr->addresses.inet.initialDataLen;
+
+    while (remaining > 0) {
+        int nsent = send(tcpPtr->so, bytes, remaining, 0);
+        if (nsent == SOCKET_ERROR)
+            return WSAGetLastError();
+        bytes     += nsent;
+        remaining -= nsent;
+    }
+    if (tcpPtr->addresses.inet.initialData) {
+        ckfree(tcpPtr->addresses.inet.initialData);
+        tcpPtr->addresses.inet.initialData    = NULL;
+        tcpPtr->addresses.inet.initialDataLen = 0;
+    }
+    return ERROR_SUCCESS;
 }
 
 
@@ -381,15 +521,23 @@ static IocpWinError TcpClientBlockingConnect(
 
                 /* Sockets should not be inherited by children */
                 SetHandleInformation((HANDLE)so, HANDLE_FLAG_INHERIT, 0);
-                if (IocpAttachDefaultPort((HANDLE)so) != NULL) {
-                    tcpPtr->base.state = IOCP_STATE_OPEN;
+                if (IocpChannelAttachPort(WinsockClientToIocpChannel(tcpPtr), (HANDLE)so) != NULL) {
                     tcpPtr->so = so;
-                    /*
-                     * Clear any error stored during -async operation prior to
-                     * blocking connect
-                     */
-                    tcpPtr->base.winError = ERROR_SUCCESS;
-                    return ERROR_SUCCESS;
+                    winError = TcpClientSendInitialData(tcpPtr);
+                    if (winError == ERROR_SUCCESS) {
+                        tcpPtr->base.state = IOCP_STATE_OPEN;
+                        /* Sockets connected with connect() are not recycled */
+                        tcpPtr->cacheSlot = -1;
+                        tcpPtr->flags &= ~IOCP_WINSOCK_RECYCLED;
+                        /*
+                         * Clear any error stored during -async operation
+                         * prior to blocking connect
+                         */
+                        tcpPtr->base.winError = ERROR_SUCCESS;
+                        return ERROR_SUCCESS;
+                    }
+                    /* Connection unusable. Try next address. */
+                    tcpPtr->so = INVALID_SOCKET;
                 }
                 else
                     winError = GetLastError(); /* NOT WSAGetLastError */
@@ -459,8 +607,17 @@ TcpClientInitiateConnection(
 
             if (tcpPtr->addresses.inet.remote->ai_family != tcpPtr->addresses.inet.local->ai_family)
                 continue;
-            so = socket(tcpPtr->addresses.inet.local->ai_family, SOCK_STREAM, 0);
-            /* Note socket call, unlike WSASocket is overlapped by default */
+            tcpPtr->cacheSlot = TcpClientCacheSlot(tcpPtr->addresses.inet.local);
+            /* Cached sockets are all attached to the shared port */
+            so = tcpPtr->base.port == iocpModuleState.completion_port ?
+                WinsockSocketCacheGet(tcpPtr->cacheSlot) : INVALID_SOCKET;
+            if (so != INVALID_SOCKET) {
+                tcpPtr->flags |= IOCP_WINSOCK_RECYCLED;
+            } else {
+                tcpPtr->flags &= ~IOCP_WINSOCK_RECYCLED;
+                so = socket(tcpPtr->addresses.inet.local->ai_family, SOCK_STREAM, 0);
+                /* Note socket call, unlike WSASocket is overlapped by default */
+            }
 
             if (so != INVALID_SOCKET) {
                 /* Sockets should not be inherited by children */
@@ -496,6 +653,36 @@ TcpClientInitiateConnection(
     return tcpPtr->base.winError;
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpClientAsyncConnected --
+ *
+ *    Called to handle connection establishment on an async attempt.
+ *    Follows the API defined by connected() in IocpChannel vtbl.
+ *
+ * Results:
+ *    Returns 0 if connection set up is successful or a Windows error code
+ *    which is also stored in lockedChanPtr->winError.
+ *
+ * Side effects:
+ *    The initial data, already sent by ConnectEx, is freed.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError TcpClientAsyncConnected(
+    IocpChannel *lockedChanPtr) /* Must be locked on entry. */
+{
+    WinsockClient *tcpPtr = IocpChannelToWinsockClient(lockedChanPtr);
+
+    if (tcpPtr->addresses.inet.initialData) {
+        ckfree(tcpPtr->addresses.inet.initialData);
+        tcpPtr->addresses.inet.initialData    = NULL;
+        tcpPtr->addresses.inet.initialDataLen = 0;
+    }
+    return WinsockClientAsyncConnected(lockedChanPtr);
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -550,9 +737,13 @@ Iocp_OpenTcpClient(
     const char *host,		/* Host on which to open port. */
     const char *myaddr,		/* Client-side address */
     int myport,			/* Client-side port */
-    int async)			/* If nonzero, attempt to do an asynchronous
+    int async,			/* If nonzero, attempt to do an asynchronous
                  * connect. Otherwise we do a blocking
                  * connect. */
+    int fastopen,               /* If nonzero, use TCP Fast Open for
+                                 * asynchronous connects */
+    const char *initialData,    /* Data to send on connecting. May be NULL */
+    int initialDataLen)         /* Length of initialData */
 {
     const char *errorMsg = NULL;
     struct addrinfo *remoteAddrs = NULL, *localAddrs = NULL;
@@ -602,6 +793,13 @@ Iocp_OpenTcpClient(
     tcpPtr->addresses.inet.remote  = remoteAddrs; /* First in remote address list */
     tcpPtr->addresses.inet.locals  = localAddrs;
     tcpPtr->addresses.inet.local   = localAddrs;  /* First in local address list */
+    if (initialDataLen > 0) {
+        tcpPtr->addresses.inet.initialData = ckalloc(initialDataLen);
+        memcpy(tcpPtr->addresses.inet.initialData, initialData, initialDataLen);
+        tcpPtr->addresses.inet.initialDataLen = initialDataLen;
+    }
+    if (fastopen)
+        tcpPtr->flags |= IOCP_WINSOCK_FASTOPEN;
 
     IocpChannelLock(WinsockClientToIocpChannel(tcpPtr));
     if (async) {
@@ -750,6 +948,12 @@ static void TcpListenerInit(IocpChannel *chanPtr)
     TcpListener *tcpPtr = IocpChannelToTcpListener(chanPtr);
     tcpPtr->numListeners = 0;
     tcpPtr->listeners = NULL;
+    tcpPtr->acceptReceive = 0;
+    tcpPtr->minAcceptPosts = IOCP_TCP_MIN_ACCEPTS_DEFAULT;
+    tcpPtr->maxAcceptPosts = IOCP_TCP_MAX_ACCEPTS_DEFAULT;
+    tcpPtr->adaptTimer = NULL;
+    tcpPtr->clientVtblPtr = &tcpClientVtbl;
+    tcpPtr->clientPrefix = IOCP_INET_NAME_PREFIX;
 }
 
 /*
@@ -808,6 +1012,11 @@ static int TcpListenerShutdown(
     int          flags)         /* Combination of TCL_CLOSE_{READ,WRITE} */
 {
     TcpListener *lockedTcpPtr = IocpChannelToTcpListener(lockedChanPtr);
+    /* Called from the owning thread so the timer can be deleted here */
+    if (lockedTcpPtr->adaptTimer) {
+        Tcl_DeleteTimerHandler(lockedTcpPtr->adaptTimer);
+        lockedTcpPtr->adaptTimer = NULL;
+    }
     TcpListenerCloseSockets(lockedTcpPtr);
     return 0;
 }
@@ -856,6 +1065,9 @@ IocpWinError TcpListenerAccept(
         SOCKADDR   *localAddrPtr, *remoteAddrPtr;
         int         localAddrLen, remoteAddrLen;
         int         listenerIndex = bufPtr->context[1].i;
+        int         recycled = bufPtr->flags & IOCP_BUFFER_F_RECYCLED;
+        int         cacheSlot;
+        int         receiveLen;
         WinsockClient  *dataChanPtr;
         Tcl_Channel channel;
         TcpListeningSocket *listenerPtr;
@@ -881,15 +1093,43 @@ IocpWinError TcpListenerAccept(
 
         IOCP_ASSERT(listenerPtr->pendingAcceptPosts > 0);
         listenerPtr->pendingAcceptPosts -= 1;
+        listenerPtr->acceptCount += 1;
+        if (listenerPtr->pendingAcceptPosts == 0) {
+            /*
+             * All posted accepts were used up before we could replace
+             * them. Grow right away so bursts do not spill into the
+             * listen backlog. Shrinking is done in TcpListenerAdaptTimer.
+             */
+            listenerPtr->drainCount += 1;
+            if (listenerPtr->maxPendingAcceptPosts < lockedTcpPtr->maxAcceptPosts) {
+                listenerPtr->maxPendingAcceptPosts =
+                    min(2 * listenerPtr->maxPendingAcceptPosts,
+                        lockedTcpPtr->maxAcceptPosts);
+            }
+        }
 
         /* connSocket is the socket for a new connection. */
         connSocket  = bufPtr->context[0].so;
         bufPtr->context[0].so = INVALID_SOCKET;
 
+        if (bufPtr->winError != ERROR_SUCCESS) {
+            /*
+             * Connection reset before it was accepted or, with -acceptreceive,
+             * before the first data arrived. Just replace the accept.
+             */
+            closesocket(connSocket);
+            IocpBufferFree(bufPtr);
+            TcpListenerPostAccepts(lockedTcpPtr, listenerIndex);
+            continue;
+        }
+
+        /* Length of data area requested from AcceptEx. See TcpListenerPostAccepts */
+        receiveLen = bufPtr->data.capacity - sizeof(TcpAcceptBuffer);
+
         /* Retrieve the connection addresses */
         listenerPtr->_GetAcceptExSockaddrs(
             bufPtr->data.bytes,
-            0,
+            receiveLen,
             IOCP_ACCEPT_ADDRESS_LEN,
             IOCP_ACCEPT_ADDRESS_LEN,
             &localAddrPtr, &localAddrLen,
@@ -912,29 +1152,58 @@ IocpWinError TcpListenerAccept(
                    SO_UPDATE_ACCEPT_CONTEXT, (char *)&listenerPtr->so,
                    sizeof(SOCKET));
 
-        /* TBD - reuse the buffer for the next accept. May use outputBuffers as queue */
-        IocpBufferFree(bufPtr);
-        bufPtr = NULL;
+        cacheSlot = WinsockSocketCacheSlot(listenerPtr->aiFamily,
+                                           IOCP_SOCKET_CACHE_ACCEPT);
+
+        if (receiveLen == 0) {
+            /* TBD - reuse the buffer for the next accept. May use outputBuffers as queue */
+            IocpBufferFree(bufPtr);
+            bufPtr = NULL;
+        } else {
+            /*
+             * The buffer holds the first data received on the connection
+             * and becomes the first input buffer of the new channel. Zero
+             * bytes indicates the peer closed without sending.
+             */
+            bufPtr->operation  = IOCP_BUFFER_OP_READ;
+            bufPtr->data.begin = 0;
+        }
 
- 
-    if (IocpAttachDefaultPort((HANDLE) connSocket) == NULL) {
+        /*
+         * Accepted sockets use the listener's completion port. Recycled
+         * sockets are already attached to it.
+         */
+        if (!recycled &&
+            IocpChannelAttachPort(TcpListenerToIocpChannel(lockedTcpPtr),
+                                  (HANDLE) connSocket) == NULL) {
             /* TBD - notify background error ? */
             closesocket(connSocket);
+            if (bufPtr)
+                IocpBufferFree(bufPtr);
             continue;
         }
 
-        dataChanPtr = (WinsockClient *) IocpChannelNew(&tcpClientVtbl);
+        dataChanPtr = (WinsockClient *) IocpChannelNew(lockedTcpPtr->clientVtblPtr);
         if (dataChanPtr == NULL) {
             /* TBD - notify background error ? */
             closesocket(connSocket);
+            if (bufPtr)
+                IocpBufferFree(bufPtr);
             continue;
         }
+        dataChanPtr->base.port = lockedTcpPtr->base.port;
         dataChanPtr->so = connSocket;
+        dataChanPtr->cacheSlot = cacheSlot;
         dataChanPtr->base.state = IOCP_STATE_OPEN;
+        if (bufPtr) {
+            /* Channel not visible to the completion thread yet, no lock needed */
+            IocpChannelQueueInput(WinsockClientToIocpChannel(dataChanPtr), bufPtr);
+            bufPtr = NULL;
+        }
 
         /* Create a new open channel */
         channel = IocpCreateTclChannel(WinsockClientToIocpChannel(dataChanPtr),
-                                       IOCP_INET_NAME_PREFIX,
+                                       lockedTcpPtr->clientPrefix,
                                        (TCL_READABLE | TCL_WRITABLE));
 
         /*
@@ -988,8 +1257,18 @@ IocpWinError TcpListenerAccept(
         /* Invoke the server callbacks */
         if (lockedTcpPtr->acceptProc != NULL) {
             char host[NI_MAXHOST], port[NI_MAXSERV];
-            getnameinfo(&remoteAddr.sa, remoteAddrLen, host, sizeof(host),
-                        port, sizeof(port), NI_NUMERICHOST|NI_NUMERICSERV);
+            if (remoteAddr.sa.sa_family == AF_UNIX) {
+                /* Peer path. Usually empty as clients are rarely bound */
+                WinsockUnixPath(&remoteAddr, remoteAddrLen, host, sizeof(host));
+                port[0] = '0';
+                port[1] = '\0';
+            } else if (getnameinfo(&remoteAddr.sa, remoteAddrLen, host,
+                                   sizeof(host), port, sizeof(port),
+                                   NI_NUMERICHOST|NI_NUMERICSERV) != 0) {
+                host[0] = '\0';
+                port[0] = '0';
+                port[1] = '\0';
+            }
             /*
              * Need to unlock before calling acceptProc as that can recurse
              * and call us back to close the channel.
@@ -1007,9 +1286,90 @@ IocpWinError TcpListenerAccept(
         }
 
     }
+
+    /* Callbacks may have closed the listener so check state */
+    if (lockedChanPtr->state == IOCP_STATE_LISTENING &&
+        lockedTcpPtr->listeners != NULL &&
+        lockedTcpPtr->minAcceptPosts < lockedTcpPtr->maxAcceptPosts &&
+        lockedTcpPtr->adaptTimer == NULL) {
+        lockedTcpPtr->adaptTimer =
+            Tcl_CreateTimerHandler(IOCP_TCP_ADAPT_INTERVAL_MS,
+                                   TcpListenerAdaptTimer, lockedTcpPtr);
+    }
     return 0;
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpListenerAdaptTimer --
+ *
+ *    Timer callback that adjusts the number of accepts posted on each
+ *    listening socket based on the accept activity in the last interval.
+ *    Listening sockets whose posted accepts were never used up and which
+ *    saw fewer accepts than posted are shrunk by half down to the
+ *    configured minimum.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The timer is rescheduled while there is accept activity or the
+ *    depth is above the minimum. Accepts in excess of a reduced depth
+ *    are left pending. They are not replaced by TcpListenerAccept as
+ *    they complete so the surplus drains with incoming connections.
+ *
+ *------------------------------------------------------------------------
+ */
+static void TcpListenerAdaptTimer(ClientData clientData)
+{
+    TcpListener *tcpPtr = (TcpListener *) clientData;
+    int          listenerIndex;
+    int          reschedule = 0;
+
+    /*
+     * The listener is valid as TcpListenerShutdown deletes the timer
+     * before the channel can be freed.
+     */
+    IocpChannelLock(TcpListenerToIocpChannel(tcpPtr));
+    tcpPtr->adaptTimer = NULL;
+    if (tcpPtr->base.state != IOCP_STATE_LISTENING || tcpPtr->listeners == NULL) {
+        IocpChannelUnlock(TcpListenerToIocpChannel(tcpPtr));
+        return;
+    }
+
+    for (listenerIndex = 0; listenerIndex < tcpPtr->numListeners; ++listenerIndex) {
+        TcpListeningSocket *listenerPtr = &tcpPtr->listeners[listenerIndex];
+        if (listenerPtr->so == INVALID_SOCKET)
+            continue;
+        if (listenerPtr->acceptCount)
+            reschedule = 1;
+        if (listenerPtr->drainCount == 0 &&
+            listenerPtr->acceptCount < listenerPtr->maxPendingAcceptPosts &&
+            listenerPtr->maxPendingAcceptPosts > tcpPtr->minAcceptPosts) {
+            /*
+             * The surplus is not cancelled as CancelIoEx on the listening
+             * socket would cancel all posted accepts and not just the
+             * surplus, leaving none to take connections until reposted.
+             */
+            listenerPtr->maxPendingAcceptPosts =
+                max(listenerPtr->maxPendingAcceptPosts / 2,
+                    tcpPtr->minAcceptPosts);
+        }
+        if (listenerPtr->maxPendingAcceptPosts > tcpPtr->minAcceptPosts)
+            reschedule = 1;
+        listenerPtr->acceptCount = 0;
+        listenerPtr->drainCount  = 0;
+    }
+
+    if (reschedule) {
+        tcpPtr->adaptTimer =
+            Tcl_CreateTimerHandler(IOCP_TCP_ADAPT_INTERVAL_MS,
+                                   TcpListenerAdaptTimer, tcpPtr);
+    }
+    IocpChannelUnlock(TcpListenerToIocpChannel(tcpPtr));
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -1045,22 +1405,40 @@ static IocpWinError TcpListenerPostAccepts(
         IocpBuffer *bufPtr;
         SOCKET      so;
         DWORD       nbytes;
-
-        so = socket(listenerPtr->aiFamily,
-                    listenerPtr->aiSocktype, listenerPtr->aiProtocol);
-        if (so == INVALID_SOCKET) {
-            winError = WSAGetLastError();
-            break;
+        int         recycled = 0;
+
+        /* Cached sockets are all attached to the shared port */
+        so = lockedTcpPtr->base.port != iocpModuleState.completion_port ?
+            INVALID_SOCKET :
+            WinsockSocketCacheGet(
+                WinsockSocketCacheSlot(listenerPtr->aiFamily, IOCP_SOCKET_CACHE_ACCEPT));
+        if (so != INVALID_SOCKET) {
+            recycled = 1;
+        } else {
+            so = socket(listenerPtr->aiFamily,
+                        listenerPtr->aiSocktype, listenerPtr->aiProtocol);
+            if (so == INVALID_SOCKET) {
+                winError = WSAGetLastError();
+                break;
+            }
+            /* Do not pass on to children */
+            SetHandleInformation((HANDLE)so, HANDLE_FLAG_INHERIT, 0);
         }
-        /* Do not pass on to children */
-        SetHandleInformation((HANDLE)so, HANDLE_FLAG_INHERIT, 0);
 
-        bufPtr = IocpBufferNew(sizeof(TcpAcceptBuffer),
+        /*
+         * Any data received with the accept is placed at the front of the
+         * buffer, followed by the addresses. TcpListenerAccept derives the
+         * receive length from the buffer capacity.
+         */
+        bufPtr = IocpBufferNew(lockedTcpPtr->acceptReceive + sizeof(TcpAcceptBuffer),
                                IOCP_BUFFER_OP_ACCEPT, IOCP_BUFFER_F_WINSOCK);
         if (bufPtr == NULL) {
+            closesocket(so);
             winError = ERROR_NOT_ENOUGH_MEMORY;
             break;
         }
+        if (recycled)
+            bufPtr->flags |= IOCP_BUFFER_F_RECYCLED;
 
         /* The buffer needs to hold context of the listening socket */
         bufPtr->context[0].so = so;
@@ -1072,7 +1450,7 @@ static IocpWinError TcpListenerPostAccepts(
                 listenerPtr->so, /* Listening socket */
                 so,              /* Socket used for new connection */
                 bufPtr->data.bytes, /* Pointer to data area */
-                0,                  /* Number of data bytes to read */
+                lockedTcpPtr->acceptReceive, /* Number of data bytes to read */
                 IOCP_ACCEPT_ADDRESS_LEN, /* Size of local address */
                 IOCP_ACCEPT_ADDRESS_LEN, /* Size of remote address */
                 &nbytes,                  /* Not used */
@@ -1179,7 +1557,7 @@ static IocpWinError IocpTcpListen(
     }
 
     /* Attach to completion port */
-    if (IocpAttachDefaultPort((HANDLE)so) == NULL) {
+    if (IocpChannelAttachPort(TcpListenerToIocpChannel(tcpPtr), (HANDLE)so) == NULL) {
         winError = GetLastError();
         closesocket(so);
         return winError;
@@ -1205,7 +1583,11 @@ static IocpWinError IocpTcpListen(
     tcpPtr->listeners[listenerIndex].aiSocktype = addrPtr->ai_socktype;
     tcpPtr->listeners[listenerIndex].aiProtocol = addrPtr->ai_protocol;
     tcpPtr->listeners[listenerIndex].pendingAcceptPosts     = 0;
-    tcpPtr->listeners[listenerIndex].maxPendingAcceptPosts  = IOCP_WINSOCK_MAX_ACCEPTS;
+    tcpPtr->listeners[listenerIndex].maxPendingAcceptPosts  =
+        max(min(IOCP_WINSOCK_MAX_ACCEPTS, tcpPtr->maxAcceptPosts),
+            tcpPtr->minAcceptPosts);
+    tcpPtr->listeners[listenerIndex].acceptCount            = 0;
+    tcpPtr->listeners[listenerIndex].drainCount             = 0;
     tcpPtr->numListeners += 1;
     return 0;
 }
@@ -1301,6 +1683,29 @@ IocpTclCode TcpListenerGetOption(
                   "%d", lockedTcpPtr->listeners[0].maxPendingAcceptPosts);
         Tcl_DStringAppend(dsPtr, integerSpace, -1);
         return TCL_OK;
+    case IOCP_WINSOCK_OPT_ACCEPTRECEIVE:
+        sprintf_s(integerSpace, sizeof(integerSpace),
+                  "%d", lockedTcpPtr->acceptReceive);
+        Tcl_DStringAppend(dsPtr, integerSpace, -1);
+        return TCL_OK;
+    case IOCP_WINSOCK_OPT_ACCEPTRANGE:
+        sprintf_s(integerSpace, sizeof(integerSpace), "%d %d",
+                  lockedTcpPtr->minAcceptPosts, lockedTcpPtr->maxAcceptPosts);
+        Tcl_DStringAppend(dsPtr, integerSpace, -1);
+        return TCL_OK;
+    case IOCP_WINSOCK_OPT_FRAMING:
+    case IOCP_WINSOCK_OPT_READDELIMITER:
+    case IOCP_WINSOCK_OPT_READRECORDS:
+    case IOCP_WINSOCK_OPT_RCVLOWAT:
+    case IOCP_WINSOCK_OPT_RATELIMIT:
+    case IOCP_WINSOCK_OPT_TLS:
+    case IOCP_WINSOCK_OPT_TLSSTATUS:
+    case IOCP_WINSOCK_OPT_COMPRESS:
+    case IOCP_WINSOCK_OPT_COMPRESSSTATS:
+    case IOCP_WINSOCK_OPT_PRIORITY:
+        /* Client only. Error so it is left out of the option list */
+        return Tcl_BadChannelOption(interp, iocpWinsockOptionNames[opt],
+                                    "-acceptrange -acceptreceive -maxpendingaccepts");
     default:
         if (interp) {
             Tcl_SetObjResult(interp, Tcl_ObjPrintf("Internal error: invalid socket option index %d", opt));
@@ -1309,6 +1714,45 @@ IocpTclCode TcpListenerGetOption(
     }
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpListenerSetAcceptRange --
+ *
+ *    Sets the bounds within which the number of accepts posted on each
+ *    listening socket is adapted and clamps the current depths to them.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    Accepts in excess of a reduced depth are left to drain as they are
+ *    not replaced on completion. See TcpListenerAdaptTimer. Additional
+ *    accepts are posted when the depth is raised.
+ *
+ *------------------------------------------------------------------------
+ */
+static void TcpListenerSetAcceptRange(
+    TcpListener *lockedTcpPtr,  /* Locked on entry, locked on exit */
+    int          minValue,      /* Lower bound on accept depth */
+    int          maxValue)      /* Upper bound on accept depth */
+{
+    int listenerIndex;
+
+    lockedTcpPtr->minAcceptPosts = minValue;
+    lockedTcpPtr->maxAcceptPosts = maxValue;
+    for (listenerIndex = 0; listenerIndex < lockedTcpPtr->numListeners; ++listenerIndex) {
+        TcpListeningSocket *listenerPtr = &lockedTcpPtr->listeners[listenerIndex];
+        if (listenerPtr->maxPendingAcceptPosts > maxValue) {
+            listenerPtr->maxPendingAcceptPosts = maxValue;
+        } else if (listenerPtr->maxPendingAcceptPosts < minValue) {
+            listenerPtr->maxPendingAcceptPosts = minValue;
+            if (listenerPtr->so != INVALID_SOCKET)
+                TcpListenerPostAccepts(lockedTcpPtr, listenerIndex);
+        }
+    }
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -1346,14 +1790,55 @@ static IocpTclCode TcpListenerSetOption(
             Tcl_SetErrno(EINVAL);
             return TCL_ERROR;
         }
-        if (intValue <= 0 || intValue > 20) {
+        if (intValue <= 0 || intValue > IOCP_TCP_MAX_ACCEPTS_LIMIT) {
             if (interp)
                 Tcl_SetObjResult(interp, Tcl_ObjPrintf("Integer value %d out of range.", intValue));
             Tcl_SetErrno(EINVAL);
             return TCL_ERROR;
         }
-        for (listenerIndex = 0; listenerIndex < lockedTcpPtr->numListeners; ++listenerIndex) {
-            lockedTcpPtr->listeners[listenerIndex].maxPendingAcceptPosts = intValue;
+        /* An explicit count fixes the depth, disabling adaptation */
+        TcpListenerSetAcceptRange(lockedTcpPtr, intValue, intValue);
+        return TCL_OK;
+    case IOCP_WINSOCK_OPT_ACCEPTRANGE:
+        {
+            int minValue, maxValue;
+            if (sscanf_s(valuePtr, "%d %d", &minValue, &maxValue) != 2 ||
+                minValue <= 0 || minValue > maxValue ||
+                maxValue > IOCP_TCP_MAX_ACCEPTS_LIMIT) {
+                if (interp)
+                    Tcl_SetObjResult(
+                        interp,
+                        Tcl_ObjPrintf("Invalid accept range \"%s\". Must be a "
+                                      "list of two integers MIN and MAX with "
+                                      "0 < MIN <= MAX <= %d.",
+                                      valuePtr, IOCP_TCP_MAX_ACCEPTS_LIMIT));
+                Tcl_SetErrno(EINVAL);
+                return TCL_ERROR;
+            }
+            TcpListenerSetAcceptRange(lockedTcpPtr, minValue, maxValue);
+        }
+        return TCL_OK;
+    case IOCP_WINSOCK_OPT_ACCEPTRECEIVE:
+        if (Tcl_GetInt(interp, valuePtr, &intValue) != TCL_OK) {
+            Tcl_SetErrno(EINVAL);
+            return TCL_ERROR;
+        }
+        if (intValue < 0 || intValue > IOCP_TCP_MAX_ACCEPT_RECEIVE) {
+            if (interp)
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Integer value %d out of range.", intValue));
+            Tcl_SetErrno(EINVAL);
+            return TCL_ERROR;
+        }
+        if (intValue != lockedTcpPtr->acceptReceive) {
+            lockedTcpPtr->acceptReceive = intValue;
+            /*
+             * Cancel accepts already posted with the old size. They complete
+             * with an error and are reposted by TcpListenerAccept.
+             */
+            for (listenerIndex = 0; listenerIndex < lockedTcpPtr->numListeners; ++listenerIndex) {
+                if (lockedTcpPtr->listeners[listenerIndex].so != INVALID_SOCKET)
+                    CancelIoEx((HANDLE) lockedTcpPtr->listeners[listenerIndex].so, NULL);
+            }
         }
         return TCL_OK;
     case IOCP_WINSOCK_OPT_CONNECTING:
@@ -1364,7 +1849,17 @@ static IocpTclCode TcpListenerSetOption(
     case IOCP_WINSOCK_OPT_MAXPENDINGWRITES:
     case IOCP_WINSOCK_OPT_SOSNDBUF:
     case IOCP_WINSOCK_OPT_SORCVBUF:
-        return Tcl_BadChannelOption(interp, iocpWinsockOptionNames[opt], "-maxpendingaccepts");
+    case IOCP_WINSOCK_OPT_FRAMING:
+    case IOCP_WINSOCK_OPT_READDELIMITER:
+    case IOCP_WINSOCK_OPT_READRECORDS:
+    case IOCP_WINSOCK_OPT_RCVLOWAT:
+    case IOCP_WINSOCK_OPT_RATELIMIT:
+    case IOCP_WINSOCK_OPT_TLS:
+    case IOCP_WINSOCK_OPT_TLSSTATUS:
+    case IOCP_WINSOCK_OPT_COMPRESS:
+    case IOCP_WINSOCK_OPT_COMPRESSSTATS:
+    case IOCP_WINSOCK_OPT_PRIORITY:
+        return Tcl_BadChannelOption(interp, iocpWinsockOptionNames[opt], "-acceptrange -acceptreceive -maxpendingaccepts");
     default:
         if (interp)
             Tcl_SetObjResult(interp, Tcl_ObjPrintf("Internal error: invalid socket option index %d", opt));
@@ -1377,65 +1872,44 @@ static IocpTclCode TcpListenerSetOption(
 /*
  *----------------------------------------------------------------------
  *
- * IocpOpenTcpServer --
+ * WinsockListenerOpen --
  *
- *	Opens a TCP server socket and creates a channel around it.
+ *	Opens listening sockets on the passed addresses and creates a
+ *	channel around them. Connections are accepted with AcceptEx and
+ *	wrapped in channels of the type specified by clientVtblPtr.
  *
  * Results:
  *	The channel or NULL if failed. If an error occurred, an error message
  *	is left in the interp's result if interp is not NULL.
  *
  * Side effects:
- *	Opens a server socket and creates a new channel.
+ *	Opens server sockets and creates a new channel. The caller retains
+ *	ownership of localAddrs.
  *
  *----------------------------------------------------------------------
  */
-
 Tcl_Channel
-Iocp_OpenTcpServer(
-    Tcl_Interp *interp,		/* For error reporting - may be NULL. */
-    int port,			/* Port number to open. */
-    const char *myHost,		/* Name of local host. */
-    Tcl_TcpAcceptProc *acceptProc,
-                /* Callback for accepting connections from new
-                 * clients. */
-    ClientData acceptProcData)	/* Data for the callback. */
+WinsockListenerOpen(
+    Tcl_Interp      *interp,         /* For error reporting - may be NULL. */
+    struct addrinfo *localAddrs,     /* Addresses to listen on */
+    int              port,           /* Port number specified by caller.
+                                      * -1 for address families without
+                                      * ports */
+    IocpChannelVtbl *clientVtblPtr,  /* Vtbl for accepted connections */
+    const char      *clientPrefix,   /* Channel name prefix for accepted
+                                      * connections and the listener */
+    Tcl_TcpAcceptProc *acceptProc,   /* Callback for accepting connections
+                                      * from new clients. */
+    ClientData       acceptProcData) /* Data for the callback. */
 {
-    const char      *errorMsg   = NULL;
     TcpListener     *tcpPtr = NULL;
     Tcl_Channel      channel;
     IocpWinError     winError;
-    struct addrinfo *localAddrs = NULL;
     struct addrinfo *addrPtr;
     int              nsockets;
     int              chosenPort = 0;
     int              i;
 
-#ifdef TBD
-
-    if (TclpHasSockets(interp) != TCL_OK) {
-        return NULL;
-    }
-
-    /*
-     * Check that WinSock is initialized; do not call it if not, to prevent
-     * system crashes. This can happen at exit time if the exit handler for
-     * WinSock ran before other exit handlers that want to use sockets.
-     */
-
-    if (!SocketsEnabled()) {
-        return NULL;
-    }
-#endif
-
-    if (!TclCreateSocketAddress(interp, &localAddrs, myHost, port, 1, &errorMsg)) {
-        if (interp != NULL) {
-            Tcl_SetObjResult(interp, Tcl_ObjPrintf(
-                                 "couldn't resolve local addresses: %s", errorMsg));
-        }
-        goto fail;
-    }
-
     tcpPtr = (TcpListener *) IocpChannelNew(&tcpListenerVtbl);
     if (tcpPtr == NULL) {
         if (interp != NULL) {
@@ -1443,6 +1917,8 @@ Iocp_OpenTcpServer(
         }
         goto fail;
     }
+    tcpPtr->clientVtblPtr = clientVtblPtr;
+    tcpPtr->clientPrefix  = clientPrefix;
 
     for (nsockets = 0, addrPtr = localAddrs; addrPtr; addrPtr = addrPtr->ai_next) {
         ++nsockets;
@@ -1479,8 +1955,6 @@ Iocp_OpenTcpServer(
         }
     }
     }
-    freeaddrinfo(localAddrs);
-    localAddrs = NULL;          /* To prevent double frees in case of errors */
 
     if (tcpPtr->numListeners == 0) {
         /* No addresses could be bound. Report the last error */
@@ -1519,7 +1993,7 @@ Iocp_OpenTcpServer(
      */
     IocpChannelUnlock(TcpListenerToIocpChannel(tcpPtr));
     channel = IocpCreateTclChannel(TcpListenerToIocpChannel(tcpPtr),
-                                   IOCP_INET_NAME_PREFIX,
+                                   clientPrefix,
                                    0);
     if (channel == NULL)  {
         goto fail;
@@ -1547,8 +2021,6 @@ Iocp_OpenTcpServer(
     return channel;
 
 fail: /* tcpPtr must NOT be locked, interp must contain error message already */
-    if (localAddrs)
-        freeaddrinfo(localAddrs);
     /* We'll just let any allocated sockets be freed when the tcpPtr is freed */
     if (tcpPtr) {
         IocpChannel *chanPtr = TcpListenerToIocpChannel(tcpPtr);
@@ -1561,6 +2033,71 @@ fail: /* tcpPtr must NOT be locked, interp must contain error message already */
 
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * IocpOpenTcpServer --
+ *
+ *	Opens a TCP server socket and creates a channel around it.
+ *
+ * Results:
+ *	The channel or NULL if failed. If an error occurred, an error message
+ *	is left in the interp's result if interp is not NULL.
+ *
+ * Side effects:
+ *	Opens a server socket and creates a new channel.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tcl_Channel
+Iocp_OpenTcpServer(
+    Tcl_Interp *interp,		/* For error reporting - may be NULL. */
+    int port,			/* Port number to open. */
+    const char *myHost,		/* Name of local host. */
+    Tcl_TcpAcceptProc *acceptProc,
+                /* Callback for accepting connections from new
+                 * clients. */
+    ClientData acceptProcData)	/* Data for the callback. */
+{
+    const char      *errorMsg   = NULL;
+    Tcl_Channel      channel;
+    struct addrinfo *localAddrs = NULL;
+
+#ifdef TBD
+
+    if (TclpHasSockets(interp) != TCL_OK) {
+        return NULL;
+    }
+
+    /*
+     * Check that WinSock is initialized; do not call it if not, to prevent
+     * system crashes. This can happen at exit time if the exit handler for
+     * WinSock ran before other exit handlers that want to use sockets.
+     */
+
+    if (!SocketsEnabled()) {
+        return NULL;
+    }
+#endif
+
+    if (!TclCreateSocketAddress(interp, &localAddrs, myHost, port, 1, &errorMsg)) {
+        if (interp != NULL) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+                                 "couldn't resolve local addresses: %s", errorMsg));
+        }
+        if (localAddrs)
+            freeaddrinfo(localAddrs);
+        return NULL;
+    }
+
+    channel = WinsockListenerOpen(interp, localAddrs, port, &tcpClientVtbl,
+                                  IOCP_INET_NAME_PREFIX, acceptProc,
+                                  acceptProcData);
+    freeaddrinfo(localAddrs);
+    return channel;
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -1585,13 +2122,14 @@ Tcp_SocketObjCmd (
     Tcl_Obj *CONST objv[])		/* Argument objects. */
 {
     static const char *const socketOptions[] = {
-    "-async", "-myaddr", "-myport", "-server", NULL
+    "-async", "-fastopen", "-initialdata", "-myaddr", "-myport", "-server", NULL
     };
     enum socketOptions {
-    SKT_ASYNC, SKT_MYADDR, SKT_MYPORT, SKT_SERVER
+    SKT_ASYNC, SKT_FASTOPEN, SKT_INITIALDATA, SKT_MYADDR, SKT_MYPORT, SKT_SERVER
     };
-    int optionIndex, a, server = 0, port, myport = 0, async = 0;
+    int optionIndex, a, server = 0, port, myport = 0, async = 0, fastopen = 0;
     const char *host, *script = NULL, *myaddr = NULL;
+    Tcl_Obj *initialDataObj = NULL;
     Tcl_Channel chan;
 
 #ifdef TBD
@@ -1619,6 +2157,18 @@ Tcp_SocketObjCmd (
         }
         async = 1;
         break;
+    case SKT_FASTOPEN:
+        fastopen = 1;
+        break;
+    case SKT_INITIALDATA:
+        a++;
+        if (a >= objc) {
+        Tcl_SetObjResult(interp, Tcl_NewStringObj(
+            "no argument given for -initialdata option", -1));
+        return TCL_ERROR;
+        }
+        initialDataObj = objv[a];
+        break;
     case SKT_MYADDR:
         a++;
         if (a >= objc) {
@@ -1669,6 +2219,12 @@ Tcp_SocketObjCmd (
             "option -myport is not valid for servers", -1));
         return TCL_ERROR;
     }
+    if (fastopen || initialDataObj) {
+        Tcl_SetObjResult(interp, Tcl_NewStringObj(
+            fastopen ? "option -fastopen is not valid for servers"
+                     : "option -initialdata is not valid for servers", -1));
+        return TCL_ERROR;
+    }
     } else if (a < objc) {
     host = TclGetString(objv[a]);
     a++;
@@ -1679,10 +2235,10 @@ Tcp_SocketObjCmd (
          * Hard code to match Tcl socket error. Can't use code below because
          * it uses internal Tcl structures.
          */
-        Tcl_SetResult(interp, "wrong # args: should be \"socket ?-myaddr addr? ?-myport myport? ?-async? host port\" or \"socket -server command ?-myaddr addr? port\"", TCL_STATIC);
+        Tcl_SetResult(interp, "wrong # args: should be \"socket ?-myaddr addr? ?-myport myport? ?-async? ?-fastopen? ?-initialdata data? host port\" or \"socket -server command ?-myaddr addr? port\"", TCL_STATIC);
 #else
     Tcl_WrongNumArgs(interp, 1, objv,
-        "?-myaddr addr? ?-myport myport? ?-async? host port");
+        "?-myaddr addr? ?-myport myport? ?-async? ?-fastopen? ?-initialdata data? host port");
     ((Interp *)interp)->flags |= INTERP_ALTERNATE_WRONG_ARGS;
     Tcl_WrongNumArgs(interp, 1, objv,
         "-server command ?-myaddr addr? port");
@@ -1738,7 +2294,20 @@ Tcp_SocketObjCmd (
                                acceptCallbackPtr);
 
     } else {
-    chan = Iocp_OpenTcpClient(interp, port, host, myaddr, myport, async);
+    const char *initialData = NULL;
+    IocpSizeT   initialDataLen = 0;
+    if (initialDataObj) {
+        initialData = (const char *)
+            Tcl_GetByteArrayFromObj(initialDataObj, &initialDataLen);
+        /* Must fit in a single ConnectEx send buffer */
+        if (initialDataLen > IOCP_TCP_MAX_INITIAL_DATA) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+            "initial data exceeds %d bytes", IOCP_TCP_MAX_INITIAL_DATA));
+        return TCL_ERROR;
+        }
+    }
+    chan = Iocp_OpenTcpClient(interp, port, host, myaddr, myport, async,
+                              fastopen, initialData, (int) initialDataLen);
     if (chan == NULL) {
         return TCL_ERROR;
     }
@@ -1749,6 +2318,572 @@ Tcp_SocketObjCmd (
     return TCL_OK;
 }
 
+/*
+ * State for an iocp::inet::sendfile operation. Pointed to from the context
+ * area of the IOCP_BUFFER_OP_TRANSMIT buffer posted to TransmitFile. The
+ * header and trailer bytes are stored in the buffer's data area.
+ */
+typedef struct TcpSendfile {
+    TRANSMIT_FILE_BUFFERS tfb;  /* Header and trailer passed to TransmitFile */
+    HANDLE        hFile;        /* File being transmitted */
+    Tcl_Interp   *interp;       /* Interpreter in which to run callback.
+                                 * Preserved until the state is freed. */
+    Tcl_ThreadId  threadId;     /* Thread that posted the operation */
+    char         *script;       /* Callback script. NULL if synchronous */
+} TcpSendfile;
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpSendfileFree --
+ *
+ *    Releases all resources associated with a sendfile buffer.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The file handle is closed, the interpreter released and bufPtr is
+ *    freed.
+ *
+ *------------------------------------------------------------------------
+ */
+static void TcpSendfileFree(IocpBuffer *bufPtr)
+{
+    TcpSendfile *sfPtr = (TcpSendfile *) bufPtr->context[0].ptr;
+    if (sfPtr->hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(sfPtr->hFile);
+    if (sfPtr->script)
+        ckfree(sfPtr->script);
+    IocpInterpRelease(sfPtr->interp, sfPtr->threadId);
+    ckfree(sfPtr);
+    IocpBufferFree(bufPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpSendfileCompleted --
+ *
+ *    Completion procedure for asynchronous sendfile operations. Invokes
+ *    the application callback with the number of bytes sent and, on
+ *    failure, an error message. See IocpCompletionProc.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The callback script is run, bufPtr is freed.
+ *
+ *------------------------------------------------------------------------
+ */
+static void TcpSendfileCompleted(
+    IocpChannel *lockedChanPtr, /* Locked on entry and return. May be NULL */
+    IocpBuffer  *bufPtr)        /* Completed buffer */
+{
+    TcpSendfile *sfPtr = (TcpSendfile *) bufPtr->context[0].ptr;
+    Tcl_Interp  *interp;
+    Tcl_Obj     *cmdObj;
+
+    if (lockedChanPtr == NULL || sfPtr->script == NULL ||
+        sfPtr->threadId != Tcl_GetCurrentThread() ||
+        Tcl_InterpDeleted(sfPtr->interp)) {
+        TcpSendfileFree(bufPtr);
+        return;
+    }
+
+    interp = sfPtr->interp;
+    cmdObj = Tcl_NewStringObj(sfPtr->script, -1);
+    Tcl_IncrRefCount(cmdObj);
+    Tcl_ListObjAppendElement(NULL, cmdObj, Tcl_NewIntObj(bufPtr->data.len));
+    if (bufPtr->winError != ERROR_SUCCESS) {
+        Tcl_ListObjAppendElement(NULL, cmdObj,
+                                 Iocp_MapWindowsError(bufPtr->winError, NULL, NULL));
+    }
+    IocpChannelInvokeCallback(lockedChanPtr, interp, cmdObj);
+    TcpSendfileFree(bufPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * TcpClientPostTransmit --
+ *
+ *    Posts a TransmitFile call for the sendfile state in bufPtr.
+ *
+ * Results:
+ *    0 on success or a Windows error code.
+ *
+ * Side effects:
+ *    On success, bufPtr is owned by the I/O subsystem and the channel's
+ *    pending write count incremented.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError TcpClientPostTransmit(
+    WinsockClient *lockedTcpPtr, /* Must be locked on entry */
+    IocpBuffer    *bufPtr,       /* IOCP_BUFFER_OP_TRANSMIT buffer */
+    Tcl_WideInt    offset,       /* Offset into file */
+    DWORD          length)       /* Number of bytes of file data to send */
+{
+    static GUID       TransmitFileGuid = WSAID_TRANSMITFILE;
+    LPFN_TRANSMITFILE fnTransmitFile;
+    TcpSendfile      *sfPtr = (TcpSendfile *) bufPtr->context[0].ptr;
+    DWORD             nbytes;
+    DWORD             winError;
+
+    /* Not cached for the same reasons as ConnectEx in TcpClientPostConnect */
+    if (WSAIoctl(lockedTcpPtr->so, SIO_GET_EXTENSION_FUNCTION_POINTER,
+                 &TransmitFileGuid, sizeof(GUID),
+                 &fnTransmitFile,
+                 sizeof(fnTransmitFile),
+                 &nbytes, NULL, NULL) != 0 ||
+        fnTransmitFile == NULL) {
+        return WSAGetLastError();
+    }
+
+    bufPtr->u.wsaOverlap.Offset     = (DWORD) offset;
+    bufPtr->u.wsaOverlap.OffsetHigh = (DWORD) (offset >> 32);
+    bufPtr->chanPtr = WinsockClientToIocpChannel(lockedTcpPtr);
+    lockedTcpPtr->base.numRefs += 1; /* Reversed when buffer is unlinked from channel */
+
+    /* A NULL file handle sends only the header and trailer */
+    if (fnTransmitFile(lockedTcpPtr->so,
+                       length ? sfPtr->hFile : NULL,
+                       length,
+                       0,       /* Default send size */
+                       &bufPtr->u.overlap,
+                       (sfPtr->tfb.HeadLength || sfPtr->tfb.TailLength) ? &sfPtr->tfb : NULL,
+                       0) == FALSE) {
+        winError = WSAGetLastError();
+        if (winError != WSA_IO_PENDING) {
+            bufPtr->chanPtr = NULL;
+            lockedTcpPtr->base.numRefs -= 1;
+            return winError;
+        }
+    }
+    lockedTcpPtr->base.pendingWrites++;
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Tcp_SendfileObjCmd --
+ *
+ *    Implements the iocp::inet::sendfile command.
+ *
+ *      sendfile CHAN PATH ?-offset N? ?-length N? ?-header DATA?
+ *          ?-trailer DATA? ?-command CMD?
+ *
+ *    File data is sent directly from the file system cache by TransmitFile
+ *    without passing through Tcl channel buffers. Any output buffered in
+ *    the Tcl channel is flushed first so ordering is preserved.
+ *
+ * Results:
+ *    Without -command, the number of bytes sent. With -command, an
+ *    empty result. On completion the command prefix is invoked with the
+ *    number of bytes sent and, on failure, an error message.
+ *
+ * Side effects:
+ *    Data is written to the socket.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Tcp_SendfileObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    static const char *const sendfileOptions[] = {
+        "-command", "-header", "-length", "-offset", "-trailer", NULL
+    };
+    enum sendfileOptions {
+        SENDFILE_COMMAND, SENDFILE_HEADER, SENDFILE_LENGTH, SENDFILE_OFFSET,
+        SENDFILE_TRAILER
+    };
+    Tcl_Channel    chan;
+    IocpChannel   *chanPtr;
+    IocpBuffer    *bufPtr;
+    TcpSendfile   *sfPtr;
+    Tcl_Obj       *scriptObj  = NULL;
+    Tcl_Obj       *headerObj  = NULL;
+    Tcl_Obj       *trailerObj = NULL;
+    const unsigned char *headerPtr  = NULL;
+    const unsigned char *trailerPtr = NULL;
+    const void    *nativePath;
+    Tcl_WideInt    offset = 0;
+    Tcl_WideInt    length = -1;
+    LARGE_INTEGER  fileSize;
+    HANDLE         hFile;
+    IocpWinError   winError;
+    IocpSizeT      headerLen  = 0;
+    IocpSizeT      trailerLen = 0;
+    int            mode;
+    int            optionIndex;
+    int            i;
+    const char    *transform;
+
+    if (objc < 3 || (objc & 1) == 0) {
+        Tcl_WrongNumArgs(interp, 1, objv, "CHAN PATH ?-option value ...?");
+        return TCL_ERROR;
+    }
+    for (i = 3; i < objc; i += 2) {
+        if (Tcl_GetIndexFromObj(interp, objv[i], sendfileOptions, "option",
+                                TCL_EXACT, &optionIndex) != TCL_OK) {
+            return TCL_ERROR;
+        }
+        switch ((enum sendfileOptions) optionIndex) {
+        case SENDFILE_COMMAND: scriptObj  = objv[i+1]; break;
+        case SENDFILE_HEADER:  headerObj  = objv[i+1]; break;
+        case SENDFILE_TRAILER: trailerObj = objv[i+1]; break;
+        case SENDFILE_OFFSET:
+        case SENDFILE_LENGTH:
+        {
+            Tcl_WideInt wide;
+            if (Tcl_GetWideIntFromObj(interp, objv[i+1], &wide) != TCL_OK)
+                return TCL_ERROR;
+            if (wide < 0) {
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Negative value for option %s.", Tcl_GetString(objv[i])));
+                return TCL_ERROR;
+            }
+            if (optionIndex == SENDFILE_OFFSET)
+                offset = wide;
+            else
+                length = wide;
+            break;
+        }
+        }
+    }
+
+    chan = Tcl_GetChannel(interp, Tcl_GetString(objv[1]), &mode);
+    if (chan == NULL)
+        return TCL_ERROR;
+    chanPtr = IocpChannelFromTclChannel(chan);
+    if (chanPtr == NULL || chanPtr->vtblPtr != &tcpClientVtbl) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" is not a TCP client socket.", Tcl_GetString(objv[1])));
+        return TCL_ERROR;
+    }
+    if ((mode & TCL_WRITABLE) == 0) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" wasn't opened for writing", Tcl_GetString(objv[1])));
+        return TCL_ERROR;
+    }
+    /* File data would bypass encryption and compression */
+    IocpChannelLock(chanPtr);
+    transform = chanPtr->tlsPtr ? "TLS" :
+        chanPtr->compressPtr ? "compression" : NULL;
+    IocpChannelUnlock(chanPtr);
+    if (transform) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" has %s enabled.", Tcl_GetString(objv[1]), transform));
+        return TCL_ERROR;
+    }
+
+    /* Data already written by the application must go out first */
+    if (Tcl_Flush(chan) != TCL_OK) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("error flushing \"%s\": %s",
+                                               Tcl_GetString(objv[1]),
+                                               Tcl_PosixError(interp)));
+        return TCL_ERROR;
+    }
+    if (Tcl_OutputBuffered(chan) != 0) {
+        /* Non-blocking channel with output still queued in the background */
+        Tcl_SetErrno(EAGAIN);
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" has pending output.", Tcl_GetString(objv[1])));
+        return TCL_ERROR;
+    }
+
+    nativePath = Tcl_FSGetNativePath(objv[2]);
+    if (nativePath == NULL) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("couldn't open \"%s\": invalid path.", Tcl_GetString(objv[2])));
+        return TCL_ERROR;
+    }
+    hFile = CreateFileW((const WCHAR *) nativePath, GENERIC_READ,
+                        FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                        FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return Iocp_ReportLastWindowsError(interp, "couldn't open file: ");
+    if (! GetFileSizeEx(hFile, &fileSize)) {
+        winError = GetLastError();
+        CloseHandle(hFile);
+        return Iocp_ReportWindowsError(interp, winError, "couldn't get file size: ");
+    }
+    if (offset > fileSize.QuadPart)
+        offset = fileSize.QuadPart;
+    if (length < 0 || length > (fileSize.QuadPart - offset))
+        length = fileSize.QuadPart - offset;
+    /* Limit on a single TransmitFile call */
+    if (length > 2147483646) {
+        CloseHandle(hFile);
+        Tcl_SetObjResult(interp, Tcl_NewStringObj("File data to transmit exceeds 2147483646 bytes.", -1));
+        return TCL_ERROR;
+    }
+
+    if (headerObj)
+        headerPtr = Tcl_GetByteArrayFromObj(headerObj, &headerLen);
+    if (trailerObj)
+        trailerPtr = Tcl_GetByteArrayFromObj(trailerObj, &trailerLen);
+
+    bufPtr = IocpBufferNew((int) (headerLen + trailerLen),
+                           IOCP_BUFFER_OP_TRANSMIT, IOCP_BUFFER_F_WINSOCK);
+    if (bufPtr == NULL) {
+        CloseHandle(hFile);
+        Tcl_SetResult(interp, "Could not allocate buffer.", TCL_STATIC);
+        return TCL_ERROR;
+    }
+    sfPtr = ckalloc(sizeof(*sfPtr));
+    sfPtr->hFile    = hFile;
+    sfPtr->interp   = interp;
+    Tcl_Preserve(interp);       /* Released in TcpSendfileFree */
+    sfPtr->threadId = Tcl_GetCurrentThread();
+    sfPtr->script   = NULL;
+    if (scriptObj) {
+        IocpSizeT len;
+        const char *script = Tcl_GetStringFromObj(scriptObj, &len);
+        sfPtr->script = ckalloc(len + 1);
+        memcpy(sfPtr->script, script, len + 1);
+    }
+    if (headerLen)
+        memcpy(bufPtr->data.bytes, headerPtr, headerLen);
+    if (trailerLen)
+        memcpy(bufPtr->data.bytes + headerLen, trailerPtr, trailerLen);
+    sfPtr->tfb.Head       = bufPtr->data.bytes;
+    sfPtr->tfb.HeadLength = (DWORD) headerLen;
+    sfPtr->tfb.Tail       = bufPtr->data.bytes + headerLen;
+    sfPtr->tfb.TailLength = (DWORD) trailerLen;
+    bufPtr->context[0].ptr = sfPtr;
+    bufPtr->completionProc = TcpSendfileCompleted;
+
+    IocpChannelLock(chanPtr);
+    if (chanPtr->state != IOCP_STATE_OPEN ||
+        (chanPtr->flags & IOCP_CHAN_F_READONLY)) {
+        winError = WSAENOTCONN;
+    } else {
+        winError = TcpClientPostTransmit(IocpChannelToWinsockClient(chanPtr),
+                                         bufPtr, offset, (DWORD) length);
+    }
+    if (winError != ERROR_SUCCESS) {
+        IocpChannelUnlock(chanPtr);
+        TcpSendfileFree(bufPtr);
+        IocpSetTclErrnoFromWin32(winError);
+        return Iocp_ReportWindowsError(interp, winError, "error sending file: ");
+    }
+
+    if (scriptObj) {
+        /* Completion will be reported through TcpSendfileCompleted */
+        IocpChannelUnlock(chanPtr);
+        return TCL_OK;
+    }
+
+    /* Synchronous. Wait for the completion thread to queue the buffer. */
+    chanPtr->numRefs += 1;      /* Protect against deallocation while waiting */
+    while (! IocpChannelRemoveCompletion(chanPtr, bufPtr)) {
+        IocpChannelAwaitCompletion(chanPtr, IOCP_CHAN_F_BLOCKED_WRITE);
+    }
+    IocpChannelDrop(chanPtr);   /* Unlocks */
+
+    winError = bufPtr->winError;
+    length   = bufPtr->data.len;
+    TcpSendfileFree(bufPtr);
+    if (winError != ERROR_SUCCESS) {
+        IocpSetTclErrnoFromWin32(winError);
+        return Iocp_ReportWindowsError(interp, winError, "error sending file: ");
+    }
+    Tcl_SetObjResult(interp, Tcl_NewWideIntObj(length));
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Tcp_BroadcastObjCmd --
+ *
+ *    Implements the iocp::inet::broadcast command.
+ *
+ *      broadcast DATA CHANS
+ *
+ *    The binary data is copied once into a shared data block and a write
+ *    referencing the block is posted to each channel in the list. The
+ *    block is freed when the last write completes. A channel is skipped
+ *    if it has -maxpendingwrites writes outstanding, is held back by its
+ *    rate limit, still has output buffered in the Tcl channel after a
+ *    flush or is no longer connected.
+ *
+ * Results:
+ *    A standard Tcl result. The interpreter result holds the list of
+ *    channels that were skipped.
+ *
+ * Side effects:
+ *    Data is written to the sockets.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Tcp_BroadcastObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    Tcl_Obj       **chanObjs;
+    Tcl_Obj        *skippedObj;
+    Tcl_Channel    *chans;
+    IocpChannel   **chanPtrs;
+    IocpSharedData *sharedPtr;
+    IocpBuffer     *bufPtr;
+    const unsigned char *bytes;
+    const char     *reason;
+    IocpSizeT       len;
+    Tcl_Size        nchans;
+    Tcl_Size        i;
+    int             mode;
+
+    if (objc != 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "DATA CHANS");
+        return TCL_ERROR;
+    }
+    bytes = Tcl_GetByteArrayFromObj(objv[1], &len);
+    if (len > INT_MAX) {
+        Tcl_SetResult(interp, "Data length too large.", TCL_STATIC);
+        return TCL_ERROR;
+    }
+    if (Tcl_ListObjGetElements(interp, objv[2], &nchans, &chanObjs) != TCL_OK)
+        return TCL_ERROR;
+
+    /* Verify all channels before anything is written to any of them */
+    chans    = ckalloc(nchans * sizeof(*chans) + 1);
+    chanPtrs = ckalloc(nchans * sizeof(*chanPtrs) + 1);
+    for (i = 0; i < nchans; ++i) {
+        chans[i] = Tcl_GetChannel(interp, Tcl_GetString(chanObjs[i]), &mode);
+        if (chans[i] == NULL)
+            goto error_return;
+        chanPtrs[i] = IocpChannelFromTclChannel(chans[i]);
+        if (chanPtrs[i] == NULL || chanPtrs[i]->vtblPtr != &tcpClientVtbl) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" is not a TCP client socket.", Tcl_GetString(chanObjs[i])));
+            goto error_return;
+        }
+        if ((mode & TCL_WRITABLE) == 0) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" wasn't opened for writing", Tcl_GetString(chanObjs[i])));
+            goto error_return;
+        }
+        /* The shared data is posted as is so cannot be transformed */
+        IocpChannelLock(chanPtrs[i]);
+        reason = chanPtrs[i]->tlsPtr ? "has TLS enabled" :
+            chanPtrs[i]->compressPtr ? "has compression enabled" :
+            chanPtrs[i]->spliceFromPtr ? "is the target of a splice" : NULL;
+        IocpChannelUnlock(chanPtrs[i]);
+        if (reason) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" %s.", Tcl_GetString(chanObjs[i]), reason));
+            goto error_return;
+        }
+    }
+
+    skippedObj = Tcl_NewListObj(0, NULL);
+    if (len == 0 || nchans == 0)
+        goto done;
+    sharedPtr = IocpSharedDataNew((const char *) bytes, (int) len);
+    if (sharedPtr == NULL) {
+        Tcl_DecrRefCount(skippedObj);
+        Tcl_SetResult(interp, "Could not allocate buffer.", TCL_STATIC);
+        goto error_return;
+    }
+    for (i = 0; i < nchans; ++i) {
+        IocpChannel *chanPtr = chanPtrs[i];
+        int sent = 0;
+
+        /*
+         * Data already written by the application must go out first. A
+         * non-blocking channel that cannot be flushed immediately is
+         * treated as being over its write limit.
+         */
+        if (Tcl_OutputBuffered(chans[i]) != 0 &&
+            (Tcl_Flush(chans[i]) != TCL_OK ||
+             Tcl_OutputBuffered(chans[i]) != 0)) {
+            Tcl_ListObjAppendElement(NULL, skippedObj, chanObjs[i]);
+            continue;
+        }
+
+        IocpChannelLock(chanPtr);
+        if (chanPtr->state == IOCP_STATE_OPEN &&
+            (chanPtr->flags & IOCP_CHAN_F_READONLY) == 0 &&
+            chanPtr->pendingWrites < chanPtr->maxPendingWrites &&
+            (chanPtr->writeBucketPtr == NULL ||
+             ! IocpRateThrottled(chanPtr, IOCP_CHAN_F_RATE_WRITE_WAIT))) {
+            bufPtr = IocpBufferNewShared(sharedPtr, IOCP_BUFFER_OP_WRITE, 0);
+            if (bufPtr) {
+                if (chanPtr->vtblPtr->postbuffer(chanPtr, bufPtr) == ERROR_SUCCESS) {
+                    sent = 1;
+                    if (chanPtr->writeBucketPtr)
+                        IocpRateConsume(chanPtr->writeBucketPtr, (int) len);
+                } else {
+                    IocpBufferFree(bufPtr);
+                }
+            }
+        }
+        IocpChannelUnlock(chanPtr);
+        if (! sent)
+            Tcl_ListObjAppendElement(NULL, skippedObj, chanObjs[i]);
+    }
+    IocpSharedDataDrop(sharedPtr); /* Writes hold their own references */
+
+done:
+    ckfree(chans);
+    ckfree(chanPtrs);
+    Tcl_SetObjResult(interp, skippedObj);
+    return TCL_OK;
+
+error_return:
+    ckfree(chans);
+    ckfree(chanPtrs);
+    return TCL_ERROR;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Tcp_SocketCacheObjCmd --
+ *
+ *    Implements the iocp::inet::socketcache command.
+ *
+ *      socketcache ?MAXSOCKETS?
+ *
+ * Results:
+ *    A standard Tcl result. The interpreter result holds the maximum
+ *    number of cached sockets in effect before the call.
+ *
+ * Side effects:
+ *    The process-wide socket cache limit is changed if MAXSOCKETS is
+ *    specified.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Tcp_SocketCacheObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    int maxSockets = -1;
+
+    if (objc > 2) {
+        Tcl_WrongNumArgs(interp, 1, objv, "?MAXSOCKETS?");
+        return TCL_ERROR;
+    }
+    if (objc == 2) {
+        if (Tcl_GetIntFromObj(interp, objv[1], &maxSockets) != TCL_OK)
+            return TCL_ERROR;
+        if (maxSockets < 0 || maxSockets > 65536) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Integer value %d out of range.", maxSockets));
+            return TCL_ERROR;
+        }
+    }
+    Tcl_SetObjResult(interp,
+                     Tcl_NewIntObj(WinsockSocketCacheConfigure(maxSockets)));
+    return TCL_OK;
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -1767,6 +2902,25 @@ Tcp_SocketObjCmd (
 IocpTclCode Tcp_ModuleInitialize (Tcl_Interp *interp)
 {
     Tcl_CreateObjCommand(interp, "iocp::inet::socket", Tcp_SocketObjCmd, 0L, 0L);
+    Tcl_CreateObjCommand(interp, "iocp::inet::sendfile", Tcp_SendfileObjCmd, 0L, 0L);
+    Tcl_CreateObjCommand(interp, "iocp::inet::broadcast", Tcp_BroadcastObjCmd, 0L, 0L);
+    Tcl_CreateObjCommand(interp, "iocp::inet::socketcache", Tcp_SocketCacheObjCmd, 0L, 0L);
+    if (Pool_ModuleInitialize(interp) != TCL_OK)
+        return TCL_ERROR;
+    if (Splice_ModuleInitialize(interp) != TCL_OK)
+        return TCL_ERROR;
+    if (Udp_ModuleInitialize(interp) != TCL_OK)
+        return TCL_ERROR;
+    if (Unix_ModuleInitialize(interp) != TCL_OK)
+        return TCL_ERROR;
+    if (Pipe_ModuleInitialize(interp) != TCL_OK)
+        return TCL_ERROR;
+    if (File_ModuleInitialize(interp) != TCL_OK)
+        return TCL_ERROR;
+    if (Frame_ModuleInitialize(interp) != TCL_OK)
+        return TCL_ERROR;
+    if (Rate_ModuleInitialize(interp) != TCL_OK)
+        return TCL_ERROR;
     Tcl_PkgProvide(interp, PACKAGE_NAME_INET, PACKAGE_VERSION);
     return TCL_OK;
 }
@@ -80,7 +80,7 @@ static void IocpCompleteDisconnect(
 {
     IOCP_TRACE(("IocpCompleteDisconenct Enter: lockedChanPtr=%p. state=0x%x\n", lockedChanPtr, lockedChanPtr->state));
     if (lockedChanPtr->vtblPtr->disconnected) {
-        lockedChanPtr->vtblPtr->disconnected(lockedChanPtr);
+        lockedChanPtr->vtblPtr->disconnected(lockedChanPtr, bufPtr->winError);
     }
     bufPtr->chanPtr = NULL;
     IocpChannelDrop(lockedChanPtr); /* Corresponding to bufPtr->chanPtr */
@@ -145,6 +145,44 @@ static void IocpCompleteAccept(
     IocpChannelDrop(lockedChanPtr);
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpReadPassOn --
+ *
+ *    Passes on the data in a completed read either to the target of a
+ *    splice or to the channel's input queue. On TLS channels, the data
+ *    is decrypted first and on compressed channels, decompressed.
+ *
+ * Results:
+ *    1 if data was added to the input queue and the Tcl thread needs
+ *    to be notified, 0 if it was forwarded to a splice target or consumed
+ *    by the TLS or compression layer without producing any input.
+ *
+ * Side effects:
+ *    bufPtr is no longer owned by the caller.
+ *
+ *------------------------------------------------------------------------
+ */
+static int IocpReadPassOn(
+    IocpChannel *lockedChanPtr, /* Locked channel */
+    IocpBuffer *bufPtr)         /* Completed read, chanPtr already cleared */
+{
+    if (lockedChanPtr->tlsPtr)
+        return IocpTlsReceive(lockedChanPtr, bufPtr);
+    if (lockedChanPtr->compressPtr)
+        return IocpCompressReceive(lockedChanPtr, bufPtr);
+
+    /* Spliced channels hand the data straight to the target channel */
+    if (lockedChanPtr->spliceDoneBufPtr != NULL &&
+        (lockedChanPtr->flags & IOCP_CHAN_F_SPLICE_HOLD) == 0 &&
+        IocpSpliceForward(lockedChanPtr, bufPtr)) {
+        return 0;
+    }
+    IocpChannelQueueInput(lockedChanPtr, bufPtr);
+    return 1;
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -159,6 +197,8 @@ static void IocpCompleteAccept(
  *    The passed bufPtr is freed or enqueued on the owning IocpChannel. The
  *    lockedChanPtr is dropped and the Tcl thread notified via the event loop.
  *    If the Tcl thread is blocked on this channel, it is woken up.
+ *    Sequenced reads that complete ahead of earlier ones are held back
+ *    and passed on, in order, when the earlier ones complete.
  *
  *------------------------------------------------------------------------
  */
@@ -166,6 +206,8 @@ static void IocpCompleteRead(
     IocpChannel *lockedChanPtr, /* Locked channel, will be dropped */
     IocpBuffer *bufPtr)         /* I/O completion buffer */
 {
+    int notify;
+
     IOCP_TRACE(("IocpCompleteRead Enter: lockedChanPtr=%p state=0x%x bufPtr=%p datalen=%d\n", lockedChanPtr, lockedChanPtr->state, bufPtr, bufPtr->data.len));
 
     IOCP_ASSERT(lockedChanPtr->pendingReads > 0);
@@ -180,25 +222,65 @@ static void IocpCompleteRead(
     }
 
     /*
-     * Add the buffer to the input queue. Then if the channel was blocked,
-     * awaken the sleeping thread. Otherwise send it a Tcl event notification.
-     */
-    IocpListAppend(&lockedChanPtr->inputBuffers, &bufPtr->link);
-    bufPtr->chanPtr = NULL;
-    /*
-     * chanPtr->numRefs-- because bufPtr does not refer to it (though it is on
-     *                    the inputBuffers queue, that is immaterial)
+     * chanPtr->numRefs-- because bufPtr does not refer to it (though it may
+     *                    be on the inputBuffers queue, that is immaterial)
      * chanPtr->numRefs++ because we still want to access chanPtr below after
      *                    unlocking and relocking.
      * The two cancel out. The latter will be reversed at function exit.
      */
+    bufPtr->chanPtr = NULL;
+
+    /* Charge received data against the read rate limit */
+    if (lockedChanPtr->readBucketPtr && bufPtr->winError == ERROR_SUCCESS)
+        IocpRateConsume(lockedChanPtr->readBucketPtr, bufPtr->data.len);
+
+    if (bufPtr->flags & IOCP_BUFFER_F_SEQUENCED) {
+        if (bufPtr->context[1].i != lockedChanPtr->readSeqNext) {
+            /* An earlier read is outstanding. Hold in sequence order. */
+            IocpLink *linkPtr = lockedChanPtr->heldBuffers.headPtr;
+            while (linkPtr &&
+                   CONTAINING_RECORD(linkPtr, IocpBuffer, link)->context[1].i
+                   < bufPtr->context[1].i) {
+                linkPtr = linkPtr->nextPtr;
+            }
+            IocpListInsertBefore(&lockedChanPtr->heldBuffers, linkPtr, &bufPtr->link);
+            IocpChannelDrop(lockedChanPtr); /* Corresponding to bufPtr->chanPtr */
+            return;
+        }
+        lockedChanPtr->readSeqNext += 1;
+    }
+
+    notify = IocpReadPassOn(lockedChanPtr, bufPtr);
+
+    /* Pass on held reads that are now in sequence */
+    while (lockedChanPtr->heldBuffers.headPtr) {
+        bufPtr = CONTAINING_RECORD(lockedChanPtr->heldBuffers.headPtr,
+                                   IocpBuffer, link);
+        if (bufPtr->context[1].i != lockedChanPtr->readSeqNext)
+            break;
+        IocpListPopFront(&lockedChanPtr->heldBuffers);
+        lockedChanPtr->readSeqNext += 1;
+        notify |= IocpReadPassOn(lockedChanPtr, bufPtr);
+    }
 
     /*
      * Note that zero bytes read => EOF. That will also be handled in the
      * Tcl thread since in any case it has to be notified of closure. So
      * also any errors indicated by bufPtr->winError.
+     *
+     * While the input is below the receive low watermark the Tcl thread
+     * has nothing to report and is only needed to repost reads. It is
+     * then not woken until half the posted reads have completed unless it
+     * is blocked waiting for input.
      */
-    IocpChannelNudgeThread(lockedChanPtr, IOCP_CHAN_F_BLOCKED_READ, 0);
+    if (notify &&
+        IocpChannelBelowLowat(lockedChanPtr) &&
+        (lockedChanPtr->flags & IOCP_CHAN_F_BLOCKED_READ) == 0 &&
+        2 * lockedChanPtr->pendingReads > lockedChanPtr->maxPendingReads) {
+        notify = 0;
+    }
+    if (notify)
+        IocpChannelNudgeThread(lockedChanPtr, IOCP_CHAN_F_BLOCKED_READ, 0);
 
     /* This drops the reference from bufPtr which was delayed (see above) */
     IocpChannelDrop(lockedChanPtr);
@@ -228,6 +310,10 @@ static void IocpCompleteWrite(
     IOCP_ASSERT(lockedChanPtr->pendingWrites > 0);
     lockedChanPtr->pendingWrites--;
 
+    /* Resume a splice source held back by this channel's pending writes */
+    if (lockedChanPtr->spliceFromPtr)
+        IocpSpliceWriteCompleted(lockedChanPtr, bufPtr);
+
     bufPtr->chanPtr = NULL;
     IocpBufferFree(bufPtr);
 
@@ -239,6 +325,138 @@ static void IocpCompleteWrite(
     IocpChannelDrop(lockedChanPtr); /* Corresponding to bufPtr->chanPtr */
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpCompleteTransmit --
+ *
+ *    Handles completion of write operations whose result has to be reported
+ *    to the Tcl thread, e.g. TransmitFile.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The passed bufPtr is queued on the channel's completions queue (or
+ *    disposed of if the channel is closed) and lockedChanPtr dropped.
+ *    The Tcl thread is notified via the event loop or woken up if blocked.
+ *
+ *------------------------------------------------------------------------
+ */
+static void IocpCompleteTransmit(
+    IocpChannel *lockedChanPtr, /* Locked channel, will be dropped */
+    IocpBuffer *bufPtr)         /* I/O completion buffer */
+{
+    IOCP_ASSERT(lockedChanPtr->pendingWrites > 0);
+    IOCP_ASSERT(bufPtr->completionProc != NULL);
+    lockedChanPtr->pendingWrites--;
+
+    bufPtr->chanPtr = NULL;
+    if (lockedChanPtr->state == IOCP_STATE_CLOSED) {
+        bufPtr->completionProc(NULL, bufPtr);
+    } else {
+        IocpListAppend(&lockedChanPtr->completions, &bufPtr->link);
+        lockedChanPtr->flags |= IOCP_CHAN_F_NOTIFY_WRITES;
+        /* Force since completion has to be reported even if not watching */
+        IocpChannelNudgeThread(lockedChanPtr, IOCP_CHAN_F_BLOCKED_WRITE, 1);
+    }
+    IocpChannelDrop(lockedChanPtr); /* Corresponding to bufPtr->chanPtr */
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpProcessCompletion --
+ *
+ *    Handles a completion packet dequeued from a completion port. Only
+ *    the completion thread of the port may call this. The completion
+ *    routines rely on completions for a channel being processed one at
+ *    a time and in the order they were dequeued.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The completion is dispatched based on the operation type. The
+ *    buffer and the channel reference held by it are disposed of by the
+ *    called completion routines. The caller must not be holding any
+ *    channel or thread data locks.
+ *
+ *------------------------------------------------------------------------
+ */
+static void IocpProcessCompletion(
+    OVERLAPPED *overlapPtr,     /* Overlap structure of completed I/O */
+    DWORD       nbytes,         /* Number of bytes transferred */
+    DWORD       winError)       /* 0 or error code of failed I/O */
+{
+    IocpBuffer  *bufPtr;
+    IocpChannel *chanPtr;
+
+    bufPtr = CONTAINING_RECORD(overlapPtr, IocpBuffer, u);
+    bufPtr->data.len = nbytes;
+    bufPtr->winError = winError;
+    chanPtr = bufPtr->chanPtr;
+    IOCP_ASSERT(chanPtr != NULL);
+    IocpChannelLock(chanPtr);
+
+    if (bufPtr->winError != 0 &&
+        chanPtr->vtblPtr->translateerror != NULL) {
+        /* Translate to a more specific error code */
+        bufPtr->winError = chanPtr->vtblPtr->translateerror(chanPtr, bufPtr);
+    }
+
+    /*
+     * NOTE - it is responsibility of called completion routines
+     * to dispose of both chanPtr and bufPtr respectively.
+     */
+    IOCP_TRACE(("IocpProcessCompletion: chanPtr=%p, chanPtr->state=0x%x, bufPtr=%p, bufPtr->operation=%d, bufPtr->winError=%d\n", chanPtr, chanPtr->state, bufPtr, bufPtr->operation, bufPtr->winError));
+    switch (bufPtr->operation) {
+    case IOCP_BUFFER_OP_READ:
+        IocpCompleteRead(chanPtr, bufPtr);
+        break;
+    case IOCP_BUFFER_OP_WRITE:
+        IocpCompleteWrite(chanPtr, bufPtr);
+        break;
+    case IOCP_BUFFER_OP_CONNECT:
+        IocpCompleteConnect(chanPtr, bufPtr);
+        break;
+    case IOCP_BUFFER_OP_DISCONNECT:
+        IocpCompleteDisconnect(chanPtr, bufPtr);
+        break;
+    case IOCP_BUFFER_OP_ACCEPT:
+        IocpCompleteAccept(chanPtr, bufPtr);
+        break;
+    case IOCP_BUFFER_OP_TRANSMIT:
+        IocpCompleteTransmit(chanPtr, bufPtr);
+        break;
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpWinErrorOfCompletion --
+ *
+ *    Returns the error code for a completion packet dequeued with
+ *    GetQueuedCompletionStatus. Must be called immediately after.
+ *
+ * Results:
+ *    0 if ok is true, else a Windows error code.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static DWORD IocpWinErrorOfCompletion(BOOL ok)
+{
+    DWORD winError;
+    if (ok)
+        return 0;
+    winError = GetLastError();
+    return winError == 0 ? WSAEINVAL : winError; /* TBD - what else? */
+}
+
 DWORD WINAPI
 IocpCompletionThread (LPVOID lpParam)
 {
@@ -248,13 +466,11 @@ IocpCompletionThread (LPVOID lpParam)
     __try {
 #endif
         while (1) {
-            IocpBuffer *bufPtr;
             HANDLE      iocpPort = (HANDLE) lpParam;
             DWORD       nbytes;
             ULONG_PTR   key;
             OVERLAPPED *overlapPtr;
             BOOL        ok;
-            IocpChannel *chanPtr;
 
             ok = GetQueuedCompletionStatus(iocpPort, &nbytes, &key,
                                            &overlapPtr, INFINITE);
@@ -266,48 +482,9 @@ IocpCompletionThread (LPVOID lpParam)
                 }
                 break;          /* Vamoose */
             }
-            bufPtr = CONTAINING_RECORD(overlapPtr, IocpBuffer, u);
-            bufPtr->data.len = nbytes;
-            if (!ok) {
-                bufPtr->winError = GetLastError();
-                if (bufPtr->winError == 0)
-                    bufPtr->winError =  WSAEINVAL; /* TBD - what else? */
-            }
-            else {
-                bufPtr->winError = 0;
-            }
-            chanPtr = bufPtr->chanPtr;
-            IOCP_ASSERT(chanPtr != NULL);
-            IocpChannelLock(chanPtr);
-
-            if (bufPtr->winError != 0 &&
-                chanPtr->vtblPtr->translateerror != NULL) {
-                /* Translate to a more specific error code */
-                bufPtr->winError = chanPtr->vtblPtr->translateerror(chanPtr, bufPtr);
-            }
-
-            /*
-             * NOTE - it is responsibility of called completion routines
-             * to dispose of both chanPtr and bufPtr respectively.
-             */
-            IOCP_TRACE(("IocpCompletionThread: chanPtr=%p, chanPtr->state=0x%x, bufPtr=%p, bufPtr->operation=%d, bufPtr->winError=%d\n", chanPtr, chanPtr->state, bufPtr, bufPtr->operation, bufPtr->winError));
-            switch (bufPtr->operation) {
-            case IOCP_BUFFER_OP_READ:
-                IocpCompleteRead(chanPtr, bufPtr);
-                break;
-            case IOCP_BUFFER_OP_WRITE:
-                IocpCompleteWrite(chanPtr, bufPtr);
-                break;
-            case IOCP_BUFFER_OP_CONNECT:
-                IocpCompleteConnect(chanPtr, bufPtr);
-                break;
-            case IOCP_BUFFER_OP_DISCONNECT:
-                IocpCompleteDisconnect(chanPtr, bufPtr);
-                break;
-            case IOCP_BUFFER_OP_ACCEPT:
-                IocpCompleteAccept(chanPtr, bufPtr);
-                break;
-            }
+            IocpProcessCompletion(overlapPtr, nbytes, IocpWinErrorOfCompletion(ok));
+            if (iocpPort != iocpModuleState.completion_port)
+                IOCP_STATS_INCR_ALWAYS(IocpThreadPortCompletions);
         }
 #ifdef _MSC_VER
     }
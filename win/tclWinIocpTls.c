@@ -0,0 +1,1281 @@
+/*
+ * tclWinIocpTls.c --
+ *
+ *	Native TLS for IOCP socket channels using Schannel.
+ *
+ * Copyright (c) 2026 agent.
+ *
+ * See the file "license.terms" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+#include "tclWinIocp.h"
+
+#define SECURITY_WIN32
+#include <security.h>
+#include <schannel.h>
+
+/*
+ * The -tls option switches a connected socket to TLS. Record processing
+ * is done within the channel instead of a stacked channel so data only
+ * crosses the Tcl channel layer once.
+ *
+ * Received data is fed to Schannel by the completion thread in
+ * IocpTlsReceive. During the handshake, the tokens generated are posted
+ * directly from the completion thread and reads reposted without any
+ * involvement of the Tcl thread. Once the handshake is complete, records
+ * are decrypted in the completion thread and the plaintext queued on
+ * inputBuffers as for plain sockets. Writes are encrypted in the Tcl thread
+ * by IocpTlsPostWrite, one record per write, into a buffer that is posted
+ * with the channel's postbuffer() without further copying.
+ *
+ * IOCP_CHAN_F_TLS_HANDSHAKE is set on the channel while a handshake is in
+ * progress. Writes are held back and the channel not reported writable
+ * during that time. All TLS state is protected by the channel lock.
+ */
+
+#ifndef SCH_USE_STRONG_CRYPTO
+# define SCH_USE_STRONG_CRYPTO 0x00400000
+#endif
+
+/* Handshake context requirements */
+#define IOCP_TLS_ISC_FLAGS                                            \
+    (ISC_REQ_SEQUENCE_DETECT | ISC_REQ_REPLAY_DETECT |                \
+     ISC_REQ_CONFIDENTIALITY | ISC_REQ_EXTENDED_ERROR |               \
+     ISC_REQ_ALLOCATE_MEMORY | ISC_REQ_STREAM)
+#define IOCP_TLS_ASC_FLAGS                                            \
+    (ASC_REQ_SEQUENCE_DETECT | ASC_REQ_REPLAY_DETECT |                \
+     ASC_REQ_CONFIDENTIALITY | ASC_REQ_EXTENDED_ERROR |               \
+     ASC_REQ_ALLOCATE_MEMORY | ASC_REQ_STREAM)
+
+/*
+ * Received data that cannot be processed is accumulated up to this limit.
+ * Records are at most 16K plus overhead so this only guards against a
+ * misbehaving peer.
+ */
+#define IOCP_TLS_MAX_PENDING (256*1024)
+
+typedef enum IocpTlsState {
+    IOCP_TLS_HANDSHAKE,         /* Handshake in progress */
+    IOCP_TLS_OPEN,              /* Data transfer */
+    IOCP_TLS_CLOSED,            /* close_notify received */
+    IOCP_TLS_FAILED             /* Handshake or record processing failed */
+} IocpTlsState;
+
+typedef struct IocpTls {
+    CredHandle     cred;
+    CtxtHandle     ctx;
+    int            haveCtx;     /* Whether ctx is initialized */
+    int            server;      /* Server side of the handshake */
+    int            verify;      /* Client only - verify server certificate */
+    WCHAR         *serverName;  /* Client only - SNI and verification name */
+    PCCERT_CONTEXT certPtr;     /* Server only - certificate */
+    char          *spec;        /* Option value, less any password */
+    IocpTlsState   state;
+    int            closeSent;   /* close_notify sent, no more writes */
+    int            postHandshake; /* Handling a post-handshake message to
+                                   * which no token has been sent */
+    IocpWinError   winError;    /* Error if state is IOCP_TLS_FAILED */
+    SecPkgContext_StreamSizes sizes; /* Record sizes once OPEN */
+    char          *inBytes;     /* Received data not yet processed */
+    int            inLen;       /* Number of bytes in inBytes */
+    int            inCapacity;  /* Allocated size of inBytes */
+} IocpTls;
+
+static void IocpTlsHandshake(IocpChannel *lockedChanPtr);
+static void IocpTlsResume(IocpChannel *lockedChanPtr);
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsWinChars --
+ *
+ *    Converts a UTF-8 string to a newly allocated wide character string.
+ *
+ * Results:
+ *    Pointer to the string which must be freed with ckfree.
+ *
+ * Side effects:
+ *    Memory is allocated.
+ *
+ *------------------------------------------------------------------------
+ */
+static WCHAR *
+IocpTlsWinChars(const char *utf)
+{
+    int    nchars;
+    WCHAR *wsPtr;
+
+    nchars = MultiByteToWideChar(CP_UTF8, 0, utf, -1, NULL, 0);
+    if (nchars <= 0)
+        nchars = 1;
+    wsPtr = ckalloc(nchars * sizeof(WCHAR));
+    if (MultiByteToWideChar(CP_UTF8, 0, utf, -1, wsPtr, nchars) <= 0)
+        wsPtr[0] = 0;
+    return wsPtr;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsFree --
+ *
+ *    Releases all resources held by a IocpTls structure.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The structure is freed.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpTlsFree(IocpTls *tlsPtr)
+{
+    if (tlsPtr->haveCtx)
+        DeleteSecurityContext(&tlsPtr->ctx);
+    if (SecIsValidHandle(&tlsPtr->cred))
+        FreeCredentialsHandle(&tlsPtr->cred);
+    if (tlsPtr->certPtr)
+        CertFreeCertificateContext(tlsPtr->certPtr);
+    if (tlsPtr->serverName)
+        ckfree(tlsPtr->serverName);
+    if (tlsPtr->spec)
+        ckfree(tlsPtr->spec);
+    if (tlsPtr->inBytes)
+        ckfree(tlsPtr->inBytes);
+    ckfree(tlsPtr);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsSend --
+ *
+ *    Posts handshake or alert data generated by Schannel to the channel.
+ *    May be called from the completion thread.
+ *
+ * Results:
+ *    0 on success or a Windows error code.
+ *
+ * Side effects:
+ *    A write is posted. The maxPendingWrites limit is not applied.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+IocpTlsSend(
+    IocpChannel *lockedChanPtr, /* Locked on entry and return */
+    const void  *bytes,
+    int          nbytes)
+{
+    IocpBuffer  *bufPtr;
+    IocpWinError winError;
+
+    if (lockedChanPtr->state != IOCP_STATE_OPEN ||
+        (lockedChanPtr->flags & IOCP_CHAN_F_READONLY))
+        return WSAENOTCONN;
+    bufPtr = IocpBufferNew(nbytes, IOCP_BUFFER_OP_WRITE, IOCP_BUFFER_F_WINSOCK);
+    if (bufPtr == NULL)
+        return WSAENOBUFS;
+    IocpBufferCopyIn(bufPtr, bytes, nbytes);
+    winError = lockedChanPtr->vtblPtr->postbuffer(lockedChanPtr, bufPtr);
+    if (winError != ERROR_SUCCESS)
+        IocpBufferFree(bufPtr);
+    return winError;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsFail --
+ *
+ *    Marks the TLS session as failed and queues the error for the reader.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    Pending received data is discarded. An error buffer is queued on
+ *    inputBuffers.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpTlsFail(
+    IocpChannel *lockedChanPtr, /* Locked on entry and return */
+    IocpWinError winError)
+{
+    IocpTls    *tlsPtr = lockedChanPtr->tlsPtr;
+    IocpBuffer *bufPtr;
+
+    IOCP_TRACE(("IocpTlsFail: lockedChanPtr=%p winError=0x%x\n", lockedChanPtr, winError));
+    tlsPtr->state    = IOCP_TLS_FAILED;
+    tlsPtr->winError = winError;
+    tlsPtr->inLen    = 0;
+    lockedChanPtr->flags &= ~IOCP_CHAN_F_TLS_HANDSHAKE;
+    lockedChanPtr->winError = winError;
+    bufPtr = IocpBufferNew(0, IOCP_BUFFER_OP_READ, IOCP_BUFFER_F_WINSOCK);
+    if (bufPtr) {
+        bufPtr->winError = winError;
+        IocpChannelQueueInput(lockedChanPtr, bufPtr);
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsAppend --
+ *
+ *    Appends received data to the TLS input accumulator.
+ *
+ * Results:
+ *    0 on success or a Windows error code.
+ *
+ * Side effects:
+ *    The accumulator may be reallocated.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+IocpTlsAppend(
+    IocpTls    *tlsPtr,
+    const char *bytes,
+    int         nbytes)
+{
+    if (tlsPtr->inLen + nbytes > tlsPtr->inCapacity) {
+        int   capacity = tlsPtr->inCapacity ? tlsPtr->inCapacity : 16384;
+        char *newPtr;
+        while (capacity < tlsPtr->inLen + nbytes)
+            capacity *= 2;
+        if (capacity > IOCP_TLS_MAX_PENDING)
+            return WSAEMSGSIZE;
+        newPtr = attemptckrealloc(tlsPtr->inBytes, capacity);
+        if (newPtr == NULL)
+            return WSAENOBUFS;
+        tlsPtr->inBytes    = newPtr;
+        tlsPtr->inCapacity = capacity;
+    }
+    memcpy(tlsPtr->inBytes + tlsPtr->inLen, bytes, nbytes);
+    tlsPtr->inLen += nbytes;
+    return ERROR_SUCCESS;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsKeepExtra --
+ *
+ *    Retains the unprocessed tail of the input accumulator as indicated
+ *    by a SECBUFFER_EXTRA buffer returned by Schannel.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    Processed data is removed from the accumulator.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpTlsKeepExtra(
+    IocpTls   *tlsPtr,
+    SecBuffer *extraPtr)        /* May be NULL if nothing left over */
+{
+    if (extraPtr && extraPtr->cbBuffer > 0 &&
+        (int) extraPtr->cbBuffer <= tlsPtr->inLen) {
+        memmove(tlsPtr->inBytes,
+                tlsPtr->inBytes + tlsPtr->inLen - extraPtr->cbBuffer,
+                extraPtr->cbBuffer);
+        tlsPtr->inLen = extraPtr->cbBuffer;
+    } else {
+        tlsPtr->inLen = 0;
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsResume --
+ *
+ *    Returns a session to data transfer once a handshake, initial or
+ *    post-handshake, is done.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    IOCP_CHAN_F_TLS_HANDSHAKE is cleared so held writes can proceed.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpTlsResume(
+    IocpChannel *lockedChanPtr) /* Locked on entry and return */
+{
+    lockedChanPtr->tlsPtr->state         = IOCP_TLS_OPEN;
+    lockedChanPtr->tlsPtr->postHandshake = 0;
+    lockedChanPtr->flags &= ~IOCP_CHAN_F_TLS_HANDSHAKE;
+    lockedChanPtr->flags |= IOCP_CHAN_F_NOTIFY_WRITES;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsHandshake --
+ *
+ *    Feeds accumulated input to the Schannel handshake and sends any
+ *    resulting tokens. May be called from the Tcl or completion thread.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    On completion of the handshake, the session is marked open and
+ *    IOCP_CHAN_F_TLS_HANDSHAKE is cleared. On failure, the error is queued
+ *    for the reader.
+ *
+ *------------------------------------------------------------------------
+ */
+static void
+IocpTlsHandshake(
+    IocpChannel *lockedChanPtr) /* Locked on entry and return */
+{
+    IocpTls *tlsPtr = lockedChanPtr->tlsPtr;
+    int      credRetries = 0;
+
+    while (tlsPtr->state == IOCP_TLS_HANDSHAKE) {
+        SecBuffer       inBufs[2];
+        SecBuffer       outBufs[1];
+        SecBufferDesc   inDesc;
+        SecBufferDesc   outDesc;
+        SECURITY_STATUS status;
+        ULONG           attrs;
+        int             noInput;
+        IocpWinError    winError;
+
+        /* The client starts the handshake without any input */
+        noInput = !tlsPtr->server && !tlsPtr->haveCtx;
+        if (tlsPtr->inLen == 0 && !noInput) {
+            if (tlsPtr->postHandshake) {
+                /*
+                 * A post-handshake message, e.g. a TLS 1.3 session ticket,
+                 * was consumed without a reply. Nothing more is expected
+                 * from the peer so go back to transferring data.
+                 */
+                IocpTlsResume(lockedChanPtr);
+            }
+            return;             /* Wait for more data from peer */
+        }
+
+        inBufs[0].BufferType = SECBUFFER_TOKEN;
+        inBufs[0].pvBuffer   = tlsPtr->inBytes;
+        inBufs[0].cbBuffer   = tlsPtr->inLen;
+        inBufs[1].BufferType = SECBUFFER_EMPTY;
+        inBufs[1].pvBuffer   = NULL;
+        inBufs[1].cbBuffer   = 0;
+        inDesc.ulVersion     = SECBUFFER_VERSION;
+        inDesc.cBuffers      = 2;
+        inDesc.pBuffers      = inBufs;
+
+        outBufs[0].BufferType = SECBUFFER_TOKEN;
+        outBufs[0].pvBuffer   = NULL;
+        outBufs[0].cbBuffer   = 0;
+        outDesc.ulVersion     = SECBUFFER_VERSION;
+        outDesc.cBuffers      = 1;
+        outDesc.pBuffers      = outBufs;
+
+        if (tlsPtr->server) {
+            status = AcceptSecurityContext(
+                &tlsPtr->cred, tlsPtr->haveCtx ? &tlsPtr->ctx : NULL, &inDesc,
+                IOCP_TLS_ASC_FLAGS, 0, &tlsPtr->ctx, &outDesc, &attrs, NULL);
+        } else {
+            status = InitializeSecurityContextW(
+                &tlsPtr->cred, tlsPtr->haveCtx ? &tlsPtr->ctx : NULL,
+                tlsPtr->serverName,
+                IOCP_TLS_ISC_FLAGS | (tlsPtr->verify ? 0 : ISC_REQ_MANUAL_CRED_VALIDATION),
+                0, 0, noInput ? NULL : &inDesc, 0, &tlsPtr->ctx, &outDesc,
+                &attrs, NULL);
+        }
+        IOCP_TRACE(("IocpTlsHandshake: lockedChanPtr=%p status=0x%x inLen=%d outLen=%d\n", lockedChanPtr, status, tlsPtr->inLen, outBufs[0].cbBuffer));
+
+        if (status == SEC_E_INCOMPLETE_MESSAGE)
+            return;             /* Wait for rest of the message */
+
+        /* Send tokens, including alerts generated on failure */
+        winError = ERROR_SUCCESS;
+        if (outBufs[0].pvBuffer) {
+            if (outBufs[0].cbBuffer) {
+                /* A renegotiation. Wait for the peer to complete it. */
+                tlsPtr->postHandshake = 0;
+                winError = IocpTlsSend(lockedChanPtr, outBufs[0].pvBuffer,
+                                       outBufs[0].cbBuffer);
+            }
+            FreeContextBuffer(outBufs[0].pvBuffer);
+        }
+
+        if (status != SEC_E_OK && status != SEC_I_CONTINUE_NEEDED &&
+            status != SEC_I_INCOMPLETE_CREDENTIALS) {
+            IocpTlsFail(lockedChanPtr, status);
+            return;
+        }
+        tlsPtr->haveCtx = 1;
+        if (winError != ERROR_SUCCESS) {
+            IocpTlsFail(lockedChanPtr, winError);
+            return;
+        }
+
+        if (status == SEC_I_INCOMPLETE_CREDENTIALS) {
+            /* Server asked for a client certificate. Retry without one. */
+            if (++credRetries > 1) {
+                IocpTlsFail(lockedChanPtr, status);
+                return;
+            }
+            continue;
+        }
+
+        if (!noInput)
+            IocpTlsKeepExtra(tlsPtr, inBufs[1].BufferType == SECBUFFER_EXTRA ?
+                             &inBufs[1] : NULL);
+
+        if (status == SEC_E_OK) {
+            status = QueryContextAttributesW(&tlsPtr->ctx,
+                                             SECPKG_ATTR_STREAM_SIZES,
+                                             &tlsPtr->sizes);
+            if (status != SEC_E_OK) {
+                IocpTlsFail(lockedChanPtr, status);
+                return;
+            }
+            IocpTlsResume(lockedChanPtr);
+            return;
+        }
+        /* SEC_I_CONTINUE_NEEDED. Loop if input remains, else wait. */
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsDecrypt --
+ *
+ *    Decrypts complete records in the input accumulator and queues the
+ *    plaintext on the channel's inputBuffers. Called from the completion
+ *    thread, or the Tcl thread when TLS is enabled.
+ *
+ * Results:
+ *    Non-0 if anything, including EOF or an error, was queued.
+ *
+ * Side effects:
+ *    Buffers are queued on inputBuffers. A renegotiation or post-handshake
+ *    message from the peer puts the session back into handshake state.
+ *
+ *------------------------------------------------------------------------
+ */
+static int
+IocpTlsDecrypt(
+    IocpChannel *lockedChanPtr) /* Locked on entry and return */
+{
+    IocpTls *tlsPtr = lockedChanPtr->tlsPtr;
+    int      queued = 0;
+
+    while (tlsPtr->state == IOCP_TLS_OPEN && tlsPtr->inLen > 0) {
+        SecBuffer       bufs[4];
+        SecBufferDesc   desc;
+        SecBuffer      *dataPtr  = NULL;
+        SecBuffer      *extraPtr = NULL;
+        SECURITY_STATUS status;
+        int             i;
+
+        bufs[0].BufferType = SECBUFFER_DATA;
+        bufs[0].pvBuffer   = tlsPtr->inBytes;
+        bufs[0].cbBuffer   = tlsPtr->inLen;
+        for (i = 1; i < 4; ++i) {
+            bufs[i].BufferType = SECBUFFER_EMPTY;
+            bufs[i].pvBuffer   = NULL;
+            bufs[i].cbBuffer   = 0;
+        }
+        desc.ulVersion = SECBUFFER_VERSION;
+        desc.cBuffers  = 4;
+        desc.pBuffers  = bufs;
+
+        status = DecryptMessage(&tlsPtr->ctx, &desc, 0, NULL);
+        if (status == SEC_E_INCOMPLETE_MESSAGE)
+            break;              /* Wait for rest of record */
+        if (status != SEC_E_OK && status != SEC_I_RENEGOTIATE &&
+            status != SEC_I_CONTEXT_EXPIRED) {
+            IocpTlsFail(lockedChanPtr, status);
+            return 1;
+        }
+
+        for (i = 1; i < 4; ++i) {
+            if (bufs[i].BufferType == SECBUFFER_DATA && dataPtr == NULL)
+                dataPtr = &bufs[i];
+            else if (bufs[i].BufferType == SECBUFFER_EXTRA && extraPtr == NULL)
+                extraPtr = &bufs[i];
+        }
+
+        if (dataPtr && dataPtr->cbBuffer > 0) {
+            IocpBuffer *bufPtr = IocpBufferNew(dataPtr->cbBuffer,
+                                               IOCP_BUFFER_OP_READ,
+                                               IOCP_BUFFER_F_WINSOCK);
+            if (bufPtr == NULL) {
+                IocpTlsFail(lockedChanPtr, WSAENOBUFS);
+                return 1;
+            }
+            IocpBufferCopyIn(bufPtr, dataPtr->pvBuffer, dataPtr->cbBuffer);
+            IocpChannelQueueInput(lockedChanPtr, bufPtr);
+            queued = 1;
+        }
+
+        /* Decryption is in place so extra data is at the tail */
+        IocpTlsKeepExtra(tlsPtr, extraPtr);
+
+        if (status == SEC_I_CONTEXT_EXPIRED) {
+            /* Peer sent close_notify. Queue a zero length buffer as EOF. */
+            IocpBuffer *bufPtr;
+            tlsPtr->state = IOCP_TLS_CLOSED;
+            tlsPtr->inLen = 0;
+            bufPtr = IocpBufferNew(0, IOCP_BUFFER_OP_READ, IOCP_BUFFER_F_WINSOCK);
+            if (bufPtr)
+                IocpChannelQueueInput(lockedChanPtr, bufPtr);
+            return 1;
+        }
+        if (status == SEC_I_RENEGOTIATE) {
+            /*
+             * Handshake messages from the peer, e.g. TLS 1.3 session
+             * tickets or a TLS 1.2 renegotiation request. The remaining
+             * data is fed to the handshake which returns to OPEN state on
+             * completion, or as soon as the message is consumed if it
+             * needs no reply.
+             */
+            tlsPtr->state = IOCP_TLS_HANDSHAKE;
+            tlsPtr->postHandshake = 1;
+            lockedChanPtr->flags |= IOCP_CHAN_F_TLS_HANDSHAKE;
+            IocpTlsHandshake(lockedChanPtr);
+            if (tlsPtr->state == IOCP_TLS_FAILED)
+                return 1;
+        }
+    }
+    return queued;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsProcessInput --
+ *
+ *    Runs accumulated input through the handshake or decryption as
+ *    appropriate for the session state.
+ *
+ * Results:
+ *    Non-0 if anything was queued on inputBuffers.
+ *
+ * Side effects:
+ *    See IocpTlsHandshake and IocpTlsDecrypt. If no input was produced,
+ *    reads are posted to receive the rest of the handshake or record.
+ *
+ *------------------------------------------------------------------------
+ */
+static int
+IocpTlsProcessInput(
+    IocpChannel *lockedChanPtr) /* Locked on entry and return */
+{
+    IocpTls *tlsPtr = lockedChanPtr->tlsPtr;
+    int      queued = 0;
+
+    if (tlsPtr->state == IOCP_TLS_HANDSHAKE)
+        IocpTlsHandshake(lockedChanPtr);
+    if (tlsPtr->state == IOCP_TLS_OPEN)
+        queued = IocpTlsDecrypt(lockedChanPtr);
+    if (tlsPtr->state == IOCP_TLS_FAILED)
+        queued = 1;
+
+    /*
+     * The Tcl thread is not woken if no input was produced, e.g. during the
+     * handshake or when only part of a record has arrived, so it will not
+     * repost reads. Post them here instead.
+     */
+    if (!queued &&
+        (tlsPtr->state == IOCP_TLS_HANDSHAKE || tlsPtr->state == IOCP_TLS_OPEN) &&
+        lockedChanPtr->state == IOCP_STATE_OPEN &&
+        (lockedChanPtr->flags & (IOCP_CHAN_F_REMOTE_EOF|IOCP_CHAN_F_WRITEONLY)) == 0) {
+        IocpWinError winError = IocpChannelPostReads(lockedChanPtr);
+        if (winError != ERROR_SUCCESS) {
+            IocpTlsFail(lockedChanPtr, winError);
+            queued = 1;
+        }
+    }
+    return queued;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsReceive --
+ *
+ *    Processes a completed read on a TLS channel. Called from the
+ *    completion thread in place of queueing the buffer on inputBuffers.
+ *
+ * Results:
+ *    Non-0 if data, EOF or an error was queued on inputBuffers and the
+ *    reader needs to be notified.
+ *
+ * Side effects:
+ *    bufPtr is no longer owned by the caller. Threads blocked waiting
+ *    for the handshake to complete are woken.
+ *
+ *------------------------------------------------------------------------
+ */
+int
+IocpTlsReceive(
+    IocpChannel *lockedChanPtr, /* Locked on entry and return */
+    IocpBuffer  *bufPtr)        /* Completed read, chanPtr already cleared */
+{
+    IocpTls     *tlsPtr = lockedChanPtr->tlsPtr;
+    IocpTlsState oldState = tlsPtr->state;
+    IocpWinError winError;
+    int          queued;
+
+    if (oldState == IOCP_TLS_FAILED || oldState == IOCP_TLS_CLOSED) {
+        /* Error or EOF already queued. Nothing more to pass up. */
+        IocpBufferFree(bufPtr);
+        return 0;
+    }
+
+    if (bufPtr->winError != ERROR_SUCCESS || bufPtr->data.len == 0) {
+        if (oldState == IOCP_TLS_HANDSHAKE) {
+            IocpTlsFail(lockedChanPtr, bufPtr->winError != ERROR_SUCCESS ?
+                        bufPtr->winError : WSAECONNRESET);
+            IocpBufferFree(bufPtr);
+            queued = 1;
+        } else {
+            /* EOF or error on the connection is passed up as is */
+            IocpChannelQueueInput(lockedChanPtr, bufPtr);
+            return 1;
+        }
+    } else {
+        winError = IocpTlsAppend(tlsPtr,
+                                 bufPtr->data.bytes + bufPtr->data.begin,
+                                 bufPtr->data.len);
+        IocpBufferFree(bufPtr);
+        if (winError != ERROR_SUCCESS) {
+            IocpTlsFail(lockedChanPtr, winError);
+            queued = 1;
+        } else {
+            queued = IocpTlsProcessInput(lockedChanPtr);
+        }
+    }
+
+    if (oldState == IOCP_TLS_HANDSHAKE && tlsPtr->state != IOCP_TLS_HANDSHAKE) {
+        /* Writers waiting on the handshake can proceed (or fail) */
+        IocpChannelNudgeThread(lockedChanPtr, IOCP_CHAN_F_BLOCKED_WRITE, 0);
+    }
+    return queued;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsPostWrite --
+ *
+ *    Encrypts data into a single TLS record and posts it to the channel.
+ *    Follows the conventions of the postwrite() function in IocpChannelVtbl.
+ *    Must not be called while IOCP_CHAN_F_TLS_HANDSHAKE is set.
+ *
+ * Results:
+ *    If data is written, returns 0 and stores the number of plaintext
+ *    bytes consumed in *countPtr. If the write would block, returns 0 and
+ *    stores 0 in *countPtr. On error, returns a Windows error code.
+ *
+ * Side effects:
+ *    A write is posted.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpWinError
+IocpTlsPostWrite(
+    IocpChannel *lockedChanPtr, /* Locked on entry and return */
+    const char  *bytes,         /* Plaintext */
+    int          nbytes,        /* Number of plaintext bytes */
+    int         *countPtr)      /* Output - number of bytes consumed */
+{
+    IocpTls        *tlsPtr = lockedChanPtr->tlsPtr;
+    IocpBuffer     *bufPtr;
+    SecBuffer       bufs[4];
+    SecBufferDesc   desc;
+    SECURITY_STATUS status;
+    IocpWinError    winError;
+    int             len;
+
+    IOCP_ASSERT((lockedChanPtr->flags & IOCP_CHAN_F_TLS_HANDSHAKE) == 0);
+    if (tlsPtr->closeSent)
+        return WSAESHUTDOWN;
+    switch (tlsPtr->state) {
+    case IOCP_TLS_OPEN:
+        break;
+    case IOCP_TLS_FAILED:
+        return tlsPtr->winError;
+    default:
+        return WSAESHUTDOWN;
+    }
+
+    if (lockedChanPtr->pendingWrites >= lockedChanPtr->maxPendingWrites) {
+        *countPtr = 0;
+        return ERROR_SUCCESS;
+    }
+
+    len = nbytes;
+    if (len > (int) tlsPtr->sizes.cbMaximumMessage)
+        len = (int) tlsPtr->sizes.cbMaximumMessage;
+    bufPtr = IocpBufferNew(tlsPtr->sizes.cbHeader + len + tlsPtr->sizes.cbTrailer,
+                           IOCP_BUFFER_OP_WRITE, IOCP_BUFFER_F_WINSOCK);
+    if (bufPtr == NULL)
+        return WSAENOBUFS;
+    memcpy(bufPtr->data.bytes + tlsPtr->sizes.cbHeader, bytes, len);
+
+    bufs[0].BufferType = SECBUFFER_STREAM_HEADER;
+    bufs[0].pvBuffer   = bufPtr->data.bytes;
+    bufs[0].cbBuffer   = tlsPtr->sizes.cbHeader;
+    bufs[1].BufferType = SECBUFFER_DATA;
+    bufs[1].pvBuffer   = bufPtr->data.bytes + tlsPtr->sizes.cbHeader;
+    bufs[1].cbBuffer   = len;
+    bufs[2].BufferType = SECBUFFER_STREAM_TRAILER;
+    bufs[2].pvBuffer   = bufPtr->data.bytes + tlsPtr->sizes.cbHeader + len;
+    bufs[2].cbBuffer   = tlsPtr->sizes.cbTrailer;
+    bufs[3].BufferType = SECBUFFER_EMPTY;
+    bufs[3].pvBuffer   = NULL;
+    bufs[3].cbBuffer   = 0;
+    desc.ulVersion = SECBUFFER_VERSION;
+    desc.cBuffers  = 4;
+    desc.pBuffers  = bufs;
+
+    status = EncryptMessage(&tlsPtr->ctx, 0, &desc, 0);
+    if (status != SEC_E_OK) {
+        IocpBufferFree(bufPtr);
+        return status;
+    }
+    /* The trailer may be shorter than the maximum */
+    bufPtr->data.len = bufs[0].cbBuffer + bufs[1].cbBuffer + bufs[2].cbBuffer;
+
+    winError = lockedChanPtr->vtblPtr->postbuffer(lockedChanPtr, bufPtr);
+    if (winError != ERROR_SUCCESS) {
+        IocpBufferFree(bufPtr);
+        return winError;
+    }
+    *countPtr = len;
+    return ERROR_SUCCESS;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsShutdown --
+ *
+ *    Sends a TLS close_notify alert if the session is open. Called when
+ *    the channel is closed or shut down for writing.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    No further writes are permitted. Received data is still decrypted.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpTlsShutdown(
+    IocpChannel *lockedChanPtr) /* Locked on entry and return */
+{
+    IocpTls        *tlsPtr = lockedChanPtr->tlsPtr;
+    DWORD           shutdownToken = SCHANNEL_SHUTDOWN;
+    SecBuffer       buf;
+    SecBufferDesc   desc;
+    SECURITY_STATUS status;
+    ULONG           attrs;
+
+    if (tlsPtr == NULL || tlsPtr->state != IOCP_TLS_OPEN || tlsPtr->closeSent)
+        return;
+    tlsPtr->closeSent = 1;
+    if (lockedChanPtr->state != IOCP_STATE_OPEN)
+        return;
+
+    buf.BufferType = SECBUFFER_TOKEN;
+    buf.pvBuffer   = &shutdownToken;
+    buf.cbBuffer   = sizeof(shutdownToken);
+    desc.ulVersion = SECBUFFER_VERSION;
+    desc.cBuffers  = 1;
+    desc.pBuffers  = &buf;
+    if (ApplyControlToken(&tlsPtr->ctx, &desc) != SEC_E_OK)
+        return;
+
+    buf.BufferType = SECBUFFER_TOKEN;
+    buf.pvBuffer   = NULL;
+    buf.cbBuffer   = 0;
+    if (tlsPtr->server) {
+        status = AcceptSecurityContext(&tlsPtr->cred, &tlsPtr->ctx, NULL,
+                                       IOCP_TLS_ASC_FLAGS, 0, NULL, &desc,
+                                       &attrs, NULL);
+    } else {
+        status = InitializeSecurityContextW(&tlsPtr->cred, &tlsPtr->ctx,
+                                            tlsPtr->serverName,
+                                            IOCP_TLS_ISC_FLAGS, 0, 0, NULL, 0,
+                                            NULL, &desc, &attrs, NULL);
+    }
+    if (buf.pvBuffer) {
+        if (status == SEC_E_OK && buf.cbBuffer)
+            IocpTlsSend(lockedChanPtr, buf.pvBuffer, buf.cbBuffer);
+        FreeContextBuffer(buf.pvBuffer);
+    }
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsRelease --
+ *
+ *    Releases the TLS state of a channel. Called when the channel is freed.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    Schannel handles are released.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpTlsRelease(
+    IocpChannel *lockedChanPtr) /* Locked on entry and return */
+{
+    if (lockedChanPtr->tlsPtr) {
+        IocpTlsFree(lockedChanPtr->tlsPtr);
+        lockedChanPtr->tlsPtr = NULL;
+    }
+    lockedChanPtr->flags &= ~IOCP_CHAN_F_TLS_HANDSHAKE;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsLoadCertificate --
+ *
+ *    Loads the certificate and private key for the server role from a
+ *    PFX (PKCS #12) file.
+ *
+ * Results:
+ *    The certificate context or NULL on error with a message in interp.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static PCCERT_CONTEXT
+IocpTlsLoadCertificate(
+    Tcl_Interp *interp,         /* May be NULL */
+    const char *path,           /* PFX file */
+    const char *password)       /* May be NULL */
+{
+    Tcl_Channel     chan;
+    Tcl_Obj        *dataObj;
+    CRYPT_DATA_BLOB blob;
+    HCERTSTORE      hStore;
+    PCCERT_CONTEXT  certPtr = NULL;
+    WCHAR          *wpassword;
+    Tcl_Size        len;
+
+    chan = Tcl_OpenFileChannel(interp, path, "rb", 0);
+    if (chan == NULL)
+        return NULL;
+    dataObj = Tcl_NewObj();
+    Tcl_IncrRefCount(dataObj);
+    if (Tcl_SetChannelOption(interp, chan, "-translation", "binary") != TCL_OK ||
+        Tcl_ReadChars(chan, dataObj, -1, 0) < 0) {
+        Tcl_Close(NULL, chan);
+        Tcl_DecrRefCount(dataObj);
+        return NULL;
+    }
+    Tcl_Close(NULL, chan);
+
+    blob.pbData = (BYTE *) Tcl_GetByteArrayFromObj(dataObj, &len);
+    blob.cbData = (DWORD) len;
+    wpassword   = IocpTlsWinChars(password ? password : "");
+    hStore = PFXImportCertStore(&blob, wpassword, PKCS12_NO_PERSIST_KEY);
+    SecureZeroMemory(wpassword, wcslen(wpassword) * sizeof(WCHAR));
+    ckfree(wpassword);
+    Tcl_DecrRefCount(dataObj);
+    if (hStore == NULL) {
+        Iocp_ReportLastWindowsError(interp, "Could not load certificate: ");
+        return NULL;
+    }
+
+    /* Pick the first certificate that has a private key */
+    while ((certPtr = CertEnumCertificatesInStore(hStore, certPtr)) != NULL) {
+        DWORD size = 0;
+        if (CertGetCertificateContextProperty(certPtr, CERT_KEY_PROV_INFO_PROP_ID, NULL, &size) ||
+            CertGetCertificateContextProperty(certPtr, CERT_KEY_CONTEXT_PROP_ID, NULL, &size) ||
+            CertGetCertificateContextProperty(certPtr, CERT_NCRYPT_KEY_HANDLE_PROP_ID, NULL, &size)) {
+            certPtr = CertDuplicateCertificateContext(certPtr);
+            break;
+        }
+    }
+    /* Certificate contexts keep the store alive as needed */
+    CertCloseStore(hStore, 0);
+    if (certPtr == NULL && interp) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("No certificate with a private key found in \"%s\".", path));
+    }
+    return certPtr;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsSetSpec --
+ *
+ *    Enables TLS on a connected channel from a -tls option value. The
+ *    value is a dictionary with the keys
+ *      role       - client (default) or server
+ *      servername - client only. Name of the server, used for SNI and
+ *                   certificate verification
+ *      verify     - client only. Boolean indicating whether the server
+ *                   certificate is verified. Default true.
+ *      certificate - server only. Path to a PFX file containing the
+ *                   server certificate and private key
+ *      password   - server only. Password for the PFX file
+ *
+ * Results:
+ *    TCL_OK if TLS was enabled, TCL_ERROR if the option value is invalid
+ *    or TLS cannot be enabled on the channel. A handshake that fails is
+ *    not reported here but on subsequent reads and writes.
+ *
+ * Side effects:
+ *    The handshake is started. Any data already received, including that
+ *    in the Tcl channel buffers, is treated as the start of the handshake.
+ *    The channel lock is released while the certificate is loaded.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode
+IocpTlsSetSpec(
+    Tcl_Interp  *interp,        /* For error reporting. May be NULL */
+    IocpChannel *lockedChanPtr, /* Locked on entry, locked on exit but
+                                 * unlocked in between */
+    const char  *specPtr)       /* Option value */
+{
+    static const char *const specKeys[] = {
+        "certificate", "password", "role", "servername", "verify", NULL
+    };
+    enum specKeys {
+        SPEC_CERTIFICATE, SPEC_PASSWORD, SPEC_ROLE, SPEC_SERVERNAME, SPEC_VERIFY
+    };
+    static const char *const roles[] = { "client", "server", NULL };
+    Tcl_Obj        *specObj;
+    Tcl_Obj       **objs;
+    Tcl_Size        nobjs;
+    Tcl_Size        i;
+    int             keyIndex;
+    int             server = 0;
+    int             verify = 1;
+    const char     *serverName = NULL;
+    const char     *certPath = NULL;
+    const char     *password = NULL;
+    SCHANNEL_CRED   schannelCred;
+    SECURITY_STATUS status;
+    IocpTls        *tlsPtr = NULL;
+    Tcl_DString     ds;
+    int             nbuffered;
+    IocpWinError    winError = ERROR_SUCCESS;
+    IocpTclCode     ret = TCL_ERROR;
+
+    specObj = Tcl_NewStringObj(specPtr, -1);
+    Tcl_IncrRefCount(specObj);
+    Tcl_DStringInit(&ds);
+
+    if (Tcl_ListObjGetElements(interp, specObj, &nobjs, &objs) != TCL_OK)
+        goto vamoose;
+    if (nobjs & 1) {
+        if (interp)
+            Tcl_SetResult(interp, "Invalid TLS configuration. Must be a dictionary.", TCL_STATIC);
+        goto vamoose;
+    }
+    for (i = 0; i < nobjs; i += 2) {
+        if (Tcl_GetIndexFromObj(interp, objs[i], specKeys, "TLS key",
+                                TCL_EXACT, &keyIndex) != TCL_OK)
+            goto vamoose;
+        switch ((enum specKeys) keyIndex) {
+        case SPEC_CERTIFICATE: certPath = Tcl_GetString(objs[i+1]); break;
+        case SPEC_PASSWORD:    password = Tcl_GetString(objs[i+1]); break;
+        case SPEC_SERVERNAME:  serverName = Tcl_GetString(objs[i+1]); break;
+        case SPEC_ROLE:
+            if (Tcl_GetIndexFromObj(interp, objs[i+1], roles, "role",
+                                    TCL_EXACT, &server) != TCL_OK)
+                goto vamoose;
+            break;
+        case SPEC_VERIFY:
+            if (Tcl_GetBooleanFromObj(interp, objs[i+1], &verify) != TCL_OK)
+                goto vamoose;
+            break;
+        }
+    }
+
+    if (lockedChanPtr->tlsPtr) {
+        if (interp)
+            Tcl_SetResult(interp, "TLS is already enabled on the channel.", TCL_STATIC);
+        goto vamoose;
+    }
+    if (lockedChanPtr->vtblPtr->postbuffer == NULL) {
+        if (interp)
+            Tcl_SetResult(interp, "TLS is not supported on this channel.", TCL_STATIC);
+        goto vamoose;
+    }
+    if (lockedChanPtr->state != IOCP_STATE_OPEN ||
+        (lockedChanPtr->flags & (IOCP_CHAN_F_REMOTE_EOF|IOCP_CHAN_F_READONLY|IOCP_CHAN_F_WRITEONLY))) {
+        if (interp)
+            Tcl_SetResult(interp, "TLS can only be enabled on a connected socket.", TCL_STATIC);
+        goto vamoose;
+    }
+    if (lockedChanPtr->spliceToPtr || lockedChanPtr->spliceFromPtr) {
+        if (interp)
+            Tcl_SetResult(interp, "TLS cannot be enabled on a spliced channel.", TCL_STATIC);
+        goto vamoose;
+    }
+    if (lockedChanPtr->compressPtr) {
+        if (interp)
+            Tcl_SetResult(interp, "TLS cannot be combined with compression.", TCL_STATIC);
+        goto vamoose;
+    }
+    if (server) {
+        if (certPath == NULL) {
+            if (interp)
+                Tcl_SetResult(interp, "A certificate must be specified for the server role.", TCL_STATIC);
+            goto vamoose;
+        }
+    } else if (verify && (serverName == NULL || serverName[0] == '\0')) {
+        if (interp)
+            Tcl_SetResult(interp, "A server name must be specified to verify the server certificate.", TCL_STATIC);
+        goto vamoose;
+    }
+
+    tlsPtr = ckalloc(sizeof(*tlsPtr));
+    memset(tlsPtr, 0, sizeof(*tlsPtr));
+    SecInvalidateHandle(&tlsPtr->cred);
+    tlsPtr->server = server;
+    tlsPtr->verify = verify;
+    tlsPtr->state  = IOCP_TLS_HANDSHAKE;
+
+    /* Keep a normalized copy of the value, leaving out the password */
+    Tcl_DStringAppendElement(&ds, "role");
+    Tcl_DStringAppendElement(&ds, roles[server]);
+    if (server) {
+        Tcl_DStringAppendElement(&ds, "certificate");
+        Tcl_DStringAppendElement(&ds, certPath);
+    } else {
+        if (serverName) {
+            Tcl_DStringAppendElement(&ds, "servername");
+            Tcl_DStringAppendElement(&ds, serverName);
+            tlsPtr->serverName = IocpTlsWinChars(serverName);
+        }
+        Tcl_DStringAppendElement(&ds, "verify");
+        Tcl_DStringAppendElement(&ds, verify ? "1" : "0");
+    }
+    tlsPtr->spec = ckalloc(Tcl_DStringLength(&ds) + 1);
+    memcpy(tlsPtr->spec, Tcl_DStringValue(&ds), Tcl_DStringLength(&ds) + 1);
+
+    /*
+     * Loading the certificate involves file I/O so it, and acquiring the
+     * credentials, are done without holding the channel lock. The caller
+     * holds a reference so the channel is not freed meanwhile. The checks
+     * above are on state only changed by this thread, except for the
+     * connection closing, which the handshake deals with below.
+     */
+    IocpChannelUnlock(lockedChanPtr);
+    if (server) {
+        tlsPtr->certPtr = IocpTlsLoadCertificate(interp, certPath, password);
+        if (tlsPtr->certPtr == NULL) {
+            IocpChannelLock(lockedChanPtr);
+            goto vamoose;
+        }
+    }
+
+    memset(&schannelCred, 0, sizeof(schannelCred));
+    schannelCred.dwVersion = SCHANNEL_CRED_VERSION;
+    schannelCred.dwFlags   = SCH_USE_STRONG_CRYPTO;
+    if (server) {
+        schannelCred.cCreds  = 1;
+        schannelCred.paCred  = &tlsPtr->certPtr;
+    } else {
+        schannelCred.dwFlags |= SCH_CRED_NO_DEFAULT_CREDS;
+        schannelCred.dwFlags |= verify ? SCH_CRED_AUTO_CRED_VALIDATION
+            : (SCH_CRED_MANUAL_CRED_VALIDATION | SCH_CRED_NO_SERVERNAME_CHECK);
+    }
+    status = AcquireCredentialsHandleW(
+        NULL, UNISP_NAME_W,
+        server ? SECPKG_CRED_INBOUND : SECPKG_CRED_OUTBOUND,
+        NULL, &schannelCred, NULL, NULL, &tlsPtr->cred, NULL);
+    if (status != SEC_E_OK) {
+        SecInvalidateHandle(&tlsPtr->cred);
+        Iocp_ReportWindowsError(interp, status, "Could not acquire TLS credentials: ");
+        IocpChannelLock(lockedChanPtr);
+        goto vamoose;
+    }
+
+    /*
+     * Data already moved into the Tcl channel buffers, e.g. by a gets of
+     * a STARTTLS reply, precedes anything on inputBuffers. As for splices,
+     * the channel is expected to be in binary mode. The option cannot fail
+     * past this point so the data is not lost.
+     */
+    nbuffered = Tcl_InputBuffered(lockedChanPtr->channel);
+    if (nbuffered > 0) {
+        char *bytes = ckalloc(nbuffered);
+        int   nread = Tcl_Read(lockedChanPtr->channel, bytes, nbuffered);
+        if (nread > 0)
+            winError = IocpTlsAppend(tlsPtr, bytes, nread);
+        ckfree(bytes);
+    }
+    IocpChannelLock(lockedChanPtr);
+
+    lockedChanPtr->tlsPtr = tlsPtr;
+    lockedChanPtr->flags |= IOCP_CHAN_F_TLS_HANDSHAKE;
+    tlsPtr = NULL;              /* Now owned by the channel */
+    if (winError != ERROR_SUCCESS)
+        IocpTlsFail(lockedChanPtr, winError);
+
+    /*
+     * Data received before TLS was enabled, e.g. a client hello that
+     * arrived with the accept, belongs to the handshake.
+     */
+    while (lockedChanPtr->inputBuffers.headPtr &&
+           lockedChanPtr->tlsPtr->state == IOCP_TLS_HANDSHAKE) {
+        IocpBuffer  *bufPtr = CONTAINING_RECORD(lockedChanPtr->inputBuffers.headPtr, IocpBuffer, link);
+        if (bufPtr->winError != ERROR_SUCCESS || bufPtr->data.len == 0)
+            break;              /* Leave EOF and errors for the reader */
+        winError = IocpTlsAppend(lockedChanPtr->tlsPtr,
+                                 bufPtr->data.bytes + bufPtr->data.begin,
+                                 bufPtr->data.len);
+        if (winError != ERROR_SUCCESS) {
+            IocpTlsFail(lockedChanPtr, winError);
+            break;
+        }
+        lockedChanPtr->inputBytes -= bufPtr->data.len;
+        IocpListPopFront(&lockedChanPtr->inputBuffers);
+        IocpBufferFree(bufPtr);
+    }
+    lockedChanPtr->lastInputByte = -1;
+    if (lockedChanPtr->inputBuffers.headPtr &&
+        lockedChanPtr->tlsPtr->state == IOCP_TLS_HANDSHAKE) {
+        /* Connection already closed or failed */
+        lockedChanPtr->tlsPtr->state    = IOCP_TLS_FAILED;
+        lockedChanPtr->tlsPtr->winError = WSAECONNRESET;
+        lockedChanPtr->flags &= ~IOCP_CHAN_F_TLS_HANDSHAKE;
+    }
+
+    IocpTlsProcessInput(lockedChanPtr);
+    /*
+     * A handshake that fails here, e.g. on data already received, is not
+     * an error for the option. Like a failure later in the handshake, it
+     * is reported on the next read or write and by -tlsstatus. TLS stays
+     * enabled so the channel cannot silently revert to plaintext. In all
+     * cases data, EOF or errors may have been queued.
+     */
+    IocpChannelNudgeThread(lockedChanPtr, 0, 0);
+    ret = TCL_OK;
+
+vamoose:
+    if (tlsPtr)
+        IocpTlsFree(tlsPtr);
+    Tcl_DStringFree(&ds);
+    Tcl_DecrRefCount(specObj);
+    if (ret != TCL_OK)
+        Tcl_SetErrno(EINVAL);
+    return ret;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsGetSpec --
+ *
+ *    Returns the -tls option value of a channel. The password is never
+ *    returned.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The value is appended to dsPtr.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpTlsGetSpec(
+    IocpChannel *lockedChanPtr, /* Locked on entry and return */
+    Tcl_DString *dsPtr)
+{
+    if (lockedChanPtr->tlsPtr)
+        Tcl_DStringAppend(dsPtr, lockedChanPtr->tlsPtr->spec, -1);
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpTlsGetStatus --
+ *
+ *    Returns the state of the TLS session of a channel as a dictionary
+ *    with the keys state, protocol (once open) and error (on failure).
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The value is appended to dsPtr.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+IocpTlsGetStatus(
+    IocpChannel *lockedChanPtr, /* Locked on entry and return */
+    Tcl_DString *dsPtr)
+{
+    static const char *const states[] = {
+        "handshake", "open", "closed", "failed"
+    };
+    IocpTls *tlsPtr = lockedChanPtr->tlsPtr;
+
+    Tcl_DStringAppendElement(dsPtr, "state");
+    if (tlsPtr == NULL) {
+        Tcl_DStringAppendElement(dsPtr, "none");
+        return;
+    }
+    Tcl_DStringAppendElement(dsPtr, states[tlsPtr->state]);
+
+    if (tlsPtr->haveCtx && tlsPtr->state != IOCP_TLS_FAILED) {
+        SecPkgContext_ConnectionInfo info;
+        if (QueryContextAttributesW(&tlsPtr->ctx, SECPKG_ATTR_CONNECTION_INFO,
+                                    &info) == SEC_E_OK) {
+            const char *protocol = NULL;
+            if (info.dwProtocol & SP_PROT_TLS1_0)
+                protocol = "tls1.0";
+            else if (info.dwProtocol & SP_PROT_TLS1_1)
+                protocol = "tls1.1";
+            else if (info.dwProtocol & SP_PROT_TLS1_2)
+                protocol = "tls1.2";
+#ifdef SP_PROT_TLS1_3
+            else if (info.dwProtocol & SP_PROT_TLS1_3)
+                protocol = "tls1.3";
+#endif
+            if (protocol) {
+                Tcl_DStringAppendElement(dsPtr, "protocol");
+                Tcl_DStringAppendElement(dsPtr, protocol);
+            }
+        }
+    }
+
+    if (tlsPtr->state == IOCP_TLS_FAILED) {
+        Tcl_Obj    *objPtr = Iocp_MapWindowsError(tlsPtr->winError, NULL, NULL);
+        Tcl_IncrRefCount(objPtr);
+        Tcl_DStringAppendElement(dsPtr, "error");
+        Tcl_DStringAppendElement(dsPtr, Tcl_GetString(objPtr));
+        Tcl_DecrRefCount(objPtr);
+    }
+}
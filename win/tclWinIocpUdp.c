@@ -0,0 +1,1295 @@
+/*
+ * tclWinIocpUdp.c --
+ *
+ *	UDP support for Windows IOCP.
+ *
+ * Copyright (c) 2026 agent.
+ *
+ * See the file "license.terms" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+#include "tclWinIocp.h"
+#include "tclWinIocpWinsock.h"
+#include <limits.h>
+
+/*
+ * A UDP channel keeps several WSARecvFrom calls posted on the socket. Each
+ * completed receive holds exactly one datagram and is queued as is on the
+ * channel's inputBuffers so datagram boundaries are preserved until the
+ * data is consumed. The sender's address is stored in a UdpAddress header
+ * at the start of the buffer's data area with the payload following it
+ * (data.begin is set past the header). Outbound datagrams use the same
+ * layout with the header holding the destination.
+ *
+ * Reading through the Tcl channel layer returns payload bytes without any
+ * record of datagram boundaries. iocp::inet::recvmany and
+ * iocp::inet::sendmany work on whole datagrams and their addresses and
+ * move a batch of datagrams per call.
+ */
+
+#define IOCP_UDP_NAME_PREFIX "udp"
+
+#define IOCP_UDP_MAX_RECEIVES     8    /* Default number of posted receives */
+#define IOCP_UDP_MAX_SENDS        64   /* Default limit on writes via the
+                                        * Tcl channel layer */
+#define IOCP_UDP_MAX_PENDING      256  /* Limit for -maxpending{reads,writes} */
+#define IOCP_UDP_DEFAULT_DATAGRAM 8192 /* Default receive buffer size */
+#define IOCP_UDP_MAX_DATAGRAM     65507
+
+#ifndef SIO_UDP_CONNRESET
+# define SIO_UDP_CONNRESET _WSAIOW(IOC_VENDOR, 12)
+#endif
+
+/* Header at the start of the data area of datagram buffers */
+typedef struct UdpAddress {
+    IocpSockaddr addr;          /* Source or destination address */
+    INT          addrLen;       /* Length of addr. Written by WSARecvFrom */
+} UdpAddress;
+
+static void         UdpInit(IocpChannel *chanPtr);
+static int          UdpShutdown(Tcl_Interp *, IocpChannel *lockedChanPtr,
+                                int flags);
+static IocpWinError UdpPostRead(IocpChannel *lockedChanPtr);
+static IocpWinError UdpPostWrite(IocpChannel *lockedChanPtr, const char *bytes,
+                                 int nbytes, int *countPtr);
+static IocpTclCode  UdpGetOption(IocpChannel *lockedChanPtr, Tcl_Interp *interp,
+                                 int optIndex, Tcl_DString *dsPtr);
+static IocpTclCode  UdpSetOption(IocpChannel *lockedChanPtr, Tcl_Interp *interp,
+                                 int optIndex, const char *valuePtr);
+static IocpWinError UdpTranslateError(IocpChannel *lockedChanPtr,
+                                      IocpBuffer *bufPtr);
+
+/*
+ * UDP channel options. Note order must match order of string option names
+ * in the udpOptionNames array.
+ */
+enum UdpOption {
+    UDP_OPT_BROADCAST,
+    UDP_OPT_MAXDATAGRAM,
+    UDP_OPT_MAXPENDINGREADS,
+    UDP_OPT_MAXPENDINGWRITES,
+    UDP_OPT_MCASTADD,
+    UDP_OPT_MCASTDROP,
+    UDP_OPT_MCASTLOOP,
+    UDP_OPT_MCASTTTL,
+    UDP_OPT_REMOTE,
+    UDP_OPT_SOCKNAME,
+    UDP_OPT_SORCVBUF,
+    UDP_OPT_SOSNDBUF,
+    UDP_OPT_INVALID             /* Must be last */
+};
+static const char *udpOptionNames[] = {
+    "-broadcast",
+    "-maxdatagram",
+    "-maxpendingreads",
+    "-maxpendingwrites",
+    "-mcastadd",
+    "-mcastdrop",
+    "-mcastloop",
+    "-mcastttl",
+    "-remote",
+    "-sockname",
+    "-sorcvbuf",
+    "-sosndbuf",
+    NULL
+};
+
+static IocpChannelVtbl udpVtbl =  {
+    /* "Virtual" functions */
+    UdpInit,
+    WinsockClientFinit,
+    UdpShutdown,
+    NULL,                       /* Accept */
+    NULL,                       /* BlockingConnect */
+    NULL,                       /* AsyncConnected */
+    NULL,                       /* AsyncConnectFailed */
+    NULL,                       /* Disconnected */
+    UdpPostRead,
+    UdpPostWrite,
+    NULL,                       /* PostBuffer - no splicing into datagrams */
+    WinsockClientGetHandle,
+    UdpGetOption,
+    UdpSetOption,
+    UdpTranslateError,
+    /* Data members */
+    udpOptionNames,
+    sizeof(WinsockClient)
+};
+IOCP_INLINE int IocpIsUdp(IocpChannel *chanPtr) {
+    return (chanPtr->vtblPtr == &udpVtbl);
+}
+IOCP_INLINE UdpAddress *UdpBufferAddress(IocpBuffer *bufPtr) {
+    return (UdpAddress *) bufPtr->data.bytes;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * UdpInit --
+ *
+ *    Initializes the UDP part of a IocpChannel structure.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static void UdpInit(IocpChannel *chanPtr)
+{
+    WinsockClient *wsPtr = IocpChannelToWinsockClient(chanPtr);
+
+    WinsockClientInit(chanPtr);
+    wsPtr->addresses.udp.remoteLen   = 0;
+    wsPtr->addresses.udp.family      = AF_INET;
+    wsPtr->addresses.udp.maxDatagram = IOCP_UDP_DEFAULT_DATAGRAM;
+    wsPtr->base.maxPendingReads  = IOCP_UDP_MAX_RECEIVES;
+    wsPtr->base.maxPendingWrites = IOCP_UDP_MAX_SENDS;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * UdpShutdown --
+ *
+ *    Conforms to the IocpChannel shutdown interface. Datagram sockets
+ *    cannot be half closed.
+ *
+ * Results:
+ *    0 on success, else a POSIX error code.
+ *
+ * Side effects:
+ *    The socket is closed. Pending I/O completes with errors.
+ *
+ *------------------------------------------------------------------------
+ */
+static int UdpShutdown(
+    Tcl_Interp   *interp,       /* May be NULL */
+    IocpChannel *lockedChanPtr, /* Locked pointer to the base IocpChannel */
+    int          flags)         /* Combination of TCL_CLOSE_{READ,WRITE} */
+{
+    WinsockClient *lockedWsPtr = IocpChannelToWinsockClient(lockedChanPtr);
+
+    if ((flags & (TCL_CLOSE_READ|TCL_CLOSE_WRITE)) != (TCL_CLOSE_READ|TCL_CLOSE_WRITE))
+        return EINVAL;
+    if (lockedWsPtr->so != INVALID_SOCKET) {
+        if (closesocket(lockedWsPtr->so) == SOCKET_ERROR) {
+            lockedWsPtr->so = INVALID_SOCKET;
+            IocpSetTclErrnoFromWin32(WSAGetLastError());
+            return Tcl_GetErrno();
+        }
+        lockedWsPtr->so = INVALID_SOCKET;
+    }
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * UdpPostRead --
+ *
+ *    Allocates a datagram buffer and posts it to the socket. Implements
+ *    the behavior defined for postread() in IocpChannel vtbl.
+ *
+ * Results:
+ *    Returns 0 on success or a Windows error code.
+ *
+ * Side effects:
+ *    The receive buffer is queued to the socket from where it will
+ *    retrieved by the IO completion thread. The pending reads count
+ *    in the IocpChannel is incremented.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+UdpPostRead(IocpChannel *lockedChanPtr)
+{
+    WinsockClient *lockedWsPtr = IocpChannelToWinsockClient(lockedChanPtr);
+    IocpBuffer *bufPtr;
+    UdpAddress *fromPtr;
+    WSABUF      wsaBuf;
+    DWORD       flags;
+    DWORD       wsaError;
+
+    IOCP_ASSERT(lockedWsPtr->base.state == IOCP_STATE_OPEN);
+    bufPtr = IocpBufferNew(
+        (int) sizeof(UdpAddress) + lockedWsPtr->addresses.udp.maxDatagram,
+        IOCP_BUFFER_OP_READ, IOCP_BUFFER_F_WINSOCK | IOCP_BUFFER_F_DATAGRAM);
+    if (bufPtr == NULL)
+        return WSAENOBUFS;
+
+    bufPtr->chanPtr    = lockedChanPtr;
+    lockedWsPtr->base.numRefs += 1; /* Reversed when buffer is unlinked from channel */
+
+    /* Completion thread sets data.len to payload length */
+    bufPtr->data.begin = sizeof(UdpAddress);
+    fromPtr            = UdpBufferAddress(bufPtr);
+    fromPtr->addrLen   = sizeof(fromPtr->addr);
+    wsaBuf.buf = bufPtr->data.bytes + bufPtr->data.begin;
+    wsaBuf.len = bufPtr->data.capacity - bufPtr->data.begin;
+    flags      = 0;
+
+    IOCP_ASSERT(lockedWsPtr->so != INVALID_SOCKET);
+    if (WSARecvFrom(lockedWsPtr->so, &wsaBuf, 1, NULL, &flags,
+                    &fromPtr->addr.sa, &fromPtr->addrLen,
+                    &bufPtr->u.wsaOverlap, NULL) != 0
+        && (wsaError = WSAGetLastError()) != WSA_IO_PENDING) {
+        lockedWsPtr->base.numRefs -= 1;
+        bufPtr->chanPtr    = NULL;
+        IocpBufferFree(bufPtr);
+        return wsaError;
+    }
+    lockedChanPtr->pendingReads++;
+
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * UdpPostDatagram --
+ *
+ *    Posts a single datagram to the specified destination. The caller
+ *    is responsible for checking limits on pending writes.
+ *
+ * Results:
+ *    0 on success or a Windows error code.
+ *
+ * Side effects:
+ *    The datagram is queued to the socket and the pending writes count
+ *    for the channel incremented.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+UdpPostDatagram(
+    WinsockClient      *lockedWsPtr, /* Must be locked on entry */
+    const char         *bytes,       /* Payload */
+    int                 nbytes,      /* Payload length */
+    const IocpSockaddr *toPtr,       /* Destination */
+    int                 toLen)       /* Length of *toPtr */
+{
+    IocpBuffer *bufPtr;
+    UdpAddress *addrPtr;
+    WSABUF      wsaBuf;
+    DWORD       wsaError;
+    DWORD       written;
+
+    if (nbytes > IOCP_UDP_MAX_DATAGRAM)
+        return WSAEMSGSIZE;
+
+    bufPtr = IocpBufferNew((int) sizeof(UdpAddress) + nbytes,
+                           IOCP_BUFFER_OP_WRITE,
+                           IOCP_BUFFER_F_WINSOCK | IOCP_BUFFER_F_DATAGRAM);
+    if (bufPtr == NULL)
+        return WSAENOBUFS;
+    addrPtr = UdpBufferAddress(bufPtr);
+    memcpy(&addrPtr->addr, toPtr, toLen);
+    addrPtr->addrLen   = toLen;
+    bufPtr->data.begin = sizeof(UdpAddress);
+    bufPtr->data.len   = nbytes;
+    memcpy(bufPtr->data.bytes + bufPtr->data.begin, bytes, nbytes);
+
+    bufPtr->chanPtr = WinsockClientToIocpChannel(lockedWsPtr);
+    lockedWsPtr->base.numRefs += 1; /* Reversed when buffer is unlinked from channel */
+    wsaBuf.buf = bufPtr->data.bytes + bufPtr->data.begin;
+    wsaBuf.len = bufPtr->data.len;
+    if (WSASendTo(lockedWsPtr->so, &wsaBuf, 1, &written, 0,
+                  &addrPtr->addr.sa, addrPtr->addrLen,
+                  &bufPtr->u.wsaOverlap, NULL) != 0
+        && (wsaError = WSAGetLastError()) != WSA_IO_PENDING) {
+        lockedWsPtr->base.numRefs -= 1;
+        bufPtr->chanPtr    = NULL;
+        IocpBufferFree(bufPtr);
+        return wsaError;
+    }
+    lockedWsPtr->base.pendingWrites++;
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * UdpPostWrite --
+ *
+ *    Sends the passed data as a single datagram to the address set with
+ *    the -remote option. Implements the behaviour expected of the
+ *    postwrite() function in IocpChannel vtbl.
+ *
+ * Results:
+ *    If data is successfully written, return 0 and stores written count
+ *    into *countPtr. If no data could be written because device would block
+ *    returns 0 and stores 0 in *countPtr. On error, returns a Windows error.
+ *
+ * Side effects:
+ *    The datagram is queued to the socket.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+UdpPostWrite(
+    IocpChannel *lockedChanPtr, /* Must be locked on entry */
+    const char  *bytes,         /* Pointer to data to write */
+    int          nbytes,        /* Number of data bytes to write */
+    int         *countPtr)      /* Output - Number of bytes written */
+{
+    WinsockClient *lockedWsPtr = IocpChannelToWinsockClient(lockedChanPtr);
+    IocpWinError   winError;
+
+    IOCP_ASSERT(lockedWsPtr->base.state == IOCP_STATE_OPEN);
+
+    if (lockedWsPtr->addresses.udp.remoteLen == 0)
+        return WSAEDESTADDRREQ;
+
+    if (lockedChanPtr->pendingWrites >= lockedChanPtr->maxPendingWrites) {
+        /* Not an error but indicate nothing written */
+        *countPtr = 0;
+        return ERROR_SUCCESS;
+    }
+
+    winError = UdpPostDatagram(lockedWsPtr, bytes, nbytes,
+                               &lockedWsPtr->addresses.udp.remote,
+                               lockedWsPtr->addresses.udp.remoteLen);
+    if (winError != ERROR_SUCCESS) {
+        *countPtr = -1;
+        return winError;
+    }
+    *countPtr = nbytes;
+    return 0;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * UdpTranslateError --
+ *
+ *    Maps the error for a completed buffer to a Winsock error. Datagrams
+ *    larger than the receive buffer are passed up truncated as for
+ *    recvfrom and are not treated as errors.
+ *
+ * Results:
+ *    The Winsock error code or 0.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpWinError
+UdpTranslateError(IocpChannel *lockedChanPtr, IocpBuffer *bufPtr)
+{
+    IocpWinError winError = WinsockClientTranslateError(lockedChanPtr, bufPtr);
+    if (winError == WSAEMSGSIZE && bufPtr->operation == IOCP_BUFFER_OP_READ)
+        return ERROR_SUCCESS;
+    return winError;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * UdpResolveAddress --
+ *
+ *    Resolves a host and port to an address of the specified family.
+ *
+ * Results:
+ *    TCL_OK on success with the address stored in *addrPtr and its length
+ *    in *addrLenPtr. TCL_ERROR on failure with an error message in interp.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+UdpResolveAddress(
+    Tcl_Interp   *interp,       /* For error messages. May be NULL */
+    int           family,       /* AF_INET or AF_INET6 */
+    const char   *host,         /* Host name or address */
+    const char   *portName,     /* Port number or service name */
+    IocpSockaddr *addrPtr,      /* Output address */
+    int          *addrLenPtr)   /* Output address length */
+{
+    struct addrinfo hints;
+    struct addrinfo *addrs;
+    int port;
+    int status;
+
+    if (TclSockGetPort(interp, portName, "udp", &port) != TCL_OK)
+        return TCL_ERROR;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = family;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+    status = getaddrinfo(host, NULL, &hints, &addrs);
+    if (status != 0) {
+        if (interp)
+            Tcl_SetObjResult(interp,
+                             Tcl_ObjPrintf("couldn't resolve address \"%s\".", host));
+        return TCL_ERROR;
+    }
+    if (addrs->ai_addrlen > sizeof(*addrPtr)) {
+        freeaddrinfo(addrs);
+        if (interp)
+            Tcl_SetObjResult(interp,
+                             Tcl_ObjPrintf("couldn't resolve address \"%s\".", host));
+        return TCL_ERROR;
+    }
+    memcpy(addrPtr, addrs->ai_addr, addrs->ai_addrlen);
+    *addrLenPtr = (int) addrs->ai_addrlen;
+    freeaddrinfo(addrs);
+    if (family == AF_INET6)
+        addrPtr->sa6.sin6_port = htons((unsigned short) port);
+    else
+        addrPtr->sa4.sin_port = htons((unsigned short) port);
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * UdpAddressToObjs --
+ *
+ *    Returns the numeric host address and port in a socket address.
+ *
+ * Results:
+ *    Number of Tcl_Obj values stored in objs (2), or 0 on failure.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static int
+UdpAddressToObjs(
+    const IocpSockaddr *addrPtr,
+    int                 addrLen,
+    Tcl_Obj            *objs[2])
+{
+    char host[NI_MAXHOST];
+    if (getnameinfo(&addrPtr->sa, addrLen, host, sizeof(host), NULL, 0,
+                    NI_NUMERICHOST) != 0)
+        return 0;
+    objs[0] = Tcl_NewStringObj(host, -1);
+    objs[1] = Tcl_NewIntObj(ntohs(addrPtr->sa.sa_family == AF_INET6 ?
+                                  addrPtr->sa6.sin6_port : addrPtr->sa4.sin_port));
+    return 2;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * UdpMembership --
+ *
+ *    Joins or leaves a multicast group. The value is a list containing
+ *    the group address and optionally the local interface address (IPv4)
+ *    or interface index (IPv6).
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on failure with error in interp.
+ *
+ * Side effects:
+ *    Multicast group membership is updated.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+UdpMembership(
+    WinsockClient *lockedWsPtr, /* Must be locked */
+    Tcl_Interp    *interp,      /* May be NULL */
+    const char    *valuePtr,    /* Option value */
+    int            join)        /* 1 -> join, 0 -> leave */
+{
+    Tcl_Size     argc;
+    const char **argv;
+    int          status;
+
+    if (Tcl_SplitList(interp, valuePtr, &argc, &argv) != TCL_OK)
+        return TCL_ERROR;
+    if (argc < 1 || argc > 2) {
+        ckfree(argv);
+        if (interp)
+            Tcl_SetResult(interp, "Multicast option value must be a list of a group address and an optional interface.", TCL_STATIC);
+        return TCL_ERROR;
+    }
+    if (lockedWsPtr->addresses.udp.family == AF_INET6) {
+        struct ipv6_mreq mreq;
+        int index = 0;
+        memset(&mreq, 0, sizeof(mreq));
+        if (inet_pton(AF_INET6, argv[0], &mreq.ipv6mr_multiaddr) != 1)
+            goto badaddr;
+        if (argc > 1 && Tcl_GetInt(interp, argv[1], &index) != TCL_OK) {
+            ckfree(argv);
+            return TCL_ERROR;
+        }
+        mreq.ipv6mr_interface = index;
+        status = setsockopt(lockedWsPtr->so, IPPROTO_IPV6,
+                            join ? IPV6_ADD_MEMBERSHIP : IPV6_DROP_MEMBERSHIP,
+                            (char *)&mreq, sizeof(mreq));
+    } else {
+        struct ip_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        if (inet_pton(AF_INET, argv[0], &mreq.imr_multiaddr) != 1)
+            goto badaddr;
+        if (argc > 1) {
+            if (inet_pton(AF_INET, argv[1], &mreq.imr_interface) != 1)
+                goto badaddr;
+        } else {
+            mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        }
+        status = setsockopt(lockedWsPtr->so, IPPROTO_IP,
+                            join ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP,
+                            (char *)&mreq, sizeof(mreq));
+    }
+    ckfree(argv);
+    if (status != 0) {
+        Iocp_ReportLastWindowsError(interp, "setsockopt failed: ");
+        Tcl_SetErrno(EINVAL);
+        return TCL_ERROR;
+    }
+    return TCL_OK;
+
+badaddr:
+    if (interp)
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("Invalid multicast address in \"%s\".", valuePtr));
+    ckfree(argv);
+    Tcl_SetErrno(EINVAL);
+    return TCL_ERROR;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * UdpGetOption --
+ *
+ *    Returns the value of the given option.
+ *
+ * Results:
+ *    Returns TCL_OK on succes and TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    On success the value of the option is stored in *dsPtr.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+UdpGetOption(
+    IocpChannel *lockedChanPtr, /* Locked on entry, locked on exit */
+    Tcl_Interp  *interp,        /* For error reporting. May be NULL */
+    int          opt,           /* Index into option table for option of interest */
+    Tcl_DString *dsPtr)         /* Where to store the value */
+{
+    WinsockClient *lockedWsPtr = IocpChannelToWinsockClient(lockedChanPtr);
+    char integerSpace[TCL_INTEGER_SPACE];
+    int  isV6 = lockedWsPtr->addresses.udp.family == AF_INET6;
+    int  level, optName;
+    DWORD dw;
+    int   dwLen;
+
+    if (lockedWsPtr->so == INVALID_SOCKET) {
+        if (interp)
+            Tcl_SetResult(interp, "No socket associated with channel.", TCL_STATIC);
+        return TCL_ERROR;
+    }
+
+    switch (opt) {
+    case UDP_OPT_MAXDATAGRAM:
+        dw = lockedWsPtr->addresses.udp.maxDatagram;
+        break;
+    case UDP_OPT_MAXPENDINGREADS:
+        dw = lockedChanPtr->maxPendingReads;
+        break;
+    case UDP_OPT_MAXPENDINGWRITES:
+        dw = lockedChanPtr->maxPendingWrites;
+        break;
+    case UDP_OPT_REMOTE:
+    case UDP_OPT_SOCKNAME:
+        {
+            IocpSockaddr addr;
+            int addrLen;
+            Tcl_Obj *objs[2];
+            if (opt == UDP_OPT_REMOTE) {
+                if (lockedWsPtr->addresses.udp.remoteLen == 0)
+                    return TCL_OK;
+                addr    = lockedWsPtr->addresses.udp.remote;
+                addrLen = lockedWsPtr->addresses.udp.remoteLen;
+            } else {
+                addrLen = sizeof(addr);
+                if (getsockname(lockedWsPtr->so, &addr.sa, &addrLen) != 0)
+                    return Iocp_ReportLastWindowsError(interp, "getsockname failed: ");
+            }
+            if (UdpAddressToObjs(&addr, addrLen, objs) == 0)
+                return Iocp_ReportLastWindowsError(interp, "getnameinfo failed: ");
+            Tcl_DStringAppendElement(dsPtr, Tcl_GetString(objs[0]));
+            Tcl_DStringAppendElement(dsPtr, Tcl_GetString(objs[1]));
+            Tcl_DecrRefCount(objs[0]);
+            Tcl_DecrRefCount(objs[1]);
+            return TCL_OK;
+        }
+    case UDP_OPT_BROADCAST:
+    case UDP_OPT_MCASTLOOP:
+    case UDP_OPT_MCASTTTL:
+    case UDP_OPT_SORCVBUF:
+    case UDP_OPT_SOSNDBUF:
+        switch (opt) {
+        case UDP_OPT_BROADCAST: level = SOL_SOCKET; optName = SO_BROADCAST; break;
+        case UDP_OPT_SORCVBUF:  level = SOL_SOCKET; optName = SO_RCVBUF; break;
+        case UDP_OPT_SOSNDBUF:  level = SOL_SOCKET; optName = SO_SNDBUF; break;
+        case UDP_OPT_MCASTLOOP:
+            level   = isV6 ? IPPROTO_IPV6 : IPPROTO_IP;
+            optName = isV6 ? IPV6_MULTICAST_LOOP : IP_MULTICAST_LOOP;
+            break;
+        default:
+            level   = isV6 ? IPPROTO_IPV6 : IPPROTO_IP;
+            optName = isV6 ? IPV6_MULTICAST_HOPS : IP_MULTICAST_TTL;
+            break;
+        }
+        dw    = 0;
+        dwLen = sizeof(dw);
+        if (getsockopt(lockedWsPtr->so, level, optName, (char *)&dw, &dwLen) != 0)
+            return Iocp_ReportLastWindowsError(interp, "getsockopt failed: ");
+        if (opt == UDP_OPT_BROADCAST || opt == UDP_OPT_MCASTLOOP)
+            dw = dw ? 1 : 0;
+        break;
+    case UDP_OPT_MCASTADD:
+    case UDP_OPT_MCASTDROP:
+        /* Write-only. Error so they are left out of the option list */
+        return Tcl_BadChannelOption(interp, udpOptionNames[opt],
+                                    "-broadcast -maxdatagram -maxpendingreads"
+                                    " -maxpendingwrites -mcastloop -mcastttl"
+                                    " -remote -sockname -sorcvbuf -sosndbuf");
+    default:
+        if (interp) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Internal error: invalid socket option index %d", opt));
+        }
+        return TCL_ERROR;
+    }
+    sprintf_s(integerSpace, sizeof(integerSpace), "%lu", dw);
+    Tcl_DStringAppend(dsPtr, integerSpace, -1);
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * UdpSetOption --
+ *
+ *    Sets the value of the given option.
+ *
+ * Results:
+ *    Returns TCL_OK on succes and TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    The option value is updated.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+UdpSetOption(
+    IocpChannel *lockedChanPtr, /* Locked on entry, locked on exit */
+    Tcl_Interp  *interp,        /* For error reporting. May be NULL */
+    int          opt,           /* Index into option table for option of interest */
+    const char  *valuePtr)      /* Option value */
+{
+    WinsockClient *lockedWsPtr = IocpChannelToWinsockClient(lockedChanPtr);
+    int   isV6 = lockedWsPtr->addresses.udp.family == AF_INET6;
+    int   intValue;
+    int   level, optName;
+    DWORD dw;
+
+    if (lockedWsPtr->so == INVALID_SOCKET) {
+        if (interp)
+            Tcl_SetResult(interp, "No socket associated with channel.", TCL_STATIC);
+        return TCL_ERROR;
+    }
+
+    switch (opt) {
+    case UDP_OPT_MAXDATAGRAM:
+    case UDP_OPT_MAXPENDINGREADS:
+    case UDP_OPT_MAXPENDINGWRITES:
+        if (Tcl_GetInt(interp, valuePtr, &intValue) != TCL_OK) {
+            Tcl_SetErrno(EINVAL);
+            return TCL_ERROR;
+        }
+        if (intValue <= 0 ||
+            intValue > (opt == UDP_OPT_MAXDATAGRAM ? IOCP_UDP_MAX_DATAGRAM
+                                                   : IOCP_UDP_MAX_PENDING)) {
+            if (interp)
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Integer value %d out of range.", intValue));
+            Tcl_SetErrno(EINVAL);
+            return TCL_ERROR;
+        }
+        if (opt == UDP_OPT_MAXDATAGRAM) {
+            /* Applies to receives posted from now on */
+            lockedWsPtr->addresses.udp.maxDatagram = intValue;
+        } else if (opt == UDP_OPT_MAXPENDINGREADS) {
+            lockedChanPtr->maxPendingReads = intValue;
+            if (lockedChanPtr->state == IOCP_STATE_OPEN)
+                IocpChannelPostReads(lockedChanPtr);
+        } else {
+            lockedChanPtr->maxPendingWrites = intValue;
+        }
+        return TCL_OK;
+
+    case UDP_OPT_REMOTE:
+        {
+            Tcl_Size     argc;
+            const char **argv;
+            IocpSockaddr addr;
+            int          addrLen;
+            IocpTclCode  tclResult;
+            if (Tcl_SplitList(interp, valuePtr, &argc, &argv) != TCL_OK)
+                return TCL_ERROR;
+            if (argc == 0) {
+                ckfree(argv);
+                lockedWsPtr->addresses.udp.remoteLen = 0;
+                return TCL_OK;
+            }
+            if (argc != 2) {
+                ckfree(argv);
+                if (interp)
+                    Tcl_SetResult(interp, "Remote address must be a list of the form {HOST PORT}.", TCL_STATIC);
+                Tcl_SetErrno(EINVAL);
+                return TCL_ERROR;
+            }
+            tclResult = UdpResolveAddress(interp,
+                                          lockedWsPtr->addresses.udp.family,
+                                          argv[0], argv[1], &addr, &addrLen);
+            ckfree(argv);
+            if (tclResult != TCL_OK) {
+                Tcl_SetErrno(EINVAL);
+                return TCL_ERROR;
+            }
+            lockedWsPtr->addresses.udp.remote    = addr;
+            lockedWsPtr->addresses.udp.remoteLen = addrLen;
+            return TCL_OK;
+        }
+
+    case UDP_OPT_MCASTADD:
+    case UDP_OPT_MCASTDROP:
+        return UdpMembership(lockedWsPtr, interp, valuePtr,
+                             opt == UDP_OPT_MCASTADD);
+
+    case UDP_OPT_BROADCAST:
+    case UDP_OPT_MCASTLOOP:
+        if (Tcl_GetBoolean(interp, valuePtr, &intValue) != TCL_OK) {
+            Tcl_SetErrno(EINVAL);
+            return TCL_ERROR;
+        }
+        if (opt == UDP_OPT_BROADCAST) {
+            level   = SOL_SOCKET;
+            optName = SO_BROADCAST;
+        } else {
+            level   = isV6 ? IPPROTO_IPV6 : IPPROTO_IP;
+            optName = isV6 ? IPV6_MULTICAST_LOOP : IP_MULTICAST_LOOP;
+        }
+        break;
+
+    case UDP_OPT_MCASTTTL:
+    case UDP_OPT_SORCVBUF:
+    case UDP_OPT_SOSNDBUF:
+        if (Tcl_GetInt(interp, valuePtr, &intValue) != TCL_OK) {
+            Tcl_SetErrno(EINVAL);
+            return TCL_ERROR;
+        }
+        if (intValue < 0 || (opt == UDP_OPT_MCASTTTL && intValue > 255)) {
+            if (interp)
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Integer value %d out of range.", intValue));
+            Tcl_SetErrno(EINVAL);
+            return TCL_ERROR;
+        }
+        if (opt == UDP_OPT_MCASTTTL) {
+            level   = isV6 ? IPPROTO_IPV6 : IPPROTO_IP;
+            optName = isV6 ? IPV6_MULTICAST_HOPS : IP_MULTICAST_TTL;
+        } else {
+            level   = SOL_SOCKET;
+            optName = opt == UDP_OPT_SORCVBUF ? SO_RCVBUF : SO_SNDBUF;
+        }
+        break;
+
+    case UDP_OPT_SOCKNAME:
+        return Tcl_BadChannelOption(interp, udpOptionNames[opt],
+                                    "-broadcast -maxdatagram -maxpendingreads"
+                                    " -maxpendingwrites -mcastadd -mcastdrop"
+                                    " -mcastloop -mcastttl -remote -sorcvbuf"
+                                    " -sosndbuf");
+    default:
+        if (interp)
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Internal error: invalid socket option index %d", opt));
+        Tcl_SetErrno(EINVAL);
+        return TCL_ERROR;
+    }
+
+    dw = intValue;
+    if (setsockopt(lockedWsPtr->so, level, optName, (char *)&dw, sizeof(dw)) != 0) {
+        Iocp_ReportLastWindowsError(interp, "setsockopt failed: ");
+        Tcl_SetErrno(EINVAL);
+        return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Iocp_OpenUdp --
+ *
+ *	Opens a UDP socket and creates a channel around it.
+ *
+ * Results:
+ *	The channel or NULL if failed. An error message is returned in the
+ *	interpreter on failure.
+ *
+ * Side effects:
+ *	Opens a bound UDP socket and creates a new channel.
+ *
+ *------------------------------------------------------------------------
+ */
+static Tcl_Channel
+Iocp_OpenUdp(
+    Tcl_Interp *interp,         /* For error reporting; can be NULL. */
+    int         family,         /* AF_INET or AF_INET6 */
+    const char *myaddr,         /* Local address. NULL -> wildcard */
+    const char *myport,         /* Local port. NULL -> any */
+    int         reuseaddr)      /* If true, set SO_REUSEADDR */
+{
+    WinsockClient  *udpPtr = NULL;
+    IocpSockaddr    addr;
+    int             addrLen;
+    SOCKET          so;
+    Tcl_Channel     channel;
+    IocpWinError    winError;
+    DWORD           dw;
+    BOOL            noReset = FALSE;
+
+    if (myaddr == NULL)
+        myaddr = family == AF_INET6 ? "::" : "0.0.0.0";
+    if (UdpResolveAddress(interp, family, myaddr, myport ? myport : "0",
+                          &addr, &addrLen) != TCL_OK)
+        return NULL;
+
+    so = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+    /* Note socket call, unlike WSASocket is overlapped by default */
+    if (so == INVALID_SOCKET) {
+        IocpSetInterpPosixErrorFromWin32(interp, WSAGetLastError(),
+                                         gSocketOpenErrorMessage);
+        return NULL;
+    }
+    /* Sockets should not be inherited by children */
+    SetHandleInformation((HANDLE)so, HANDLE_FLAG_INHERIT, 0);
+
+    /*
+     * Without this, an ICMP port unreachable in response to a send fails
+     * the next receive with WSAECONNRESET.
+     */
+    WSAIoctl(so, SIO_UDP_CONNRESET, &noReset, sizeof(noReset), NULL, 0,
+             &dw, NULL, NULL);
+
+    if (reuseaddr) {
+        dw = 1;
+        if (setsockopt(so, SOL_SOCKET, SO_REUSEADDR, (char *)&dw, sizeof(dw)) != 0)
+            goto winsock_error;
+    }
+    if (bind(so, &addr.sa, addrLen) != 0)
+        goto winsock_error;
+    if (IocpAttachDefaultPort((HANDLE) so) == NULL) {
+        winError = GetLastError(); /* NOT WSAGetLastError() ! */
+        closesocket(so);
+        IocpSetInterpPosixErrorFromWin32(interp, winError, gSocketOpenErrorMessage);
+        return NULL;
+    }
+
+    udpPtr = (WinsockClient *) IocpChannelNew(&udpVtbl);
+    if (udpPtr == NULL) {
+        closesocket(so);
+        if (interp != NULL) {
+            Tcl_SetResult(interp, "couldn't allocate WinsockClient", TCL_STATIC);
+        }
+        return NULL;
+    }
+    udpPtr->so                    = so;
+    udpPtr->addresses.udp.family  = family;
+    udpPtr->base.state            = IOCP_STATE_OPEN;
+
+    IocpChannelLock(WinsockClientToIocpChannel(udpPtr));
+    winError = IocpChannelPostReads(WinsockClientToIocpChannel(udpPtr));
+    if (winError) {
+        Iocp_ReportWindowsError(interp, winError, "couldn't post read on socket: ");
+        goto fail;
+    }
+
+    channel = IocpMakeTclChannel(interp,
+                                 WinsockClientToIocpChannel(udpPtr),
+                                 IOCP_UDP_NAME_PREFIX,
+                                 (TCL_READABLE | TCL_WRITABLE));
+    if (channel == NULL)
+        goto fail;
+
+    /*
+     * At this point IocpMakeTclChannel has incremented the references
+     * on udpPtr, so we can drop the one this function is holding from
+     * the allocation.
+     */
+    IocpChannelDrop(WinsockClientToIocpChannel(udpPtr));
+    udpPtr = NULL; /* Ensure not accessed beyond here */
+
+    if (Tcl_SetChannelOption(NULL, channel, "-translation", "binary") == TCL_ERROR) {
+        Tcl_Close(NULL, channel);
+        return NULL;
+    }
+
+    return channel;
+
+winsock_error:
+    winError = WSAGetLastError();
+    closesocket(so);
+    IocpSetInterpPosixErrorFromWin32(interp, winError, gSocketOpenErrorMessage);
+    return NULL;
+
+fail:
+    /* udpPtr must be locked when jumping here. Also closes the socket. */
+    if (udpPtr)
+        IocpChannelDrop(WinsockClientToIocpChannel(udpPtr));
+    return NULL;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Udp_UdpObjCmd --
+ *
+ *    Implements the iocp::inet::udp command.
+ *
+ *      udp ?-myaddr ADDR? ?-myport PORT? ?-family inet|inet6? ?-reuseaddr?
+ *
+ * Results:
+ *    A standard Tcl result with the channel handle stored in interp result.
+ *
+ * Side effects:
+ *    A new UDP channel is created.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Udp_UdpObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    static const char *const udpOptions[] = {
+        "-family", "-myaddr", "-myport", "-reuseaddr", NULL
+    };
+    enum udpOptions {
+        UDP_FAMILY, UDP_MYADDR, UDP_MYPORT, UDP_REUSEADDR
+    };
+    static const char *const families[] = { "inet", "inet6", NULL };
+    const char *myaddr = NULL, *myport = NULL;
+    int         family = AF_INET, reuseaddr = 0;
+    int         i, optionIndex;
+    Tcl_Channel chan;
+
+    for (i = 1; i < objc; i++) {
+        if (Tcl_GetIndexFromObj(interp, objv[i], udpOptions, "option",
+                                TCL_EXACT, &optionIndex) != TCL_OK)
+            return TCL_ERROR;
+        if (optionIndex == UDP_REUSEADDR) {
+            reuseaddr = 1;
+            continue;
+        }
+        if (++i >= objc) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+                                 "no argument given for %s option",
+                                 udpOptions[optionIndex]));
+            return TCL_ERROR;
+        }
+        switch ((enum udpOptions) optionIndex) {
+        case UDP_FAMILY:
+            {
+                int familyIndex;
+                if (Tcl_GetIndexFromObj(interp, objv[i], families, "family",
+                                        TCL_EXACT, &familyIndex) != TCL_OK)
+                    return TCL_ERROR;
+                family = familyIndex == 0 ? AF_INET : AF_INET6;
+            }
+            break;
+        case UDP_MYADDR: myaddr = Tcl_GetString(objv[i]); break;
+        case UDP_MYPORT: myport = Tcl_GetString(objv[i]); break;
+        default:
+            Iocp_Panic("Udp_UdpObjCmd: bad option index to udpOptions");
+        }
+    }
+
+    chan = Iocp_OpenUdp(interp, family, myaddr, myport, reuseaddr);
+    if (chan == NULL)
+        return TCL_ERROR;
+    Tcl_RegisterChannel(interp, chan);
+    Tcl_SetObjResult(interp, Tcl_NewStringObj(Tcl_GetChannelName(chan), -1));
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * UdpChannelFromObj --
+ *
+ *    Returns the IocpChannel for a UDP Tcl channel.
+ *
+ * Results:
+ *    Pointer to the unlocked IocpChannel or NULL with an error in interp.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpChannel *
+UdpChannelFromObj(Tcl_Interp *interp, Tcl_Obj *objPtr)
+{
+    Tcl_Channel  chan;
+    IocpChannel *chanPtr;
+
+    chan = Tcl_GetChannel(interp, Tcl_GetString(objPtr), NULL);
+    if (chan == NULL)
+        return NULL;
+    chanPtr = IocpChannelFromTclChannel(chan);
+    if (chanPtr == NULL || !IocpIsUdp(chanPtr)) {
+        Tcl_SetObjResult(interp, Tcl_ObjPrintf("channel \"%s\" is not a UDP socket.", Tcl_GetString(objPtr)));
+        return NULL;
+    }
+    return chanPtr;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Udp_RecvmanyObjCmd --
+ *
+ *    Implements the iocp::inet::recvmany command.
+ *
+ *      recvmany CHAN ?MAXCOUNT?
+ *
+ *    Never blocks. Datagrams that have already been received are returned
+ *    as a list of {PAYLOAD ADDRESS PORT} elements.
+ *
+ * Results:
+ *    A standard Tcl result.
+ *
+ * Side effects:
+ *    Received datagrams are removed from the channel and receives
+ *    reposted.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Udp_RecvmanyObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    IocpChannel *chanPtr;
+    IocpList     datagrams;
+    IocpLink    *linkPtr;
+    IocpWinError winError = ERROR_SUCCESS;
+    Tcl_Obj     *resultObj;
+    int          maxCount = INT_MAX;
+    int          count;
+
+    if (objc < 2 || objc > 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "CHANNEL ?MAXCOUNT?");
+        return TCL_ERROR;
+    }
+    if (objc == 3) {
+        if (Tcl_GetIntFromObj(interp, objv[2], &maxCount) != TCL_OK)
+            return TCL_ERROR;
+        if (maxCount <= 0) {
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf("Integer value %d out of range.", maxCount));
+            return TCL_ERROR;
+        }
+    }
+    chanPtr = UdpChannelFromObj(interp, objv[1]);
+    if (chanPtr == NULL)
+        return TCL_ERROR;
+
+    /* Detach the datagrams under the lock and build the result outside it */
+    datagrams.headPtr = NULL;
+    datagrams.tailPtr = NULL;
+    IocpChannelLock(chanPtr);
+    for (count = 0; count < maxCount; ++count) {
+        IocpBuffer *bufPtr;
+        if (chanPtr->inputBuffers.headPtr == NULL)
+            break;
+        bufPtr = CONTAINING_RECORD(chanPtr->inputBuffers.headPtr, IocpBuffer, link);
+        if (bufPtr->winError != ERROR_SUCCESS) {
+            /* Report error only if nothing to return, else on next call */
+            if (count == 0) {
+                IocpListPopFront(&chanPtr->inputBuffers);
+                winError = bufPtr->winError;
+                IocpBufferFree(bufPtr);
+            }
+            break;
+        }
+        IocpListPopFront(&chanPtr->inputBuffers);
+        chanPtr->inputBytes -= bufPtr->data.len;
+        IocpListAppend(&datagrams, &bufPtr->link);
+    }
+    if (chanPtr->state == IOCP_STATE_OPEN)
+        IocpChannelPostReads(chanPtr);
+    IocpChannelUnlock(chanPtr);
+
+    resultObj = Tcl_NewListObj(0, NULL);
+    while ((linkPtr = IocpListPopFront(&datagrams)) != NULL) {
+        IocpBuffer *bufPtr = CONTAINING_RECORD(linkPtr, IocpBuffer, link);
+        UdpAddress *fromPtr = UdpBufferAddress(bufPtr);
+        Tcl_Obj    *objs[3];
+        objs[0] = Tcl_NewByteArrayObj(
+            (unsigned char *) bufPtr->data.bytes + bufPtr->data.begin,
+            bufPtr->data.len);
+        if (UdpAddressToObjs(&fromPtr->addr, fromPtr->addrLen, &objs[1]) == 0) {
+            objs[1] = Tcl_NewObj();
+            objs[2] = Tcl_NewObj();
+        }
+        Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewListObj(3, objs));
+        IocpBufferFree(bufPtr);
+    }
+
+    if (winError != ERROR_SUCCESS) {
+        Tcl_DecrRefCount(resultObj);
+        IocpSetTclErrnoFromWin32(winError);
+        return Iocp_ReportWindowsError(interp, winError, "error receiving datagram: ");
+    }
+    Tcl_SetObjResult(interp, resultObj);
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Udp_SendmanyObjCmd --
+ *
+ *    Implements the iocp::inet::sendmany command.
+ *
+ *      sendmany CHAN DATAGRAMS
+ *
+ *    Each element of DATAGRAMS is a list {PAYLOAD ?ADDRESS PORT?}. If the
+ *    address is not specified, the datagram is sent to the -remote address.
+ *    The sends are queued without regard to -maxpendingwrites.
+ *
+ * Results:
+ *    A standard Tcl result holding the number of datagrams queued.
+ *
+ * Side effects:
+ *    Datagrams are queued for sending.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Udp_SendmanyObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    IocpChannel   *chanPtr;
+    WinsockClient *wsPtr;
+    Tcl_Obj      **datagramObjs;
+    Tcl_Size       numDatagrams;
+    Tcl_Size       i;
+    IocpSockaddr   addr;
+    int            addrLen = 0;
+    Tcl_Obj       *lastHostObj = NULL; /* Resolution cache for runs of */
+    Tcl_Obj       *lastPortObj = NULL; /* datagrams to the same address */
+    IocpWinError   winError = ERROR_SUCCESS;
+
+    if (objc != 3) {
+        Tcl_WrongNumArgs(interp, 1, objv, "CHANNEL DATAGRAMS");
+        return TCL_ERROR;
+    }
+    chanPtr = UdpChannelFromObj(interp, objv[1]);
+    if (chanPtr == NULL)
+        return TCL_ERROR;
+    wsPtr = IocpChannelToWinsockClient(chanPtr);
+    if (Tcl_ListObjGetElements(interp, objv[2], &numDatagrams, &datagramObjs) != TCL_OK)
+        return TCL_ERROR;
+
+    IocpChannelLock(chanPtr);
+    for (i = 0; i < numDatagrams; ++i) {
+        Tcl_Obj      **fieldObjs;
+        Tcl_Size       numFields;
+        unsigned char *payload;
+        IocpSizeT      payloadLen;
+
+        if (Tcl_ListObjGetElements(interp, datagramObjs[i], &numFields, &fieldObjs) != TCL_OK)
+            goto error_return;
+        if (numFields != 1 && numFields != 3) {
+            Tcl_SetResult(interp, "Datagram must be a list of the form {PAYLOAD ?ADDRESS PORT?}.", TCL_STATIC);
+            goto error_return;
+        }
+        if (chanPtr->state != IOCP_STATE_OPEN || wsPtr->so == INVALID_SOCKET) {
+            winError = WSAENOTCONN;
+            break;
+        }
+        if (numFields == 1) {
+            if (wsPtr->addresses.udp.remoteLen == 0) {
+                winError = WSAEDESTADDRREQ;
+                break;
+            }
+            addr    = wsPtr->addresses.udp.remote;
+            addrLen = wsPtr->addresses.udp.remoteLen;
+            lastHostObj = NULL;
+        } else if (lastHostObj == NULL ||
+                   strcmp(Tcl_GetString(lastHostObj), Tcl_GetString(fieldObjs[1])) ||
+                   strcmp(Tcl_GetString(lastPortObj), Tcl_GetString(fieldObjs[2]))) {
+            if (UdpResolveAddress(interp, wsPtr->addresses.udp.family,
+                                  Tcl_GetString(fieldObjs[1]),
+                                  Tcl_GetString(fieldObjs[2]),
+                                  &addr, &addrLen) != TCL_OK)
+                goto error_return;
+            lastHostObj = fieldObjs[1];
+            lastPortObj = fieldObjs[2];
+        }
+        payload  = Tcl_GetByteArrayFromObj(fieldObjs[0], &payloadLen);
+        winError = UdpPostDatagram(wsPtr, (const char *) payload,
+                                   (int) payloadLen, &addr, addrLen);
+        if (winError != ERROR_SUCCESS)
+            break;
+    }
+    IocpChannelUnlock(chanPtr);
+
+    if (winError != ERROR_SUCCESS) {
+        IocpSetTclErrnoFromWin32(winError);
+        return Iocp_ReportWindowsError(interp, winError, "error sending datagram: ");
+    }
+    Tcl_SetObjResult(interp, Tcl_NewWideIntObj(numDatagrams));
+    return TCL_OK;
+
+error_return:
+    IocpChannelUnlock(chanPtr);
+    return TCL_ERROR;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Udp_ModuleInitialize --
+ *
+ *    Initializes the UDP module.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    Creates the UDP related Tcl commands.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode Udp_ModuleInitialize (Tcl_Interp *interp)
+{
+    Tcl_CreateObjCommand(interp, "iocp::inet::udp", Udp_UdpObjCmd, 0L, 0L);
+    Tcl_CreateObjCommand(interp, "iocp::inet::recvmany", Udp_RecvmanyObjCmd, 0L, 0L);
+    Tcl_CreateObjCommand(interp, "iocp::inet::sendmany", Udp_SendmanyObjCmd, 0L, 0L);
+    return TCL_OK;
+}
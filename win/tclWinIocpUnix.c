@@ -0,0 +1,400 @@
+/*
+ * tclWinIocpUnix.c --
+ *
+ *	AF_UNIX stream socket support for Windows IOCP.
+ *
+ * Copyright (c) 2026 agent.
+ *
+ * See the file "license.terms" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+#include "tclWinIocp.h"
+#include "tclWinIocpWinsock.h"
+
+/*
+ * AF_UNIX sockets are available from Windows 10 1803. Once connected they
+ * behave like TCP sockets as far as I/O is concerned so the connection
+ * channels use the generic WinsockClient functions. Listening sockets are
+ * handled by the AcceptEx based TCP listener implementation.
+ *
+ * Connects are always done synchronously. A connect to a local listener
+ * either succeeds or fails immediately so there is nothing to be gained
+ * from ConnectEx which in any case is not supported for AF_UNIX.
+ */
+
+#define IOCP_UNIX_NAME_PREFIX "unix"
+
+static IocpChannelVtbl unixClientVtbl =  {
+    /* "Virtual" functions */
+    WinsockClientInit,
+    WinsockClientFinit,
+    WinsockClientShutdown,
+    NULL,                       /* Accept */
+    NULL,                       /* BlockingConnect - never retried */
+    NULL,                       /* AsyncConnected */
+    NULL,                       /* AsyncConnectFailed */
+    WinsockClientDisconnected,
+    WinsockClientPostRead,
+    WinsockClientPostWrite,
+    WinsockClientPostBuffer,
+    WinsockClientGetHandle,
+    WinsockClientGetOption,
+    WinsockClientSetOption,
+    WinsockClientTranslateError,
+    /* Data members */
+    iocpWinsockOptionNames,
+    sizeof(WinsockClient)
+};
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * UnixMakeAddress --
+ *
+ *    Constructs an AF_UNIX socket address from a file path.
+ *
+ * Results:
+ *    TCL_OK on success with the address length stored in *addrLenPtr.
+ *    TCL_ERROR on failure with an error message in interp.
+ *
+ * Side effects:
+ *    The native form of the path is also stored in nativePathPtr which
+ *    the caller must initialize. It must be freed with Tcl_DStringFree
+ *    irrespective of the return value.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+UnixMakeAddress(
+    Tcl_Interp     *interp,        /* For error messages. May be NULL */
+    const char     *path,          /* Path in Tcl form */
+    IocpSockaddrUn *addrPtr,       /* Output address */
+    int            *addrLenPtr,    /* Output address length */
+    Tcl_DString    *nativePathPtr) /* Output native path */
+{
+    Tcl_DString ds;
+    IocpSizeT   len;
+    const char *nativePath;
+
+    Tcl_DStringInit(&ds);
+    if (Tcl_TranslateFileName(interp, path, &ds) == NULL) {
+        Tcl_DStringFree(&ds);
+        return TCL_ERROR;
+    }
+    nativePath = Tcl_UtfToExternalDString(NULL, Tcl_DStringValue(&ds),
+                                          Tcl_DStringLength(&ds), nativePathPtr);
+    Tcl_DStringFree(&ds);
+    len = Tclh_strlen(nativePath);
+    if (len == 0 || len >= IOCP_UNIX_PATH_MAX) {
+        if (interp)
+            Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+                                 "Invalid socket path \"%s\". Must be 1-%d bytes long.",
+                                 path, IOCP_UNIX_PATH_MAX - 1));
+        return TCL_ERROR;
+    }
+    memset(addrPtr, 0, sizeof(*addrPtr));
+    addrPtr->sun_family = AF_UNIX;
+    memcpy(addrPtr->sun_path, nativePath, len);
+    *addrLenPtr = (int) (offsetof(IocpSockaddrUn, sun_path) + len + 1);
+    return TCL_OK;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Iocp_OpenUnixClient --
+ *
+ *	Opens an AF_UNIX client socket and creates a channel around it.
+ *
+ * Results:
+ *	The channel or NULL if failed. An error message is returned in the
+ *	interpreter on failure.
+ *
+ * Side effects:
+ *	Opens a client socket and creates a new channel.
+ *
+ *----------------------------------------------------------------------
+ */
+static Tcl_Channel
+Iocp_OpenUnixClient(
+    Tcl_Interp *interp,         /* For error reporting; can be NULL. */
+    const char *path)           /* Path of the listening socket */
+{
+    WinsockClient *unixPtr = NULL;
+    IocpSockaddrUn addr;
+    int            addrLen;
+    SOCKET         so;
+    IocpWinError   winError;
+    Tcl_Channel    channel;
+    Tcl_DString    nativePath;
+
+    Tcl_DStringInit(&nativePath);
+    if (UnixMakeAddress(interp, path, &addr, &addrLen, &nativePath) != TCL_OK) {
+        Tcl_DStringFree(&nativePath);
+        return NULL;
+    }
+    Tcl_DStringFree(&nativePath);
+
+    /* Note socket call, unlike WSASocket is overlapped by default */
+    so = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (so == INVALID_SOCKET) {
+        IocpSetInterpPosixErrorFromWin32(interp, WSAGetLastError(),
+                                         gSocketOpenErrorMessage);
+        return NULL;
+    }
+    /* Sockets should not be inherited by children */
+    SetHandleInformation((HANDLE)so, HANDLE_FLAG_INHERIT, 0);
+
+    if (connect(so, (SOCKADDR *) &addr, addrLen) != 0) {
+        winError = WSAGetLastError();
+        closesocket(so);
+        IocpSetInterpPosixErrorFromWin32(interp, winError, gSocketOpenErrorMessage);
+        return NULL;
+    }
+    if (IocpAttachDefaultPort((HANDLE) so) == NULL) {
+        winError = GetLastError(); /* NOT WSAGetLastError() ! */
+        closesocket(so);
+        IocpSetInterpPosixErrorFromWin32(interp, winError, gSocketOpenErrorMessage);
+        return NULL;
+    }
+
+    unixPtr = (WinsockClient *) IocpChannelNew(&unixClientVtbl);
+    if (unixPtr == NULL) {
+        closesocket(so);
+        if (interp != NULL) {
+            Tcl_SetResult(interp, "couldn't allocate WinsockClient", TCL_STATIC);
+        }
+        return NULL;
+    }
+    unixPtr->so         = so;
+    unixPtr->base.state = IOCP_STATE_OPEN;
+
+    IocpChannelLock(WinsockClientToIocpChannel(unixPtr));
+    winError = IocpChannelPostReads(WinsockClientToIocpChannel(unixPtr));
+    if (winError) {
+        Iocp_ReportWindowsError(interp, winError, "couldn't post read on socket: ");
+        goto fail;
+    }
+
+    channel = IocpMakeTclChannel(interp,
+                                 WinsockClientToIocpChannel(unixPtr),
+                                 IOCP_UNIX_NAME_PREFIX,
+                                 (TCL_READABLE | TCL_WRITABLE));
+    if (channel == NULL)
+        goto fail;
+
+    /*
+     * At this point IocpMakeTclChannel has incremented the references
+     * on unixPtr, so we can drop the one this function is holding from
+     * the allocation.
+     */
+    IocpChannelDrop(WinsockClientToIocpChannel(unixPtr));
+    unixPtr = NULL; /* Ensure not accessed beyond here */
+
+    if (IocpSetChannelDefaults(channel) == TCL_ERROR) {
+        Tcl_Close(NULL, channel);
+        return NULL;
+    }
+
+    return channel;
+
+fail:
+    /* unixPtr must be locked when jumping here. Also closes the socket. */
+    if (unixPtr)
+        IocpChannelDrop(WinsockClientToIocpChannel(unixPtr));
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * UnixServerDeletePath --
+ *
+ *	Close handler for AF_UNIX listening channels that deletes the
+ *	socket file so the path can be bound again.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The socket file is deleted and clientData is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+static void
+UnixServerDeletePath(ClientData clientData) /* Native path from ckalloc */
+{
+    DeleteFileA((char *) clientData);
+    ckfree(clientData);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * Iocp_OpenUnixServer --
+ *
+ *	Opens an AF_UNIX listening socket bound to a path and creates a
+ *	channel around it.
+ *
+ * Results:
+ *	The channel or NULL if failed. An error message is returned in the
+ *	interpreter on failure.
+ *
+ * Side effects:
+ *	Creates the socket file and a new channel. The file is deleted when
+ *	the channel is closed.
+ *
+ *----------------------------------------------------------------------
+ */
+static Tcl_Channel
+Iocp_OpenUnixServer(
+    Tcl_Interp *interp,              /* For error reporting; can be NULL. */
+    const char *path,                /* Path to bind to */
+    Tcl_TcpAcceptProc *acceptProc,   /* Callback for new connections */
+    ClientData acceptProcData)       /* Data for the callback. */
+{
+    IocpSockaddr    addr;
+    int             addrLen;
+    struct addrinfo ai;
+    Tcl_Channel     channel;
+    Tcl_DString     nativePath;
+    char           *pathCopy;
+
+    Tcl_DStringInit(&nativePath);
+    if (UnixMakeAddress(interp, path, &addr.saun, &addrLen, &nativePath) != TCL_OK) {
+        Tcl_DStringFree(&nativePath);
+        return NULL;
+    }
+
+    /* The listener works off address lists so construct a single entry */
+    memset(&ai, 0, sizeof(ai));
+    ai.ai_family   = AF_UNIX;
+    ai.ai_socktype = SOCK_STREAM;
+    ai.ai_protocol = 0;
+    ai.ai_addrlen  = addrLen;
+    ai.ai_addr     = &addr.sa;
+    channel = WinsockListenerOpen(interp, &ai, -1, &unixClientVtbl,
+                                  IOCP_UNIX_NAME_PREFIX, acceptProc,
+                                  acceptProcData);
+    if (channel != NULL) {
+        pathCopy = ckalloc(Tcl_DStringLength(&nativePath) + 1);
+        memcpy(pathCopy, Tcl_DStringValue(&nativePath),
+               Tcl_DStringLength(&nativePath) + 1);
+        Tcl_CreateCloseHandler(channel, UnixServerDeletePath, pathCopy);
+    }
+    Tcl_DStringFree(&nativePath);
+    return channel;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Unix_SocketObjCmd --
+ *
+ *    Implements the iocp::unix::socket command.
+ *
+ *      socket PATH
+ *      socket -server CMDPREFIX PATH
+ *
+ * Results:
+ *    A standard Tcl result with the channel handle stored in interp result.
+ *
+ * Side effects:
+ *    A new server or client socket is created.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode
+Unix_SocketObjCmd (
+    ClientData notUsed,			/* Not used. */
+    Tcl_Interp *interp,			/* Current interpreter. */
+    int objc,				/* Number of arguments. */
+    Tcl_Obj *CONST objv[])		/* Argument objects. */
+{
+    static const char *const socketOptions[] = {
+        "-server", NULL
+    };
+    enum socketOptions {
+        SKT_SERVER
+    };
+    const char *script = NULL;
+    const char *path;
+    int         optionIndex, a;
+    Tcl_Channel chan;
+
+    for (a = 1; a < objc - 1; a++) {
+        if (Tcl_GetIndexFromObj(interp, objv[a], socketOptions, "option",
+                                TCL_EXACT, &optionIndex) != TCL_OK)
+            return TCL_ERROR;
+        switch ((enum socketOptions) optionIndex) {
+        case SKT_SERVER:
+            if (++a >= objc - 1)
+                goto wrongNumArgs;
+            script = Tcl_GetString(objv[a]);
+            break;
+        default:
+            Iocp_Panic("Unix_SocketObjCmd: bad option index to socketOptions");
+        }
+    }
+    if (a != objc - 1) {
+    wrongNumArgs:
+        Tcl_WrongNumArgs(interp, 1, objv, "?-server CMDPREFIX? PATH");
+        return TCL_ERROR;
+    }
+    path = Tcl_GetString(objv[a]);
+
+    if (script) {
+        IocpAcceptCallback *acceptCallbackPtr;
+        IocpSizeT           len;
+        char               *copyScript;
+
+        len        = Tclh_strlen(script) + 1;
+        copyScript = ckalloc(len);
+        memcpy(copyScript, script, len);
+        acceptCallbackPtr         = ckalloc(sizeof(*acceptCallbackPtr));
+        acceptCallbackPtr->script = copyScript;
+        acceptCallbackPtr->interp = interp;
+
+        chan = Iocp_OpenUnixServer(interp, path, AcceptCallbackProc,
+                                   acceptCallbackPtr);
+        if (chan == NULL) {
+            ckfree(copyScript);
+            ckfree(acceptCallbackPtr);
+            return TCL_ERROR;
+        }
+
+        /* See Tcp_SocketObjCmd for why these are needed */
+        IocpRegisterAcceptCallbackCleanup(interp, acceptCallbackPtr);
+        Tcl_CreateCloseHandler(chan, IocpUnregisterAcceptCallbackCleanupOnClose,
+                               acceptCallbackPtr);
+    } else {
+        chan = Iocp_OpenUnixClient(interp, path);
+        if (chan == NULL)
+            return TCL_ERROR;
+    }
+
+    Tcl_RegisterChannel(interp, chan);
+    Tcl_SetObjResult(interp, Tcl_NewStringObj(Tcl_GetChannelName(chan), -1));
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * Unix_ModuleInitialize --
+ *
+ *    Initializes the AF_UNIX socket module.
+ *
+ * Results:
+ *    TCL_OK on success, TCL_ERROR on failure.
+ *
+ * Side effects:
+ *    Creates the AF_UNIX related Tcl commands.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpTclCode Unix_ModuleInitialize (Tcl_Interp *interp)
+{
+    Tcl_CreateObjCommand(interp, "iocp::unix::socket", Unix_SocketObjCmd, 0L, 0L);
+    return TCL_OK;
+}
@@ -286,6 +286,35 @@ void IocpListPrepend(IocpList *listPtr, IocpLink *linkPtr)
     }
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpListInsertBefore --
+ *
+ *    Inserts an element in a list before another element.
+ *
+ * Side effects:
+ *    None
+ *
+ *------------------------------------------------------------------------
+ */
+void IocpListInsertBefore(
+    IocpList *listPtr,          /* List to insert into */
+    IocpLink *beforePtr,        /* Element already on list. NULL -> append */
+    IocpLink *linkPtr)          /* Element to insert */
+{
+    if (beforePtr == NULL) {
+        IocpListAppend(listPtr, linkPtr);
+    } else if (beforePtr->prevPtr == NULL) {
+        IocpListPrepend(listPtr, linkPtr);
+    } else {
+        linkPtr->prevPtr = beforePtr->prevPtr;
+        linkPtr->nextPtr = beforePtr;
+        beforePtr->prevPtr->nextPtr = linkPtr;
+        beforePtr->prevPtr = linkPtr;
+    }
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -669,6 +698,38 @@ IocpSetChannelDefaults(
     return TCL_OK;
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * IocpChannelFromTclChannel --
+ *
+ *    Returns the IocpChannel underlying a Tcl channel. Any stacked
+ *    transforms are skipped.
+ *
+ * Results:
+ *    Pointer to the IocpChannel or NULL if the channel is not an IOCP
+ *    channel. The returned pointer is not locked and no reference is
+ *    added. It is valid only as long as the Tcl channel is open.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpChannel *
+IocpChannelFromTclChannel(
+    Tcl_Channel channel
+    )
+{
+    Tcl_Channel below;
+
+    while ((below = Tcl_GetStackedChannel(channel)) != NULL)
+        channel = below;
+    if (Tcl_GetChannelType(channel) != &IocpChannelDispatch)
+        return NULL;
+    return (IocpChannel *) Tcl_GetChannelInstanceData(channel);
+}
+
 
 /*
  *------------------------------------------------------------------------
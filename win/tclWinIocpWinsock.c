@@ -21,6 +21,18 @@ const char *iocpWinsockOptionNames[] = {
     "-sorcvbuf",
     "-keepalive",
     "-nagle",
+    "-acceptreceive",
+    "-acceptrange",
+    "-framing",
+    "-readdelimiter",
+    "-readrecords",
+    "-rcvlowat",
+    "-ratelimit",
+    "-tls",
+    "-tlsstatus",
+    "-compress",
+    "-compressstats",
+    "-priority",
     NULL
 };
 
@@ -29,6 +41,21 @@ const char *gSocketOpenErrorMessage = "couldn't open socket: ";
 
 static IocpWinError WinsockClientPostDisconnect(WinsockClient *chanPtr);
 
+/*
+ * Process-wide socket cache. Slots are indexed by address family (IPv4/IPv6)
+ * and by the operation (AcceptEx/ConnectEx) the sockets are recycled for.
+ * See WinsockSocketCacheSlot.
+ */
+#define IOCP_SOCKET_CACHE_SLOTS 4
+typedef struct WinsockSocketCache {
+    IocpLock lock;
+    int      maxSockets;        /* Max sockets per slot. 0 disables caching */
+    int      counts[IOCP_SOCKET_CACHE_SLOTS];   /* Sockets in each slot */
+    SOCKET  *sockets[IOCP_SOCKET_CACHE_SLOTS];  /* maxSockets entries each */
+} WinsockSocketCache;
+static WinsockSocketCache socketCache;
+static Iocp_DoOnceState socketCacheInitFlag;
+
 /*
  *------------------------------------------------------------------------
  *
@@ -51,6 +78,7 @@ void WinsockClientInit(IocpChannel *chanPtr)
     wsPtr->so             = INVALID_SOCKET;
     memset(&wsPtr->addresses, 0, sizeof(wsPtr->addresses));
     wsPtr->flags          = 0;
+    wsPtr->cacheSlot      = -1;
 
     wsPtr->base.maxPendingReads  = IOCP_WINSOCK_MAX_RECEIVES;
     wsPtr->base.maxPendingWrites = IOCP_WINSOCK_MAX_SENDS;
@@ -215,7 +243,18 @@ WinsockClientPostDisconnect(
         bufPtr->chanPtr    = WinsockClientToIocpChannel(lockedWsPtr);
         lockedWsPtr->base.numRefs += 1; /* Reversed when buffer is unlinked from channel */
 
-        if (fnDisconnectEx(lockedWsPtr->so, &bufPtr->u.wsaOverlap, 0, 0) == FALSE) {
+        DWORD flags = 0;
+        /*
+         * Only ask for the socket to be recycled if there is room in the
+         * cache now. WinsockClientDisconnected rechecks on completion.
+         */
+        if (lockedWsPtr->cacheSlot >= 0) {
+            if (WinsockSocketCacheHasRoom(lockedWsPtr->cacheSlot))
+                flags = TF_REUSE_SOCKET;
+            else
+                lockedWsPtr->cacheSlot = -1;
+        }
+        if (fnDisconnectEx(lockedWsPtr->so, &bufPtr->u.wsaOverlap, flags, 0) == FALSE) {
             IocpWinError    winError = WSAGetLastError();
             if (winError != WSA_IO_PENDING) {
                 lockedWsPtr->base.numRefs -= 1; /* Reverse above increment */
@@ -365,6 +404,56 @@ WinsockClientPostWrite(
     return 0;
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * WinsockClientPostBuffer --
+ *
+ *    Posts the data in an already filled buffer to the socket associated
+ *    with lockedChanPtr. Implements the behaviour expected of the
+ *    postbuffer() function in IocpChannel vtbl.
+ *
+ * Results:
+ *    0 on success or a Windows error code. On error, the caller retains
+ *    ownership of bufPtr.
+ *
+ * Side effects:
+ *    On success the buffer is posted to the socket and the pending write
+ *    count for the channel incremented.
+ *
+ *------------------------------------------------------------------------
+ */
+IocpWinError
+WinsockClientPostBuffer(
+    IocpChannel *lockedChanPtr, /* Must be locked on entry */
+    IocpBuffer  *bufPtr)        /* Buffer containing data to write */
+{
+    WinsockClient *lockedWsPtr = IocpChannelToWinsockClient(lockedChanPtr);
+    WSABUF      wsaBuf;
+    DWORD       wsaError;
+    DWORD       written;
+
+    IOCP_ASSERT(lockedWsPtr->base.state == IOCP_STATE_OPEN);
+    IOCP_ASSERT(bufPtr->operation == IOCP_BUFFER_OP_WRITE);
+
+    /* Buffer may have been used for an earlier I/O */
+    memset(&bufPtr->u, 0, sizeof(bufPtr->u));
+    bufPtr->chanPtr    = lockedChanPtr;
+    lockedChanPtr->numRefs += 1; /* Reversed when buffer is unlinked from channel */
+    wsaBuf.buf = bufPtr->data.bytes + bufPtr->data.begin;
+    wsaBuf.len = bufPtr->data.len;
+    if (WSASend(lockedWsPtr->so, &wsaBuf, 1, &written, 0,
+                &bufPtr->u.wsaOverlap, NULL) != 0
+        && (wsaError = WSAGetLastError()) != WSA_IO_PENDING) {
+        lockedChanPtr->numRefs -= 1;
+        bufPtr->chanPtr    = NULL;
+        return wsaError;
+    }
+    lockedChanPtr->pendingWrites++;
+
+    return 0;
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -442,7 +531,8 @@ WinsockClientAsyncConnectFailed(
  *
  * WinsockClientDisconnected --
  *
- *    Closes the socket associated with the channel.
+ *    Closes the socket associated with the channel or returns it to the
+ *    socket cache if it was recycled by the disconnect.
  *
  * Results:
  *    None.
@@ -454,12 +544,21 @@ WinsockClientAsyncConnectFailed(
  */
 void
 WinsockClientDisconnected(
-    IocpChannel *lockedChanPtr) /* Must be locked on entry. */
+    IocpChannel *lockedChanPtr, /* Must be locked on entry. */
+    IocpWinError winError)      /* Status of the disconnect */
 {
     WinsockClient *wsPtr = IocpChannelToWinsockClient(lockedChanPtr);
 
     if (wsPtr->so != INVALID_SOCKET) {
-        closesocket(wsPtr->so);
+        /*
+         * Only sockets on the shared completion port are cached as they
+         * cannot be moved to the port of the channel reusing them.
+         */
+        if (winError != ERROR_SUCCESS || wsPtr->cacheSlot < 0 ||
+            wsPtr->base.port != iocpModuleState.completion_port ||
+            !WinsockSocketCachePut(wsPtr->cacheSlot, wsPtr->so)) {
+            closesocket(wsPtr->so);
+        }
         wsPtr->so = INVALID_SOCKET;
     }
 }
@@ -575,6 +674,13 @@ WinsockListifyAddress(
         return ERROR_SUCCESS;
     }
 
+    if (addrPtr->sa.sa_family == AF_UNIX) {
+        char path[IOCP_UNIX_PATH_MAX+1];
+        WinsockUnixPath(addrPtr, addrSize, path, sizeof(path));
+        Tcl_DStringAppendElement(dsPtr, path);
+        return ERROR_SUCCESS;
+    }
+
 #if IOCP_ENABLE_BLUETOOTH
     if (addrPtr->sa.sa_family == AF_BTH) {
         char buf[40];
@@ -597,6 +703,41 @@ WinsockListifyAddress(
 
 }
 
+/*
+ *------------------------------------------------------------------------
+ *
+ * WinsockUnixPath --
+ *
+ *    Extracts the path from an AF_UNIX socket address. The path in the
+ *    address need not be null terminated if it fills the structure.
+ *
+ * Results:
+ *    None.
+ *
+ * Side effects:
+ *    The null terminated path, possibly empty for unnamed sockets, is
+ *    stored in pathPtr, truncated if necessary.
+ *
+ *------------------------------------------------------------------------
+ */
+void
+WinsockUnixPath(
+    const IocpSockaddr *addrPtr,  /* AF_UNIX address */
+    int                 addrSize, /* Size of address structure */
+    char               *pathPtr,  /* Output buffer */
+    int                 pathSize) /* Size of pathPtr. Must be > 0 */
+{
+    int len = addrSize - (int) offsetof(IocpSockaddrUn, sun_path);
+    int i;
+    if (len > IOCP_UNIX_PATH_MAX)
+        len = IOCP_UNIX_PATH_MAX;
+    if (len > pathSize - 1)
+        len = pathSize - 1;
+    for (i = 0; i < len && addrPtr->saun.sun_path[i]; ++i)
+        pathPtr[i] = addrPtr->saun.sun_path[i];
+    pathPtr[i] = '\0';
+}
+
 /*
  *------------------------------------------------------------------------
  *
@@ -698,6 +839,12 @@ WinsockClientGetOption(
     case IOCP_WINSOCK_OPT_MAXPENDINGACCEPTS:
         Tcl_DStringAppend(dsPtr, "0", 1);
         return TCL_OK;
+    case IOCP_WINSOCK_OPT_ACCEPTRECEIVE:
+    case IOCP_WINSOCK_OPT_ACCEPTRANGE:
+        /* Listener only. Error so it is left out of the option list */
+        return Tcl_BadChannelOption(interp, iocpWinsockOptionNames[opt],
+                                    "-maxpendingreads -maxpendingwrites"
+                                    " -sorcvbuf -sosndbuf");
     case IOCP_WINSOCK_OPT_SOSNDBUF:
     case IOCP_WINSOCK_OPT_SORCVBUF:
         if (lockedWsPtr->so == INVALID_SOCKET) {
@@ -746,6 +893,41 @@ WinsockClientGetOption(
             Tcl_DStringAppend(dsPtr, optval ? "1" : "0", 1);
         }
         return TCL_OK;
+    case IOCP_WINSOCK_OPT_FRAMING:
+        IocpFrameGetSpec(lockedChanPtr, dsPtr);
+        return TCL_OK;
+    case IOCP_WINSOCK_OPT_READDELIMITER:
+        Tcl_DStringAppend(dsPtr, lockedChanPtr->readDelimiter,
+                          lockedChanPtr->readDelimiterLen);
+        return TCL_OK;
+    case IOCP_WINSOCK_OPT_READRECORDS:
+        sprintf_s(integerSpace, sizeof(integerSpace), "%d",
+                  IocpChannelRecordCount(lockedChanPtr));
+        Tcl_DStringAppend(dsPtr, integerSpace, -1);
+        return TCL_OK;
+    case IOCP_WINSOCK_OPT_RCVLOWAT:
+        sprintf_s(integerSpace, sizeof(integerSpace), "%d",
+                  lockedChanPtr->rcvLowat);
+        Tcl_DStringAppend(dsPtr, integerSpace, -1);
+        return TCL_OK;
+    case IOCP_WINSOCK_OPT_RATELIMIT:
+        IocpRateGetSpec(lockedChanPtr, dsPtr);
+        return TCL_OK;
+    case IOCP_WINSOCK_OPT_TLS:
+        IocpTlsGetSpec(lockedChanPtr, dsPtr);
+        return TCL_OK;
+    case IOCP_WINSOCK_OPT_TLSSTATUS:
+        IocpTlsGetStatus(lockedChanPtr, dsPtr);
+        return TCL_OK;
+    case IOCP_WINSOCK_OPT_COMPRESS:
+        IocpCompressGetSpec(lockedChanPtr, dsPtr);
+        return TCL_OK;
+    case IOCP_WINSOCK_OPT_COMPRESSSTATS:
+        IocpCompressGetStats(lockedChanPtr, dsPtr);
+        return TCL_OK;
+    case IOCP_WINSOCK_OPT_PRIORITY:
+        IocpChannelGetPriority(lockedChanPtr, dsPtr);
+        return TCL_OK;
     default:
         if (interp) {
           Tcl_SetObjResult(
@@ -821,6 +1003,8 @@ IocpTclCode WinsockClientSetOption(
             Tcl_SetErrno(EINVAL);
             return TCL_ERROR;
         }
+        /* Options persist across reuse so do not recycle the socket */
+        lockedWsPtr->cacheSlot = -1;
         if (setsockopt(lockedWsPtr->so,
                        SOL_SOCKET,
                        opt == IOCP_WINSOCK_OPT_SOSNDBUF ? SO_SNDBUF : SO_RCVBUF,
@@ -838,6 +1022,11 @@ IocpTclCode WinsockClientSetOption(
     case IOCP_WINSOCK_OPT_PEERNAME:
     case IOCP_WINSOCK_OPT_SOCKNAME:
     case IOCP_WINSOCK_OPT_MAXPENDINGACCEPTS:
+    case IOCP_WINSOCK_OPT_ACCEPTRECEIVE:
+    case IOCP_WINSOCK_OPT_ACCEPTRANGE:
+    case IOCP_WINSOCK_OPT_READRECORDS:
+    case IOCP_WINSOCK_OPT_TLSSTATUS:
+    case IOCP_WINSOCK_OPT_COMPRESSSTATS:
         return Tcl_BadChannelOption(interp,
                                     iocpWinsockOptionNames[opt],
                                     "-maxpendingreads -maxpendingwrites"
@@ -848,6 +1037,7 @@ IocpTclCode WinsockClientSetOption(
             Tcl_SetErrno(EINVAL);
             return TCL_ERROR;
         }
+        lockedWsPtr->cacheSlot = -1; /* See above */
         if (opt == IOCP_WINSOCK_OPT_KEEPALIVE) {
             bVal     = intValue ? TRUE : FALSE;
             intValue = setsockopt(lockedWsPtr->so,
@@ -873,6 +1063,37 @@ IocpTclCode WinsockClientSetOption(
             return TCL_ERROR;
         }
         return TCL_OK;
+    case IOCP_WINSOCK_OPT_FRAMING:
+        return IocpFrameSetSpec(interp, lockedChanPtr, valuePtr);
+    case IOCP_WINSOCK_OPT_READDELIMITER:
+        return IocpChannelSetReadDelimiter(interp, lockedChanPtr, valuePtr);
+    case IOCP_WINSOCK_OPT_RCVLOWAT:
+        /*
+         * Winsock does not support SO_RCVLOWAT so the watermark is
+         * implemented purely at the channel level.
+         */
+        if (Tcl_GetInt(interp, valuePtr, &intValue) != TCL_OK) {
+            Tcl_SetErrno(EINVAL);
+            return TCL_ERROR;
+        }
+        if (intValue <= 0 || intValue > IOCP_RCVLOWAT_MAX) {
+            if (interp)
+                Tcl_SetObjResult(interp, Tcl_ObjPrintf("Integer value %d out of range.", intValue));
+            Tcl_SetErrno(EINVAL);
+            return TCL_ERROR;
+        }
+        lockedChanPtr->rcvLowat = intValue;
+        /* Queued input may now satisfy the watermark */
+        IocpChannelNudgeThread(lockedChanPtr, 0, 0);
+        return TCL_OK;
+    case IOCP_WINSOCK_OPT_RATELIMIT:
+        return IocpRateSetSpec(interp, lockedChanPtr, valuePtr);
+    case IOCP_WINSOCK_OPT_TLS:
+        return IocpTlsSetSpec(interp, lockedChanPtr, valuePtr);
+    case IOCP_WINSOCK_OPT_COMPRESS:
+        return IocpCompressSetSpec(interp, lockedChanPtr, valuePtr);
+    case IOCP_WINSOCK_OPT_PRIORITY:
+        return IocpChannelSetPriority(interp, lockedChanPtr, valuePtr);
     default:
         if (interp)
             Tcl_SetObjResult(
@@ -883,3 +1104,205 @@ IocpTclCode WinsockClientSetOption(
         return TCL_ERROR;
     }
 }
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * WinsockSocketCacheInit --
+ *
+ *    Initializes the process-wide socket cache. Called through Iocp_DoOnce.
+ *
+ * Results:
+ *    TCL_OK.
+ *
+ * Side effects:
+ *    The cache lock is initialized. Caching is disabled by default.
+ *
+ *------------------------------------------------------------------------
+ */
+static IocpTclCode WinsockSocketCacheInit(ClientData notUsed)
+{
+    IocpLockInit(&socketCache.lock);
+    socketCache.maxSockets = 0;
+    return TCL_OK;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * WinsockSocketCacheSlot --
+ *
+ *    Maps an address family and use to a socket cache slot.
+ *
+ * Results:
+ *    The slot index or -1 if sockets of that family are not cached.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+int WinsockSocketCacheSlot(int family, enum WinsockSocketCacheUse use)
+{
+    int slot;
+    switch (family) {
+    case AF_INET:  slot = 0; break;
+    case AF_INET6: slot = 1; break;
+    default: return -1;
+    }
+    return use == IOCP_SOCKET_CACHE_CONNECT ? slot + 2 : slot;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * WinsockSocketCacheGet --
+ *
+ *    Retrieves a recycled socket from the socket cache.
+ *
+ * Results:
+ *    A socket that is already associated with the completion port or
+ *    INVALID_SOCKET if the slot is empty.
+ *
+ * Side effects:
+ *    Cache hit and miss counters are updated when caching is enabled.
+ *
+ *------------------------------------------------------------------------
+ */
+SOCKET WinsockSocketCacheGet(int slot)
+{
+    SOCKET so = INVALID_SOCKET;
+
+    /* Unlocked peek to keep the disabled case cheap */
+    if (slot < 0 || socketCache.maxSockets == 0)
+        return INVALID_SOCKET;
+
+    IocpLockAcquireExclusive(&socketCache.lock);
+    if (socketCache.counts[slot] > 0) {
+        so = socketCache.sockets[slot][--socketCache.counts[slot]];
+    }
+    IocpLockReleaseExclusive(&socketCache.lock);
+
+    if (so == INVALID_SOCKET)
+        IOCP_STATS_INCR_ALWAYS(IocpSocketCacheMisses);
+    else
+        IOCP_STATS_INCR_ALWAYS(IocpSocketCacheHits);
+    return so;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * WinsockSocketCacheHasRoom --
+ *
+ *    Checks whether a socket cache slot can accept another socket.
+ *
+ * Results:
+ *    Non-zero if there is room, else 0. The result is only a hint as
+ *    the cache may be filled by other threads.
+ *
+ * Side effects:
+ *    None.
+ *
+ *------------------------------------------------------------------------
+ */
+int WinsockSocketCacheHasRoom(int slot)
+{
+    int hasRoom;
+    if (slot < 0 || socketCache.maxSockets == 0)
+        return 0;
+    IocpLockAcquireShared(&socketCache.lock);
+    hasRoom = socketCache.counts[slot] < socketCache.maxSockets;
+    IocpLockReleaseShared(&socketCache.lock);
+    return hasRoom;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * WinsockSocketCachePut --
+ *
+ *    Returns a socket recycled with DisconnectEx(TF_REUSE_SOCKET) to the
+ *    socket cache.
+ *
+ * Results:
+ *    Non-zero if the socket was cached, 0 if the cache was full in which
+ *    case the caller retains ownership of the socket.
+ *
+ * Side effects:
+ *    As above.
+ *
+ *------------------------------------------------------------------------
+ */
+int WinsockSocketCachePut(int slot, SOCKET so)
+{
+    int cached = 0;
+    if (slot < 0 || socketCache.maxSockets == 0)
+        return 0;
+    IocpLockAcquireExclusive(&socketCache.lock);
+    if (socketCache.counts[slot] < socketCache.maxSockets) {
+        socketCache.sockets[slot][socketCache.counts[slot]++] = so;
+        cached = 1;
+    }
+    IocpLockReleaseExclusive(&socketCache.lock);
+    if (cached)
+        IOCP_STATS_INCR_ALWAYS(IocpSocketCachePuts);
+    return cached;
+}
+
+/*
+ *------------------------------------------------------------------------
+ *
+ * WinsockSocketCacheConfigure --
+ *
+ *    Sets the maximum number of sockets held in each socket cache slot.
+ *
+ * Results:
+ *    The previous maximum. If maxSockets is negative, the maximum is
+ *    not changed.
+ *
+ * Side effects:
+ *    Cached sockets in excess of the new maximum are closed.
+ *
+ *------------------------------------------------------------------------
+ */
+int WinsockSocketCacheConfigure(int maxSockets)
+{
+    int     prevMax;
+    int     slot;
+    SOCKET *sockets[IOCP_SOCKET_CACHE_SLOTS];
+
+    (void) Iocp_DoOnce(&socketCacheInitFlag, WinsockSocketCacheInit, NULL);
+    if (maxSockets < 0)
+        return socketCache.maxSockets;
+
+    /* Allocate outside the lock */
+    for (slot = 0; slot < IOCP_SOCKET_CACHE_SLOTS; ++slot) {
+        sockets[slot] = maxSockets ? ckalloc(maxSockets * sizeof(SOCKET)) : NULL;
+    }
+
+    IocpLockAcquireExclusive(&socketCache.lock);
+    prevMax = socketCache.maxSockets;
+    for (slot = 0; slot < IOCP_SOCKET_CACHE_SLOTS; ++slot) {
+        SOCKET *oldSockets = socketCache.sockets[slot];
+        int     i;
+        for (i = 0; i < socketCache.counts[slot]; ++i) {
+            if (i < maxSockets)
+                sockets[slot][i] = oldSockets[i];
+            else
+                closesocket(oldSockets[i]);
+        }
+        if (socketCache.counts[slot] > maxSockets)
+            socketCache.counts[slot] = maxSockets;
+        socketCache.sockets[slot] = sockets[slot];
+        sockets[slot] = oldSockets; /* To be freed below */
+    }
+    socketCache.maxSockets = maxSockets;
+    IocpLockReleaseExclusive(&socketCache.lock);
+
+    for (slot = 0; slot < IOCP_SOCKET_CACHE_SLOTS; ++slot) {
+        if (sockets[slot])
+            ckfree(sockets[slot]);
+    }
+    return prevMax;
+}
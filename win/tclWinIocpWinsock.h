@@ -13,11 +13,22 @@
  * simplifies casting between the different sockaddr types.
  */
 
+/*
+ * Same layout as SOCKADDR_UN from afunix.h which is missing from older
+ * SDKs and MinGW headers.
+ */
+#define IOCP_UNIX_PATH_MAX 108
+typedef struct IocpSockaddrUn {
+    USHORT         sun_family;  /* AF_UNIX */
+    char           sun_path[IOCP_UNIX_PATH_MAX]; /* Null terminated path */
+} IocpSockaddrUn;
+
 typedef union {
     struct sockaddr         sa;
     struct sockaddr_in      sa4;
     struct sockaddr_in6     sa6;
     struct sockaddr_storage sas;
+    IocpSockaddrUn          saun;
 #if IOCP_ENABLE_BLUETOOTH
     SOCKADDR_BTH            sabt;
 #endif
@@ -51,7 +62,17 @@ typedef struct WinsockClient {
             struct addrinfo *locals;  /* List of potential local addresses */
             struct addrinfo *local;   /* Local address in use
                                        * Points into localAddrList */
+            char *initialData;        /* Data sent along with the connect.
+                                       * Retained until connected so it can
+                                       * be resent on retries. May be NULL */
+            int   initialDataLen;     /* Number of bytes in initialData */
         } inet;                       /* AF_INET or AF_INET6 */
+        struct {
+            IocpSockaddr remote;      /* Default destination for writes */
+            int remoteLen;            /* Length of remote. 0 if none */
+            int family;               /* AF_INET or AF_INET6 */
+            int maxDatagram;          /* Size of receive buffers */
+        } udp;                        /* SOCK_DGRAM */
 #if IOCP_ENABLE_BLUETOOTH
         struct {
             SOCKADDR_BTH remote;      /* Remote address */
@@ -62,6 +83,12 @@ typedef struct WinsockClient {
     int flags;                         /* Miscellaneous flags */
 #define IOCP_WINSOCK_HALF_CLOSABLE 0x1 /* Socket support unidirectional close */
 #define IOCP_WINSOCK_AUTHENTICATE  0x2 /* Authenticated connection */
+#define IOCP_WINSOCK_RECYCLED      0x4 /* Socket came from the socket cache
+                                        * and is already associated with the
+                                        * completion port */
+#define IOCP_WINSOCK_FASTOPEN      0x8 /* Use TCP Fast Open on connect */
+    int cacheSlot;              /* Socket cache slot the socket is returned
+                                 * to on disconnect. -1 if not recyclable */
 
 #define IOCP_WINSOCK_MAX_RECEIVES 3
 #define IOCP_WINSOCK_MAX_SENDS    3
@@ -91,6 +118,18 @@ enum IocpWinsockOption {
     IOCP_WINSOCK_OPT_SORCVBUF,
     IOCP_WINSOCK_OPT_KEEPALIVE,
     IOCP_WINSOCK_OPT_NAGLE,
+    IOCP_WINSOCK_OPT_ACCEPTRECEIVE,
+    IOCP_WINSOCK_OPT_ACCEPTRANGE,
+    IOCP_WINSOCK_OPT_FRAMING,
+    IOCP_WINSOCK_OPT_READDELIMITER,
+    IOCP_WINSOCK_OPT_READRECORDS,
+    IOCP_WINSOCK_OPT_RCVLOWAT,
+    IOCP_WINSOCK_OPT_RATELIMIT,
+    IOCP_WINSOCK_OPT_TLS,
+    IOCP_WINSOCK_OPT_TLSSTATUS,
+    IOCP_WINSOCK_OPT_COMPRESS,
+    IOCP_WINSOCK_OPT_COMPRESSSTATS,
+    IOCP_WINSOCK_OPT_PRIORITY,
     IOCP_WINSOCK_OPT_INVALID        /* Must be last */
 };
 extern const char*iocpWinsockOptionNames[];
@@ -108,14 +147,18 @@ IocpTclCode  WinsockClientGetHandle(IocpChannel *lockedChanPtr,
 IocpWinError WinsockClientPostRead(IocpChannel *);
 IocpWinError WinsockClientPostWrite(IocpChannel *, const char *data,
                                     int nbytes, int *countPtr);
+IocpWinError WinsockClientPostBuffer(IocpChannel *, IocpBuffer *bufPtr);
 IocpWinError WinsockClientAsyncConnected(IocpChannel *lockedChanPtr);
 IocpWinError WinsockClientAsyncConnectFailed(IocpChannel *lockedChanPtr);
-void         WinsockClientDisconnected(IocpChannel *lockedChanPtr);
+void         WinsockClientDisconnected(IocpChannel *lockedChanPtr,
+                                       IocpWinError winError);
 IocpWinError WinsockClientTranslateError(IocpChannel *chanPtr,
                                          IocpBuffer *bufPtr);
 IocpWinError WinsockListifyAddress(const IocpSockaddr *addr,
                                    int addr_size, int noRDNS,
                                    Tcl_DString *dsPtr);
+void         WinsockUnixPath(const IocpSockaddr *addrPtr, int addrSize,
+                             char *pathPtr, int pathSize);
 IocpTclCode  WinsockClientGetOption (IocpChannel *lockedChanPtr,
                                      Tcl_Interp *interp, int optIndex,
                                      Tcl_DString *dsPtr);
@@ -123,6 +166,35 @@ IocpTclCode  WinsockClientSetOption (IocpChannel *lockedChanPtr,
                                      Tcl_Interp *interp, int optIndex,
                                      const char *valuePtr);
 
+/*
+ * Process-wide cache of sockets recycled with DisconnectEx(TF_REUSE_SOCKET).
+ * Sockets recycled from AcceptEx and ConnectEx connections are kept apart
+ * since the latter remain bound to their local address.
+ */
+enum WinsockSocketCacheUse {
+    IOCP_SOCKET_CACHE_ACCEPT,
+    IOCP_SOCKET_CACHE_CONNECT
+};
+int    WinsockSocketCacheSlot(int family, enum WinsockSocketCacheUse use);
+SOCKET WinsockSocketCacheGet(int slot);
+int    WinsockSocketCacheHasRoom(int slot);
+int    WinsockSocketCachePut(int slot, SOCKET so);
+int    WinsockSocketCacheConfigure(int maxSockets);
+
+/*
+ * TCP exports
+ */
+Tcl_Channel Iocp_OpenTcpClient(Tcl_Interp *interp, int port, const char *host,
+                               const char *myaddr, int myport, int async,
+                               int fastopen, const char *initialData,
+                               int initialDataLen);
+Tcl_Channel WinsockListenerOpen(Tcl_Interp *interp,
+                                struct addrinfo *localAddrs, int port,
+                                IocpChannelVtbl *clientVtblPtr,
+                                const char *clientPrefix,
+                                Tcl_TcpAcceptProc *acceptProc,
+                                ClientData acceptProcData);
+
 #if IOCP_ENABLE_BLUETOOTH
 /*
  * Bluetooth exports